@@ -0,0 +1,115 @@
+#include "Arena.h"
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+struct ArenaChunk
+{
+	ArenaChunk* next;
+	uint8_t* data;
+	size_t capacity;
+	size_t offset;
+};
+
+static inline uintptr_t alignAddress(uintptr_t address, size_t alignment)
+{
+	return (address + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+}
+
+// Returns the number of bytes needed to fit size bytes in chunk, or 0 if they don't fit
+static inline size_t chunkFit(const ArenaChunk* chunk, size_t size, size_t alignment)
+{
+	uintptr_t base = (uintptr_t)chunk->data + chunk->offset;
+	size_t padding = (size_t)(alignAddress(base, alignment) - base);
+	return chunk->offset + padding + size <= chunk->capacity ? padding + size : 0;
+}
+
+static ArenaChunk* addChunk(size_t capacity)
+{
+	// NOTE: The chunk header and its data come from a single allocation
+	ArenaChunk* chunk = (ArenaChunk*)tf_malloc(sizeof(ArenaChunk) + capacity);
+	ASSERT(chunk);
+	chunk->next = NULL;
+	chunk->data = (uint8_t*)(chunk + 1);
+	chunk->capacity = capacity;
+	chunk->offset = 0;
+	return chunk;
+}
+
+void* Arena::alloc(size_t size, size_t alignment)
+{
+	ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	if (size == 0)
+	{
+		size = 1;
+	}
+
+	// Reuse the chunks left over by a previous reset before adding new ones
+	while (currentChunk && chunkFit(currentChunk, size, alignment) == 0 && currentChunk->next)
+	{
+		usedSize += currentChunk->capacity - currentChunk->offset;
+		currentChunk = currentChunk->next;
+		currentChunk->offset = 0;
+	}
+
+	size_t needed = currentChunk ? chunkFit(currentChunk, size, alignment) : 0;
+	if (needed == 0)
+	{
+		// Oversized allocations get a chunk of their own
+		size_t capacity = size + alignment > chunkSize ? size + alignment : chunkSize;
+		ArenaChunk* chunk = addChunk(capacity);
+		reservedSize += capacity;
+
+		if (currentChunk)
+		{
+			usedSize += currentChunk->capacity - currentChunk->offset;
+			currentChunk->offset = currentChunk->capacity;
+			ASSERT(currentChunk->next == NULL);
+			currentChunk->next = chunk;
+		}
+		else
+		{
+			firstChunk = chunk;
+		}
+
+		currentChunk = chunk;
+		needed = chunkFit(currentChunk, size, alignment);
+		ASSERT(needed > 0);
+	}
+
+	uint8_t* result = currentChunk->data + currentChunk->offset + (needed - size);
+	currentChunk->offset += needed;
+	usedSize += needed;
+	highWaterMark = usedSize > highWaterMark ? usedSize : highWaterMark;
+
+	return result;
+}
+
+void Arena::reset()
+{
+	currentChunk = firstChunk;
+	if (currentChunk)
+	{
+		currentChunk->offset = 0;
+	}
+	usedSize = 0;
+}
+
+void Arena::destroy()
+{
+	ArenaChunk* chunk = firstChunk;
+	while (chunk)
+	{
+		ArenaChunk* next = chunk->next;
+		tf_free(chunk);
+		chunk = next;
+	}
+
+	firstChunk = NULL;
+	currentChunk = NULL;
+	usedSize = 0;
+	reservedSize = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+const size_t k_ArenaDefaultChunkSize = 4 * 1024 * 1024;
+const size_t k_ArenaDefaultAlignment = 16;
+
+struct ArenaChunk;
+
+// Chunked linear allocator for short-lived memory.
+// Allocations are bumped out of the current chunk and a new chunk is added when it runs out of
+// space, so the arena grows as needed. reset() rewinds to the first chunk in O(1) without releasing
+// or clearing memory, destroy() releases every chunk. Memory is NOT zero-initialized.
+struct Arena
+{
+	ArenaChunk* firstChunk = NULL;
+	ArenaChunk* currentChunk = NULL;
+	size_t chunkSize = k_ArenaDefaultChunkSize;
+
+	// Bytes handed out since the last reset (including alignment padding)
+	size_t usedSize = 0;
+	// Bytes held by the chunks
+	size_t reservedSize = 0;
+	// Largest usedSize since the arena was created
+	size_t highWaterMark = 0;
+
+	void* alloc(size_t size, size_t alignment = k_ArenaDefaultAlignment);
+	void reset();
+	void destroy();
+
+	template <typename T>
+	T* allocArray(size_t count)
+	{
+		return (T*)alloc(sizeof(T) * count, alignof(T) > k_ArenaDefaultAlignment ? alignof(T) : k_ArenaDefaultAlignment);
+	}
+};
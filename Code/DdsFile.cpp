@@ -0,0 +1,265 @@
+#include "DdsFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+const char* const k_DdsMipTailMarker = ".mip";
+const char* const k_DdsExtension = ".dds";
+const uint32_t k_DDSMiscFlagTextureCube = 0x4;
+
+// Bytes per 4x4 block of the block-compressed DXGI formats, 0 for the other ones
+static uint32_t dxgiFormatBlockSize(uint32_t dxgiFormat)
+{
+	if (dxgiFormat >= 70 && dxgiFormat <= 72) // BC1
+	{
+		return 8;
+	}
+	if (dxgiFormat >= 73 && dxgiFormat <= 78) // BC2, BC3
+	{
+		return 16;
+	}
+	if (dxgiFormat >= 79 && dxgiFormat <= 81) // BC4
+	{
+		return 8;
+	}
+	if (dxgiFormat >= 82 && dxgiFormat <= 84) // BC5
+	{
+		return 16;
+	}
+	if (dxgiFormat >= 94 && dxgiFormat <= 99) // BC6H, BC7
+	{
+		return 16;
+	}
+	return 0;
+}
+
+static uint32_t fourCCBlockSize(uint32_t fourCC)
+{
+	switch (fourCC)
+	{
+	case k_DDSFourCCDXT1:
+	case k_DDSFourCCATI1:
+		return 8;
+	case k_DDSFourCCDXT3:
+	case k_DDSFourCCDXT5:
+	case k_DDSFourCCATI2:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+bool ParseDdsHeader(const void* data, size_t size, DdsFileInfo* info)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	if (size < sizeof(uint32_t) + sizeof(DDSHeader))
+	{
+		return false;
+	}
+
+	uint32_t magic = 0;
+	memcpy(&magic, bytes, sizeof(magic));
+	DDSHeader header = {};
+	memcpy(&header, bytes + sizeof(magic), sizeof(header));
+	if (magic != k_DDSMagic || header.size != sizeof(DDSHeader) || header.width == 0 || header.height == 0)
+	{
+		return false;
+	}
+
+	if ((header.caps2 & (k_DDSCaps2CubeMap | k_DDSCaps2Volume)) != 0 || (header.pixelFormat.flags & k_DDSPixelFormatFourCC) == 0)
+	{
+		return false;
+	}
+
+	uint32_t headerSize = sizeof(magic) + sizeof(DDSHeader);
+	uint32_t blockSize = 0;
+	if (header.pixelFormat.fourCC == k_DDSFourCCDX10)
+	{
+		if (size < k_DDSMaxHeaderSize)
+		{
+			return false;
+		}
+
+		DDSHeaderDX10 headerDX10 = {};
+		memcpy(&headerDX10, bytes + headerSize, sizeof(headerDX10));
+		if (headerDX10.resourceDimension != k_DDSResourceDimensionTexture2D || headerDX10.arraySize > 1 || (headerDX10.miscFlag & k_DDSMiscFlagTextureCube) != 0)
+		{
+			return false;
+		}
+
+		headerSize += sizeof(DDSHeaderDX10);
+		blockSize = dxgiFormatBlockSize(headerDX10.dxgiFormat);
+	}
+	else
+	{
+		blockSize = fourCCBlockSize(header.pixelFormat.fourCC);
+	}
+
+	if (blockSize == 0)
+	{
+		return false;
+	}
+
+	// NOTE: mipMapCount is only meaningful with k_DDSFlagMipMapCount, some writers leave it at 0
+	uint32_t mipCount = (header.flags & k_DDSFlagMipMapCount) != 0 ? header.mipMapCount : 1;
+	uint32_t fullMipCount = 1;
+	while ((header.width >> fullMipCount) > 0 || (header.height >> fullMipCount) > 0)
+	{
+		fullMipCount++;
+	}
+
+	info->width = header.width;
+	info->height = header.height;
+	info->mipCount = mipCount > 0 ? (mipCount < fullMipCount ? mipCount : fullMipCount) : 1;
+	info->blockSize = blockSize;
+	info->headerSize = headerSize;
+	return info->mipCount <= k_DDSMaxMips;
+}
+
+bool ReadDdsFileInfo(::ResourceDirectory resourceDir, const char* path, DdsFileInfo* info)
+{
+	::FileStream stream = {};
+	if (!::fsOpenStreamFromPath(resourceDir, path, ::FM_READ, &stream))
+	{
+		return false;
+	}
+
+	uint8_t header[k_DDSMaxHeaderSize] = {};
+	const size_t headerBytes = ::fsReadFromStream(&stream, header, sizeof(header));
+	::fsCloseStream(&stream);
+
+	return ParseDdsHeader(header, headerBytes, info);
+}
+
+bool FormatDdsMipTailPath(const char* path, uint32_t firstMip, char* output, size_t capacity)
+{
+	const int length = snprintf(output, capacity, "%s%s%u%s", path, k_DdsMipTailMarker, firstMip, k_DdsExtension);
+	return length > 0 && (size_t)length < capacity;
+}
+
+// Splits a mip tail path into the path of the original file and the first mip.
+// Returns false for the paths of regular files.
+static bool parseDdsMipTailPath(const char* mipTailPath, char* path, size_t capacity, uint32_t* firstMip)
+{
+	const char* marker = NULL;
+	for (const char* found = strstr(mipTailPath, k_DdsMipTailMarker); found; found = strstr(found + 1, k_DdsMipTailMarker))
+	{
+		marker = found;
+	}
+
+	if (!marker)
+	{
+		return false;
+	}
+
+	char* end = NULL;
+	const unsigned long mip = strtoul(marker + strlen(k_DdsMipTailMarker), &end, 10);
+	if (end == marker + strlen(k_DdsMipTailMarker) || strcmp(end, k_DdsExtension) != 0 || mip >= k_DDSMaxMips)
+	{
+		return false;
+	}
+
+	const size_t length = (size_t)(marker - mipTailPath);
+	if (length == 0 || length >= capacity)
+	{
+		return false;
+	}
+
+	memcpy(path, mipTailPath, length);
+	path[length] = '\0';
+	*firstMip = (uint32_t)mip;
+	return true;
+}
+
+// Reads the mips [firstMip, mipCount) of stream into a new DDS file in memory
+static bool readDdsMipTail(::FileStream* stream, const char* path, uint32_t firstMip, ::FileStream* pOut)
+{
+	uint8_t header[k_DDSMaxHeaderSize] = {};
+	const size_t headerBytes = ::fsReadFromStream(stream, header, sizeof(header));
+
+	DdsFileInfo info = {};
+	if (!ParseDdsHeader(header, headerBytes, &info))
+	{
+		LOGF(eERROR, "Couldn't stream the mips of '%s', it isn't a 2D block-compressed DDS file", path);
+		return false;
+	}
+
+	// NOTE(gmodarelli): The smallest mip is always kept, a texture can't lose all its mips
+	const uint32_t mip = firstMip < info.mipCount ? firstMip : info.mipCount - 1;
+	const uint64_t dataSize = GetDdsMipTailSize(info.width, info.height, info.mipCount, info.blockSize, 0);
+	const uint64_t tailSize = GetDdsMipTailSize(info.width, info.height, info.mipCount, info.blockSize, mip);
+	const uint64_t tailOffset = info.headerSize + (dataSize - tailSize);
+	const size_t size = (size_t)(info.headerSize + tailSize);
+
+	uint8_t* data = (uint8_t*)tf_malloc(size);
+	ASSERT(data);
+	memcpy(data, header, info.headerSize);
+
+	if (!::fsSeekStream(stream, ::SBO_START_OF_FILE, (ssize_t)tailOffset) ||
+		::fsReadFromStream(stream, data + info.headerSize, (size_t)tailSize) != (size_t)tailSize)
+	{
+		LOGF(eERROR, "Couldn't read the mips of '%s' starting at mip %u", path, mip);
+		tf_free(data);
+		return false;
+	}
+
+	DDSHeader* ddsHeader = (DDSHeader*)(data + sizeof(uint32_t));
+	ddsHeader->width = info.width >> mip > 0 ? info.width >> mip : 1;
+	ddsHeader->height = info.height >> mip > 0 ? info.height >> mip : 1;
+	ddsHeader->mipMapCount = info.mipCount - mip;
+	ddsHeader->pitchOrLinearSize = (uint32_t)GetDdsMipSize(info.width, info.height, info.blockSize, mip);
+	ddsHeader->flags |= k_DDSFlagMipMapCount | k_DDSFlagLinearSize;
+	if (ddsHeader->mipMapCount == 1)
+	{
+		ddsHeader->caps &= ~(k_DDSCapsComplex | k_DDSCapsMipMap);
+	}
+
+	// NOTE(gmodarelli): The stream owns the buffer and releases it when closed
+	if (!::fsOpenStreamFromMemory(data, size, ::FM_READ, true, pOut))
+	{
+		tf_free(data);
+		return false;
+	}
+
+	return true;
+}
+
+static bool ddsMipTailFileSystemOpen(::IFileSystem* pIO, const ::ResourceDirectory resourceDir, const char* fileName, ::FileMode mode, ::FileStream* pOut)
+{
+	::IFileSystem* baseFileSystem = (::IFileSystem*)pIO->pUser;
+
+	char path[FS_MAX_PATH] = {};
+	uint32_t firstMip = 0;
+	if ((mode & (::FM_WRITE | ::FM_APPEND)) != 0 || !parseDdsMipTailPath(fileName, path, sizeof(path), &firstMip))
+	{
+		return baseFileSystem->Open(baseFileSystem, resourceDir, fileName, mode, pOut);
+	}
+
+	::FileStream stream = {};
+	if (!baseFileSystem->Open(baseFileSystem, resourceDir, path, ::FM_READ, &stream))
+	{
+		return false;
+	}
+
+	const bool success = readDdsMipTail(&stream, path, firstMip, pOut);
+	::fsCloseStream(&stream);
+	return success;
+}
+
+void MountDdsMipTailFileSystem(::IFileSystem* fileSystem, ::IFileSystem* baseFileSystem, ::ResourceDirectory resourceDir, const char* bundledFolder)
+{
+	ASSERT(fileSystem && baseFileSystem && fileSystem != baseFileSystem);
+
+	// NOTE(gmodarelli): Like the pak file system, only Open needs overriding
+	*fileSystem = *baseFileSystem;
+	fileSystem->Open = ddsMipTailFileSystemOpen;
+	fileSystem->pUser = baseFileSystem;
+
+	::fsSetPathForResourceDir(fileSystem, ::RM_CONTENT, resourceDir, bundledFolder);
+}
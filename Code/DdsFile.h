@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The-Forge
+#include <Utilities/Interfaces/IFileSystem.h>
+
+// DDS file layout, see https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+const uint32_t k_DDSMagic = 0x20534444; // "DDS "
+const uint32_t k_DDSFourCCDX10 = 0x30315844; // "DX10"
+const uint32_t k_DDSFourCCDXT1 = 0x31545844; // "DXT1"
+const uint32_t k_DDSFourCCDXT3 = 0x33545844; // "DXT3"
+const uint32_t k_DDSFourCCDXT5 = 0x35545844; // "DXT5"
+const uint32_t k_DDSFourCCATI1 = 0x31495441; // "ATI1"
+const uint32_t k_DDSFourCCATI2 = 0x32495441; // "ATI2"
+const uint32_t k_DDSFlagCaps = 0x1;
+const uint32_t k_DDSFlagHeight = 0x2;
+const uint32_t k_DDSFlagWidth = 0x4;
+const uint32_t k_DDSFlagPixelFormat = 0x1000;
+const uint32_t k_DDSFlagMipMapCount = 0x20000;
+const uint32_t k_DDSFlagLinearSize = 0x80000;
+const uint32_t k_DDSPixelFormatFourCC = 0x4;
+const uint32_t k_DDSCapsComplex = 0x8;
+const uint32_t k_DDSCapsTexture = 0x1000;
+const uint32_t k_DDSCapsMipMap = 0x400000;
+const uint32_t k_DDSCaps2CubeMap = 0x200;
+const uint32_t k_DDSCaps2Volume = 0x200000;
+const uint32_t k_DDSResourceDimensionTexture2D = 3;
+const uint32_t k_DDSMaxMips = 16;
+
+struct DDSPixelFormat
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t rBitMask;
+	uint32_t gBitMask;
+	uint32_t bBitMask;
+	uint32_t aBitMask;
+};
+
+struct DDSHeader
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DDSPixelFormat pixelFormat;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+};
+
+// Largest header: magic, DDSHeader and DDSHeaderDX10
+const uint32_t k_DDSMaxHeaderSize = sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+
+// Block-compressed 2D texture whose mips are stored top-down after the header
+struct DdsFileInfo
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+	// Bytes per 4x4 block
+	uint32_t blockSize;
+	// Bytes before the first mip, including the magic
+	uint32_t headerSize;
+};
+
+// Size in bytes of mip of a block-compressed texture
+inline uint64_t GetDdsMipSize(uint32_t width, uint32_t height, uint32_t blockSize, uint32_t mip)
+{
+	const uint64_t mipWidth = width >> mip > 0 ? width >> mip : 1;
+	const uint64_t mipHeight = height >> mip > 0 ? height >> mip : 1;
+	return ((mipWidth + 3) / 4) * ((mipHeight + 3) / 4) * blockSize;
+}
+
+// Size in bytes of the mips [firstMip, mipCount) of a block-compressed texture
+inline uint64_t GetDdsMipTailSize(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t blockSize, uint32_t firstMip)
+{
+	uint64_t size = 0;
+	for (uint32_t mip = firstMip; mip < mipCount; ++mip)
+	{
+		size += GetDdsMipSize(width, height, blockSize, mip);
+	}
+	return size;
+}
+
+// Parses the header of a DDS file. Only 2D block-compressed textures (BC1 to BC7, DX10 or legacy
+// FourCC headers) without array layers are supported, the other ones return false.
+bool ParseDdsHeader(const void* data, size_t size, DdsFileInfo* info);
+// Reads and parses the header of the DDS file at path, without reading its mips
+bool ReadDdsFileInfo(::ResourceDirectory resourceDir, const char* path, DdsFileInfo* info);
+
+// Name of the virtual DDS file holding the mips [firstMip, mipCount) of the DDS file at path, as
+// served by MountDdsMipTailFileSystem ("Textures/Grid_albedo.dds" -> "Textures/Grid_albedo.dds.mip2.dds")
+bool FormatDdsMipTailPath(const char* path, uint32_t firstMip, char* output, size_t capacity);
+
+// Serves the virtual mip tail files (see FormatDdsMipTailPath) of resourceDir: reads the header and the
+// tail of the original file and patches the header, so the texture loader sees a smaller texture.
+// Every other file is opened with baseFileSystem, which has to outlive the mount.
+// fileSystem is the IFileSystem mounted on resourceDir, it has to stay valid until resourceDir is
+// mounted on another file system.
+void MountDdsMipTailFileSystem(::IFileSystem* fileSystem, ::IFileSystem* baseFileSystem, ::ResourceDirectory resourceDir, const char* bundledFolder);
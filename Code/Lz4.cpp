@@ -0,0 +1,246 @@
+#include "Lz4.h"
+
+#include <string.h>
+
+const uint32_t k_Lz4MinMatch = 4;
+// The last match has to start at least this many bytes before the end of the block...
+const size_t k_Lz4MatchStartLimit = 12;
+// ...and the last bytes of the block are always literals
+const size_t k_Lz4LastLiterals = 5;
+const uint32_t k_Lz4MaxOffset = 65535;
+const uint32_t k_Lz4HashLog = 14;
+
+static inline uint32_t read32(const uint8_t* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static inline uint32_t hashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - k_Lz4HashLog);
+}
+
+// Writes the 255-byte continuation of a literal or match length
+static inline uint8_t* writeLength(uint8_t* op, size_t length)
+{
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (uint8_t)length;
+	return op;
+}
+
+static inline size_t lengthSize(size_t length)
+{
+	return length >= 15 ? (length - 15) / 255 + 1 : 0;
+}
+
+// Writes literals followed by a match. A match length of 0 ends the block.
+static uint8_t* writeSequence(uint8_t* op, const uint8_t* opEnd, const uint8_t* literals, size_t literalLength, uint32_t offset, size_t matchLength)
+{
+	const size_t matchCode = matchLength > 0 ? matchLength - k_Lz4MinMatch : 0;
+	size_t size = 1 + lengthSize(literalLength) + literalLength;
+	if (matchLength > 0)
+	{
+		size += 2 + lengthSize(matchCode);
+	}
+	if ((size_t)(opEnd - op) < size)
+	{
+		return NULL;
+	}
+
+	uint8_t* token = op++;
+	*token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+	if (literalLength >= 15)
+	{
+		op = writeLength(op, literalLength - 15);
+	}
+	// NOTE: Empty blocks have no literals and may come with a NULL source
+	if (literalLength > 0)
+	{
+		memcpy(op, literals, literalLength);
+		op += literalLength;
+	}
+
+	if (matchLength > 0)
+	{
+		*op++ = (uint8_t)(offset & 0xFF);
+		*op++ = (uint8_t)(offset >> 8);
+		*token |= (uint8_t)(matchCode >= 15 ? 15 : matchCode);
+		if (matchCode >= 15)
+		{
+			op = writeLength(op, matchCode - 15);
+		}
+	}
+
+	return op;
+}
+
+size_t Lz4CompressBlock(const void* src, size_t srcSize, void* dst, size_t dstCapacity)
+{
+	const uint8_t* input = (const uint8_t*)src;
+	uint8_t* op = (uint8_t*)dst;
+	uint8_t* opEnd = op + dstCapacity;
+
+	// NOTE(gmodarelli): Positions are stored relative to the start of the block, UINT32_MAX is empty
+	uint32_t hashTable[1 << k_Lz4HashLog];
+	memset(hashTable, 0xFF, sizeof(hashTable));
+
+	size_t anchor = 0;
+	if (srcSize > k_Lz4MatchStartLimit)
+	{
+		const size_t matchStartLimit = srcSize - k_Lz4MatchStartLimit;
+		const size_t matchEndLimit = srcSize - k_Lz4LastLiterals;
+
+		size_t ip = 0;
+		while (ip < matchStartLimit)
+		{
+			const uint32_t sequence = read32(input + ip);
+			const uint32_t hash = hashSequence(sequence);
+			const uint32_t candidate = hashTable[hash];
+			hashTable[hash] = (uint32_t)ip;
+
+			if (candidate == UINT32_MAX || ip - candidate > k_Lz4MaxOffset || read32(input + candidate) != sequence)
+			{
+				ip++;
+				continue;
+			}
+
+			// Extend the match backwards over the pending literals, then forwards
+			size_t matchStart = ip;
+			size_t reference = candidate;
+			while (matchStart > anchor && reference > 0 && input[matchStart - 1] == input[reference - 1])
+			{
+				matchStart--;
+				reference--;
+			}
+
+			size_t matchEnd = ip + k_Lz4MinMatch;
+			while (matchEnd < matchEndLimit && input[matchEnd] == input[candidate + (matchEnd - ip)])
+			{
+				matchEnd++;
+			}
+
+			op = writeSequence(op, opEnd, input + anchor, matchStart - anchor, (uint32_t)(matchStart - reference), matchEnd - matchStart);
+			if (!op)
+			{
+				return 0;
+			}
+
+			anchor = matchEnd;
+			ip = matchEnd;
+
+			// Keep the positions skipped by the match reachable
+			if (ip - 2 < matchStartLimit)
+			{
+				hashTable[hashSequence(read32(input + ip - 2))] = (uint32_t)(ip - 2);
+			}
+		}
+	}
+
+	op = writeSequence(op, opEnd, input + anchor, srcSize - anchor, 0, 0);
+	if (!op)
+	{
+		return 0;
+	}
+
+	return (size_t)(op - (uint8_t*)dst);
+}
+
+bool Lz4DecompressBlock(const void* src, size_t srcSize, void* dst, size_t dstSize)
+{
+	const uint8_t* ip = (const uint8_t*)src;
+	const uint8_t* ipEnd = ip + srcSize;
+	uint8_t* op = (uint8_t*)dst;
+	uint8_t* opEnd = op + dstSize;
+
+	while (ip < ipEnd)
+	{
+		const uint8_t token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15)
+		{
+			uint8_t byte;
+			do
+			{
+				if (ip >= ipEnd)
+				{
+					return false;
+				}
+				byte = *ip++;
+				literalLength += byte;
+			} while (byte == 255);
+		}
+
+		if ((size_t)(ipEnd - ip) < literalLength || (size_t)(opEnd - op) < literalLength)
+		{
+			return false;
+		}
+		if (literalLength > 0)
+		{
+			memcpy(op, ip, literalLength);
+			ip += literalLength;
+			op += literalLength;
+		}
+
+		// The last sequence only has literals
+		if (ip == ipEnd)
+		{
+			return op == opEnd;
+		}
+
+		if (ipEnd - ip < 2)
+		{
+			return false;
+		}
+		const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - (uint8_t*)dst))
+		{
+			return false;
+		}
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15)
+		{
+			uint8_t byte;
+			do
+			{
+				if (ip >= ipEnd)
+				{
+					return false;
+				}
+				byte = *ip++;
+				matchLength += byte;
+			} while (byte == 255);
+		}
+		matchLength += k_Lz4MinMatch;
+
+		if ((size_t)(opEnd - op) < matchLength)
+		{
+			return false;
+		}
+
+		// Matches can overlap their own output (offset < length repeats a pattern)
+		const uint8_t* match = op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(op, match, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			for (size_t i = 0; i < matchLength; ++i)
+			{
+				*op++ = match[i];
+			}
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Encoder and decoder of the LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+// Blocks are interchangeable with LZ4_compress_default/LZ4_decompress_safe. The encoder is a greedy
+// single-probe one, tuned for small code rather than for ratio: it's only run by the cookers.
+
+// Worst case size of a compressed block
+inline size_t Lz4CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+// Returns the size of the compressed block, or 0 if it doesn't fit in dstCapacity bytes
+size_t Lz4CompressBlock(const void* src, size_t srcSize, void* dst, size_t dstCapacity);
+
+// Decompresses a block of exactly dstSize bytes. Returns false if the block is malformed.
+bool Lz4DecompressBlock(const void* src, size_t srcSize, void* dst, size_t dstSize);
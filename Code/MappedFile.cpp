@@ -0,0 +1,93 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MapFile(const char* path, MappedFile* mappedFile)
+{
+	*mappedFile = {};
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const char* data = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (!data)
+	{
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+
+	mappedFile->file = file;
+	mappedFile->mapping = mapping;
+	mappedFile->data = data;
+	mappedFile->size = (uint64_t)size.QuadPart;
+#else
+	mappedFile->file = open(path, O_RDONLY);
+	if (mappedFile->file < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat = {};
+	if (fstat(mappedFile->file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(mappedFile->file);
+		*mappedFile = {};
+		return false;
+	}
+
+	void* data = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, mappedFile->file, 0);
+	if (data == MAP_FAILED)
+	{
+		close(mappedFile->file);
+		*mappedFile = {};
+		return false;
+	}
+	madvise(data, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+	mappedFile->data = (const char*)data;
+	mappedFile->size = (uint64_t)fileStat.st_size;
+#endif
+
+	return true;
+}
+
+void UnmapFile(MappedFile* mappedFile)
+{
+	if (!mappedFile->data)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile(mappedFile->data);
+	CloseHandle((HANDLE)mappedFile->mapping);
+	CloseHandle((HANDLE)mappedFile->file);
+#else
+	munmap((void*)mappedFile->data, (size_t)mappedFile->size);
+	close(mappedFile->file);
+#endif
+	*mappedFile = {};
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Read-only mapping of a whole file
+struct MappedFile
+{
+	const char* data = NULL;
+	uint64_t size = 0;
+#if defined(_WIN32)
+	// HANDLEs of the file and of its mapping
+	void* file = NULL;
+	void* mapping = NULL;
+#else
+	int file = -1;
+#endif
+};
+
+// Maps a file for sequential reads. Fails on empty files.
+bool MapFile(const char* path, MappedFile* mappedFile);
+void UnmapFile(MappedFile* mappedFile);
@@ -0,0 +1,248 @@
+#include "MaterialFile.h"
+
+#include "Hash.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+MaterialParameters GetDefaultMaterialParameters()
+{
+	MaterialParameters parameters = {};
+	parameters.baseColor[0] = 1.0f;
+	parameters.baseColor[1] = 1.0f;
+	parameters.baseColor[2] = 1.0f;
+	parameters.baseColor[3] = 1.0f;
+	parameters.normalIntensity = 1.0f;
+	parameters.occlusionFactor = 1.0f;
+	parameters.roughnessFactor = 1.0f;
+	parameters.metalnessFactor = 0.0f;
+	parameters.emissiveFactor = 0.0f;
+	parameters.reflectance = 0.5f;
+	parameters.uv0Tiling[0] = 1.0f;
+	parameters.uv0Tiling[1] = 1.0f;
+	return parameters;
+}
+
+uint64_t HashMaterialContent(const MaterialParameters& parameters, const char* const* texturePaths)
+{
+	uint64_t hash = HashBytes(&parameters, sizeof(MaterialParameters), 0);
+	for (uint32_t i = 0; i < (uint32_t)MaterialFileTexture::_Count; ++i)
+	{
+		const char* path = texturePaths[i] ? texturePaths[i] : "";
+
+		char normalizedPath[FS_MAX_PATH] = {};
+		size_t length = 0;
+		for (; path[length] != '\0' && length + 1 < sizeof(normalizedPath); ++length)
+		{
+			const char c = path[length];
+			normalizedPath[length] = c == '\\' ? '/' : (c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c);
+		}
+
+		// NOTE: The slot is hashed too, so the same texture in another slot makes another material
+		hash = HashBytes(&i, sizeof(i), hash);
+		hash = HashBytes(normalizedPath, length, hash);
+	}
+	return hash;
+}
+
+// Appends a null-terminated string to the strings of a material file and returns its offset
+static uint32_t appendString(char* strings, uint64_t* stringsSize, const char* string)
+{
+	const size_t size = strlen(string) + 1;
+	const uint32_t offset = (uint32_t)*stringsSize;
+	memcpy(strings + offset, string, size);
+	*stringsSize += size;
+	return offset;
+}
+
+bool WriteMaterialFile(const char* path, const MaterialDesc* materials, uint32_t materialCount, uint32_t* uniqueMaterialCount)
+{
+	// Every string is stored at most once per material
+	uint64_t stringsCapacity = 0;
+	for (uint32_t i = 0; i < materialCount; ++i)
+	{
+		stringsCapacity += strlen(materials[i].name) + 1;
+		for (uint32_t slot = 0; slot < (uint32_t)MaterialFileTexture::_Count; ++slot)
+		{
+			stringsCapacity += materials[i].texturePaths[slot] ? strlen(materials[i].texturePaths[slot]) + 1 : 0;
+		}
+	}
+
+	MaterialFileMaterial* fileMaterials = (MaterialFileMaterial*)tf_malloc(sizeof(MaterialFileMaterial) * TF_MAX(materialCount, 1u));
+	MaterialFileName* fileNames = (MaterialFileName*)tf_malloc(sizeof(MaterialFileName) * TF_MAX(materialCount, 1u));
+	uint64_t* nameHashes = (uint64_t*)tf_malloc(sizeof(uint64_t) * TF_MAX(materialCount, 1u));
+	char* strings = (char*)tf_malloc((size_t)TF_MAX(stringsCapacity, 1ull));
+	ASSERT(fileMaterials && fileNames && nameHashes && strings);
+
+	bool success = true;
+	uint32_t fileMaterialCount = 0;
+	uint64_t stringsSize = 0;
+	for (uint32_t i = 0; i < materialCount && success; ++i)
+	{
+		const MaterialDesc& material = materials[i];
+
+		nameHashes[i] = HashBytes(material.name, strlen(material.name), 0);
+		for (uint32_t j = 0; j < i; ++j)
+		{
+			if (nameHashes[j] == nameHashes[i] && strcmp(materials[j].name, material.name) == 0)
+			{
+				LOGF(eERROR, "Material '%s' is defined more than once", material.name);
+				success = false;
+			}
+		}
+
+		// NOTE(gmodarelli): Materials are few, a linear scan is enough to find identical ones
+		const uint64_t contentHash = HashMaterialContent(material.parameters, material.texturePaths);
+		uint32_t materialIndex = 0;
+		while (materialIndex < fileMaterialCount && fileMaterials[materialIndex].contentHash != contentHash)
+		{
+			materialIndex++;
+		}
+
+		if (materialIndex == fileMaterialCount)
+		{
+			MaterialFileMaterial* fileMaterial = &fileMaterials[fileMaterialCount++];
+			fileMaterial->contentHash = contentHash;
+			fileMaterial->parameters = material.parameters;
+			for (uint32_t slot = 0; slot < (uint32_t)MaterialFileTexture::_Count; ++slot)
+			{
+				fileMaterial->textureOffsets[slot] = material.texturePaths[slot] ? appendString(strings, &stringsSize, material.texturePaths[slot]) : k_MaterialFileNoTexture;
+			}
+		}
+
+		fileNames[i].nameOffset = appendString(strings, &stringsSize, material.name);
+		fileNames[i].materialIndex = materialIndex;
+	}
+
+	MaterialFileHeader header = {};
+	header.magic = k_MaterialFileMagic;
+	header.version = k_MaterialFileVersion;
+	header.materialCount = fileMaterialCount;
+	header.nameCount = materialCount;
+	header.materialsOffset = sizeof(MaterialFileHeader);
+	header.namesOffset = header.materialsOffset + sizeof(MaterialFileMaterial) * (uint64_t)fileMaterialCount;
+	header.stringsOffset = header.namesOffset + sizeof(MaterialFileName) * (uint64_t)materialCount;
+	header.stringsSize = stringsSize;
+
+	FILE* file = success ? fopen(path, "wb") : NULL;
+	if (success && !file)
+	{
+		LOGF(eERROR, "Couldn't open '%s' for writing", path);
+		success = false;
+	}
+
+	if (file)
+	{
+		success = fwrite(&header, sizeof(MaterialFileHeader), 1, file) == 1;
+		success = success && fwrite(fileMaterials, sizeof(MaterialFileMaterial), fileMaterialCount, file) == fileMaterialCount;
+		success = success && fwrite(fileNames, sizeof(MaterialFileName), materialCount, file) == materialCount;
+		success = success && fwrite(strings, 1, (size_t)stringsSize, file) == (size_t)stringsSize;
+		success = fclose(file) == 0 && success;
+
+		if (!success)
+		{
+			LOGF(eERROR, "Couldn't write material file '%s'", path);
+			remove(path);
+		}
+	}
+
+	tf_free(fileMaterials);
+	tf_free(fileNames);
+	tf_free(nameHashes);
+	tf_free(strings);
+
+	*uniqueMaterialCount = fileMaterialCount;
+	return success;
+}
+
+bool OpenMaterialFile(::ResourceDirectory resourceDir, const char* fileName, MaterialFile* materialFile)
+{
+	*materialFile = {};
+
+	if (!::fsOpenStreamFromPath(resourceDir, fileName, ::FM_READ, &materialFile->stream))
+	{
+		return false;
+	}
+
+	size_t size = 0;
+	const void* data = NULL;
+	if (!::fsStreamMemoryMap(&materialFile->stream, &size, &data))
+	{
+		LOGF(eERROR, "Couldn't memory-map material file '%s'", fileName);
+		CloseMaterialFile(materialFile);
+		return false;
+	}
+
+	const MaterialFileHeader* header = (const MaterialFileHeader*)data;
+	if (size < sizeof(MaterialFileHeader) || header->magic != k_MaterialFileMagic)
+	{
+		LOGF(eERROR, "'%s' is not a material file", fileName);
+		CloseMaterialFile(materialFile);
+		return false;
+	}
+
+	if (header->version != k_MaterialFileVersion)
+	{
+		LOGF(eWARNING, "Material file '%s' is out of date (version %u, expected %u), it needs to be cooked again", fileName, header->version, k_MaterialFileVersion);
+		CloseMaterialFile(materialFile);
+		return false;
+	}
+
+	if (header->materialsOffset + sizeof(MaterialFileMaterial) * (uint64_t)header->materialCount > size ||
+		header->namesOffset + sizeof(MaterialFileName) * (uint64_t)header->nameCount > size ||
+		header->stringsOffset + header->stringsSize > size ||
+		(header->stringsSize > 0 && ((const char*)data)[header->stringsOffset + header->stringsSize - 1] != '\0'))
+	{
+		LOGF(eERROR, "Material file '%s' is truncated", fileName);
+		CloseMaterialFile(materialFile);
+		return false;
+	}
+
+	materialFile->header = header;
+	materialFile->materials = (const MaterialFileMaterial*)((const uint8_t*)data + header->materialsOffset);
+	materialFile->names = (const MaterialFileName*)((const uint8_t*)data + header->namesOffset);
+	materialFile->strings = (const char*)data + header->stringsOffset;
+
+	// NOTE: Offsets are checked once here, so the accessors can trust them
+	for (uint32_t i = 0; i < header->nameCount; ++i)
+	{
+		if (materialFile->names[i].nameOffset >= header->stringsSize || materialFile->names[i].materialIndex >= header->materialCount)
+		{
+			LOGF(eERROR, "Material file '%s' is corrupted", fileName);
+			CloseMaterialFile(materialFile);
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header->materialCount; ++i)
+	{
+		for (uint32_t slot = 0; slot < (uint32_t)MaterialFileTexture::_Count; ++slot)
+		{
+			const uint32_t offset = materialFile->materials[i].textureOffsets[slot];
+			if (offset != k_MaterialFileNoTexture && offset >= header->stringsSize)
+			{
+				LOGF(eERROR, "Material file '%s' is corrupted", fileName);
+				CloseMaterialFile(materialFile);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void CloseMaterialFile(MaterialFile* materialFile)
+{
+	::fsCloseStream(&materialFile->stream);
+	*materialFile = {};
+}
+
+const char* GetMaterialFileTexturePath(const MaterialFile* materialFile, const MaterialFileMaterial* material, MaterialFileTexture texture)
+{
+	const uint32_t offset = material->textureOffsets[(uint32_t)texture];
+	return offset != k_MaterialFileNoTexture ? materialFile->strings + offset : NULL;
+}
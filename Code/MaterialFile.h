@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The-Forge
+#include <Utilities/Interfaces/IFileSystem.h>
+
+// Cooked material library (*.matlib), written by the MaterialCooker and memory-mapped at runtime.
+//
+// Layout:
+//   MaterialFileHeader
+//   MaterialFileMaterial[materialCount]    at materialsOffset
+//   MaterialFileName[nameCount]            at namesOffset, in the order of the source library
+//   char[stringsSize]                      at stringsOffset, null-terminated names and texture paths
+//
+// Materials are unique: names of materials with the same parameters and textures point to the same
+// material. Texture paths are relative to the content directory, like the ones of the pak files.
+
+const uint32_t k_MaterialFileMagic = 0x4C54414D; // "MATL"
+// NOTE: Bump this every time the layout of the file changes
+const uint32_t k_MaterialFileVersion = 1;
+const uint32_t k_MaterialFileNoTexture = UINT32_MAX;
+
+// NOTE: Keep in sync with MaterialTextureSlot in Code/Renderer.cpp
+enum class MaterialFileTexture
+{
+	Albedo = 0,
+	Normal,
+	Orm,
+	Emissive,
+
+	_Count,
+};
+
+// Values of GPUMaterial that don't depend on the textures
+struct MaterialParameters
+{
+	float baseColor[4];
+	float normalIntensity;
+	float occlusionFactor;
+	float roughnessFactor;
+	float metalnessFactor;
+	float emissiveFactor;
+	float reflectance;
+	float uv0Tiling[2];
+};
+
+struct MaterialFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t materialCount;
+	uint32_t nameCount;
+	uint64_t materialsOffset;
+	uint64_t namesOffset;
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+};
+
+struct MaterialFileMaterial
+{
+	// HashMaterialContent of the material, used to deduplicate materials across libraries
+	uint64_t contentHash;
+	MaterialParameters parameters;
+	// Offsets of the texture paths in the strings, k_MaterialFileNoTexture for the slots without texture
+	uint32_t textureOffsets[(uint32_t)MaterialFileTexture::_Count];
+};
+
+struct MaterialFileName
+{
+	uint32_t nameOffset;
+	uint32_t materialIndex;
+};
+
+struct MaterialFile
+{
+	::FileStream stream = {};
+	const MaterialFileHeader* header = NULL;
+	const MaterialFileMaterial* materials = NULL;
+	const MaterialFileName* names = NULL;
+	const char* strings = NULL;
+};
+
+// Material of a source library, as parsed by the MaterialCooker
+struct MaterialDesc
+{
+	const char* name;
+	MaterialParameters parameters;
+	// NULL for the slots without texture
+	const char* texturePaths[(uint32_t)MaterialFileTexture::_Count];
+};
+
+// Default parameters, the ones a material gets for the values its source doesn't set
+MaterialParameters GetDefaultMaterialParameters();
+
+// Hashes the parameters and the texture paths of a material, ignoring case and slashes in the paths
+uint64_t HashMaterialContent(const MaterialParameters& parameters, const char* const* texturePaths);
+
+// Writes a material library, deduplicating the materials by content. Fails on duplicated names.
+bool WriteMaterialFile(const char* path, const MaterialDesc* materials, uint32_t materialCount, uint32_t* uniqueMaterialCount);
+
+// Memory-maps a material library. The mapping stays valid until CloseMaterialFile is called.
+bool OpenMaterialFile(::ResourceDirectory resourceDir, const char* fileName, MaterialFile* materialFile);
+void CloseMaterialFile(MaterialFile* materialFile);
+
+// Texture path of a slot of a material, NULL without texture
+const char* GetMaterialFileTexturePath(const MaterialFile* materialFile, const MaterialFileMaterial* material, MaterialFileTexture texture);
@@ -0,0 +1,173 @@
+#include "MeshCache.h"
+#include "Hash.h"
+#include "VertexPacking.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IThread.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+const size_t k_MeshCacheReadChunkSize = 1024 * 1024;
+
+// Everything that changes the output of ImportMesh besides the source file
+struct MeshImportSettings
+{
+	uint32_t meshFileVersion;
+	uint32_t vertexLayoutVersion;
+	uint32_t vertexStride;
+	uint32_t meshletMaxVertices;
+	uint32_t meshletMaxTriangles;
+	float meshletConeWeight;
+	float lodTargetRatio;
+	float lodMaxError;
+	uint32_t maxLods;
+	uint32_t index16MaxVertices;
+	float packedNormalMaxError;
+	float packedTangentMaxError;
+};
+
+static bool createDirectory(const char* path)
+{
+#if defined(_WIN32)
+	return _mkdir(path) == 0 || errno == EEXIST;
+#else
+	return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+// Creates every directory of path, like mkdir -p
+static bool createDirectories(const char* path)
+{
+	char partial[FS_MAX_PATH] = {};
+	size_t length = strlen(path);
+	if (length >= sizeof(partial))
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i <= length; ++i)
+	{
+		if (i > 0 && (path[i] == '/' || path[i] == '\\' || path[i] == '\0'))
+		{
+			memcpy(partial, path, i);
+			partial[i] = '\0';
+			if (!createDirectory(partial))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool ComputeMeshImportKey(const char* sourcePath, uint64_t* key)
+{
+	MeshImportSettings settings = {};
+	settings.meshFileVersion = k_MeshFileVersion;
+	settings.vertexLayoutVersion = k_MeshVertexLayoutVersion;
+	settings.vertexStride = sizeof(MeshVertex);
+	settings.meshletMaxVertices = k_MeshletMaxVertices;
+	settings.meshletMaxTriangles = k_MeshletMaxTriangles;
+	settings.meshletConeWeight = k_MeshletConeWeight;
+	settings.lodTargetRatio = k_MeshLodTargetRatio;
+	settings.lodMaxError = k_MeshLodMaxError;
+	settings.maxLods = MESH_MAX_LODS;
+	settings.index16MaxVertices = MESH_INDEX16_MAX_VERTICES;
+	settings.packedNormalMaxError = k_PackedNormalMaxError;
+	settings.packedTangentMaxError = k_PackedTangentMaxError;
+
+	FILE* file = fopen(sourcePath, "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	// NOTE(gmodarelli): The file is hashed in fixed-size chunks, each one seeded with the hash so far,
+	// so the key only depends on the content and never on how much of it fits in memory
+	uint64_t hash = HashBytes(&settings, sizeof(settings), 0);
+	uint8_t* chunk = (uint8_t*)tf_malloc(k_MeshCacheReadChunkSize);
+	ASSERT(chunk);
+
+	bool success = true;
+	while (true)
+	{
+		size_t readSize = fread(chunk, 1, k_MeshCacheReadChunkSize, file);
+		if (readSize > 0)
+		{
+			hash = HashBytes(chunk, readSize, hash);
+		}
+
+		if (readSize < k_MeshCacheReadChunkSize)
+		{
+			success = ferror(file) == 0;
+			break;
+		}
+	}
+
+	tf_free(chunk);
+	fclose(file);
+
+	if (!success)
+	{
+		LOGF(eERROR, "Couldn't read '%s' while hashing it", sourcePath);
+		return false;
+	}
+
+	*key = hash;
+	return true;
+}
+
+void GetMeshCachePath(uint64_t key, char* path, size_t pathSize)
+{
+	snprintf(path, pathSize, "%s/%016llx.mesh", k_MeshCacheDirectory, (unsigned long long)key);
+}
+
+bool OpenCachedMesh(uint64_t key, MeshFile* meshFile)
+{
+	char path[FS_MAX_PATH] = {};
+	GetMeshCachePath(key, path, sizeof(path));
+	return OpenMeshFileFromPath(path, meshFile);
+}
+
+bool StoreCachedMesh(uint64_t key, const ImportedMesh* importedMesh)
+{
+	if (!createDirectories(k_MeshCacheDirectory))
+	{
+		LOGF(eWARNING, "Couldn't create the mesh cache directory '%s'", k_MeshCacheDirectory);
+		return false;
+	}
+
+	char path[FS_MAX_PATH] = {};
+	char temporaryPath[FS_MAX_PATH] = {};
+	GetMeshCachePath(key, path, sizeof(path));
+	// NOTE: Import workers can store the same key at the same time, so each one writes its own file
+	snprintf(temporaryPath, sizeof(temporaryPath), "%s.%llx.tmp", path, (unsigned long long)::getCurrentThreadID());
+
+	if (!WriteMeshFile(temporaryPath, &importedMesh->geometry, &importedMesh->mesh))
+	{
+		return false;
+	}
+
+#if defined(_WIN32)
+	// NOTE: rename doesn't replace existing files on Windows
+	remove(path);
+#endif
+	if (rename(temporaryPath, path) != 0)
+	{
+		remove(temporaryPath);
+	}
+
+	return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "MeshFile.h"
+
+// Content-hash cache of imported meshes.
+//
+// Imported meshes are stored as mesh files in k_MeshCacheDirectory, named after a 64-bit key made of
+// the bytes of the source OBJ, the import settings (meshlet and LOD limits, packing precision) and
+// the MeshVertex layout version. A mesh that didn't change since its last import is loaded from the
+// cache instead of going through the parse/tangent/remap/optimize pipeline again.
+//
+// Nothing is ever evicted, deleting the directory is always safe.
+
+const char* const k_MeshCacheDirectory = "Cache/Meshes";
+
+// Hashes the source file and the import settings. Returns false if the file can't be read.
+bool ComputeMeshImportKey(const char* sourcePath, uint64_t* key);
+
+void GetMeshCachePath(uint64_t key, char* path, size_t pathSize);
+
+// Opens the cached mesh for key, if any. Close it with CloseMeshFile.
+bool OpenCachedMesh(uint64_t key, MeshFile* meshFile);
+
+// Writes an imported mesh to the cache. The file is written under a temporary name and then renamed,
+// so concurrent writers of the same key never expose a partial file.
+bool StoreCachedMesh(uint64_t key, const ImportedMesh* importedMesh);
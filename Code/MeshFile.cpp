@@ -0,0 +1,387 @@
+#include "MeshFile.h"
+
+#include <stdio.h>
+
+// meshoptimizer
+#include <meshoptimizer.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+static inline uint64_t alignOffset(uint64_t offset)
+{
+	return (offset + (k_MeshFileAlignment - 1)) & ~(uint64_t)(k_MeshFileAlignment - 1);
+}
+
+static bool writePadding(FILE* file, uint64_t from, uint64_t to)
+{
+	static const uint8_t zeros[k_MeshFileAlignment] = {};
+	ASSERT(to - from <= k_MeshFileAlignment);
+	return fwrite(zeros, 1, (size_t)(to - from), file) == (size_t)(to - from);
+}
+
+bool WriteMeshFile(const char* path, const RendererGeometry* geometry, const GPUMesh* gpuMesh)
+{
+	ASSERT(gpuMesh->vertexOffset + gpuMesh->vertexCount <= geometry->vertexCount);
+	ASSERT(gpuMesh->indexOffset + gpuMesh->indexCount <= geometry->indexCount);
+	ASSERT(gpuMesh->meshletOffset + gpuMesh->meshletCount <= geometry->meshletCount);
+	ASSERT(gpuMesh->submeshOffset + gpuMesh->submeshCount <= geometry->submeshCount);
+
+	// Meshlet offsets are mesh-local, so the last meshlet tells how many vertices and triangles the mesh uses
+	uint32_t meshletVertexCount = 0;
+	uint32_t meshletTriangleCount = 0;
+	if (gpuMesh->meshletCount > 0)
+	{
+		const GPUMeshlet& lastMeshlet = geometry->meshlets[gpuMesh->meshletOffset + gpuMesh->meshletCount - 1];
+		meshletVertexCount = lastMeshlet.vertexOffset + lastMeshlet.vertexCount;
+		meshletTriangleCount = lastMeshlet.triangleOffset + lastMeshlet.triangleCount;
+	}
+
+	// Split the vertices into the position and attribute streams and encode them with the indices
+	float3* positions = (float3*)tf_malloc(sizeof(float3) * TF_MAX(gpuMesh->vertexCount, 1u));
+	MeshVertexAttributes* attributes = (MeshVertexAttributes*)tf_malloc(sizeof(MeshVertexAttributes) * TF_MAX(gpuMesh->vertexCount, 1u));
+	ASSERT(positions && attributes);
+	for (uint32_t i = 0; i < gpuMesh->vertexCount; ++i)
+	{
+		const MeshVertex& vertex = geometry->vertices[gpuMesh->vertexOffset + i];
+		positions[i] = vertex.position;
+		attributes[i].normal = vertex.normal;
+		attributes[i].tangent = vertex.tangent;
+		attributes[i].uv = vertex.uv;
+		attributes[i].color = vertex.color;
+	}
+
+	size_t positionBufferBound = meshopt_encodeVertexBufferBound(gpuMesh->vertexCount, sizeof(float3));
+	size_t attributeBufferBound = meshopt_encodeVertexBufferBound(gpuMesh->vertexCount, sizeof(MeshVertexAttributes));
+	size_t indexBufferBound = meshopt_encodeIndexBufferBound(gpuMesh->indexCount, gpuMesh->vertexCount);
+	uint8_t* encodedPositions = (uint8_t*)tf_malloc(positionBufferBound);
+	uint8_t* encodedAttributes = (uint8_t*)tf_malloc(attributeBufferBound);
+	uint8_t* encodedIndices = (uint8_t*)tf_malloc(indexBufferBound);
+	ASSERT(encodedPositions && encodedAttributes && encodedIndices);
+
+	size_t positionDataSize = meshopt_encodeVertexBuffer(encodedPositions, positionBufferBound, positions, gpuMesh->vertexCount, sizeof(float3));
+	size_t attributeDataSize = meshopt_encodeVertexBuffer(encodedAttributes, attributeBufferBound, attributes, gpuMesh->vertexCount, sizeof(MeshVertexAttributes));
+	size_t indexDataSize = meshopt_encodeIndexBuffer(encodedIndices, indexBufferBound, &geometry->indices[gpuMesh->indexOffset], gpuMesh->indexCount);
+	ASSERT(positionDataSize > 0 && attributeDataSize > 0 && indexDataSize > 0);
+	tf_free(positions);
+	tf_free(attributes);
+
+	MeshFileHeader header = {};
+	header.magic = k_MeshFileMagic;
+	header.version = k_MeshFileVersion;
+	header.positionStride = sizeof(float3);
+	header.attributeStride = sizeof(MeshVertexAttributes);
+	header.vertexCount = gpuMesh->vertexCount;
+	header.indexCount = gpuMesh->indexCount;
+	header.aabbMin[0] = gpuMesh->aabbMin.x;
+	header.aabbMin[1] = gpuMesh->aabbMin.y;
+	header.aabbMin[2] = gpuMesh->aabbMin.z;
+	header.aabbMax[0] = gpuMesh->aabbMax.x;
+	header.aabbMax[1] = gpuMesh->aabbMax.y;
+	header.aabbMax[2] = gpuMesh->aabbMax.z;
+	header.indexSize = gpuMesh->indexSize;
+	header.positionDataOffset = alignOffset(sizeof(MeshFileHeader));
+	header.positionDataSize = positionDataSize;
+	header.attributeDataOffset = alignOffset(header.positionDataOffset + header.positionDataSize);
+	header.attributeDataSize = attributeDataSize;
+	header.indexDataOffset = alignOffset(header.attributeDataOffset + header.attributeDataSize);
+	header.indexDataSize = indexDataSize;
+	header.lodCount = gpuMesh->lodCount;
+	header.contentHash = HashMeshGeometry(geometry, gpuMesh);
+	memcpy(header.lods, gpuMesh->lods, sizeof(header.lods));
+	header.meshletCount = gpuMesh->meshletCount;
+	header.meshletVertexCount = meshletVertexCount;
+	header.meshletTriangleCount = meshletTriangleCount;
+	header.meshletDataOffset = alignOffset(header.indexDataOffset + header.indexDataSize);
+	header.meshletVertexDataOffset = alignOffset(header.meshletDataOffset + sizeof(GPUMeshlet) * (uint64_t)header.meshletCount);
+	header.meshletTriangleDataOffset = alignOffset(header.meshletVertexDataOffset + sizeof(uint32_t) * (uint64_t)header.meshletVertexCount);
+	header.submeshCount = gpuMesh->submeshCount;
+	header.submeshDataOffset = alignOffset(header.meshletTriangleDataOffset + sizeof(uint32_t) * (uint64_t)header.meshletTriangleCount);
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		LOGF(eERROR, "Couldn't open '%s' for writing", path);
+		tf_free(encodedPositions);
+		tf_free(encodedAttributes);
+		tf_free(encodedIndices);
+		return false;
+	}
+
+	bool success = fwrite(&header, sizeof(MeshFileHeader), 1, file) == 1;
+	success = success && writePadding(file, sizeof(MeshFileHeader), header.positionDataOffset);
+	success = success && fwrite(encodedPositions, 1, positionDataSize, file) == positionDataSize;
+	success = success && writePadding(file, header.positionDataOffset + header.positionDataSize, header.attributeDataOffset);
+	success = success && fwrite(encodedAttributes, 1, attributeDataSize, file) == attributeDataSize;
+	success = success && writePadding(file, header.attributeDataOffset + header.attributeDataSize, header.indexDataOffset);
+	success = success && fwrite(encodedIndices, 1, indexDataSize, file) == indexDataSize;
+	success = success && writePadding(file, header.indexDataOffset + header.indexDataSize, header.meshletDataOffset);
+	success = success && fwrite(&geometry->meshlets[gpuMesh->meshletOffset], sizeof(GPUMeshlet), header.meshletCount, file) == header.meshletCount;
+	success = success && writePadding(file, header.meshletDataOffset + sizeof(GPUMeshlet) * (uint64_t)header.meshletCount, header.meshletVertexDataOffset);
+	success = success && fwrite(&geometry->meshletVertices[gpuMesh->meshletVertexOffset], sizeof(uint32_t), header.meshletVertexCount, file) == header.meshletVertexCount;
+	success = success && writePadding(file, header.meshletVertexDataOffset + sizeof(uint32_t) * (uint64_t)header.meshletVertexCount, header.meshletTriangleDataOffset);
+	success = success && fwrite(&geometry->meshletTriangles[gpuMesh->meshletTriangleOffset], sizeof(uint32_t), header.meshletTriangleCount, file) == header.meshletTriangleCount;
+	success = success && writePadding(file, header.meshletTriangleDataOffset + sizeof(uint32_t) * (uint64_t)header.meshletTriangleCount, header.submeshDataOffset);
+	success = success && fwrite(&geometry->submeshes[gpuMesh->submeshOffset], sizeof(GPUSubmesh), header.submeshCount, file) == header.submeshCount;
+	fclose(file);
+
+	tf_free(encodedPositions);
+	tf_free(encodedAttributes);
+	tf_free(encodedIndices);
+
+	if (!success)
+	{
+		LOGF(eERROR, "Couldn't write mesh file '%s'", path);
+		remove(path);
+	}
+
+	return success;
+}
+
+// Validates the header of an open mesh file stream and points meshFile at its streams
+static bool mapMeshFile(const char* fileName, MeshFile* meshFile)
+{
+	size_t size = 0;
+	const void* data = NULL;
+	if (!::fsStreamMemoryMap(&meshFile->stream, &size, &data))
+	{
+		LOGF(eERROR, "Couldn't memory-map mesh file '%s'", fileName);
+		CloseMeshFile(meshFile);
+		return false;
+	}
+
+	const MeshFileHeader* header = (const MeshFileHeader*)data;
+	if (size < sizeof(MeshFileHeader) || header->magic != k_MeshFileMagic)
+	{
+		LOGF(eERROR, "'%s' is not a mesh file", fileName);
+		CloseMeshFile(meshFile);
+		return false;
+	}
+
+	if (header->version != k_MeshFileVersion || header->positionStride != sizeof(float3) || header->attributeStride != sizeof(MeshVertexAttributes))
+	{
+		LOGF(eWARNING, "Mesh file '%s' is out of date (version %u, expected %u), it needs to be cooked again", fileName, header->version, k_MeshFileVersion);
+		CloseMeshFile(meshFile);
+		return false;
+	}
+
+	if (header->positionDataOffset + header->positionDataSize > size ||
+		header->attributeDataOffset + header->attributeDataSize > size ||
+		header->indexDataOffset + header->indexDataSize > size ||
+		header->meshletDataOffset + sizeof(GPUMeshlet) * (uint64_t)header->meshletCount > size ||
+		header->meshletVertexDataOffset + sizeof(uint32_t) * (uint64_t)header->meshletVertexCount > size ||
+		header->meshletTriangleDataOffset + sizeof(uint32_t) * (uint64_t)header->meshletTriangleCount > size ||
+		header->submeshDataOffset + sizeof(GPUSubmesh) * (uint64_t)header->submeshCount > size)
+	{
+		LOGF(eERROR, "Mesh file '%s' is truncated", fileName);
+		CloseMeshFile(meshFile);
+		return false;
+	}
+
+	if ((header->indexSize != sizeof(uint16_t) && header->indexSize != sizeof(uint32_t)) ||
+		(header->indexSize == sizeof(uint16_t) && header->vertexCount > MESH_INDEX16_MAX_VERTICES))
+	{
+		LOGF(eERROR, "Mesh file '%s' has an invalid index size (%u)", fileName, header->indexSize);
+		CloseMeshFile(meshFile);
+		return false;
+	}
+
+	if (header->lodCount == 0 || header->lodCount > MESH_MAX_LODS)
+	{
+		LOGF(eERROR, "Mesh file '%s' has an invalid LOD count (%u)", fileName, header->lodCount);
+		CloseMeshFile(meshFile);
+		return false;
+	}
+
+	if (header->submeshCount == 0 || header->submeshCount > k_MeshMaxSubmeshes)
+	{
+		LOGF(eERROR, "Mesh file '%s' has an invalid submesh count (%u)", fileName, header->submeshCount);
+		CloseMeshFile(meshFile);
+		return false;
+	}
+
+	meshFile->header = header;
+	meshFile->encodedPositions = (const uint8_t*)data + header->positionDataOffset;
+	meshFile->encodedAttributes = (const uint8_t*)data + header->attributeDataOffset;
+	meshFile->encodedIndices = (const uint8_t*)data + header->indexDataOffset;
+	meshFile->meshlets = (const GPUMeshlet*)((const uint8_t*)data + header->meshletDataOffset);
+	meshFile->meshletVertices = (const uint32_t*)((const uint8_t*)data + header->meshletVertexDataOffset);
+	meshFile->meshletTriangles = (const uint32_t*)((const uint8_t*)data + header->meshletTriangleDataOffset);
+	meshFile->submeshes = (const GPUSubmesh*)((const uint8_t*)data + header->submeshDataOffset);
+
+	return true;
+}
+
+bool OpenMeshFile(::ResourceDirectory resourceDir, const char* fileName, MeshFile* meshFile)
+{
+	*meshFile = {};
+
+	if (!::fsOpenStreamFromPath(resourceDir, fileName, ::FM_READ, &meshFile->stream))
+	{
+		return false;
+	}
+
+	return mapMeshFile(fileName, meshFile);
+}
+
+bool OpenMeshFileFromPath(const char* path, MeshFile* meshFile)
+{
+	*meshFile = {};
+
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size <= 0)
+	{
+		fclose(file);
+		return false;
+	}
+
+	void* data = tf_malloc((size_t)size);
+	ASSERT(data);
+	bool success = fread(data, 1, (size_t)size, file) == (size_t)size;
+	fclose(file);
+
+	// NOTE(gmodarelli): The stream owns the buffer and releases it when closed
+	if (!success || !::fsOpenStreamFromMemory(data, (size_t)size, ::FM_READ, true, &meshFile->stream))
+	{
+		LOGF(eERROR, "Couldn't read mesh file '%s'", path);
+		tf_free(data);
+		return false;
+	}
+
+	return mapMeshFile(path, meshFile);
+}
+
+void CloseMeshFile(MeshFile* meshFile)
+{
+	::fsCloseStream(&meshFile->stream);
+	*meshFile = {};
+}
+
+bool DecodeMeshFilePositions(const MeshFile* meshFile, float3* positions)
+{
+	const MeshFileHeader* header = meshFile->header;
+	int result = meshopt_decodeVertexBuffer(positions, header->vertexCount, sizeof(float3), meshFile->encodedPositions, (size_t)header->positionDataSize);
+	if (result != 0)
+	{
+		LOGF(eERROR, "Couldn't decode the positions of a mesh file (error %d)", result);
+		return false;
+	}
+
+	return true;
+}
+
+bool DecodeMeshFileAttributes(const MeshFile* meshFile, MeshVertexAttributes* attributes)
+{
+	const MeshFileHeader* header = meshFile->header;
+	int result = meshopt_decodeVertexBuffer(attributes, header->vertexCount, sizeof(MeshVertexAttributes), meshFile->encodedAttributes, (size_t)header->attributeDataSize);
+	if (result != 0)
+	{
+		LOGF(eERROR, "Couldn't decode the vertex attributes of a mesh file (error %d)", result);
+		return false;
+	}
+
+	return true;
+}
+
+bool DecodeMeshFileIndices(const MeshFile* meshFile, void* indices)
+{
+	const MeshFileHeader* header = meshFile->header;
+	int result = meshopt_decodeIndexBuffer(indices, header->indexCount, header->indexSize, meshFile->encodedIndices, (size_t)header->indexDataSize);
+	if (result != 0)
+	{
+		LOGF(eERROR, "Couldn't decode the indices of a mesh file (error %d)", result);
+		return false;
+	}
+
+	return true;
+}
+
+bool LoadMeshFile(const MeshFile* meshFile, ImportedMesh* importedMesh)
+{
+	const MeshFileHeader* header = meshFile->header;
+	*importedMesh = {};
+
+	RendererGeometry* geometry = &importedMesh->geometry;
+	geometry->vertexCount = header->vertexCount;
+	geometry->indexCount = header->indexCount;
+	geometry->meshletCount = header->meshletCount;
+	geometry->meshletVertexCount = header->meshletVertexCount;
+	geometry->meshletTriangleCount = header->meshletTriangleCount;
+	geometry->submeshCount = header->submeshCount;
+	geometry->vertices = (MeshVertex*)tf_malloc(sizeof(MeshVertex) * geometry->vertexCount);
+	geometry->indices = (uint32_t*)tf_malloc(sizeof(uint32_t) * geometry->indexCount);
+	geometry->meshlets = (GPUMeshlet*)tf_malloc(sizeof(GPUMeshlet) * TF_MAX(geometry->meshletCount, 1u));
+	geometry->meshletVertices = (uint32_t*)tf_malloc(sizeof(uint32_t) * TF_MAX(geometry->meshletVertexCount, 1u));
+	geometry->meshletTriangles = (uint32_t*)tf_malloc(sizeof(uint32_t) * TF_MAX(geometry->meshletTriangleCount, 1u));
+	geometry->submeshes = (GPUSubmesh*)tf_malloc(sizeof(GPUSubmesh) * geometry->submeshCount);
+	ASSERT(geometry->vertices && geometry->indices && geometry->meshlets && geometry->meshletVertices && geometry->meshletTriangles && geometry->submeshes);
+
+	// NOTE(gmodarelli): The CPU keeps interleaved vertices, the streams are decoded into scratch copies and merged
+	float3* positions = (float3*)tf_malloc(sizeof(float3) * TF_MAX(geometry->vertexCount, 1u));
+	MeshVertexAttributes* attributes = (MeshVertexAttributes*)tf_malloc(sizeof(MeshVertexAttributes) * TF_MAX(geometry->vertexCount, 1u));
+	ASSERT(positions && attributes);
+	bool success = DecodeMeshFilePositions(meshFile, positions) && DecodeMeshFileAttributes(meshFile, attributes);
+	for (uint32_t i = 0; success && i < geometry->vertexCount; ++i)
+	{
+		MeshVertex& vertex = geometry->vertices[i];
+		vertex.position = positions[i];
+		vertex.normal = attributes[i].normal;
+		vertex.tangent = attributes[i].tangent;
+		vertex.uv = attributes[i].uv;
+		vertex.color = attributes[i].color;
+	}
+	tf_free(positions);
+	tf_free(attributes);
+
+	if (success && header->indexSize == sizeof(uint16_t))
+	{
+		// NOTE(gmodarelli): Imported geometry always uses 32-bit indices
+		uint16_t* indices16 = (uint16_t*)tf_malloc(sizeof(uint16_t) * geometry->indexCount);
+		ASSERT(indices16);
+		success = DecodeMeshFileIndices(meshFile, indices16);
+		for (uint32_t i = 0; success && i < geometry->indexCount; ++i)
+		{
+			geometry->indices[i] = indices16[i];
+		}
+		tf_free(indices16);
+	}
+	else if (success)
+	{
+		success = DecodeMeshFileIndices(meshFile, geometry->indices);
+	}
+
+	if (!success)
+	{
+		DestroyImportedMesh(importedMesh);
+		return false;
+	}
+
+	memcpy(geometry->meshlets, meshFile->meshlets, sizeof(GPUMeshlet) * geometry->meshletCount);
+	memcpy(geometry->meshletVertices, meshFile->meshletVertices, sizeof(uint32_t) * geometry->meshletVertexCount);
+	memcpy(geometry->meshletTriangles, meshFile->meshletTriangles, sizeof(uint32_t) * geometry->meshletTriangleCount);
+	memcpy(geometry->submeshes, meshFile->submeshes, sizeof(GPUSubmesh) * geometry->submeshCount);
+
+	GPUMesh* mesh = &importedMesh->mesh;
+	mesh->vertexCount = header->vertexCount;
+	mesh->indexCount = header->indexCount;
+	mesh->indexSize = header->indexSize;
+	mesh->aabbMin = { header->aabbMin[0], header->aabbMin[1], header->aabbMin[2] };
+	mesh->aabbMax = { header->aabbMax[0], header->aabbMax[1], header->aabbMax[2] };
+	mesh->meshletCount = header->meshletCount;
+	mesh->submeshCount = header->submeshCount;
+	mesh->lodCount = header->lodCount;
+	memcpy(mesh->lods, header->lods, sizeof(mesh->lods));
+	importedMesh->contentHash = header->contentHash;
+
+	return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "MeshImporter.h"
+
+// The-Forge
+#include <Utilities/Interfaces/IFileSystem.h>
+
+// Cooked mesh file (*.mesh), written by the MeshCooker and memory-mapped at runtime.
+//
+// Layout:
+//   MeshFileHeader
+//   float3[vertexCount]               at positionDataOffset, positionDataSize bytes encoded with meshopt_encodeVertexBuffer
+//   MeshVertexAttributes[vertexCount] at attributeDataOffset, attributeDataSize bytes encoded with meshopt_encodeVertexBuffer
+//   uint32_t[indexCount]              at indexDataOffset, indexDataSize bytes encoded with meshopt_encodeIndexBuffer
+//   GPUMeshlet[meshletCount]          at meshletDataOffset
+//   uint32_t[meshletVertexCount]      at meshletVertexDataOffset
+//   uint32_t[meshletTriangleCount]    at meshletTriangleDataOffset
+//   GPUSubmesh[submeshCount]          at submeshDataOffset
+//
+// Offsets are relative to the start of the file and aligned to k_MeshFileAlignment.
+// Meshlet and submesh data can be copied straight into GPU buffers, positions, attributes and indices
+// are decoded straight into the upload memory of the GPU buffers (see DecodeMeshFilePositions/Attributes/Indices).
+// Positions and attributes are stored as separate streams, laid out like the position and vertex buffers,
+// so they don't need to be split after decoding.
+
+const uint32_t k_MeshFileMagic = 0x4853454D; // "MESH"
+// NOTE: Bump this every time MeshVertex, GPUMesh, the layout of the file or the import pipeline changes
+const uint32_t k_MeshFileVersion = 10;
+const uint32_t k_MeshFileAlignment = 16;
+
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t positionStride;
+	uint32_t attributeStride;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	float aabbMin[3];
+	float aabbMax[3];
+	uint32_t indexSize;
+	uint32_t _pad1;
+	uint64_t positionDataOffset;
+	uint64_t attributeDataOffset;
+	uint64_t indexDataOffset;
+	uint64_t positionDataSize;
+	uint64_t attributeDataSize;
+	uint64_t indexDataSize;
+	uint32_t meshletCount;
+	uint32_t meshletVertexCount;
+	uint32_t meshletTriangleCount;
+	uint32_t submeshCount;
+	uint64_t meshletDataOffset;
+	uint64_t meshletVertexDataOffset;
+	uint64_t meshletTriangleDataOffset;
+	uint64_t submeshDataOffset;
+	// LOD index ranges, relative to the start of the index data
+	uint32_t lodCount;
+	uint32_t _pad2;
+	// HashMeshGeometry of the mesh
+	uint64_t contentHash;
+	GPUMeshLod lods[MESH_MAX_LODS];
+};
+
+struct MeshFile
+{
+	::FileStream stream = {};
+	const MeshFileHeader* header = NULL;
+	const uint8_t* encodedPositions = NULL;
+	const uint8_t* encodedAttributes = NULL;
+	const uint8_t* encodedIndices = NULL;
+	const GPUMeshlet* meshlets = NULL;
+	const uint32_t* meshletVertices = NULL;
+	const uint32_t* meshletTriangles = NULL;
+	const GPUSubmesh* submeshes = NULL;
+};
+
+// Writes the mesh described by gpuMesh (a range of geometry) to a cooked mesh file
+bool WriteMeshFile(const char* path, const RendererGeometry* geometry, const GPUMesh* gpuMesh);
+
+// Memory-maps a cooked mesh file. The mapping stays valid until CloseMeshFile is called.
+bool OpenMeshFile(::ResourceDirectory resourceDir, const char* fileName, MeshFile* meshFile);
+// Reads a mesh file outside of the resource directories (see MeshCache.h) into memory
+bool OpenMeshFileFromPath(const char* path, MeshFile* meshFile);
+void CloseMeshFile(MeshFile* meshFile);
+
+// Decode the position and attribute (header->vertexCount) and index (header->indexCount) streams of a
+// mesh file. Indices are decoded as header->indexSize (2 or 4) bytes each.
+bool DecodeMeshFilePositions(const MeshFile* meshFile, float3* positions);
+bool DecodeMeshFileAttributes(const MeshFile* meshFile, MeshVertexAttributes* attributes);
+bool DecodeMeshFileIndices(const MeshFile* meshFile, void* indices);
+
+// Decodes a whole mesh file into an ImportedMesh (with 32-bit indices), as if it had just been imported
+bool LoadMeshFile(const MeshFile* meshFile, ImportedMesh* importedMesh);
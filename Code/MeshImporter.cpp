@@ -0,0 +1,810 @@
+#include "MeshImporter.h"
+#include "Hash.h"
+#include "MeshTangents.h"
+#include "ObjParser.h"
+#include "VertexPacking.h"
+
+#include <stdio.h>
+
+// meshoptimizer
+#include <meshoptimizer.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IThread.h>
+#include <Utilities/Interfaces/ITime.h>
+#include <Utilities/Threading/Atomics.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// NOTE(gmodarelli): Post-transform cache size used to report ACMR/ATVR. 16 entries is the
+// conservative figure meshoptimizer recommends when the target hardware isn't known.
+const uint32_t k_MeshVertexCacheSize = 16;
+// Allow the overdraw optimizer to worsen vertex cache efficiency by up to 5%
+const float k_MeshOverdrawThreshold = 1.05f;
+
+struct MeshOptimizationStats
+{
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+	float overdraw = 0.0f;
+	float overfetch = 0.0f;
+};
+
+static uint32_t AssignFaceSubmeshes(const fastObjMesh* obj, const char* path, Arena* arena, uint32_t* faceSubmeshes, uint32_t* submeshMaterials);
+static void PackVertex(const ImportVertex* vertex, MeshVertex* packedVertex);
+static MeshOptimizationStats AnalyzeMesh(const RendererGeometry* geometry);
+static void BuildMeshlets(RendererGeometry* geometry, GPUMesh* mesh, ScratchGeometryData* scratch);
+static void BuildLods(RendererGeometry* geometry, GPUMesh* mesh, ScratchGeometryData* scratch);
+static void OptimizeMesh(RendererGeometry* geometry, ScratchGeometryData* scratch);
+
+bool ImportMesh(const char* path, ScratchGeometryData* scratch, ImportedMesh* importedMesh)
+{
+	ASSERT(scratch);
+	ASSERT(importedMesh);
+	*importedMesh = {};
+
+	MeshImportStats* stats = &importedMesh->stats;
+	const int64_t importStart = ::getUSec(true);
+	int64_t stageStart = importStart;
+
+	ObjFile objFile = {};
+	if (!ReadObjFile(path, scratch->maxWorkers, &objFile))
+	{
+		LOGF(eERROR, "Couldn't read mesh '%s'", path);
+		return false;
+	}
+	const fastObjMesh* obj = objFile.mesh;
+	stats->parsedInParallel = objFile.parsedInParallel;
+
+	stats->parseTime = ::getUSec(true) - stageStart;
+	stageStart = ::getUSec(true);
+
+	size_t indexCount = 0;
+	for (uint32_t i = 0; i < obj->face_count; ++i)
+	{
+		indexCount += 3 * (obj->face_vertices[i] - 2);
+	}
+
+	scratch->reset((uint32_t)indexCount, (uint32_t)indexCount);
+
+	// Triangles are written grouped by submesh, so that every submesh is a contiguous index range
+	uint32_t* faceSubmeshes = scratch->arena.allocArray<uint32_t>(obj->face_count);
+	uint32_t submeshMaterials[k_MeshMaxSubmeshes] = {};
+	const uint32_t submeshCount = AssignFaceSubmeshes(obj, path, &scratch->arena, faceSubmeshes, submeshMaterials);
+
+	uint32_t submeshCorners[k_MeshMaxSubmeshes] = {};
+	for (uint32_t i = 0; i < obj->face_count; ++i)
+	{
+		submeshCorners[faceSubmeshes[i]] += 3 * (obj->face_vertices[i] - 2);
+	}
+
+	RendererGeometry* geometry = &importedMesh->geometry;
+	geometry->submeshes = (GPUSubmesh*)tf_malloc(sizeof(GPUSubmesh) * submeshCount);
+	ASSERT(geometry->submeshes);
+	geometry->submeshCount = submeshCount;
+
+	uint32_t submeshStart = 0;
+	for (uint32_t i = 0; i < submeshCount; ++i)
+	{
+		GPUSubmesh* submesh = &geometry->submeshes[i];
+		*submesh = {};
+		submesh->aabbMin = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+		submesh->aabbMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		submesh->materialSlot = submeshMaterials[i];
+		submesh->lods[0].indexOffset = submeshStart;
+		submesh->lods[0].indexCount = submeshCorners[i];
+
+		// From here on submeshCorners is the next corner to write
+		const uint32_t cornerCount = submeshCorners[i];
+		submeshCorners[i] = submeshStart;
+		submeshStart += cornerCount;
+	}
+
+	GPUMesh* mesh = &importedMesh->mesh;
+	size_t indexOffset = 0;
+	mesh->aabbMin = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+	mesh->aabbMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	mesh->submeshCount = submeshCount;
+
+	for (uint32_t i = 0; i < obj->face_count; ++i)
+	{
+		ASSERT(obj->face_vertices[i] == 3);
+
+		GPUSubmesh* submesh = &geometry->submeshes[faceSubmeshes[i]];
+		uint32_t* vertexOffset = &submeshCorners[faceSubmeshes[i]];
+
+		for (uint32_t j = 0; j < obj->face_vertices[i]; ++j)
+		{
+			fastObjIndex gi = obj->indices[indexOffset + j];
+
+			ImportVertex* v = &scratch->importVertices[(*vertexOffset)++];
+			v->position.x = obj->positions[gi.p * 3 + 0];
+			v->position.y = obj->positions[gi.p * 3 + 1];
+			v->position.z = obj->positions[gi.p * 3 + 2];
+			v->color.x = obj->colors[gi.p * 3 + 0];
+			v->color.y = obj->colors[gi.p * 3 + 1];
+			v->color.z = obj->colors[gi.p * 3 + 2];
+			v->normal.x = obj->normals[gi.n * 3 + 0];
+			v->normal.y = obj->normals[gi.n * 3 + 1];
+			v->normal.z = obj->normals[gi.n * 3 + 2];
+			v->uv.x = obj->texcoords[gi.t * 2 + 0];
+			v->uv.y = 1.0f - obj->texcoords[gi.t * 2 + 1];
+			v->tangent.x = 0;
+			v->tangent.z = 0;
+			v->tangent.y = 0;
+			v->tangent.w = 0;
+
+			submesh->aabbMin.x = TF_MIN(submesh->aabbMin.x, v->position.x);
+			submesh->aabbMin.y = TF_MIN(submesh->aabbMin.y, v->position.y);
+			submesh->aabbMin.z = TF_MIN(submesh->aabbMin.z, v->position.z);
+			submesh->aabbMax.x = TF_MAX(submesh->aabbMax.x, v->position.x);
+			submesh->aabbMax.y = TF_MAX(submesh->aabbMax.y, v->position.y);
+			submesh->aabbMax.z = TF_MAX(submesh->aabbMax.z, v->position.z);
+		}
+
+		indexOffset += obj->face_vertices[i];
+	}
+
+	for (uint32_t i = 0; i < submeshCount; ++i)
+	{
+		const GPUSubmesh& submesh = geometry->submeshes[i];
+		ASSERT(submeshCorners[i] == submesh.lods[0].indexOffset + submesh.lods[0].indexCount);
+		mesh->aabbMin.x = TF_MIN(mesh->aabbMin.x, submesh.aabbMin.x);
+		mesh->aabbMin.y = TF_MIN(mesh->aabbMin.y, submesh.aabbMin.y);
+		mesh->aabbMin.z = TF_MIN(mesh->aabbMin.z, submesh.aabbMin.z);
+		mesh->aabbMax.x = TF_MAX(mesh->aabbMax.x, submesh.aabbMax.x);
+		mesh->aabbMax.y = TF_MAX(mesh->aabbMax.y, submesh.aabbMax.y);
+		mesh->aabbMax.z = TF_MAX(mesh->aabbMax.z, submesh.aabbMax.z);
+	}
+
+	ASSERT(submeshStart == indexCount);
+	stats->sourceVertexCount = (uint32_t)indexCount;
+	stats->expandTime = ::getUSec(true) - stageStart;
+	stageStart = ::getUSec(true);
+
+	// Calculate MikkTSpace tangents
+	GenerateTangents(scratch->importVertices, (uint32_t)indexCount, k_TangentsParallelImport ? scratch->maxWorkers : 1, &scratch->arena);
+
+	stats->tangentsTime = ::getUSec(true) - stageStart;
+	stageStart = ::getUSec(true);
+
+	// Pack the vertices before indexing them, so that vertices that only differ below
+	// the precision of the packed format get merged
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		PackVertex(&scratch->importVertices[i], &scratch->geometry.vertices[i]);
+		scratch->geometry.indices[i] = (uint32_t)i;
+	}
+	scratch->geometry.vertexCount = (uint32_t)indexCount;
+	scratch->geometry.indexCount = (uint32_t)indexCount;
+
+	DestroyObjFile(&objFile);
+
+	stats->packTime = ::getUSec(true) - stageStart;
+	stageStart = ::getUSec(true);
+
+	// Generate the index buffer with meshoptimizer
+	{
+		uint32_t* remap = scratch->arena.allocArray<uint32_t>(scratch->geometry.vertexCount);
+		size_t vertexCount = meshopt_generateVertexRemap(remap,
+			scratch->geometry.indices,
+			scratch->geometry.indexCount,
+			scratch->geometry.vertices,
+			scratch->geometry.vertexCount,
+			sizeof(MeshVertex));
+
+		geometry->vertices = (MeshVertex*)tf_malloc(sizeof(MeshVertex) * vertexCount);
+		geometry->indices = (uint32_t*)tf_malloc(sizeof(uint32_t) * indexCount);
+		ASSERT(geometry->vertices && geometry->indices);
+
+		meshopt_remapIndexBuffer(geometry->indices,
+			scratch->geometry.indices,
+			scratch->geometry.indexCount,
+			remap);
+
+		meshopt_remapVertexBuffer(geometry->vertices,
+			scratch->geometry.vertices,
+			scratch->geometry.vertexCount,
+			sizeof(MeshVertex),
+			remap);
+
+		geometry->indexCount = (uint32_t)indexCount;
+		geometry->vertexCount = (uint32_t)vertexCount;
+		mesh->indexCount = (uint32_t)indexCount;
+		mesh->vertexCount = (uint32_t)vertexCount;
+		// NOTE(gmodarelli): Indices are mesh-local, so small meshes can go to the 16-bit index pool
+		mesh->indexSize = vertexCount <= MESH_INDEX16_MAX_VERTICES ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	stats->remapTime = ::getUSec(true) - stageStart;
+
+	// Reorder triangles and vertices for the geometry pass
+	{
+		stageStart = ::getUSec(true);
+		MeshOptimizationStats before = AnalyzeMesh(&importedMesh->geometry);
+		stats->analyzeTime = ::getUSec(true) - stageStart;
+
+		stageStart = ::getUSec(true);
+		OptimizeMesh(&importedMesh->geometry, scratch);
+		stats->optimizeTime = ::getUSec(true) - stageStart;
+
+		stageStart = ::getUSec(true);
+		MeshOptimizationStats after = AnalyzeMesh(&importedMesh->geometry);
+		stats->analyzeTime += ::getUSec(true) - stageStart;
+
+		LOGF(eINFO, "Optimized mesh '%s' (%u vertices, %u triangles): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overdraw %.3f -> %.3f, overfetch %.3f -> %.3f",
+			path, mesh->vertexCount, mesh->indexCount / 3,
+			before.acmr, after.acmr,
+			before.atvr, after.atvr,
+			before.overdraw, after.overdraw,
+			before.overfetch, after.overfetch);
+	}
+
+	stageStart = ::getUSec(true);
+	BuildMeshlets(&importedMesh->geometry, mesh, scratch);
+	stats->meshletsTime = ::getUSec(true) - stageStart;
+
+	stageStart = ::getUSec(true);
+	BuildLods(&importedMesh->geometry, mesh, scratch);
+	stats->lodsTime = ::getUSec(true) - stageStart;
+
+	importedMesh->contentHash = HashMeshGeometry(&importedMesh->geometry, mesh);
+
+	stats->totalTime = ::getUSec(true) - importStart;
+	return true;
+}
+
+// NOTE(gmodarelli): Faces are grouped by (object, material) pair, in order of first appearance. When a file
+// has more pairs than k_MeshMaxSubmeshes we group by material only, and whatever still doesn't fit ends up
+// in the last submesh (drawn with its material).
+static uint32_t AssignFaceSubmeshes(const fastObjMesh* obj, const char* path, Arena* arena, uint32_t* faceSubmeshes, uint32_t* submeshMaterials)
+{
+	uint32_t* faceObjects = arena->allocArray<uint32_t>(obj->face_count);
+	memset(faceObjects, 0, sizeof(uint32_t) * obj->face_count);
+	for (uint32_t i = 0; i < obj->object_count; ++i)
+	{
+		const fastObjGroup& object = obj->objects[i];
+		for (uint32_t j = 0; j < object.face_count; ++j)
+		{
+			faceObjects[object.face_offset + j] = i;
+		}
+	}
+
+	uint32_t submeshCount = 0;
+	bool merged = false;
+	for (uint32_t pass = 0; pass < 2; ++pass)
+	{
+		const bool byObject = pass == 0;
+		uint32_t submeshObjects[k_MeshMaxSubmeshes] = {};
+		uint32_t submesh = UINT32_MAX;
+		bool overflow = false;
+		submeshCount = 0;
+
+		for (uint32_t i = 0; i < obj->face_count && !overflow; ++i)
+		{
+			const uint32_t object = byObject ? faceObjects[i] : 0;
+			const uint32_t material = obj->material_count > 0 ? obj->face_materials[i] : 0;
+
+			// Consecutive faces almost always share their submesh
+			if (submesh == UINT32_MAX || submeshObjects[submesh] != object || submeshMaterials[submesh] != material)
+			{
+				submesh = UINT32_MAX;
+				for (uint32_t j = 0; j < submeshCount; ++j)
+				{
+					if (submeshObjects[j] == object && submeshMaterials[j] == material)
+					{
+						submesh = j;
+						break;
+					}
+				}
+
+				if (submesh == UINT32_MAX)
+				{
+					if (submeshCount < k_MeshMaxSubmeshes)
+					{
+						submeshObjects[submeshCount] = object;
+						submeshMaterials[submeshCount] = material;
+						submesh = submeshCount++;
+					}
+					else if (byObject)
+					{
+						overflow = true;
+						continue;
+					}
+					else
+					{
+						submesh = submeshCount - 1;
+						merged = true;
+					}
+				}
+			}
+
+			faceSubmeshes[i] = submesh;
+		}
+
+		if (!overflow)
+		{
+			break;
+		}
+	}
+
+	if (merged)
+	{
+		LOGF(eWARNING, "Mesh '%s' uses more than %u materials, the extra ones are drawn with the last one", path, k_MeshMaxSubmeshes);
+	}
+
+	// A mesh always has at least one submesh, even when empty
+	if (submeshCount == 0)
+	{
+		submeshMaterials[0] = 0;
+		submeshCount = 1;
+	}
+
+	return submeshCount;
+}
+
+// NOTE(gmodarelli): Every LOD is simplified from LOD 0 rather than from the previous LOD, so that
+// the errors don't accumulate. LOD indices are appended after the LOD 0 indices and share its vertices.
+// Submeshes are simplified one by one and a mesh LOD is the concatenation of their LODs, so every
+// submesh stays a contiguous range in every LOD. A submesh that can't be reduced any further repeats
+// its previous LOD.
+static void BuildLods(RendererGeometry* geometry, GPUMesh* mesh, ScratchGeometryData* scratch)
+{
+	const uint32_t lod0IndexCount = geometry->indexCount;
+	const float* positions = &geometry->vertices[0].position.x;
+	const float errorScale = meshopt_simplifyScale(positions, geometry->vertexCount, sizeof(MeshVertex));
+
+	mesh->lodCount = 1;
+	mesh->lods[0].indexOffset = 0;
+	mesh->lods[0].indexCount = lod0IndexCount;
+	mesh->lods[0].error = 0.0f;
+
+	// Every LOD is at most as big as LOD 0, so the scratch indices can hold one
+	ASSERT(scratch->indicesMaxCount >= lod0IndexCount);
+	uint32_t* lodIndices = scratch->arena.allocArray<uint32_t>((size_t)lod0IndexCount * (MESH_MAX_LODS - 1));
+	uint32_t lodIndexCount = 0;
+
+	for (uint32_t lodIndex = 1; lodIndex < MESH_MAX_LODS; ++lodIndex)
+	{
+		const GPUMeshLod& previousLod = mesh->lods[lodIndex - 1];
+		const uint32_t levelIndexOffset = lodIndexCount;
+		float levelError = 0.0f;
+
+		for (uint32_t submeshIndex = 0; submeshIndex < geometry->submeshCount; ++submeshIndex)
+		{
+			GPUSubmesh* submesh = &geometry->submeshes[submeshIndex];
+			const GPUMeshLod& submeshLod0 = submesh->lods[0];
+			const GPUMeshLod& previousSubmeshLod = submesh->lods[lodIndex - 1];
+			size_t targetIndexCount = (size_t)(previousSubmeshLod.indexCount * k_MeshLodTargetRatio) / 3 * 3;
+
+			float error = 0.0f;
+			size_t indexCount = 0;
+			if (previousSubmeshLod.indexCount > 0)
+			{
+				indexCount = meshopt_simplify(scratch->geometry.indices,
+					&geometry->indices[submeshLod0.indexOffset],
+					submeshLod0.indexCount,
+					positions,
+					geometry->vertexCount,
+					sizeof(MeshVertex),
+					targetIndexCount,
+					k_MeshLodMaxError,
+					0,
+					&error);
+			}
+
+			uint32_t* indices = &lodIndices[lodIndexCount];
+			if (indexCount == 0 || indexCount > previousSubmeshLod.indexCount * 0.9f)
+			{
+				const uint32_t* previousIndices = lodIndex == 1 ?
+					&geometry->indices[previousSubmeshLod.indexOffset] :
+					&lodIndices[previousSubmeshLod.indexOffset - lod0IndexCount];
+				memcpy(indices, previousIndices, sizeof(uint32_t) * previousSubmeshLod.indexCount);
+				indexCount = previousSubmeshLod.indexCount;
+				error = previousSubmeshLod.error;
+			}
+			else
+			{
+				meshopt_optimizeVertexCache(indices, scratch->geometry.indices, indexCount, geometry->vertexCount);
+				error *= errorScale;
+			}
+
+			GPUMeshLod* submeshLod = &submesh->lods[lodIndex];
+			submeshLod->indexOffset = lod0IndexCount + lodIndexCount;
+			submeshLod->indexCount = (uint32_t)indexCount;
+			submeshLod->error = error;
+			lodIndexCount += (uint32_t)indexCount;
+			levelError = TF_MAX(levelError, error);
+		}
+
+		// Stop when the simplifier can't remove a meaningful amount of triangles within the error bound
+		const uint32_t levelIndexCount = lodIndexCount - levelIndexOffset;
+		if (levelIndexCount == 0 || levelIndexCount > previousLod.indexCount * 0.9f)
+		{
+			lodIndexCount = levelIndexOffset;
+			break;
+		}
+
+		GPUMeshLod* lod = &mesh->lods[mesh->lodCount++];
+		lod->indexOffset = lod0IndexCount + levelIndexOffset;
+		lod->indexCount = levelIndexCount;
+		lod->error = levelError;
+	}
+
+	for (uint32_t submeshIndex = 0; submeshIndex < geometry->submeshCount; ++submeshIndex)
+	{
+		GPUSubmesh* submesh = &geometry->submeshes[submeshIndex];
+		for (uint32_t lodIndex = mesh->lodCount; lodIndex < MESH_MAX_LODS; ++lodIndex)
+		{
+			submesh->lods[lodIndex] = {};
+		}
+	}
+
+	if (lodIndexCount > 0)
+	{
+		uint32_t* indices = (uint32_t*)tf_malloc(sizeof(uint32_t) * (lod0IndexCount + lodIndexCount));
+		ASSERT(indices);
+		memcpy(indices, geometry->indices, sizeof(uint32_t) * lod0IndexCount);
+		memcpy(&indices[lod0IndexCount], lodIndices, sizeof(uint32_t) * lodIndexCount);
+
+		tf_free(geometry->indices);
+		geometry->indices = indices;
+		geometry->indexCount = lod0IndexCount + lodIndexCount;
+		mesh->indexCount = geometry->indexCount;
+	}
+}
+
+// NOTE(gmodarelli): Meshlets are built on the optimized index buffer, so their triangles
+// keep the vertex cache friendly order. Each submesh gets its own meshlets.
+static void BuildMeshlets(RendererGeometry* geometry, GPUMesh* mesh, ScratchGeometryData* scratch)
+{
+	size_t maxMeshlets = 0;
+	for (uint32_t i = 0; i < geometry->submeshCount; ++i)
+	{
+		maxMeshlets += meshopt_buildMeshletsBound(geometry->submeshes[i].lods[0].indexCount, k_MeshletMaxVertices, k_MeshletMaxTriangles);
+	}
+	meshopt_Meshlet* meshlets = scratch->arena.allocArray<meshopt_Meshlet>(maxMeshlets);
+	uint32_t* meshletVertices = scratch->arena.allocArray<uint32_t>(maxMeshlets * k_MeshletMaxVertices);
+	uint8_t* meshletTriangles = scratch->arena.allocArray<uint8_t>(maxMeshlets * k_MeshletMaxTriangles * 3);
+
+	size_t meshletCount = 0;
+	size_t meshletVertexBase = 0;
+	size_t meshletTriangleBase = 0;
+	for (uint32_t i = 0; i < geometry->submeshCount; ++i)
+	{
+		GPUSubmesh* submesh = &geometry->submeshes[i];
+		const GPUMeshLod& lod0 = submesh->lods[0];
+		size_t submeshMaxMeshlets = meshopt_buildMeshletsBound(lod0.indexCount, k_MeshletMaxVertices, k_MeshletMaxTriangles);
+
+		size_t submeshMeshletCount = meshopt_buildMeshlets(&meshlets[meshletCount],
+			&meshletVertices[meshletVertexBase],
+			&meshletTriangles[meshletTriangleBase],
+			&geometry->indices[lod0.indexOffset],
+			lod0.indexCount,
+			&geometry->vertices[0].position.x,
+			geometry->vertexCount,
+			sizeof(MeshVertex),
+			k_MeshletMaxVertices,
+			k_MeshletMaxTriangles,
+			k_MeshletConeWeight);
+
+		// Make the offsets relative to the start of the scratch arrays
+		for (size_t j = 0; j < submeshMeshletCount; ++j)
+		{
+			meshlets[meshletCount + j].vertex_offset += (uint32_t)meshletVertexBase;
+			meshlets[meshletCount + j].triangle_offset += (uint32_t)meshletTriangleBase;
+		}
+
+		submesh->meshletOffset = (uint32_t)meshletCount;
+		submesh->meshletCount = (uint32_t)submeshMeshletCount;
+		meshletCount += submeshMeshletCount;
+		meshletVertexBase += submeshMaxMeshlets * k_MeshletMaxVertices;
+		meshletTriangleBase += submeshMaxMeshlets * k_MeshletMaxTriangles * 3;
+	}
+
+	uint32_t meshletVertexCount = 0;
+	uint32_t meshletTriangleCount = 0;
+	for (size_t i = 0; i < meshletCount; ++i)
+	{
+		meshletVertexCount += meshlets[i].vertex_count;
+		meshletTriangleCount += meshlets[i].triangle_count;
+	}
+
+	geometry->meshlets = (GPUMeshlet*)tf_malloc(sizeof(GPUMeshlet) * meshletCount);
+	geometry->meshletVertices = (uint32_t*)tf_malloc(sizeof(uint32_t) * meshletVertexCount);
+	geometry->meshletTriangles = (uint32_t*)tf_malloc(sizeof(uint32_t) * meshletTriangleCount);
+	ASSERT(geometry->meshlets && geometry->meshletVertices && geometry->meshletTriangles);
+
+	uint32_t vertexOffset = 0;
+	uint32_t triangleOffset = 0;
+	for (size_t i = 0; i < meshletCount; ++i)
+	{
+		const meshopt_Meshlet& meshlet = meshlets[i];
+		uint32_t* vertices = &meshletVertices[meshlet.vertex_offset];
+		uint8_t* triangles = &meshletTriangles[meshlet.triangle_offset];
+
+		meshopt_optimizeMeshlet(vertices, triangles, meshlet.triangle_count, meshlet.vertex_count);
+
+		meshopt_Bounds bounds = meshopt_computeMeshletBounds(vertices,
+			triangles,
+			meshlet.triangle_count,
+			&geometry->vertices[0].position.x,
+			geometry->vertexCount,
+			sizeof(MeshVertex));
+
+		GPUMeshlet* gpuMeshlet = &geometry->meshlets[i];
+		gpuMeshlet->vertexOffset = vertexOffset;
+		gpuMeshlet->triangleOffset = triangleOffset;
+		gpuMeshlet->vertexCount = meshlet.vertex_count;
+		gpuMeshlet->triangleCount = meshlet.triangle_count;
+		gpuMeshlet->boundsCenter = { bounds.center[0], bounds.center[1], bounds.center[2] };
+		gpuMeshlet->boundsRadius = bounds.radius;
+		gpuMeshlet->coneApex = { bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2] };
+		gpuMeshlet->coneCutoff = bounds.cone_cutoff;
+		gpuMeshlet->coneAxis = { bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2] };
+		gpuMeshlet->_pad0 = 0.0f;
+
+		memcpy(&geometry->meshletVertices[vertexOffset], vertices, sizeof(uint32_t) * meshlet.vertex_count);
+		for (uint32_t j = 0; j < meshlet.triangle_count; ++j)
+		{
+			geometry->meshletTriangles[triangleOffset + j] = (uint32_t)triangles[j * 3 + 0] |
+				((uint32_t)triangles[j * 3 + 1] << 8) |
+				((uint32_t)triangles[j * 3 + 2] << 16);
+		}
+
+		vertexOffset += meshlet.vertex_count;
+		triangleOffset += meshlet.triangle_count;
+	}
+
+	geometry->meshletCount = (uint32_t)meshletCount;
+	geometry->meshletVertexCount = meshletVertexCount;
+	geometry->meshletTriangleCount = meshletTriangleCount;
+	mesh->meshletCount = (uint32_t)meshletCount;
+}
+
+static void PackVertex(const ImportVertex* vertex, MeshVertex* packedVertex)
+{
+	packedVertex->position = vertex->position;
+	packedVertex->normal = PackOctahedral(vertex->normal);
+	packedVertex->tangent = PackTangent(vertex->tangent);
+	packedVertex->uv = PackTexcoord(vertex->uv);
+	packedVertex->color = PackColor(vertex->color);
+
+#if defined(_DEBUG)
+	// Make sure the round-trip stays within the error bounds of the format
+	float3 normal = UnpackOctahedral(packedVertex->normal);
+	float normalCosError = normal.x * vertex->normal.x + normal.y * vertex->normal.y + normal.z * vertex->normal.z;
+	float normalLength = sqrtf(vertex->normal.x * vertex->normal.x + vertex->normal.y * vertex->normal.y + vertex->normal.z * vertex->normal.z);
+	ASSERT(normalLength < 0.5f || normalCosError >= cosf(k_PackedNormalMaxError) * normalLength);
+
+	float4 tangent = UnpackTangent(packedVertex->tangent);
+	float tangentCosError = tangent.x * vertex->tangent.x + tangent.y * vertex->tangent.y + tangent.z * vertex->tangent.z;
+	float tangentLength = sqrtf(vertex->tangent.x * vertex->tangent.x + vertex->tangent.y * vertex->tangent.y + vertex->tangent.z * vertex->tangent.z);
+	ASSERT(tangentLength < 0.5f || tangentCosError >= cosf(k_PackedTangentMaxError) * tangentLength);
+	ASSERT((tangent.w < 0.0f) == (vertex->tangent.w < 0.0f));
+
+	float2 uv = UnpackTexcoord(packedVertex->uv);
+	ASSERT(fabsf(uv.x - vertex->uv.x) <= TF_MAX(fabsf(vertex->uv.x), 1.0f) / 1024.0f);
+	ASSERT(fabsf(uv.y - vertex->uv.y) <= TF_MAX(fabsf(vertex->uv.y), 1.0f) / 1024.0f);
+#endif
+}
+
+static MeshOptimizationStats AnalyzeMesh(const RendererGeometry* geometry)
+{
+	MeshOptimizationStats stats = {};
+
+	meshopt_VertexCacheStatistics vertexCacheStats = meshopt_analyzeVertexCache(geometry->indices,
+		geometry->indexCount,
+		geometry->vertexCount,
+		k_MeshVertexCacheSize,
+		0,
+		0);
+	stats.acmr = vertexCacheStats.acmr;
+	stats.atvr = vertexCacheStats.atvr;
+
+	meshopt_OverdrawStatistics overdrawStats = meshopt_analyzeOverdraw(geometry->indices,
+		geometry->indexCount,
+		&geometry->vertices[0].position.x,
+		geometry->vertexCount,
+		sizeof(MeshVertex));
+	stats.overdraw = overdrawStats.overdraw;
+
+	meshopt_VertexFetchStatistics vertexFetchStats = meshopt_analyzeVertexFetch(geometry->indices,
+		geometry->indexCount,
+		geometry->vertexCount,
+		sizeof(MeshVertex));
+	stats.overfetch = vertexFetchStats.overfetch;
+
+	return stats;
+}
+
+// NOTE(gmodarelli): The order matters: vertex cache first, then overdraw (which only reorders
+// clusters of triangles and keeps most of the cache locality), and vertex fetch last since it
+// reorders vertices based on the final index order.
+// The scratch buffers are free at this point and are big enough to hold a copy of the mesh,
+// so we use them as the destination of each pass.
+static void OptimizeMesh(RendererGeometry* geometry, ScratchGeometryData* scratch)
+{
+	ASSERT(scratch->indicesMaxCount >= geometry->indexCount);
+	ASSERT(scratch->verticesMaxCount >= geometry->vertexCount);
+
+	const size_t indexCount = geometry->indexCount;
+	const size_t vertexCount = geometry->vertexCount;
+	uint32_t* scratchIndices = scratch->geometry.indices;
+
+	// Triangles are only reordered inside their submesh, so the submesh ranges stay valid
+	for (uint32_t i = 0; i < geometry->submeshCount; ++i)
+	{
+		const GPUMeshLod& lod0 = geometry->submeshes[i].lods[0];
+		meshopt_optimizeVertexCache(&scratchIndices[lod0.indexOffset], &geometry->indices[lod0.indexOffset], lod0.indexCount, vertexCount);
+
+		meshopt_optimizeOverdraw(&geometry->indices[lod0.indexOffset],
+			&scratchIndices[lod0.indexOffset],
+			lod0.indexCount,
+			&geometry->vertices[0].position.x,
+			vertexCount,
+			sizeof(MeshVertex),
+			k_MeshOverdrawThreshold);
+	}
+
+	size_t fetchedVertexCount = meshopt_optimizeVertexFetch(scratch->geometry.vertices,
+		geometry->indices,
+		indexCount,
+		geometry->vertices,
+		vertexCount,
+		sizeof(MeshVertex));
+	// NOTE(gmodarelli): Vertices are already deduplicated by the remap, so none should be dropped here
+	ASSERT(fetchedVertexCount == vertexCount);
+	memcpy(geometry->vertices, scratch->geometry.vertices, sizeof(MeshVertex) * fetchedVertexCount);
+}
+
+uint64_t HashMeshGeometry(const RendererGeometry* geometry, const GPUMesh* mesh)
+{
+	ASSERT(mesh->vertexOffset + mesh->vertexCount <= geometry->vertexCount);
+	ASSERT(mesh->indexOffset + mesh->indexCount <= geometry->indexCount);
+	ASSERT(mesh->submeshOffset + mesh->submeshCount <= geometry->submeshCount);
+
+	// NOTE(gmodarelli): Meshlets are built from the vertices and indices, so they don't need hashing
+	uint64_t hash = HashBytes(&mesh->indexSize, sizeof(mesh->indexSize), 0);
+	hash = HashBytes(&mesh->lodCount, sizeof(mesh->lodCount), hash);
+	hash = HashBytes(mesh->lods, sizeof(GPUMeshLod) * mesh->lodCount, hash);
+	hash = HashBytes(&geometry->vertices[mesh->vertexOffset], sizeof(MeshVertex) * mesh->vertexCount, hash);
+	hash = HashBytes(&geometry->indices[mesh->indexOffset], sizeof(uint32_t) * mesh->indexCount, hash);
+	hash = HashBytes(&mesh->submeshCount, sizeof(mesh->submeshCount), hash);
+	hash = HashBytes(&geometry->submeshes[mesh->submeshOffset], sizeof(GPUSubmesh) * mesh->submeshCount, hash);
+	return hash;
+}
+
+void DestroyImportedMesh(ImportedMesh* importedMesh)
+{
+	tf_free(importedMesh->geometry.vertices);
+	tf_free(importedMesh->geometry.indices);
+	tf_free(importedMesh->geometry.meshlets);
+	tf_free(importedMesh->geometry.meshletVertices);
+	tf_free(importedMesh->geometry.meshletTriangles);
+	tf_free(importedMesh->geometry.submeshes);
+	*importedMesh = {};
+}
+
+struct ImportMeshesJob
+{
+	const char* const* paths = NULL;
+	ImportedMesh* importedMeshes = NULL;
+	bool* results = NULL;
+	uint32_t count = 0;
+	tfrg_atomic32_t nextMesh = 0;
+};
+
+struct ImportMeshesWorker
+{
+	ImportMeshesJob* job = NULL;
+	uint32_t maxWorkers = UINT32_MAX;
+	size_t scratchHighWaterMark = 0;
+};
+
+// NOTE: Every worker owns its scratch memory and pulls meshes from the job until there are none left.
+// Results are written to the slot of each mesh, so the output doesn't depend on scheduling.
+static void importMeshesWorker(void* userData)
+{
+	ImportMeshesWorker* worker = (ImportMeshesWorker*)userData;
+	ImportMeshesJob* job = worker->job;
+	ScratchGeometryData scratch = {};
+	scratch.maxWorkers = worker->maxWorkers;
+
+	while (true)
+	{
+		uint32_t meshIndex = (uint32_t)tfrg_atomic32_add_relaxed(&job->nextMesh, 1);
+		if (meshIndex >= job->count)
+		{
+			break;
+		}
+
+		job->results[meshIndex] = ImportMesh(job->paths[meshIndex], &scratch, &job->importedMeshes[meshIndex]);
+	}
+
+	worker->scratchHighWaterMark = scratch.arena.highWaterMark;
+	scratch.destroy();
+}
+
+uint32_t ImportMeshes(const char* const* paths, uint32_t count, ImportedMesh* importedMeshes, bool* results)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	ImportMeshesJob job = {};
+	job.paths = paths;
+	job.importedMeshes = importedMeshes;
+	job.results = results;
+	job.count = count;
+
+	// The calling thread works too, so we only spawn (workerCount - 1) threads
+	uint32_t workerCount = TF_MIN(TF_MAX(::getNumCPUCores(), 1u), count);
+	workerCount = TF_MIN(workerCount, k_MeshImportMaxWorkers);
+	::ThreadHandle threads[k_MeshImportMaxWorkers] = {};
+	ImportMeshesWorker workers[k_MeshImportMaxWorkers] = {};
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		workers[i].job = &job;
+		// NOTE(gmodarelli): A single mesh gets the whole machine for its parsing and tangents
+		workers[i].maxWorkers = workerCount > 1 ? 1 : UINT32_MAX;
+	}
+
+	for (uint32_t i = 1; i < workerCount; ++i)
+	{
+		::ThreadDesc threadDesc = {};
+		threadDesc.pFunc = importMeshesWorker;
+		threadDesc.pData = &workers[i];
+		snprintf(threadDesc.mThreadName, sizeof(threadDesc.mThreadName), "MeshImport %u", i);
+		::initThread(&threadDesc, &threads[i]);
+	}
+
+	importMeshesWorker(&workers[0]);
+
+	for (uint32_t i = 1; i < workerCount; ++i)
+	{
+		::joinThread(threads[i]);
+	}
+
+	size_t scratchHighWaterMark = 0;
+	size_t scratchTotalSize = 0;
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		scratchHighWaterMark = TF_MAX(scratchHighWaterMark, workers[i].scratchHighWaterMark);
+		scratchTotalSize += workers[i].scratchHighWaterMark;
+	}
+	LOGF(eINFO, "Imported %u meshes on %u workers, scratch high-water mark: %.2f MB per worker, %.2f MB total",
+		count, workerCount, scratchHighWaterMark / (1024.0 * 1024.0), scratchTotalSize / (1024.0 * 1024.0));
+
+	uint32_t importedCount = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		importedCount += results[i] ? 1 : 0;
+	}
+
+	return importedCount;
+}
+
+void ScratchGeometryData::reset(uint32_t vertexCount, uint32_t indexCount)
+{
+	// NOTE(gmodarelli): Nothing is cleared, every buffer is fully written before being read
+	arena.reset();
+
+	verticesMaxCount = vertexCount;
+	indicesMaxCount = indexCount;
+	importVertices = arena.allocArray<ImportVertex>(vertexCount);
+	geometry = {};
+	geometry.vertices = arena.allocArray<MeshVertex>(vertexCount);
+	geometry.indices = arena.allocArray<uint32_t>(indexCount);
+}
+
+void ScratchGeometryData::destroy()
+{
+	arena.destroy();
+	importVertices = NULL;
+	geometry = {};
+	verticesMaxCount = 0;
+	indicesMaxCount = 0;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+// Math
+#include <Utilities/Math/MathTypes.h>
+
+// Shader Interop
+#include <ShaderGlobals.h>
+
+#include "Arena.h"
+
+const uint32_t k_MeshImportMaxWorkers = 64;
+
+// NOTE(gmodarelli): 64 vertices and 124 triangles per meshlet are the limits recommended by
+// meshoptimizer for mesh shaders and cluster culling on NVIDIA and AMD.
+const uint32_t k_MeshletMaxVertices = 64;
+const uint32_t k_MeshletMaxTriangles = 124;
+const float k_MeshletConeWeight = 0.25f;
+
+// Every LOD targets half the triangles of the previous one, without deviating from the
+// full mesh more than k_MeshLodMaxError (relative to the mesh extents)
+const float k_MeshLodTargetRatio = 0.5f;
+const float k_MeshLodMaxError = 0.05f;
+
+// An OBJ is split in one submesh per object and material. Files with more pairs than this are
+// split per material only, and whatever doesn't fit goes into the last submesh.
+const uint32_t k_MeshMaxSubmeshes = 64;
+
+struct RendererGeometry
+{
+	MeshVertex* vertices = NULL;
+	uint32_t* indices = NULL;
+	GPUMeshlet* meshlets = NULL;
+	uint32_t* meshletVertices = NULL;
+	uint32_t* meshletTriangles = NULL;
+	GPUSubmesh* submeshes = NULL;
+
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t meshletCount = 0;
+	uint32_t meshletVertexCount = 0;
+	uint32_t meshletTriangleCount = 0;
+	uint32_t submeshCount = 0;
+};
+
+// Full precision vertex used while importing a mesh, before it gets packed into a MeshVertex
+struct ImportVertex
+{
+	float3 position;
+	float3 normal;
+	float4 tangent;
+	float3 color;
+	float2 uv;
+};
+
+// Temporary memory used while importing a mesh (de-indexed vertices, their tangents and the
+// buffers of the optimization passes). Everything comes from an arena that is rewound for every
+// mesh, so it grows to fit the largest mesh and is never cleared. Each import thread owns one.
+struct ScratchGeometryData
+{
+	Arena arena = {};
+	ImportVertex* importVertices = NULL;
+	RendererGeometry geometry = {};
+	uint32_t verticesMaxCount = 0;
+	uint32_t indicesMaxCount = 0;
+	// Threads ReadObjFile and GenerateTangents (see k_TangentsParallelImport) may use for a large mesh.
+	// Import workers set it to 1, since they already keep every core busy.
+	uint32_t maxWorkers = UINT32_MAX;
+
+	// Rewinds the arena and allocates the de-indexed buffers of a mesh
+	void reset(uint32_t vertexCount, uint32_t indexCount);
+	void destroy();
+};
+
+// Wall time spent in every stage of ImportMesh, in microseconds
+struct MeshImportStats
+{
+	// Vertices before indexing (3 per triangle)
+	uint32_t sourceVertexCount = 0;
+	// The source was big enough for ParseObjParallel (see ObjParser.h)
+	bool parsedInParallel = false;
+
+	int64_t parseTime = 0;			// fast_obj or ParseObjParallel
+	int64_t expandTime = 0;			// De-indexing into ImportVertex
+	int64_t tangentsTime = 0;		// MikkTSpace
+	int64_t packTime = 0;
+	int64_t remapTime = 0;			// Vertex remap and index buffer generation
+	int64_t optimizeTime = 0;
+	int64_t analyzeTime = 0;		// Before/after optimization stats
+	int64_t meshletsTime = 0;
+	int64_t lodsTime = 0;
+	int64_t totalTime = 0;
+};
+
+// A mesh imported on its own. Its geometry is owned by the ImportedMesh and
+// the offsets in mesh are zero until it gets appended to a RendererGeometry.
+struct ImportedMesh
+{
+	RendererGeometry geometry = {};
+	GPUMesh mesh = {};
+	MeshImportStats stats = {};
+	// See HashMeshGeometry
+	uint64_t contentHash = 0;
+};
+
+// Imports an OBJ file, generates MikkTSpace tangents, packs and indexes its vertices,
+// splits it into submeshes and meshlets and generates its LOD chain.
+// Safe to call from multiple threads as long as each one uses its own scratch.
+bool ImportMesh(const char* path, ScratchGeometryData* scratch, ImportedMesh* importedMesh);
+void DestroyImportedMesh(ImportedMesh* importedMesh);
+
+// Hashes the final vertices, indices and LOD ranges of a mesh. Meshes with the same hash are drawn
+// the same way, so the renderer keeps a single copy of them (see AddGeometryMesh).
+uint64_t HashMeshGeometry(const RendererGeometry* geometry, const GPUMesh* mesh);
+
+// Imports count meshes on a pool of worker threads.
+// importedMeshes[i] and results[i] receive the result for paths[i]. Returns the number of meshes imported.
+uint32_t ImportMeshes(const char* const* paths, uint32_t count, ImportedMesh* importedMeshes, bool* results);
@@ -0,0 +1,296 @@
+#include "MeshTangents.h"
+#include "MeshImporter.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// meshoptimizer
+#include <meshoptimizer.h>
+
+// MikkTSpace
+
+#include <mikktspace.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IThread.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// A range of triangles processed by one MikkTSpace run
+struct TangentJob
+{
+	ImportVertex* vertices = NULL;
+	const uint32_t* triangles = NULL;
+	uint32_t triangleCount = 0;
+};
+
+// Vertex key used to find the connected components, see findTangentComponents
+struct TangentWeldKey
+{
+	float position[3];
+	float normal[3];
+	float texcoord[2];
+};
+
+int32_t mikkt_GetNumFaces(const SMikkTSpaceContext* context);
+int32_t mikkt_GetNumVerticesOfFace(const SMikkTSpaceContext* context, int32_t faceIndex);
+void mikkt_GetPosition(const SMikkTSpaceContext* context, float position[3], int32_t faceIndex, int32_t vertIndex);
+void mikkt_GetNormal(const SMikkTSpaceContext* context, float normal[3], int32_t faceIndex, int32_t vertIndex);
+void mikkt_GetTexcoord(const SMikkTSpaceContext* context, float texcoord[2], int32_t faceIndex, int32_t vertIndex);
+void mikkt_SetTSpaceBasic(const SMikkTSpaceContext* context, const float tangent[3], float sign, int32_t faceIndex, int32_t vertIndex);
+
+static void runTangentJob(void* userData)
+{
+	TangentJob* job = (TangentJob*)userData;
+	if (job->triangleCount == 0)
+	{
+		return;
+	}
+
+	::SMikkTSpaceInterface mikktInterface = {};
+	mikktInterface.m_getNumFaces = mikkt_GetNumFaces;
+	mikktInterface.m_getNumVerticesOfFace = mikkt_GetNumVerticesOfFace;
+	mikktInterface.m_getPosition = mikkt_GetPosition;
+	mikktInterface.m_getNormal = mikkt_GetNormal;
+	mikktInterface.m_getTexCoord = mikkt_GetTexcoord;
+	mikktInterface.m_setTSpaceBasic = mikkt_SetTSpaceBasic;
+
+	::SMikkTSpaceContext mikktContext = {};
+	mikktContext.m_pInterface = &mikktInterface;
+	mikktContext.m_pUserData = (void*)job;
+
+	::genTangSpaceDefault(&mikktContext);
+}
+
+static uint32_t findRoot(uint32_t* parents, uint32_t index)
+{
+	while (parents[index] != index)
+	{
+		// Path halving
+		parents[index] = parents[parents[index]];
+		index = parents[index];
+	}
+	return index;
+}
+
+// Returns the component of every triangle, as the index of one of its welded vertices
+static uint32_t* findTangentComponents(const ImportVertex* vertices, uint32_t triangleCount, Arena* arena)
+{
+	const uint32_t cornerCount = triangleCount * 3;
+
+	// NOTE(gmodarelli): MikkTSpace welds vertices whose attributes compare equal as floats, while the
+	// remap compares bytes. Adding 0 turns -0 into +0 so that no vertex welded by MikkTSpace is missed.
+	// NaNs get welded here and not by MikkTSpace, which only makes components larger.
+	TangentWeldKey* keys = arena->allocArray<TangentWeldKey>(cornerCount);
+	for (uint32_t i = 0; i < cornerCount; ++i)
+	{
+		const ImportVertex& vertex = vertices[i];
+		TangentWeldKey* key = &keys[i];
+		key->position[0] = vertex.position.x + 0.0f;
+		key->position[1] = vertex.position.y + 0.0f;
+		key->position[2] = vertex.position.z + 0.0f;
+		key->normal[0] = vertex.normal.x + 0.0f;
+		key->normal[1] = vertex.normal.y + 0.0f;
+		key->normal[2] = vertex.normal.z + 0.0f;
+		key->texcoord[0] = vertex.uv.x + 0.0f;
+		key->texcoord[1] = vertex.uv.y + 0.0f;
+	}
+
+	uint32_t* remap = arena->allocArray<uint32_t>(cornerCount);
+	size_t weldedCount = meshopt_generateVertexRemap(remap, NULL, cornerCount, keys, cornerCount, sizeof(TangentWeldKey));
+
+	uint32_t* parents = arena->allocArray<uint32_t>(weldedCount);
+	for (uint32_t i = 0; i < (uint32_t)weldedCount; ++i)
+	{
+		parents[i] = i;
+	}
+
+	for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		uint32_t root0 = findRoot(parents, remap[triangle * 3 + 0]);
+		for (uint32_t corner = 1; corner < 3; ++corner)
+		{
+			uint32_t root = findRoot(parents, remap[triangle * 3 + corner]);
+			if (root != root0)
+			{
+				// Keep the smallest index as root, so it doesn't depend on the merge order
+				if (root < root0)
+				{
+					parents[root0] = root;
+					root0 = root;
+				}
+				else
+				{
+					parents[root] = root0;
+				}
+			}
+		}
+	}
+
+	uint32_t* components = arena->allocArray<uint32_t>(triangleCount);
+	for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		components[triangle] = findRoot(parents, remap[triangle * 3]);
+	}
+
+	return components;
+}
+
+void GenerateTangents(ImportVertex* vertices, uint32_t vertexCount, uint32_t maxWorkerCount, Arena* arena)
+{
+	ASSERT(vertexCount % 3 == 0);
+	const uint32_t triangleCount = vertexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	uint32_t workerCount = TF_MIN(TF_MAX(::getNumCPUCores(), 1u), k_TangentsMaxWorkers);
+	workerCount = TF_MIN(workerCount, TF_MAX(maxWorkerCount, 1u));
+	if (triangleCount < k_TangentsParallelMinTriangles)
+	{
+		workerCount = 1;
+	}
+
+	uint32_t* triangles = arena->allocArray<uint32_t>(triangleCount);
+	TangentJob jobs[k_TangentsMaxWorkers] = {};
+	uint32_t jobCount = 1;
+
+	if (workerCount == 1)
+	{
+		for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			triangles[triangle] = triangle;
+		}
+		jobs[0].vertices = vertices;
+		jobs[0].triangles = triangles;
+		jobs[0].triangleCount = triangleCount;
+	}
+	else
+	{
+		const uint32_t* components = findTangentComponents(vertices, triangleCount, arena);
+
+		// Components are given to the jobs in order of first appearance, filling each job up to
+		// its share of the triangles. A component is never split, so a mesh made of a single
+		// component ends up in one job.
+		uint32_t* componentTriangleCounts = arena->allocArray<uint32_t>(vertexCount);
+		uint32_t* componentJobs = arena->allocArray<uint32_t>(vertexCount);
+		memset(componentTriangleCounts, 0, sizeof(uint32_t) * vertexCount);
+		for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			componentTriangleCounts[components[triangle]]++;
+		}
+
+		const uint32_t jobTargetCount = (triangleCount + workerCount - 1) / workerCount;
+		uint32_t jobIndex = 0;
+		for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			uint32_t component = components[triangle];
+			if (componentTriangleCounts[component] == 0)
+			{
+				// Already assigned
+				continue;
+			}
+
+			if (jobs[jobIndex].triangleCount >= jobTargetCount && jobIndex + 1 < workerCount)
+			{
+				jobIndex++;
+			}
+
+			componentJobs[component] = jobIndex;
+			jobs[jobIndex].triangleCount += componentTriangleCounts[component];
+			componentTriangleCounts[component] = 0;
+		}
+		jobCount = jobIndex + 1;
+
+		// Triangles keep their relative order inside each job
+		uint32_t* jobCursors = arena->allocArray<uint32_t>(jobCount);
+		uint32_t jobOffset = 0;
+		for (uint32_t i = 0; i < jobCount; ++i)
+		{
+			jobs[i].vertices = vertices;
+			jobs[i].triangles = &triangles[jobOffset];
+			jobCursors[i] = jobOffset;
+			jobOffset += jobs[i].triangleCount;
+		}
+		ASSERT(jobOffset == triangleCount);
+
+		for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			triangles[jobCursors[componentJobs[components[triangle]]]++] = triangle;
+		}
+	}
+
+	// The calling thread runs the first job
+	::ThreadHandle threads[k_TangentsMaxWorkers] = {};
+	for (uint32_t i = 1; i < jobCount; ++i)
+	{
+		::ThreadDesc threadDesc = {};
+		threadDesc.pFunc = runTangentJob;
+		threadDesc.pData = &jobs[i];
+		snprintf(threadDesc.mThreadName, sizeof(threadDesc.mThreadName), "Tangents %u", i);
+		::initThread(&threadDesc, &threads[i]);
+	}
+
+	runTangentJob(&jobs[0]);
+
+	for (uint32_t i = 1; i < jobCount; ++i)
+	{
+		::joinThread(threads[i]);
+	}
+}
+
+int32_t mikkt_GetNumFaces(const SMikkTSpaceContext* context)
+{
+	const TangentJob* job = (const TangentJob*)context->m_pUserData;
+	return (int32_t)job->triangleCount;
+}
+
+int32_t mikkt_GetNumVerticesOfFace(const SMikkTSpaceContext* context, int32_t faceIndex)
+{
+	(void)context;
+	(void)faceIndex;
+
+	return 3;
+}
+
+static inline uint32_t mikktCorner(const SMikkTSpaceContext* context, int32_t faceIndex, int32_t vertIndex)
+{
+	const TangentJob* job = (const TangentJob*)context->m_pUserData;
+	ASSERT((uint32_t)faceIndex < job->triangleCount);
+	return job->triangles[faceIndex] * 3 + (uint32_t)vertIndex;
+}
+
+void mikkt_GetPosition(const SMikkTSpaceContext* context, float position[3], int32_t faceIndex, int32_t vertIndex)
+{
+	const ImportVertex& vertex = ((const TangentJob*)context->m_pUserData)->vertices[mikktCorner(context, faceIndex, vertIndex)];
+	position[0] = vertex.position.x;
+	position[1] = vertex.position.y;
+	position[2] = vertex.position.z;
+}
+
+void mikkt_GetNormal(const SMikkTSpaceContext* context, float normal[3], int32_t faceIndex, int32_t vertIndex)
+{
+	const ImportVertex& vertex = ((const TangentJob*)context->m_pUserData)->vertices[mikktCorner(context, faceIndex, vertIndex)];
+	normal[0] = vertex.normal.x;
+	normal[1] = vertex.normal.y;
+	normal[2] = vertex.normal.z;
+}
+
+void mikkt_GetTexcoord(const SMikkTSpaceContext* context, float texcoord[2], int32_t faceIndex, int32_t vertIndex)
+{
+	const ImportVertex& vertex = ((const TangentJob*)context->m_pUserData)->vertices[mikktCorner(context, faceIndex, vertIndex)];
+	texcoord[0] = vertex.uv.x;
+	texcoord[1] = vertex.uv.y;
+}
+
+void mikkt_SetTSpaceBasic(const SMikkTSpaceContext* context, const float tangent[3], float sign, int32_t faceIndex, int32_t vertIndex)
+{
+	// NOTE: Jobs own disjoint triangles, so they never write the same vertex
+	ImportVertex& vertex = ((const TangentJob*)context->m_pUserData)->vertices[mikktCorner(context, faceIndex, vertIndex)];
+	vertex.tangent.x = tangent[0];
+	vertex.tangent.y = tangent[1];
+	vertex.tangent.z = tangent[2];
+	vertex.tangent.w = sign;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Arena;
+struct ImportVertex;
+
+// NOTE(gmodarelli): Meshes below this many triangles are not worth spawning threads for
+const uint32_t k_TangentsParallelMinTriangles = 32 * 1024;
+const uint32_t k_TangentsMaxWorkers = 16;
+// NOTE(gmodarelli): The importer runs GenerateTangents on a single thread until MeshTangentsTests has
+// passed on the shipped meshes. Splitting a mesh renumbers the vertices MikkTSpace welds, which could
+// change the order it visits neighbours in, so matching MikkTSpace bit for bit isn't a given.
+const bool k_TangentsParallelImport = false;
+
+// Generates MikkTSpace tangents for de-indexed vertices (3 per triangle), writing ImportVertex::tangent.
+//
+// MikkTSpace reads the vertices through its per-corner callbacks. Large meshes can be split in
+// triangle ranges made of whole connected components (triangles sharing a vertex with the same
+// position, normal and texcoord, which is how MikkTSpace welds vertices), and each range run on its
+// own thread. A mesh made of a single component always runs on one thread.
+// MeshTangentsTests compares the result with a single MikkTSpace run over the whole mesh.
+//
+// At most maxWorkerCount threads are used, including the calling one. Scratch memory comes from
+// arena and is released with it.
+void GenerateTangents(ImportVertex* vertices, uint32_t vertexCount, uint32_t maxWorkerCount, Arena* arena);
@@ -0,0 +1,812 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// fast_obj
+
+#define FAST_OBJ_IMPLEMENTATION
+#include <fast_obj.h>
+
+// The-Forge
+
+#include <Utilities/Math/MathTypes.h>
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IThread.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// NOTE(gmodarelli): Relative (negative) indices can point before the start of their chunk, so the
+// chunk parser stores them relative to the chunk, shifted below zero by this bias, and they are made
+// absolute once the number of elements of the previous chunks is known. See encodeIndex/decodeIndex.
+const int32_t k_ObjRelativeIndexBias = 1 << 30;
+
+// Growable array used by the chunk parsers
+template <typename T>
+struct ChunkArray
+{
+	T* data = NULL;
+	uint32_t count = 0;
+	uint32_t capacity = 0;
+
+	void push(const T& value)
+	{
+		if (count == capacity)
+		{
+			capacity = capacity > 0 ? capacity * 2 : 1024;
+			data = (T*)tf_realloc(data, sizeof(T) * capacity);
+			ASSERT(data);
+		}
+		data[count++] = value;
+	}
+
+	void destroy()
+	{
+		tf_free(data);
+		data = NULL;
+		count = 0;
+		capacity = 0;
+	}
+};
+
+enum class ObjStatement
+{
+	Object = 0,
+	Group,
+	UseMaterial,
+	MaterialLibrary,
+};
+
+// A statement that changes the parser state, replayed in file order when the chunks are merged
+struct ObjEvent
+{
+	ObjStatement statement;
+	// Faces and indices of the chunk read before the statement
+	uint32_t faceCount;
+	uint32_t indexCount;
+	// Points into the mapped file
+	const char* name;
+	uint32_t nameLength;
+	// UseMaterial only, resolved when merging
+	uint32_t material;
+};
+
+// Like fastObjIndex, see encodeIndex
+struct ObjChunkIndex
+{
+	int32_t p;
+	int32_t t;
+	int32_t n;
+};
+
+struct ObjChunk
+{
+	const char* begin = NULL;
+	const char* end = NULL;
+
+	ChunkArray<float> positions;
+	// Only filled once the chunk has seen a vertex color, padded with white for the earlier vertices
+	ChunkArray<float> colors;
+	ChunkArray<float> texcoords;
+	ChunkArray<float> normals;
+	ChunkArray<uint32_t> faceVertices;
+	ChunkArray<ObjChunkIndex> indices;
+	ChunkArray<ObjEvent> events;
+
+	// Set when merging
+	fastObjMesh* mesh = NULL;
+	uint32_t positionBase = 0;
+	uint32_t texcoordBase = 0;
+	uint32_t normalBase = 0;
+	uint32_t faceBase = 0;
+	uint32_t indexBase = 0;
+	// Material of the faces read before the first usemtl of the chunk
+	uint32_t firstMaterial = 0;
+	uint32_t invalidIndexCount = 0;
+};
+
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* skipSpaces(const char* ptr, const char* end)
+{
+	while (ptr < end && isSpace(*ptr))
+	{
+		ptr++;
+	}
+	return ptr;
+}
+
+// True if the statement at ptr is keyword followed by a space
+static inline bool isStatement(const char* ptr, const char* end, const char* keyword, size_t keywordLength)
+{
+	return (size_t)(end - ptr) > keywordLength && memcmp(ptr, keyword, keywordLength) == 0 && isSpace(ptr[keywordLength]);
+}
+
+// NOTE(gmodarelli): Same approach as fast_obj, digits are accumulated in a double. Unlike strtod it
+// doesn't depend on the locale and it stops at the end of the line, which isn't null terminated.
+static const char* parseFloat(const char* ptr, const char* end, float* value)
+{
+	ptr = skipSpaces(ptr, end);
+
+	double sign = 1.0;
+	if (ptr < end && (*ptr == '+' || *ptr == '-'))
+	{
+		sign = *ptr == '-' ? -1.0 : 1.0;
+		ptr++;
+	}
+
+	double number = 0.0;
+	while (ptr < end && isDigit(*ptr))
+	{
+		number = number * 10.0 + (double)(*ptr++ - '0');
+	}
+
+	if (ptr < end && *ptr == '.')
+	{
+		ptr++;
+		double fraction = 0.0;
+		double divisor = 1.0;
+		while (ptr < end && isDigit(*ptr))
+		{
+			fraction = fraction * 10.0 + (double)(*ptr++ - '0');
+			divisor *= 10.0;
+		}
+		number += fraction / divisor;
+	}
+
+	if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+	{
+		ptr++;
+		int exponentSign = 1;
+		if (ptr < end && (*ptr == '+' || *ptr == '-'))
+		{
+			exponentSign = *ptr == '-' ? -1 : 1;
+			ptr++;
+		}
+
+		int exponent = 0;
+		while (ptr < end && isDigit(*ptr))
+		{
+			exponent = TF_MIN(exponent * 10 + (*ptr++ - '0'), 1000);
+		}
+		number *= pow(10.0, (double)(exponentSign * exponent));
+	}
+
+	*value = (float)(sign * number);
+	return ptr;
+}
+
+static const char* parseInt(const char* ptr, const char* end, int32_t* value)
+{
+	int32_t sign = 1;
+	if (ptr < end && (*ptr == '+' || *ptr == '-'))
+	{
+		sign = *ptr == '-' ? -1 : 1;
+		ptr++;
+	}
+
+	int32_t number = 0;
+	while (ptr < end && isDigit(*ptr))
+	{
+		number = number * 10 + (*ptr++ - '0');
+	}
+
+	*value = sign * number;
+	return ptr;
+}
+
+// count is the number of elements read by the chunk so far
+static inline int32_t encodeIndex(int32_t value, uint32_t count)
+{
+	// Absolute indices are 1-based, 0 means missing
+	if (value >= 0)
+	{
+		return value;
+	}
+
+	return (int32_t)count + value + 1 - k_ObjRelativeIndexBias;
+}
+
+// base is the number of elements read by the previous chunks, count the number of elements in the
+// mesh (including the dummy element 0). Out of range indices point at the dummy element.
+static inline uint32_t decodeIndex(int32_t value, uint32_t base, uint32_t count, uint32_t* invalidIndexCount)
+{
+	int64_t index = value >= 0 ? (int64_t)value : (int64_t)base + value + k_ObjRelativeIndexBias;
+	if (index < 0 || index >= (int64_t)count)
+	{
+		(*invalidIndexCount)++;
+		return 0;
+	}
+
+	return (uint32_t)index;
+}
+
+static void parseVertexLine(ObjChunk* chunk, const char* ptr, const char* end)
+{
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		float value = 0.0f;
+		ptr = parseFloat(ptr, end, &value);
+		chunk->positions.push(value);
+	}
+
+	ptr = skipSpaces(ptr, end);
+	const bool hasColor = ptr < end && *ptr != '#';
+	if (hasColor && chunk->colors.count == 0)
+	{
+		// First color of the chunk, the previous vertices are white
+		for (uint32_t i = 0; i + 3 < chunk->positions.count; ++i)
+		{
+			chunk->colors.push(1.0f);
+		}
+	}
+
+	if (hasColor)
+	{
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			float value = 0.0f;
+			ptr = parseFloat(ptr, end, &value);
+			chunk->colors.push(value);
+		}
+	}
+	else if (chunk->colors.count > 0)
+	{
+		chunk->colors.push(1.0f);
+		chunk->colors.push(1.0f);
+		chunk->colors.push(1.0f);
+	}
+}
+
+static void parseFaceLine(ObjChunk* chunk, const char* ptr, const char* end)
+{
+	const uint32_t positionCount = chunk->positions.count / 3;
+	const uint32_t texcoordCount = chunk->texcoords.count / 2;
+	const uint32_t normalCount = chunk->normals.count / 3;
+
+	uint32_t vertexCount = 0;
+	while (true)
+	{
+		ptr = skipSpaces(ptr, end);
+		if (ptr >= end || *ptr == '#')
+		{
+			break;
+		}
+
+		int32_t p = 0;
+		int32_t t = 0;
+		int32_t n = 0;
+		ptr = parseInt(ptr, end, &p);
+		if (ptr < end && *ptr == '/')
+		{
+			ptr++;
+			if (ptr < end && *ptr != '/')
+			{
+				ptr = parseInt(ptr, end, &t);
+			}
+
+			if (ptr < end && *ptr == '/')
+			{
+				ptr++;
+				ptr = parseInt(ptr, end, &n);
+			}
+		}
+
+		// Skip anything we didn't understand, so malformed lines can't loop forever
+		while (ptr < end && !isSpace(*ptr))
+		{
+			ptr++;
+		}
+
+		ObjChunkIndex index = {};
+		index.p = encodeIndex(p, positionCount);
+		index.t = encodeIndex(t, texcoordCount);
+		index.n = encodeIndex(n, normalCount);
+		chunk->indices.push(index);
+		vertexCount++;
+	}
+
+	if (vertexCount > 0)
+	{
+		chunk->faceVertices.push(vertexCount);
+	}
+}
+
+static void pushEvent(ObjChunk* chunk, ObjStatement statement, const char* ptr, const char* end)
+{
+	ptr = skipSpaces(ptr, end);
+	while (end > ptr && isSpace(end[-1]))
+	{
+		end--;
+	}
+
+	ObjEvent event = {};
+	event.statement = statement;
+	event.faceCount = chunk->faceVertices.count;
+	event.indexCount = chunk->indices.count;
+	event.name = ptr;
+	event.nameLength = (uint32_t)(end - ptr);
+	chunk->events.push(event);
+}
+
+static void parseObjChunk(void* userData)
+{
+	ObjChunk* chunk = (ObjChunk*)userData;
+	const char* ptr = chunk->begin;
+	const char* end = chunk->end;
+
+	while (ptr < end)
+	{
+		const char* lineEnd = (const char*)memchr(ptr, '\n', (size_t)(end - ptr));
+		if (!lineEnd)
+		{
+			lineEnd = end;
+		}
+
+		ptr = skipSpaces(ptr, lineEnd);
+		if (isStatement(ptr, lineEnd, "v", 1))
+		{
+			parseVertexLine(chunk, ptr + 1, lineEnd);
+		}
+		else if (isStatement(ptr, lineEnd, "vt", 2))
+		{
+			float u = 0.0f;
+			float v = 0.0f;
+			const char* next = parseFloat(ptr + 2, lineEnd, &u);
+			parseFloat(next, lineEnd, &v);
+			chunk->texcoords.push(u);
+			chunk->texcoords.push(v);
+		}
+		else if (isStatement(ptr, lineEnd, "vn", 2))
+		{
+			const char* next = ptr + 2;
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				float value = 0.0f;
+				next = parseFloat(next, lineEnd, &value);
+				chunk->normals.push(value);
+			}
+		}
+		else if (isStatement(ptr, lineEnd, "f", 1))
+		{
+			parseFaceLine(chunk, ptr + 1, lineEnd);
+		}
+		else if (isStatement(ptr, lineEnd, "o", 1))
+		{
+			pushEvent(chunk, ObjStatement::Object, ptr + 1, lineEnd);
+		}
+		else if (isStatement(ptr, lineEnd, "g", 1))
+		{
+			pushEvent(chunk, ObjStatement::Group, ptr + 1, lineEnd);
+		}
+		else if (isStatement(ptr, lineEnd, "usemtl", 6))
+		{
+			pushEvent(chunk, ObjStatement::UseMaterial, ptr + 6, lineEnd);
+		}
+		else if (isStatement(ptr, lineEnd, "mtllib", 6))
+		{
+			pushEvent(chunk, ObjStatement::MaterialLibrary, ptr + 6, lineEnd);
+		}
+
+		ptr = lineEnd + 1;
+	}
+}
+
+static char* copyString(const char* string, size_t length)
+{
+	char* copy = (char*)tf_malloc(length + 1);
+	ASSERT(copy);
+	memcpy(copy, string, length);
+	copy[length] = '\0';
+	return copy;
+}
+
+// Adds the materials defined by a material library (newmtl statements), in file order
+static void readMaterialLibrary(const char* objPath, const char* name, uint32_t nameLength, ChunkArray<char*>* materialNames)
+{
+	// Material libraries are relative to the OBJ file
+	char path[FS_MAX_PATH] = {};
+	const char* separator = strrchr(objPath, '/');
+	const char* backslash = strrchr(objPath, '\\');
+	if (backslash > separator)
+	{
+		separator = backslash;
+	}
+	const int directoryLength = separator ? (int)(separator - objPath + 1) : 0;
+	snprintf(path, sizeof(path), "%.*s%.*s", directoryLength, objPath, (int)nameLength, name);
+
+	MappedFile library = {};
+	if (!MapFile(path, &library))
+	{
+		LOGF(eWARNING, "Couldn't read material library '%s'", path);
+		return;
+	}
+
+	const char* ptr = library.data;
+	const char* end = library.data + library.size;
+	while (ptr < end)
+	{
+		const char* lineEnd = (const char*)memchr(ptr, '\n', (size_t)(end - ptr));
+		if (!lineEnd)
+		{
+			lineEnd = end;
+		}
+
+		ptr = skipSpaces(ptr, lineEnd);
+		if (isStatement(ptr, lineEnd, "newmtl", 6))
+		{
+			const char* nameBegin = skipSpaces(ptr + 6, lineEnd);
+			const char* nameEnd = lineEnd;
+			while (nameEnd > nameBegin && isSpace(nameEnd[-1]))
+			{
+				nameEnd--;
+			}
+			materialNames->push(copyString(nameBegin, (size_t)(nameEnd - nameBegin)));
+		}
+
+		ptr = lineEnd + 1;
+	}
+
+	UnmapFile(&library);
+}
+
+static uint32_t findOrAddMaterial(const char* name, uint32_t nameLength, ChunkArray<char*>* materialNames)
+{
+	for (uint32_t i = 0; i < materialNames->count; ++i)
+	{
+		if (strlen(materialNames->data[i]) == nameLength && memcmp(materialNames->data[i], name, nameLength) == 0)
+		{
+			return i;
+		}
+	}
+
+	// NOTE: Like fast_obj, materials missing from the libraries are added with their name
+	materialNames->push(copyString(name, nameLength));
+	return materialNames->count - 1;
+}
+
+// Closes the current object or group at faceOffset, keeping it only if it has faces
+static void flushGroup(fastObjGroup* current, uint32_t faceOffset, uint32_t indexOffset, ChunkArray<fastObjGroup>* groups)
+{
+	current->face_count = faceOffset - current->face_offset;
+	if (current->face_count > 0)
+	{
+		groups->push(*current);
+	}
+	else
+	{
+		tf_free(current->name);
+	}
+
+	*current = {};
+	current->face_offset = faceOffset;
+	current->index_offset = indexOffset;
+}
+
+// Copies a parsed chunk to its place in the mesh, resolves its indices and assigns the materials of its faces
+static void mergeObjChunk(void* userData)
+{
+	ObjChunk* chunk = (ObjChunk*)userData;
+	fastObjMesh* mesh = chunk->mesh;
+
+	const uint32_t positionCount = chunk->positions.count / 3;
+	memcpy(&mesh->positions[(1 + chunk->positionBase) * 3], chunk->positions.data, sizeof(float) * chunk->positions.count);
+	memcpy(&mesh->texcoords[(1 + chunk->texcoordBase) * 2], chunk->texcoords.data, sizeof(float) * chunk->texcoords.count);
+	memcpy(&mesh->normals[(1 + chunk->normalBase) * 3], chunk->normals.data, sizeof(float) * chunk->normals.count);
+	float* colors = &mesh->colors[(1 + chunk->positionBase) * 3];
+	if (chunk->colors.count > 0)
+	{
+		ASSERT(chunk->colors.count == chunk->positions.count);
+		memcpy(colors, chunk->colors.data, sizeof(float) * chunk->colors.count);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < positionCount * 3; ++i)
+		{
+			colors[i] = 1.0f;
+		}
+	}
+
+	memcpy(&mesh->face_vertices[chunk->faceBase], chunk->faceVertices.data, sizeof(uint32_t) * chunk->faceVertices.count);
+
+	uint32_t material = chunk->firstMaterial;
+	uint32_t eventIndex = 0;
+	for (uint32_t face = 0; face < chunk->faceVertices.count; ++face)
+	{
+		while (eventIndex < chunk->events.count && chunk->events.data[eventIndex].faceCount <= face)
+		{
+			const ObjEvent& event = chunk->events.data[eventIndex++];
+			if (event.statement == ObjStatement::UseMaterial)
+			{
+				material = event.material;
+			}
+		}
+		mesh->face_materials[chunk->faceBase + face] = material;
+	}
+
+	for (uint32_t i = 0; i < chunk->indices.count; ++i)
+	{
+		const ObjChunkIndex& index = chunk->indices.data[i];
+		fastObjIndex* meshIndex = &mesh->indices[chunk->indexBase + i];
+		meshIndex->p = decodeIndex(index.p, chunk->positionBase, mesh->position_count, &chunk->invalidIndexCount);
+		meshIndex->t = decodeIndex(index.t, chunk->texcoordBase, mesh->texcoord_count, &chunk->invalidIndexCount);
+		meshIndex->n = decodeIndex(index.n, chunk->normalBase, mesh->normal_count, &chunk->invalidIndexCount);
+	}
+
+	chunk->positions.destroy();
+	chunk->colors.destroy();
+	chunk->texcoords.destroy();
+	chunk->normals.destroy();
+	chunk->faceVertices.destroy();
+	chunk->indices.destroy();
+}
+
+// Runs job on every chunk, one thread per chunk. The calling thread runs the first one.
+static void runObjChunkJobs(void (*job)(void*), ObjChunk* chunks, uint32_t chunkCount, const char* threadName)
+{
+	::ThreadHandle threads[k_ObjParserMaxWorkers] = {};
+	for (uint32_t i = 1; i < chunkCount; ++i)
+	{
+		::ThreadDesc threadDesc = {};
+		threadDesc.pFunc = job;
+		threadDesc.pData = &chunks[i];
+		snprintf(threadDesc.mThreadName, sizeof(threadDesc.mThreadName), "%s %u", threadName, i);
+		::initThread(&threadDesc, &threads[i]);
+	}
+
+	job(&chunks[0]);
+
+	for (uint32_t i = 1; i < chunkCount; ++i)
+	{
+		::joinThread(threads[i]);
+	}
+}
+
+static fastObjMesh* parseMappedObj(const char* path, const MappedFile& file, uint32_t maxWorkerCount)
+{
+	uint32_t chunkCount = TF_MIN(TF_MAX(::getNumCPUCores(), 1u), k_ObjParserMaxWorkers);
+	chunkCount = TF_MIN(chunkCount, TF_MAX(maxWorkerCount, 1u));
+	chunkCount = (uint32_t)TF_MIN((uint64_t)chunkCount, TF_MAX(file.size / k_ObjParserMinChunkSize, (uint64_t)1));
+
+	// Chunks end right after a line break, so no line is split between two chunks
+	ObjChunk chunks[k_ObjParserMaxWorkers] = {};
+	const uint64_t chunkSize = file.size / chunkCount;
+	const char* fileEnd = file.data + file.size;
+	const char* chunkBegin = file.data;
+	for (uint32_t i = 0; i < chunkCount; ++i)
+	{
+		const char* chunkEnd = fileEnd;
+		if (i + 1 < chunkCount)
+		{
+			chunkEnd = TF_MAX(file.data + chunkSize * (i + 1), chunkBegin);
+			const char* lineBreak = (const char*)memchr(chunkEnd, '\n', (size_t)(fileEnd - chunkEnd));
+			chunkEnd = lineBreak ? lineBreak + 1 : fileEnd;
+		}
+
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	runObjChunkJobs(parseObjChunk, chunks, chunkCount, "ObjParse");
+
+	fastObjMesh* mesh = (fastObjMesh*)tf_malloc(sizeof(fastObjMesh));
+	ASSERT(mesh);
+	memset(mesh, 0, sizeof(fastObjMesh));
+
+	// Element 0 of every vertex stream is a dummy, like in fast_obj
+	uint32_t positionCount = 1;
+	uint32_t texcoordCount = 1;
+	uint32_t normalCount = 1;
+	uint32_t faceCount = 0;
+	uint32_t indexCount = 0;
+	for (uint32_t i = 0; i < chunkCount; ++i)
+	{
+		ObjChunk* chunk = &chunks[i];
+		chunk->mesh = mesh;
+		chunk->positionBase = positionCount - 1;
+		chunk->texcoordBase = texcoordCount - 1;
+		chunk->normalBase = normalCount - 1;
+		chunk->faceBase = faceCount;
+		chunk->indexBase = indexCount;
+		positionCount += chunk->positions.count / 3;
+		texcoordCount += chunk->texcoords.count / 2;
+		normalCount += chunk->normals.count / 3;
+		faceCount += chunk->faceVertices.count;
+		indexCount += chunk->indices.count;
+	}
+
+	mesh->position_count = positionCount;
+	mesh->texcoord_count = texcoordCount;
+	mesh->normal_count = normalCount;
+	mesh->color_count = positionCount;
+	mesh->face_count = faceCount;
+	mesh->index_count = indexCount;
+	mesh->positions = (float*)tf_malloc(sizeof(float) * 3 * positionCount);
+	mesh->colors = (float*)tf_malloc(sizeof(float) * 3 * positionCount);
+	mesh->texcoords = (float*)tf_malloc(sizeof(float) * 2 * texcoordCount);
+	mesh->normals = (float*)tf_malloc(sizeof(float) * 3 * normalCount);
+	mesh->face_vertices = (unsigned int*)tf_malloc(sizeof(unsigned int) * TF_MAX(faceCount, 1u));
+	mesh->face_materials = (unsigned int*)tf_malloc(sizeof(unsigned int) * TF_MAX(faceCount, 1u));
+	mesh->indices = (fastObjIndex*)tf_malloc(sizeof(fastObjIndex) * TF_MAX(indexCount, 1u));
+	ASSERT(mesh->positions && mesh->colors && mesh->texcoords && mesh->normals && mesh->face_vertices && mesh->face_materials && mesh->indices);
+
+	const float dummyPosition[3] = { 0.0f, 0.0f, 0.0f };
+	const float dummyColor[3] = { 1.0f, 1.0f, 1.0f };
+	const float dummyTexcoord[2] = { 0.0f, 0.0f };
+	const float dummyNormal[3] = { 0.0f, 0.0f, 1.0f };
+	memcpy(mesh->positions, dummyPosition, sizeof(dummyPosition));
+	memcpy(mesh->colors, dummyColor, sizeof(dummyColor));
+	memcpy(mesh->texcoords, dummyTexcoord, sizeof(dummyTexcoord));
+	memcpy(mesh->normals, dummyNormal, sizeof(dummyNormal));
+
+	// Replay the objects, groups and materials in file order
+	ChunkArray<char*> materialNames;
+	ChunkArray<fastObjGroup> objects;
+	ChunkArray<fastObjGroup> groups;
+	fastObjGroup currentObject = {};
+	fastObjGroup currentGroup = {};
+	uint32_t material = 0;
+	for (uint32_t i = 0; i < chunkCount; ++i)
+	{
+		ObjChunk* chunk = &chunks[i];
+		chunk->firstMaterial = material;
+
+		for (uint32_t j = 0; j < chunk->events.count; ++j)
+		{
+			ObjEvent* event = &chunk->events.data[j];
+			const uint32_t faceOffset = chunk->faceBase + event->faceCount;
+			const uint32_t indexOffset = chunk->indexBase + event->indexCount;
+			switch (event->statement)
+			{
+			case ObjStatement::Object:
+				flushGroup(&currentObject, faceOffset, indexOffset, &objects);
+				currentObject.name = copyString(event->name, event->nameLength);
+				break;
+			case ObjStatement::Group:
+				flushGroup(&currentGroup, faceOffset, indexOffset, &groups);
+				currentGroup.name = copyString(event->name, event->nameLength);
+				break;
+			case ObjStatement::UseMaterial:
+				material = findOrAddMaterial(event->name, event->nameLength, &materialNames);
+				event->material = material;
+				break;
+			case ObjStatement::MaterialLibrary:
+				readMaterialLibrary(path, event->name, event->nameLength, &materialNames);
+				break;
+			}
+		}
+	}
+	flushGroup(&currentObject, faceCount, indexCount, &objects);
+	flushGroup(&currentGroup, faceCount, indexCount, &groups);
+
+	runObjChunkJobs(mergeObjChunk, chunks, chunkCount, "ObjMerge");
+
+	uint32_t invalidIndexCount = 0;
+	for (uint32_t i = 0; i < chunkCount; ++i)
+	{
+		invalidIndexCount += chunks[i].invalidIndexCount;
+		chunks[i].events.destroy();
+	}
+
+	if (invalidIndexCount > 0)
+	{
+		LOGF(eWARNING, "'%s' has %u out of range vertex indices", path, invalidIndexCount);
+	}
+
+	mesh->material_count = materialNames.count;
+	if (materialNames.count > 0)
+	{
+		mesh->materials = (fastObjMaterial*)tf_malloc(sizeof(fastObjMaterial) * materialNames.count);
+		ASSERT(mesh->materials);
+		memset(mesh->materials, 0, sizeof(fastObjMaterial) * materialNames.count);
+		for (uint32_t i = 0; i < materialNames.count; ++i)
+		{
+			mesh->materials[i].name = materialNames.data[i];
+		}
+	}
+	materialNames.destroy();
+
+	// The group arrays are handed over to the mesh
+	mesh->object_count = objects.count;
+	mesh->objects = objects.data;
+	mesh->group_count = groups.count;
+	mesh->groups = groups.data;
+
+	return mesh;
+}
+
+fastObjMesh* ParseObjParallel(const char* path, uint32_t maxWorkerCount)
+{
+	MappedFile file = {};
+	if (!MapFile(path, &file))
+	{
+		return NULL;
+	}
+
+	fastObjMesh* mesh = parseMappedObj(path, file, maxWorkerCount);
+	UnmapFile(&file);
+	return mesh;
+}
+
+static void destroyParsedObj(fastObjMesh* mesh)
+{
+	for (uint32_t i = 0; i < mesh->material_count; ++i)
+	{
+		tf_free(mesh->materials[i].name);
+	}
+
+	for (uint32_t i = 0; i < mesh->object_count; ++i)
+	{
+		tf_free(mesh->objects[i].name);
+	}
+
+	for (uint32_t i = 0; i < mesh->group_count; ++i)
+	{
+		tf_free(mesh->groups[i].name);
+	}
+
+	tf_free(mesh->positions);
+	tf_free(mesh->colors);
+	tf_free(mesh->texcoords);
+	tf_free(mesh->normals);
+	tf_free(mesh->face_vertices);
+	tf_free(mesh->face_materials);
+	tf_free(mesh->indices);
+	tf_free(mesh->materials);
+	tf_free(mesh->objects);
+	tf_free(mesh->groups);
+	tf_free(mesh);
+}
+
+bool ReadObjFile(const char* path, uint32_t maxWorkerCount, ObjFile* objFile)
+{
+	*objFile = {};
+
+	MappedFile file = {};
+	if (!MapFile(path, &file))
+	{
+		return false;
+	}
+
+	if (file.size >= k_ObjParallelMinFileSize)
+	{
+		objFile->mesh = parseMappedObj(path, file, maxWorkerCount);
+		objFile->parsedInParallel = true;
+		UnmapFile(&file);
+	}
+	else
+	{
+		UnmapFile(&file);
+		objFile->mesh = fast_obj_read(path);
+	}
+
+	return objFile->mesh != NULL;
+}
+
+void DestroyObjFile(ObjFile* objFile)
+{
+	if (objFile->mesh)
+	{
+		if (objFile->parsedInParallel)
+		{
+			destroyParsedObj(objFile->mesh);
+		}
+		else
+		{
+			fast_obj_destroy(objFile->mesh);
+		}
+	}
+
+	*objFile = {};
+}
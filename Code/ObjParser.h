@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// fast_obj
+#include <fast_obj.h>
+
+// NOTE(gmodarelli): Below this size fast_obj is fast enough and spawning threads isn't worth it
+const uint64_t k_ObjParallelMinFileSize = 16 * 1024 * 1024;
+// Every parse thread gets at least this many bytes of the file
+const uint64_t k_ObjParserMinChunkSize = 4 * 1024 * 1024;
+const uint32_t k_ObjParserMaxWorkers = 16;
+
+// An OBJ file read either by fast_obj or by ParseObjParallel. Release it with DestroyObjFile.
+struct ObjFile
+{
+	fastObjMesh* mesh = NULL;
+	bool parsedInParallel = false;
+};
+
+// Reads an OBJ file, with ParseObjParallel when it's at least k_ObjParallelMinFileSize bytes and
+// with fast_obj otherwise. At most maxWorkerCount threads are used, including the calling one.
+bool ReadObjFile(const char* path, uint32_t maxWorkerCount, ObjFile* objFile);
+void DestroyObjFile(ObjFile* objFile);
+
+// Memory-maps an OBJ file, splits it in line-aligned chunks and parses every chunk on its own thread,
+// then merges the chunks into a fastObjMesh laid out the way fast_obj lays it out: element 0 of the
+// positions, texcoords and normals is a dummy, indices are absolute (relative indices are resolved)
+// and materials come from the mtllib files and usemtl statements in the order fast_obj would add them.
+// Only material names are read from the material libraries. Colors are always present (white when
+// the file has none). Returns NULL if the file can't be read. Release it with DestroyObjFile.
+fastObjMesh* ParseObjParallel(const char* path, uint32_t maxWorkerCount);
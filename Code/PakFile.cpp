@@ -0,0 +1,395 @@
+#include "PakFile.h"
+
+#include "Hash.h"
+#include "Lz4.h"
+#include "MappedFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+static inline uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+{
+	return (offset + (alignment - 1)) & ~(alignment - 1);
+}
+
+static bool writePadding(FILE* file, uint64_t from, uint64_t to)
+{
+	static const uint8_t zeros[k_PakFileAlignment] = {};
+	ASSERT(to - from <= k_PakFileAlignment);
+	return fwrite(zeros, 1, (size_t)(to - from), file) == (size_t)(to - from);
+}
+
+// Lower-cases path, turns '\' into '/' and drops leading "./" and '/'.
+// Returns the length of the normalized path, or 0 if it doesn't fit in normalizedPath.
+static size_t normalizePakPath(const char* path, char* normalizedPath, size_t capacity)
+{
+	while (path[0] == '/' || path[0] == '\\' || (path[0] == '.' && (path[1] == '/' || path[1] == '\\')))
+	{
+		path += path[0] == '.' ? 2 : 1;
+	}
+
+	size_t length = 0;
+	for (; path[length] != '\0'; ++length)
+	{
+		if (length + 1 >= capacity)
+		{
+			return 0;
+		}
+
+		char c = path[length];
+		if (c == '\\')
+		{
+			c = '/';
+		}
+		else if (c >= 'A' && c <= 'Z')
+		{
+			c = (char)(c - 'A' + 'a');
+		}
+		normalizedPath[length] = c;
+	}
+	normalizedPath[length] = '\0';
+
+	return length;
+}
+
+uint64_t HashPakPath(const char* path)
+{
+	char normalizedPath[FS_MAX_PATH] = {};
+	size_t length = normalizePakPath(path, normalizedPath, sizeof(normalizedPath));
+	return HashBytes(normalizedPath, length, 0);
+}
+
+// Scratch state of WritePakFile, one per input file
+struct PakWriteEntry
+{
+	PakFileEntry entry;
+	char normalizedPath[FS_MAX_PATH];
+};
+
+static int comparePakWriteEntries(const void* a, const void* b)
+{
+	const uint64_t hashA = ((const PakWriteEntry*)a)->entry.pathHash;
+	const uint64_t hashB = ((const PakWriteEntry*)b)->entry.pathHash;
+	return hashA < hashB ? -1 : (hashA > hashB ? 1 : 0);
+}
+
+// Writes the payload of a file, LZ4 compressed when that's worth it
+static bool writePakPayload(FILE* file, const MappedFile& input, bool compress, PakFileEntry* entry)
+{
+	entry->size = input.size;
+	entry->storedSize = input.size;
+	entry->flags = PAK_ENTRY_FLAG_NONE;
+
+	// NOTE(gmodarelli): The LZ4 encoder addresses its input with 32-bit positions
+	if (compress && input.size < UINT32_MAX)
+	{
+		const size_t bound = Lz4CompressBound((size_t)input.size);
+		uint8_t* compressed = (uint8_t*)tf_malloc(bound);
+		ASSERT(compressed);
+
+		// Files that don't shrink by at least an eighth aren't worth decompressing at load time
+		const size_t maxCompressedSize = (size_t)(input.size - input.size / 8);
+		const size_t compressedSize = Lz4CompressBlock(input.data, (size_t)input.size, compressed, bound);
+		if (compressedSize > 0 && compressedSize <= maxCompressedSize)
+		{
+			entry->storedSize = compressedSize;
+			entry->flags = PAK_ENTRY_FLAG_LZ4;
+			const bool success = fwrite(compressed, 1, compressedSize, file) == compressedSize;
+			tf_free(compressed);
+			return success;
+		}
+
+		tf_free(compressed);
+	}
+
+	return fwrite(input.data, 1, (size_t)input.size, file) == (size_t)input.size;
+}
+
+bool WritePakFile(const char* path, const char* rootDirectory, const char* const* paths, uint32_t pathCount, bool compress, PakWriteStats* stats)
+{
+	*stats = {};
+
+	PakWriteEntry* writeEntries = (PakWriteEntry*)tf_calloc(TF_MAX(pathCount, 1u), sizeof(PakWriteEntry));
+	ASSERT(writeEntries);
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		LOGF(eERROR, "Couldn't create pak file '%s'", path);
+		tf_free(writeEntries);
+		return false;
+	}
+
+	PakFileHeader header = {};
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+	uint64_t offset = sizeof(header);
+	uint64_t namesSize = 0;
+
+	// NOTE(gmodarelli): Payloads are written in the order of paths, so files that are loaded
+	// together should be listed together to get the most out of the OS readahead
+	for (uint32_t i = 0; success && i < pathCount; ++i)
+	{
+		PakWriteEntry* writeEntry = &writeEntries[i];
+		if (normalizePakPath(paths[i], writeEntry->normalizedPath, sizeof(writeEntry->normalizedPath)) == 0)
+		{
+			LOGF(eERROR, "Invalid pak entry path '%s'", paths[i]);
+			success = false;
+			break;
+		}
+
+		char inputPath[FS_MAX_PATH] = {};
+		snprintf(inputPath, sizeof(inputPath), "%s/%s", rootDirectory, paths[i]);
+
+		MappedFile input = {};
+		if (!MapFile(inputPath, &input))
+		{
+			LOGF(eERROR, "Couldn't read '%s'", inputPath);
+			success = false;
+			break;
+		}
+
+		const uint64_t payloadOffset = alignOffset(offset, k_PakFileAlignment);
+		PakFileEntry* entry = &writeEntry->entry;
+		entry->pathHash = HashPakPath(writeEntry->normalizedPath);
+		entry->offset = payloadOffset;
+		entry->nameOffset = (uint32_t)namesSize;
+		success = writePadding(file, offset, payloadOffset) && writePakPayload(file, input, compress, entry);
+		UnmapFile(&input);
+
+		offset = payloadOffset + entry->storedSize;
+		namesSize += strlen(writeEntry->normalizedPath) + 1;
+
+		stats->entryCount++;
+		stats->compressedEntryCount += (entry->flags & PAK_ENTRY_FLAG_LZ4) ? 1 : 0;
+		stats->inputSize += entry->size;
+	}
+
+	// Names are written in the order of the payloads, which is the order of their name offsets
+	header.namesOffset = offset;
+	header.namesSize = namesSize;
+	for (uint32_t i = 0; success && i < pathCount; ++i)
+	{
+		const size_t nameSize = strlen(writeEntries[i].normalizedPath) + 1;
+		success = fwrite(writeEntries[i].normalizedPath, 1, nameSize, file) == nameSize;
+	}
+
+	if (success)
+	{
+		qsort(writeEntries, pathCount, sizeof(PakWriteEntry), comparePakWriteEntries);
+		for (uint32_t i = 1; i < pathCount; ++i)
+		{
+			if (writeEntries[i].entry.pathHash == writeEntries[i - 1].entry.pathHash)
+			{
+				LOGF(eERROR, "Pak entries '%s' and '%s' have the same path hash", writeEntries[i - 1].normalizedPath, writeEntries[i].normalizedPath);
+				success = false;
+			}
+		}
+	}
+
+	if (success)
+	{
+		header.magic = k_PakFileMagic;
+		header.version = k_PakFileVersion;
+		header.entryCount = pathCount;
+		header.alignment = k_PakFileAlignment;
+		header.indexOffset = alignOffset(header.namesOffset + header.namesSize, alignof(PakFileEntry));
+
+		success = writePadding(file, header.namesOffset + header.namesSize, header.indexOffset);
+		for (uint32_t i = 0; success && i < pathCount; ++i)
+		{
+			success = fwrite(&writeEntries[i].entry, sizeof(PakFileEntry), 1, file) == 1;
+		}
+
+		stats->outputSize = header.indexOffset + sizeof(PakFileEntry) * (uint64_t)pathCount;
+		success = success && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+	}
+
+	fclose(file);
+	tf_free(writeEntries);
+
+	if (!success)
+	{
+		LOGF(eERROR, "Couldn't write pak file '%s'", path);
+		remove(path);
+	}
+
+	return success;
+}
+
+bool OpenPakFile(::ResourceDirectory resourceDir, const char* fileName, PakFile* pakFile)
+{
+	*pakFile = {};
+
+	if (!::fsOpenStreamFromPath(resourceDir, fileName, ::FM_READ, &pakFile->stream))
+	{
+		return false;
+	}
+
+	size_t size = 0;
+	const void* data = NULL;
+	if (!::fsStreamMemoryMap(&pakFile->stream, &size, &data))
+	{
+		LOGF(eERROR, "Couldn't memory-map pak file '%s'", fileName);
+		ClosePakFile(pakFile);
+		return false;
+	}
+
+	const PakFileHeader* header = (const PakFileHeader*)data;
+	if (size < sizeof(PakFileHeader) || header->magic != k_PakFileMagic)
+	{
+		LOGF(eERROR, "'%s' is not a pak file", fileName);
+		ClosePakFile(pakFile);
+		return false;
+	}
+
+	if (header->version != k_PakFileVersion)
+	{
+		LOGF(eWARNING, "Pak file '%s' is out of date (version %u, expected %u), it needs to be cooked again", fileName, header->version, k_PakFileVersion);
+		ClosePakFile(pakFile);
+		return false;
+	}
+
+	// NOTE: Offsets and sizes are checked against what's left after them, so corrupt values can't wrap
+	if (header->indexOffset % alignof(PakFileEntry) != 0 ||
+		header->indexOffset > size || sizeof(PakFileEntry) * (uint64_t)header->entryCount > size - header->indexOffset ||
+		header->namesOffset > size || header->namesSize > size - header->namesOffset ||
+		(header->namesSize > 0 && ((const char*)data)[header->namesOffset + header->namesSize - 1] != '\0'))
+	{
+		LOGF(eERROR, "Pak file '%s' is truncated", fileName);
+		ClosePakFile(pakFile);
+		return false;
+	}
+
+	const PakFileEntry* entries = (const PakFileEntry*)((const uint8_t*)data + header->indexOffset);
+	for (uint32_t i = 0; i < header->entryCount; ++i)
+	{
+		const PakFileEntry& entry = entries[i];
+		// NOTE(gmodarelli): LZ4 can't expand a block more than 255 times, larger sizes would only make
+		// OpenPakFileEntryStream allocate whatever a corrupt entry asks for
+		if (entry.offset > size || entry.storedSize > size - entry.offset || entry.nameOffset >= header->namesSize ||
+			(!(entry.flags & PAK_ENTRY_FLAG_LZ4) && entry.storedSize != entry.size) ||
+			((entry.flags & PAK_ENTRY_FLAG_LZ4) && (entry.size > k_PakFileMaxEntrySize || entry.size > entry.storedSize * 255 + 16)))
+		{
+			LOGF(eERROR, "Pak file '%s' has an invalid entry (%u)", fileName, i);
+			ClosePakFile(pakFile);
+			return false;
+		}
+	}
+
+	pakFile->data = (const uint8_t*)data;
+	pakFile->size = (uint64_t)size;
+	pakFile->header = header;
+	pakFile->entries = entries;
+	pakFile->names = (const char*)data + header->namesOffset;
+
+	return true;
+}
+
+void ClosePakFile(PakFile* pakFile)
+{
+	::fsCloseStream(&pakFile->stream);
+	*pakFile = {};
+}
+
+const PakFileEntry* FindPakFileEntry(const PakFile* pakFile, const char* path)
+{
+	char normalizedPath[FS_MAX_PATH] = {};
+	const size_t length = normalizePakPath(path, normalizedPath, sizeof(normalizedPath));
+	if (length == 0)
+	{
+		return NULL;
+	}
+
+	const uint64_t pathHash = HashBytes(normalizedPath, length, 0);
+
+	// Entries are sorted by path hash
+	uint32_t first = 0;
+	uint32_t count = pakFile->header->entryCount;
+	while (count > 0)
+	{
+		const uint32_t step = count / 2;
+		if (pakFile->entries[first + step].pathHash < pathHash)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
+
+	if (first == pakFile->header->entryCount || pakFile->entries[first].pathHash != pathHash)
+	{
+		return NULL;
+	}
+
+	const PakFileEntry* entry = &pakFile->entries[first];
+	return strcmp(pakFile->names + entry->nameOffset, normalizedPath) == 0 ? entry : NULL;
+}
+
+bool OpenPakFileEntryStream(const PakFile* pakFile, const PakFileEntry* entry, ::FileStream* stream)
+{
+	const uint8_t* payload = pakFile->data + entry->offset;
+	if (!(entry->flags & PAK_ENTRY_FLAG_LZ4))
+	{
+		return ::fsOpenStreamFromMemory(payload, (size_t)entry->size, ::FM_READ, false, stream);
+	}
+
+	void* data = tf_malloc((size_t)TF_MAX(entry->size, 1ull));
+	ASSERT(data);
+	if (!Lz4DecompressBlock(payload, (size_t)entry->storedSize, data, (size_t)entry->size))
+	{
+		LOGF(eERROR, "Couldn't decompress pak entry '%s'", pakFile->names + entry->nameOffset);
+		tf_free(data);
+		return false;
+	}
+
+	// NOTE(gmodarelli): The stream owns the buffer and releases it when closed
+	if (!::fsOpenStreamFromMemory(data, (size_t)entry->size, ::FM_READ, true, stream))
+	{
+		tf_free(data);
+		return false;
+	}
+
+	return true;
+}
+
+static bool pakFileSystemOpen(::IFileSystem* pIO, const ::ResourceDirectory resourceDir, const char* fileName, ::FileMode mode, ::FileStream* pOut)
+{
+	const PakFile* pakFile = (const PakFile*)pIO->pUser;
+	if ((mode & (::FM_WRITE | ::FM_APPEND)) == 0)
+	{
+		const PakFileEntry* entry = FindPakFileEntry(pakFile, fileName);
+		if (entry)
+		{
+			return OpenPakFileEntryStream(pakFile, entry, pOut);
+		}
+	}
+
+	return ::pSystemFileIO->Open(::pSystemFileIO, resourceDir, fileName, mode, pOut);
+}
+
+void MountPakFile(PakFile* pakFile, ::ResourceDirectory resourceDir, const char* bundledFolder)
+{
+	ASSERT(pakFile->header);
+
+	// NOTE(gmodarelli): Streams opened by the pak file system are memory or system streams, so only
+	// Open needs overriding. The rest (GetResourceMount in particular) comes from the system file system.
+	pakFile->fileSystem = *::pSystemFileIO;
+	pakFile->fileSystem.Open = pakFileSystemOpen;
+	pakFile->fileSystem.pUser = pakFile;
+
+	::fsSetPathForResourceDir(&pakFile->fileSystem, ::RM_CONTENT, resourceDir, bundledFolder);
+}
+
+void UnmountPakFile(::ResourceDirectory resourceDir, const char* bundledFolder)
+{
+	::fsSetPathForResourceDir(::pSystemFileIO, ::RM_CONTENT, resourceDir, bundledFolder);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The-Forge
+#include <Utilities/Interfaces/IFileSystem.h>
+
+// Packed asset archive (*.pak), written by the PakCooker and memory-mapped at runtime.
+//
+// Layout:
+//   PakFileHeader
+//   Payloads                    each at PakFileEntry::offset, aligned to k_PakFileAlignment
+//   char[namesSize]             at namesOffset, the null-terminated paths of the entries
+//   PakFileEntry[entryCount]    at indexOffset, sorted by pathHash
+//
+// Paths are relative to the content directory ("Models/DamagedHelmet.mesh"). They are hashed with
+// HashPakPath, so lookups don't depend on case or on the kind of slashes.
+// Entries flagged with PAK_ENTRY_FLAG_LZ4 are a single LZ4 block (see Lz4.h) of storedSize bytes
+// that decompresses to size bytes. The other entries are stored as they are and are read straight
+// from the mapping.
+
+const uint32_t k_PakFileMagic = 0x304B4150; // "PAK0"
+// NOTE: Bump this every time the layout of the file changes
+const uint32_t k_PakFileVersion = 1;
+// NOTE(gmodarelli): Payloads start on a page boundary so each file is mapped on its own pages
+const uint32_t k_PakFileAlignment = 4096;
+// Largest decompressed size of LZ4 entries, anything larger is treated as corruption
+// NOTE: The cooker only compresses files smaller than 4 GB, see writePakPayload
+const uint64_t k_PakFileMaxEntrySize = 1ull << 32;
+
+enum PakEntryFlags
+{
+	PAK_ENTRY_FLAG_NONE = 0,
+	PAK_ENTRY_FLAG_LZ4 = 1 << 0,
+};
+
+struct PakFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t alignment;
+	uint64_t indexOffset;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+};
+
+struct PakFileEntry
+{
+	uint64_t pathHash;
+	uint64_t offset;
+	// Size of the file
+	uint64_t size;
+	// Size of the payload, smaller than size when the entry is compressed
+	uint64_t storedSize;
+	uint32_t nameOffset;
+	uint32_t flags;
+};
+
+struct PakFile
+{
+	::FileStream stream = {};
+	const uint8_t* data = NULL;
+	uint64_t size = 0;
+	const PakFileHeader* header = NULL;
+	const PakFileEntry* entries = NULL;
+	const char* names = NULL;
+	// Serves the resource directories mounted with MountPakFile
+	::IFileSystem fileSystem = {};
+};
+
+struct PakWriteStats
+{
+	uint32_t entryCount;
+	uint32_t compressedEntryCount;
+	uint64_t inputSize;
+	uint64_t outputSize;
+};
+
+// Hashes a path relative to the content directory, ignoring case and treating '\' as '/'
+uint64_t HashPakPath(const char* path);
+
+// Packs the files at rootDirectory/paths[i] into a pak file. When compress is set, files are LZ4
+// compressed unless that saves less than an eighth of their size.
+bool WritePakFile(const char* path, const char* rootDirectory, const char* const* paths, uint32_t pathCount, bool compress, PakWriteStats* stats);
+
+// Memory-maps a pak file. The mapping stays valid until ClosePakFile is called.
+bool OpenPakFile(::ResourceDirectory resourceDir, const char* fileName, PakFile* pakFile);
+void ClosePakFile(PakFile* pakFile);
+
+// Returns NULL when the pak file doesn't contain path
+const PakFileEntry* FindPakFileEntry(const PakFile* pakFile, const char* path);
+// Opens a read-only memory stream on an entry. Uncompressed entries point into the mapping,
+// compressed ones are decompressed into a buffer owned by the stream.
+bool OpenPakFileEntryStream(const PakFile* pakFile, const PakFileEntry* entry, ::FileStream* stream);
+
+// Serves reads of resourceDir (whose files live in bundledFolder, see Content/PathStatement.Windows.txt)
+// from the pak file. Files that aren't in the pak file, and writes, go to the system file system.
+// The pak file has to stay open until UnmountPakFile is called.
+void MountPakFile(PakFile* pakFile, ::ResourceDirectory resourceDir, const char* bundledFolder);
+void UnmountPakFile(::ResourceDirectory resourceDir, const char* bundledFolder);
@@ -0,0 +1,214 @@
+#include "RangeAllocator.h"
+
+#include <string.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+static void reserveFreeRanges(RangeAllocator* allocator, uint32_t count)
+{
+	if (count <= allocator->freeRangeCapacity)
+	{
+		return;
+	}
+
+	uint32_t newCapacity = allocator->freeRangeCapacity > 0 ? allocator->freeRangeCapacity * 2 : 64;
+	while (newCapacity < count)
+	{
+		newCapacity *= 2;
+	}
+
+	RangeAllocatorRange* freeRanges = (RangeAllocatorRange*)tf_malloc(sizeof(RangeAllocatorRange) * newCapacity);
+	ASSERT(freeRanges);
+	if (allocator->freeRanges)
+	{
+		memcpy(freeRanges, allocator->freeRanges, sizeof(RangeAllocatorRange) * allocator->freeRangeCount);
+		tf_free(allocator->freeRanges);
+	}
+
+	allocator->freeRanges = freeRanges;
+	allocator->freeRangeCapacity = newCapacity;
+}
+
+static void insertFreeRange(RangeAllocator* allocator, uint32_t index, uint32_t offset, uint32_t size)
+{
+	reserveFreeRanges(allocator, allocator->freeRangeCount + 1);
+	memmove(&allocator->freeRanges[index + 1], &allocator->freeRanges[index], sizeof(RangeAllocatorRange) * (allocator->freeRangeCount - index));
+	allocator->freeRanges[index] = { offset, size };
+	allocator->freeRangeCount++;
+}
+
+static void eraseFreeRange(RangeAllocator* allocator, uint32_t index)
+{
+	ASSERT(index < allocator->freeRangeCount);
+	memmove(&allocator->freeRanges[index], &allocator->freeRanges[index + 1], sizeof(RangeAllocatorRange) * (allocator->freeRangeCount - index - 1));
+	allocator->freeRangeCount--;
+}
+
+void RangeAllocator::init(uint32_t initialCapacity)
+{
+	ASSERT(freeRanges == NULL);
+	capacity = 0;
+	usedSize = 0;
+	freeRangeCount = 0;
+	grow(initialCapacity);
+}
+
+void RangeAllocator::destroy()
+{
+	tf_free(freeRanges);
+	freeRanges = NULL;
+	freeRangeCount = 0;
+	freeRangeCapacity = 0;
+	capacity = 0;
+	usedSize = 0;
+}
+
+bool RangeAllocator::alloc(uint32_t size, uint32_t* offset)
+{
+	if (size == 0)
+	{
+		*offset = 0;
+		return true;
+	}
+
+	uint32_t bestIndex = UINT32_MAX;
+	for (uint32_t i = 0; i < freeRangeCount; ++i)
+	{
+		if (freeRanges[i].size >= size && (bestIndex == UINT32_MAX || freeRanges[i].size < freeRanges[bestIndex].size))
+		{
+			bestIndex = i;
+			if (freeRanges[i].size == size)
+			{
+				break;
+			}
+		}
+	}
+
+	if (bestIndex == UINT32_MAX)
+	{
+		return false;
+	}
+
+	RangeAllocatorRange* range = &freeRanges[bestIndex];
+	*offset = range->offset;
+	range->offset += size;
+	range->size -= size;
+	if (range->size == 0)
+	{
+		eraseFreeRange(this, bestIndex);
+	}
+
+	usedSize += size;
+	return true;
+}
+
+void RangeAllocator::release(uint32_t offset, uint32_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	ASSERT(offset + size <= capacity);
+	ASSERT(size <= usedSize);
+
+	// First free range after the released one
+	uint32_t lo = 0;
+	uint32_t hi = freeRangeCount;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (freeRanges[mid].offset < offset)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	const uint32_t index = lo;
+	ASSERT(index == freeRangeCount || offset + size <= freeRanges[index].offset);
+	ASSERT(index == 0 || freeRanges[index - 1].offset + freeRanges[index - 1].size <= offset);
+
+	bool mergePrevious = index > 0 && freeRanges[index - 1].offset + freeRanges[index - 1].size == offset;
+	bool mergeNext = index < freeRangeCount && offset + size == freeRanges[index].offset;
+
+	if (mergePrevious && mergeNext)
+	{
+		freeRanges[index - 1].size += size + freeRanges[index].size;
+		eraseFreeRange(this, index);
+	}
+	else if (mergePrevious)
+	{
+		freeRanges[index - 1].size += size;
+	}
+	else if (mergeNext)
+	{
+		freeRanges[index].offset = offset;
+		freeRanges[index].size += size;
+	}
+	else
+	{
+		insertFreeRange(this, index, offset, size);
+	}
+
+	usedSize -= size;
+}
+
+void RangeAllocator::grow(uint32_t newCapacity)
+{
+	if (newCapacity <= capacity)
+	{
+		return;
+	}
+
+	uint32_t addedSize = newCapacity - capacity;
+	if (freeRangeCount > 0 && freeRanges[freeRangeCount - 1].offset + freeRanges[freeRangeCount - 1].size == capacity)
+	{
+		freeRanges[freeRangeCount - 1].size += addedSize;
+	}
+	else
+	{
+		insertFreeRange(this, freeRangeCount, capacity, addedSize);
+	}
+
+	capacity = newCapacity;
+}
+
+void RangeAllocator::resetCompacted(uint32_t newCapacity, uint32_t newUsedSize)
+{
+	ASSERT(newUsedSize <= newCapacity);
+	capacity = newCapacity;
+	usedSize = newUsedSize;
+	freeRangeCount = 0;
+	if (newUsedSize < newCapacity)
+	{
+		insertFreeRange(this, 0, newUsedSize, newCapacity - newUsedSize);
+	}
+}
+
+uint32_t RangeAllocator::largestFreeRange() const
+{
+	uint32_t largest = 0;
+	for (uint32_t i = 0; i < freeRangeCount; ++i)
+	{
+		largest = freeRanges[i].size > largest ? freeRanges[i].size : largest;
+	}
+	return largest;
+}
+
+float RangeAllocator::fragmentation() const
+{
+	uint32_t freeSize = capacity - usedSize;
+	if (freeSize == 0)
+	{
+		return 0.0f;
+	}
+
+	return 1.0f - (float)largestFreeRange() / (float)freeSize;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct RangeAllocatorRange
+{
+	uint32_t offset;
+	uint32_t size;
+};
+
+// Free-list allocator of [offset, offset + size) ranges, used to suballocate GPU buffers.
+// Offsets and sizes are in elements of whatever the owner stores. Free ranges are kept sorted
+// by offset and merged with their neighbours when released, allocations take the smallest free
+// range that fits. The allocator only does the bookkeeping, it never touches the memory it manages.
+struct RangeAllocator
+{
+	RangeAllocatorRange* freeRanges = NULL;
+	uint32_t freeRangeCount = 0;
+	uint32_t freeRangeCapacity = 0;
+
+	uint32_t capacity = 0;
+	uint32_t usedSize = 0;
+
+	void init(uint32_t capacity);
+	void destroy();
+
+	// Zero-sized allocations always succeed and don't use any space
+	bool alloc(uint32_t size, uint32_t* offset);
+	void release(uint32_t offset, uint32_t size);
+
+	// Appends [capacity, newCapacity) to the free space
+	void grow(uint32_t newCapacity);
+	// Marks [0, usedSize) as allocated and the rest as free. Used after the owner has moved all
+	// of its allocations to the front of a (possibly larger) buffer.
+	void resetCompacted(uint32_t newCapacity, uint32_t newUsedSize);
+
+	uint32_t largestFreeRange() const;
+	// 0 when the free space is a single range, tends to 1 as it gets scattered in small ranges
+	float fragmentation() const;
+};
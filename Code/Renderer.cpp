@@ -3,17 +3,15 @@
 
 #include "DescriptorSets.autogen.h"
 
-// fast_obj
-
-#define FAST_OBJ_IMPLEMENTATION
-#include <fast_obj.h>
-
-// meshoptimizer
-#include <meshoptimizer.h>
-
-// MikkTSpace
-
-#include <mikktspace.h>
+#include "DdsFile.h"
+#include "Hash.h"
+#include "MaterialFile.h"
+#include "MeshCache.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "PakFile.h"
+#include "RangeAllocator.h"
+#include "TextureStreaming.h"
 
 // The-Forge
 
@@ -42,9 +40,145 @@ const uint32_t k_UpsampleSteps = 7;
 
 const uint32_t k_LightsMaxCount = 1024;
 const uint32_t k_MaterialsMaxCount = 1024;
+// Names of the loaded materials, several names can share a material (see MaterialFile.h)
+const uint32_t k_MaterialNamesMaxCount = 4 * k_MaterialsMaxCount;
+const uint32_t k_MaterialDirtyRangesMaxCount = 8;
 const uint32_t k_MeshesMaxCount = 1024;
 const uint32_t k_InstancesMaxCount = 1024 * 1024;
-const uint32_t k_IndirectDrawCommandsMaxCount = 1024;
+// Every instance gets one draw instance per submesh of its mesh. Instances that don't fit are not drawn.
+const uint32_t k_DrawInstancesMaxCount = 2 * k_InstancesMaxCount;
+// Every mesh emits at most one draw per LOD and submesh (mesh files have at most k_MeshMaxSubmeshes)
+// NOTE(gmodarelli): 256K draws, 5 MB of draw arguments per buffer
+const uint32_t k_IndirectDrawCommandsMaxCount = k_MeshesMaxCount * MESH_MAX_LODS * k_MeshMaxSubmeshes;
+// NOTE(gmodarelli): Texture handles keep the slot in their low 16 bits, see makeTextureHandle
+const uint32_t k_TexturesMaxCount = 16 * 1024;
+
+// Memory the streamed texture mips can use by default, see renderer::SetTextureStreamingBudget
+const uint64_t k_TextureStreamingDefaultBudget = 256ull * 1024 * 1024;
+// NOTE(gmodarelli): A streamed texture is loaded again with its new mips before the old version is
+// removed, so the loads in flight are capped to bound the memory both versions use at once
+const uint32_t k_TextureStreamingMaxLoads = 4;
+
+// Material library loaded at startup (see Content/Materials/Prototype.materials)
+const char* const k_MaterialLibraryFileName = "Materials/Prototype.matlib";
+
+// Archive of the cooked textures, meshes and materials (see Content/Content.pakmanifest)
+const char* const k_ContentPakFileName = "Content.pak";
+// NOTE: Keep in sync with RD_TEXTURES, RD_MESHES and RD_COMPILED_MATERIALS in Content/PathStatement.Windows.txt
+const char* const k_ContentDirectory = "Content/";
+
+// Horizontal field of view of the player camera
+const float k_CameraFovX = 1.0471f;
+// NOTE(gmodarelli): A LOD is selected when its error, projected on screen, is below this many pixels
+const float k_LodMaxScreenError = 1.0f;
+// Marks instances whose mesh is not loaded in instanceLods
+const uint8_t k_InstanceNotDrawn = 0xFF;
+
+// Initial capacity of the geometry pool, in elements. Streams grow when they run out of space.
+const uint32_t k_GeometryPoolInitialVertexCount = 256 * 1024;
+const uint32_t k_GeometryPoolInitialIndexCount = 1024 * 1024;
+// Streams more fragmented than this get compacted when a mesh is removed
+const float k_GeometryPoolMaxFragmentation = 0.5f;
+
+enum class MaterialTextureSlot
+{
+	Albedo = 0,
+	Normal,
+	Orm,
+	Emissive,
+
+	_Count,
+};
+
+static_assert((uint32_t)MaterialTextureSlot::_Count == (uint32_t)MaterialFileTexture::_Count, "MaterialTextureSlot and MaterialFileTexture are out of sync");
+
+// 1x1 textures bound to the material texture slots while their textures are loading
+enum class PlaceholderTexture
+{
+	White = 0,
+	FlatNormal,
+	Black,
+
+	_Count,
+};
+
+// NOTE(gmodarelli): Placeholders sample like the missing texture paths of Uber.pixel.hlsl, so a
+// material looks the same whether a texture is loading or it has none
+static const uint8_t k_PlaceholderTextureColors[(uint32_t)PlaceholderTexture::_Count][4] = {
+	{ 255, 255, 255, 255 },
+	{ 128, 128, 255, 255 },
+	{ 0, 0, 0, 255 },
+};
+
+static const PlaceholderTexture k_MaterialTextureSlotPlaceholders[(uint32_t)MaterialTextureSlot::_Count] = {
+	PlaceholderTexture::White,
+	PlaceholderTexture::FlatNormal,
+	PlaceholderTexture::White,
+	PlaceholderTexture::Black,
+};
+
+enum class TextureState : uint8_t
+{
+	Loading = 0,
+	Ready,
+	Failed,
+};
+
+// Slot of the texture registry (see renderer::AcquireTexture)
+// NOTE(gmodarelli): A slot whose last reference is released keeps its texture until the frames in
+// flight are done with it (releaseFrame + k_DataBufferCount). Acquiring the same path before then
+// revives it with the same handle.
+// Streamed textures (see UpdateTextureStreaming) only load their mips [residentMip, mipCount). Their
+// mips change by loading the texture again from another mip (streamingTexture), which then replaces
+// texture. The replaced texture is retired like released ones.
+struct TextureSlot
+{
+	bool used;
+	TextureState state;
+	// Bumped every time the slot is freed, so handles of removed textures don't resolve
+	uint16_t generation;
+	uint32_t refCount;
+	uint64_t releaseFrame;
+	::Texture* texture;
+	::SyncToken token;
+	char* path;
+
+	bool streamed;
+	// A load of streamingTexture is in flight
+	bool streaming;
+	uint8_t residentMip;
+	uint8_t streamingMip;
+	DdsFileInfo info;
+	// Virtual path of the mip tail being loaded (see FormatDdsMipTailPath), streamed textures only
+	char* mipTailPath;
+	::Texture* streamingTexture;
+	::SyncToken streamingToken;
+	::Texture* retiredTexture;
+	uint64_t retiredFrame;
+};
+
+// Textures referenced by a material. GPUMaterial holds their bindless indices (or the ones of the
+// placeholders while they load).
+struct MaterialTextures
+{
+	renderer::TextureHandle handles[(uint32_t)MaterialTextureSlot::_Count];
+};
+
+struct MaterialName
+{
+	uint64_t nameHash;
+	uint32_t materialIndex;
+};
+
+// Materials changed since a material buffer was last updated, as [begin, end) ranges
+// NOTE(gmodarelli): Past k_MaterialDirtyRangesMaxCount ranges they are merged into one, uploading the
+// unchanged materials in between is cheaper than tracking every change
+struct MaterialDirtyRanges
+{
+	uint32_t begins[k_MaterialDirtyRangesMaxCount];
+	uint32_t ends[k_MaterialDirtyRangesMaxCount];
+	uint32_t count;
+};
 
 enum class RaytracingTechnique
 {
@@ -61,34 +195,60 @@ enum class Meshes
 	_Count,
 };
 
-struct RendererGeometry
+// Geometry is stored in one GPU buffer per stream, each suballocated between the meshes
+enum class GeometryStream
 {
-	MeshVertex* vertices = NULL;
-	uint32_t* indices = NULL;
+	Positions = 0,
+	Vertices,
+	Indices32,
+	Indices16,
+	Meshlets,
+	MeshletVertices,
+	MeshletTriangles,
+	Submeshes,
 
-	uint32_t vertexCount = 0;
-	uint32_t indexCount = 0;
+	_Count,
 };
 
-struct ScratchGeometryData
+struct GeometryStreamPool
 {
-	RendererGeometry geometry = {};
-	uint32_t verticesMaxCount = 256 * 1024;
-	uint32_t indicexMaxCount = 1024 * 1024;
-
-	bool isInitialized();
-	void initialize();
-	void reset();
-	void destroy();
+	::Buffer** ppBuffer = NULL;
+	// Ranges are in elements of the stream
+	RangeAllocator allocator;
 };
 
-static ScratchGeometryData k_ScratchGeometryData;
+// Ranges of the geometry streams owned by a mesh slot, in elements
+// NOTE(gmodarelli): Meshes with the same path or the same content (see HashMeshGeometry) share the
+// geometry ranges of the first one that was added, its owner. Only the owner holds ranges (counts),
+// the other meshes are copies of its GPUMesh and keep it alive through refCount.
+struct MeshAllocation
+{
+	bool used;
+	uint32_t owner;
+	uint32_t refCount;
+	uint64_t pathHash;
+	uint64_t contentHash;
+	uint32_t offsets[(uint32_t)GeometryStream::_Count];
+	uint32_t counts[(uint32_t)GeometryStream::_Count];
+	// CPU copy of the submeshes, read when building the draw commands (owners only)
+	GPUSubmesh* submeshes;
+	// Path the geometry is reloaded from when its CPU positions are needed again (owners only)
+	char* meshPath;
+	// CPU copy of the positions and LOD 0 indices, see renderer::GeometryResidency (owners only)
+	float3* positions;
+	uint32_t* indices;
+};
 
 struct RendererState
 {
 	void* nativeWindowHandle = NULL;
 
+	// Mounted on RD_TEXTURES and RD_MESHES when it has been cooked (header != NULL)
+	PakFile contentPak = {};
+
 	uint32_t frameIndex = 0;
+	// Number of frames drawn so far
+	uint64_t frameCount = 0;
 
 	::Renderer* renderer = NULL;
 	::Raytracing* raytracing = NULL;
@@ -119,10 +279,19 @@ struct RendererState
 	::Texture* bloomDownsamples[k_DownsampleSteps] = { NULL };
 	::Texture* bloomUpsamples[k_UpsampleSteps] = { NULL };
 
-	RendererGeometry geometry = {};
 	::Buffer* meshesBuffer = NULL;
+	// float3 positions, split from the attributes for position-only passes and BLAS builds
+	::Buffer* positionBuffer = NULL;
+	// MeshVertexAttributes
 	::Buffer* vertexBuffer = NULL;
 	::Buffer* indexBuffer = NULL;
+	// Meshes with at most MESH_INDEX16_MAX_VERTICES vertices keep their indices here
+	::Buffer* indexBuffer16 = NULL;
+	::Buffer* meshletsBuffer = NULL;
+	::Buffer* meshletVerticesBuffer = NULL;
+	::Buffer* meshletTrianglesBuffer = NULL;
+	::Buffer* submeshesBuffer = NULL;
+	GeometryStreamPool geometryStreams[(uint32_t)GeometryStream::_Count];
 
 	::AccelerationStructure* blas = NULL;
 	::AccelerationStructure* tlas = NULL;
@@ -133,20 +302,69 @@ struct RendererState
 	::Buffer* lightBuffers[k_DataBufferCount] = { NULL };
 	::Buffer* indirectDrawBuffers[k_DataBufferCount] = { NULL };
 
+	// NOTE(gmodarelli): meshCount is the number of mesh slots ever used, slots of removed meshes
+	// are empty (lodCount == 0) until they are reused
 	GPUMesh* meshes = NULL;
+	MeshAllocation* meshAllocations = NULL;
 	uint32_t meshCount = 0;
+	renderer::GeometryResidency geometryResidency = renderer::GeometryResidency::Bounds;
 
 	GPUInstance* instances = NULL;
 	uint32_t instanceCount = 0;
 
 	GPUMaterial* materials = NULL;
+	MaterialTextures* materialTextures = NULL;
+	// HashMaterialContent of the materials, to share the materials of the libraries that are identical.
+	// 0 for the materials changed at runtime, which aren't shared anymore.
+	uint64_t* materialContentHashes = NULL;
 	uint32_t materialCount = 0;
+	MaterialName* materialNames = NULL;
+	uint32_t materialNameCount = 0;
+	// Materials each material buffer is missing
+	MaterialDirtyRanges materialDirtyRanges[k_DataBufferCount] = {};
+
+	// Texture registry. textureSlotCount is the number of slots ever used, texturePathHashes the
+	// path hashes (see HashPakPath) of the used ones, scanned to deduplicate loads.
+	TextureSlot* textures = NULL;
+	uint64_t* texturePathHashes = NULL;
+	uint32_t textureSlotCount = 0;
+	uint32_t* freeTextureSlots = NULL;
+	uint32_t freeTextureSlotCount = 0;
+	uint32_t loadingTextureCount = 0;
+	uint32_t releasedTextureCount = 0;
+
+	// Texture streaming. RD_TEXTURES is mounted on textureStreamingFileSystem, which serves the mip
+	// tails of the streamed textures. The arrays are indexed like textures, except the ones filled
+	// for SelectTextureMips which are indexed by streamed texture.
+	::IFileSystem textureStreamingFileSystem = {};
+	uint64_t textureStreamingBudget = 0;
+	uint32_t streamingTextureCount = 0;
+	uint32_t retiredTextureCount = 0;
+	float* textureScreenSizes = NULL;
+	float* materialScreenSizes = NULL;
+	StreamedTexture* streamedTextures = NULL;
+	uint32_t* streamedTextureSlots = NULL;
+	uint32_t* targetTextureMips = NULL;
+	uint32_t* textureStreamingOrder = NULL;
+
+	::Texture* placeholderTextures[(uint32_t)PlaceholderTexture::_Count] = { NULL };
 
 	GPULight* lights = NULL;
 	uint32_t lightsCount = 0;
 
 	IndirectDrawIndexArguments* indirectDrawIndexArgs = NULL;
 	uint32_t indirectDrawCommandCount = 0;
+	// Draws of the 32-bit index pool come first, followed by the ones of the 16-bit pool
+	uint32_t indirectDrawIndex32CommandCount = 0;
+
+	// Instance and material indices sorted by submesh and LOD, indexed by SV_InstanceID + StartInstanceLocation
+	::Buffer* drawInstanceBuffers[k_DataBufferCount] = { NULL };
+	GPUDrawInstance* drawInstances = NULL;
+	uint32_t drawInstanceCount = 0;
+	uint8_t* instanceLods = NULL;
+	// Instances of every (mesh, LOD) batch, and where the draw instances of the batch start
+	uint32_t* drawBatchInstanceCounts = NULL;
+	uint32_t* drawBatchOffsets = NULL;
 
 	// UberShader
 	::Shader* uberShader = NULL;
@@ -182,14 +400,6 @@ struct RendererState
 
 	::Sampler* linearRepeatSampler = NULL;
 	::Sampler* linearClampSampler = NULL;
-
-	// TODO(gmodarelli): Use a pool to store pointers to textures
-	::Texture* damagedHelmetAlbedoTexture = NULL;
-	::Texture* damagedHelmetNormalTexture = NULL;
-	::Texture* damagedHelmetOrmTexture = NULL;
-	::Texture* damagedHelmetEmissiveTexture = NULL;
-	::Texture* gridAlbedoTexture = NULL;
-	::Texture* gridOrmTexture = NULL;
 };
 
 static RendererState* g_State = NULL;
@@ -207,7 +417,29 @@ void AddPipelines();
 void RemovePipelines();
 void AddGeometry();
 void RemoveGeometry();
-void LoadMesh(struct RendererGeometry* geometry, const char* path, GPUMesh* mesh);
+uint32_t AddGeometryMesh(const char* meshPath);
+void RemoveGeometryMesh(uint32_t meshIndex);
+bool CompactGeometry(float maxFragmentation);
+bool LoadGeometryMeshPositions(uint32_t meshIndex);
+void ReleaseGeometryMeshPositions(uint32_t meshIndex);
+void AddPlaceholderTextures();
+void RemovePlaceholderTextures();
+void AddTextures();
+void RemoveTextures();
+renderer::TextureHandle AddTextureReference(const char* path);
+void RemoveTextureReference(renderer::TextureHandle handle);
+void UpdateTextures();
+void UpdateTextureStreaming(const PlayerCamera* camera, uint32_t viewportWidth);
+void SetMaterialTexture(uint32_t materialIndex, MaterialTextureSlot slot, const char* path);
+void ReleaseMaterialTextures(uint32_t materialIndex);
+bool AddMaterialLibrary(const char* path);
+static uint32_t findMaterialName(uint64_t nameHash);
+static uint32_t copyMaterial(uint32_t materialIndex);
+static void setMaterialParameters(GPUMaterial* material, const MaterialParameters& parameters);
+static void markMaterialDirty(uint32_t materialIndex);
+void AddBottomLevelAccelerationStructure();
+void AddTopLevelAccelerationStructure();
+void BuildDrawCommands(const PlayerCamera* camera, uint32_t viewportWidth);
 
 namespace renderer
 {
@@ -244,6 +476,29 @@ namespace renderer
 			::initLog("Prototype 0", LogLevel::eALL);
 		}
 
+		// Mount the content archive
+		{
+			// NOTE(gmodarelli): Reading the textures and meshes from a single mapped file saves an open
+			// and a seek per file, and lets the OS read ahead across files. Without the archive
+			// (it hasn't been cooked) the loose files are loaded instead.
+			if (OpenPakFile(::RD_MESHES, k_ContentPakFileName, &g_State->contentPak))
+			{
+				MountPakFile(&g_State->contentPak, ::RD_TEXTURES, k_ContentDirectory);
+				MountPakFile(&g_State->contentPak, ::RD_MESHES, k_ContentDirectory);
+				MountPakFile(&g_State->contentPak, ::RD_COMPILED_MATERIALS, k_ContentDirectory);
+				LOGF(eINFO, "Mounted '%s' (%u files)", k_ContentPakFileName, g_State->contentPak.header->entryCount);
+			}
+			else
+			{
+				LOGF(eINFO, "'%s' has not been cooked, loading loose content files", k_ContentPakFileName);
+			}
+
+			// NOTE(gmodarelli): Streamed textures load their mips from virtual files served on top of
+			// the archive (or the loose files), see UpdateTextureStreaming
+			::IFileSystem* textureFileSystem = g_State->contentPak.header ? &g_State->contentPak.fileSystem : ::pSystemFileIO;
+			MountDdsMipTailFileSystem(&g_State->textureStreamingFileSystem, textureFileSystem, ::RD_TEXTURES, k_ContentDirectory);
+		}
+
 		// Initialize The-Forge Renderer
 		{
 			::RendererDesc desc = RendererDesc{};
@@ -386,92 +641,22 @@ namespace renderer
 		AddGeometry();
 
 		// Materials
+		// NOTE(gmodarelli): The materials themselves come from the material library, loaded last
 		{
-			// Load PBR Textures
-			{
-				::SyncToken texturesToken = NULL;
-
-				::TextureLoadDesc textureLoadDesc = {};
-				memset(&textureLoadDesc, 0, sizeof(::TextureLoadDesc));
-
-				::TextureDesc textureDesc = {};
-				memset(&textureDesc, 0, sizeof(::TextureDesc));
-				textureDesc.bBindless = true;
-				textureLoadDesc.pDesc = &textureDesc;
-
-				textureLoadDesc.pFileName = "Models/DamagedHelmet_albedo.dds";
-				textureLoadDesc.ppTexture = &g_State->damagedHelmetAlbedoTexture;
-				::addResource(&textureLoadDesc, &texturesToken);
-
-				textureLoadDesc.pFileName = "Models/DamagedHelmet_normal.dds";
-				textureLoadDesc.ppTexture = &g_State->damagedHelmetNormalTexture;
-				::addResource(&textureLoadDesc, &texturesToken);
-
-				textureLoadDesc.pFileName = "Models/DamagedHelmet_orm.dds";
-				textureLoadDesc.ppTexture = &g_State->damagedHelmetOrmTexture;
-				::addResource(&textureLoadDesc, &texturesToken);
-
-				textureLoadDesc.pFileName = "Models/DamagedHelmet_emissive.dds";
-				textureLoadDesc.ppTexture = &g_State->damagedHelmetEmissiveTexture;
-				::addResource(&textureLoadDesc, &texturesToken);
-
-				textureLoadDesc.pFileName = "Textures/Debug/Grid_albedo.dds";
-				textureLoadDesc.ppTexture = &g_State->gridAlbedoTexture;
-				::addResource(&textureLoadDesc, &texturesToken);
-
-				textureLoadDesc.pFileName = "Textures/Debug/Grid_orm.dds";
-				textureLoadDesc.ppTexture = &g_State->gridOrmTexture;
-				::addResource(&textureLoadDesc, &texturesToken);
-
-				::waitForToken(&texturesToken);
-			}
+			AddPlaceholderTextures();
+			AddTextures();
 
 			g_State->materials = (GPUMaterial*)tf_malloc(sizeof(GPUMaterial) * k_MaterialsMaxCount);
-			ASSERT(g_State->materials);
+			g_State->materialTextures = (MaterialTextures*)tf_malloc(sizeof(MaterialTextures) * k_MaterialsMaxCount);
+			g_State->materialContentHashes = (uint64_t*)tf_malloc(sizeof(uint64_t) * k_MaterialsMaxCount);
+			g_State->materialNames = (MaterialName*)tf_malloc(sizeof(MaterialName) * k_MaterialNamesMaxCount);
+			ASSERT(g_State->materials && g_State->materialTextures && g_State->materialContentHashes && g_State->materialNames);
 			memset(g_State->materials, 0, sizeof(GPUMaterial) * k_MaterialsMaxCount);
+			memset(g_State->materialTextures, 0, sizeof(MaterialTextures) * k_MaterialsMaxCount);
+			g_State->materialCount = 0;
+			g_State->materialNameCount = 0;
 
-			GPUMaterial& playerMaterial = g_State->materials[g_State->materialCount++];
-			playerMaterial.baseColor = { 0.8f, 0.8f, 0.8f, 1.0f };
-			playerMaterial.normalIntensity = 1.0f;
-			playerMaterial.occlusionFactor = 1.0f;
-			playerMaterial.roughnessFactor = 0.8f;
-			playerMaterial.metalnessFactor = 0.0f;
-			playerMaterial.emissiveFactor = 0.0f;
-			playerMaterial.reflectance = 0.5f;
-			playerMaterial.uv0Tiling = { 1.0f, 1.0f };
-			playerMaterial.albedoTextureIndex = INVALID_BINDLESS_INDEX;
-			playerMaterial.normalTextureIndex = INVALID_BINDLESS_INDEX;
-			playerMaterial.ormTextureIndex = INVALID_BINDLESS_INDEX;
-			playerMaterial.emissiveTextureIndex = INVALID_BINDLESS_INDEX;
-
-			GPUMaterial& gridMaterial = g_State->materials[g_State->materialCount++];
-			gridMaterial.baseColor = { 1.0f, 1.0f, 1.0f, 1.0f };
-			gridMaterial.normalIntensity = 1.0f;
-			gridMaterial.occlusionFactor = 1.0f;
-			gridMaterial.roughnessFactor = 1.0f;
-			gridMaterial.metalnessFactor = 0.0f;
-			gridMaterial.emissiveFactor = 0.0f;
-			gridMaterial.reflectance = 0.5f;
-			gridMaterial.uv0Tiling = { 1.0f, 1.0f };
-			gridMaterial.albedoTextureIndex = g_State->gridAlbedoTexture->mDx.mDescriptors;
-			gridMaterial.normalTextureIndex = INVALID_BINDLESS_INDEX;
-			gridMaterial.ormTextureIndex = g_State->gridOrmTexture->mDx.mDescriptors;
-			gridMaterial.emissiveTextureIndex = INVALID_BINDLESS_INDEX;
-
-			GPUMaterial& damagedHelmetMaterial = g_State->materials[g_State->materialCount++];
-			damagedHelmetMaterial.baseColor = { 1.0f, 1.0f, 1.0f, 1.0f };
-			damagedHelmetMaterial.normalIntensity = 1.0f;
-			damagedHelmetMaterial.occlusionFactor = 1.0f;
-			damagedHelmetMaterial.roughnessFactor = 1.0f;
-			damagedHelmetMaterial.metalnessFactor = 0.0f;
-			damagedHelmetMaterial.emissiveFactor = 2.0f;
-			damagedHelmetMaterial.reflectance = 0.5f;
-			damagedHelmetMaterial.uv0Tiling = { 1.0f, 1.0f };
-			damagedHelmetMaterial.albedoTextureIndex = g_State->damagedHelmetAlbedoTexture->mDx.mDescriptors;
-			damagedHelmetMaterial.normalTextureIndex = g_State->damagedHelmetNormalTexture->mDx.mDescriptors;
-			damagedHelmetMaterial.ormTextureIndex = g_State->damagedHelmetOrmTexture->mDx.mDescriptors;
-			damagedHelmetMaterial.emissiveTextureIndex = g_State->damagedHelmetEmissiveTexture->mDx.mDescriptors;
-
+			// NOTE(gmodarelli): Only the materials in use are uploaded, the rest of the buffers is never read
 			::BufferLoadDesc desc = {};
 			desc.mDesc.mDescriptors = ::DESCRIPTOR_TYPE_BUFFER_RAW;
 			desc.mDesc.mMemoryUsage = ::RESOURCE_MEMORY_USAGE_GPU_ONLY;
@@ -479,8 +664,8 @@ namespace renderer
 			desc.mDesc.mSize = sizeof(GPUMaterial) * k_MaterialsMaxCount;
 			desc.mDesc.mElementCount = (uint32_t)(desc.mDesc.mSize / sizeof(uint32_t));
 			desc.mDesc.bBindless = true;
-			desc.pData = g_State->materials;
 			desc.mDesc.pName = "Materials Buffer";
+			desc.pData = NULL;
 			for (uint32_t i = 0; i < k_DataBufferCount; ++i)
 			{
 				desc.ppBuffer = &g_State->materialBuffers[i];
@@ -500,6 +685,16 @@ namespace renderer
 			memset(g_State->indirectDrawIndexArgs, 0, sizeof(::IndirectDrawIndexArguments) * k_IndirectDrawCommandsMaxCount);
 			g_State->indirectDrawCommandCount = 0;
 
+			g_State->drawInstances = (GPUDrawInstance*)tf_malloc(sizeof(GPUDrawInstance) * k_DrawInstancesMaxCount);
+			ASSERT(g_State->drawInstances);
+			g_State->drawInstanceCount = 0;
+			g_State->instanceLods = (uint8_t*)tf_malloc(sizeof(uint8_t) * k_InstancesMaxCount);
+			ASSERT(g_State->instanceLods);
+			g_State->drawBatchInstanceCounts = (uint32_t*)tf_malloc(sizeof(uint32_t) * k_MeshesMaxCount * MESH_MAX_LODS);
+			ASSERT(g_State->drawBatchInstanceCounts);
+			g_State->drawBatchOffsets = (uint32_t*)tf_malloc(sizeof(uint32_t) * k_MeshesMaxCount * MESH_MAX_LODS);
+			ASSERT(g_State->drawBatchOffsets);
+
 			// Instance buffers
 			{
 				::BufferLoadDesc desc = {};
@@ -538,6 +733,25 @@ namespace renderer
 					::addResource(&desc, NULL);
 				}
 			}
+
+			// Draw instance buffers
+			{
+				::BufferLoadDesc desc = {};
+				desc.mDesc.mDescriptors = ::DESCRIPTOR_TYPE_BUFFER_RAW;
+				desc.mDesc.mMemoryUsage = ::RESOURCE_MEMORY_USAGE_GPU_ONLY;
+				desc.mDesc.mFlags = ::BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS;
+				desc.mDesc.mSize = sizeof(GPUDrawInstance) * k_DrawInstancesMaxCount;
+				desc.mDesc.mElementCount = (uint32_t)(desc.mDesc.mSize / sizeof(uint32_t));
+				desc.mDesc.bBindless = true;
+				desc.mDesc.pName = "Draw Instances Buffer";
+				desc.pData = NULL;
+
+				for (uint32_t i = 0; i < k_DataBufferCount; ++i)
+				{
+					desc.ppBuffer = &g_State->drawInstanceBuffers[i];
+					::addResource(&desc, NULL);
+				}
+			}
 		}
 
 		// Lights
@@ -572,53 +786,15 @@ namespace renderer
 
 		::waitForAllResourceLoads();
 
-		// BLAS creation
-		{
-			::AccelerationStructureDesc desc = {};
-			::AccelerationStructureGeometryDesc geometryDesc[k_MeshesMaxCount] = {};
-
-			for (uint32_t i = 0; i < g_State->meshCount; ++i)
-			{
-				const GPUMesh& gpuMesh = g_State->meshes[i];
-
-				geometryDesc[i].mFlags = ::ACCELERATION_STRUCTURE_GEOMETRY_FLAG_OPAQUE;
-				geometryDesc[i].pVertexBuffer = g_State->vertexBuffer;
-				geometryDesc[i].mVertexCount = gpuMesh.vertexCount;
-				geometryDesc[i].mVertexStride = sizeof(MeshVertex);
-				geometryDesc[i].mVertexOffset = gpuMesh.vertexOffset * sizeof(MeshVertex);
-				geometryDesc[i].mVertexFormat = ::TinyImageFormat_R32G32B32_SFLOAT;
-				geometryDesc[i].pIndexBuffer = g_State->indexBuffer;
-				geometryDesc[i].mIndexCount = gpuMesh.indexCount;
-				geometryDesc[i].mIndexOffset = gpuMesh.indexOffset * sizeof(uint32_t);
-				geometryDesc[i].mIndexType = ::INDEX_TYPE_UINT32;
-			}
-
-			desc.mBottom.mDescCount = g_State->meshCount;
-			desc.mBottom.pGeometryDescs = geometryDesc;
-			desc.mType = ::ACCELERATION_STRUCTURE_TYPE_BOTTOM;
-			desc.mFlags = ::ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
-			::addAccelerationStructure(g_State->raytracing, &desc, &g_State->blas);
-
-			::GpuCmdRingElement elem = ::getNextGpuCmdRingElement(&g_State->graphicsCmdRing, true, 1);
-			::resetCmdPool(g_State->renderer, elem.pCmdPool);
-
-			::RaytracingBuildASDesc buildASDesc = {};
-			buildASDesc.pAccelerationStructure = g_State->blas;
-			buildASDesc.mIssueRWBarrier = true;
-			::beginCmd(elem.pCmds[0]);
-			::cmdBuildAccelerationStructure(elem.pCmds[0], g_State->raytracing, &buildASDesc);
-
-			::endCmd(elem.pCmds[0]);
-
-			::QueueSubmitDesc submitDesc = {};
-			submitDesc.mCmdCount = 1;
-			submitDesc.ppCmds = elem.pCmds;
-			submitDesc.pSignalFence = elem.pFence;
-			submitDesc.mSubmitDone = true;
-			::queueSubmit(g_State->graphicsQueue, &submitDesc);
-			::waitForFences(g_State->renderer, 1, &elem.pFence);
+		AddBottomLevelAccelerationStructure();
 
-			::removeAccelerationStructureScratch(g_State->raytracing, g_State->blas);
+		// NOTE(gmodarelli): Materials are loaded last so that nothing above waits on their textures.
+		// They load in the background and their materials use placeholders until UpdateTextures
+		// patches in the bindless index of each texture that finished loading.
+		if (!AddMaterialLibrary(k_MaterialLibraryFileName))
+		{
+			LOGF(eERROR, "Couldn't load material library '%s'", k_MaterialLibraryFileName);
+			return false;
 		}
 
 		return true;
@@ -632,7 +808,14 @@ namespace renderer
 			return;
 		}
 
+		for (uint32_t i = 0; i < g_State->materialCount; ++i)
+		{
+			ReleaseMaterialTextures(i);
+		}
 		tf_free(g_State->materials);
+		tf_free(g_State->materialTextures);
+		tf_free(g_State->materialContentHashes);
+		tf_free(g_State->materialNames);
 		tf_free(g_State->instances);
 		tf_free(g_State->lights);
 
@@ -642,12 +825,11 @@ namespace renderer
 
 		RemoveGeometry();
 
-		::removeResource(g_State->gridAlbedoTexture);
-		::removeResource(g_State->gridOrmTexture);
-		::removeResource(g_State->damagedHelmetAlbedoTexture);
-		::removeResource(g_State->damagedHelmetNormalTexture);
-		::removeResource(g_State->damagedHelmetOrmTexture);
-		::removeResource(g_State->damagedHelmetEmissiveTexture);
+		// NOTE(gmodarelli): Textures might still be loading
+		::waitForAllResourceLoads();
+		RemoveTextures();
+		RemovePlaceholderTextures();
+
 		::removeResource(g_State->tonyMcMapfaceLUT);
 
 		::removeSampler(g_State->renderer, g_State->linearRepeatSampler);
@@ -664,8 +846,13 @@ namespace renderer
 		for (uint32_t i = 0; i < k_DataBufferCount; ++i)
 		{
 			::removeResource(g_State->indirectDrawBuffers[i]);
+			::removeResource(g_State->drawInstanceBuffers[i]);
 		}
 		tf_free(g_State->indirectDrawIndexArgs);
+		tf_free(g_State->drawInstances);
+		tf_free(g_State->instanceLods);
+		tf_free(g_State->drawBatchInstanceCounts);
+		tf_free(g_State->drawBatchOffsets);
 
 		for (uint32_t i = 0; i < k_DownsampleSteps; ++i)
 		{
@@ -677,11 +864,14 @@ namespace renderer
 			::removeResource(g_State->upsampleUniformBuffers[i]);
 		}
 
-		if (g_State->raytracingTechniqueSupported[(uint32_t)RaytracingTechnique::RAY_QUERY])
+		if (g_State->tlas)
 		{
-			::removeAccelerationStructure(g_State->raytracing, g_State->blas);
 			::removeAccelerationStructure(g_State->raytracing, g_State->tlas);
 		}
+		if (g_State->blas)
+		{
+			::removeAccelerationStructure(g_State->raytracing, g_State->blas);
+		}
 
 		::exitGpuCmdRing(g_State->renderer, &g_State->graphicsCmdRing);
 		::exitSemaphore(g_State->renderer, g_State->imageAcquiredSemaphore);
@@ -692,6 +882,16 @@ namespace renderer
 		::exitRaytracing(g_State->renderer, g_State->raytracing);
 		::exitRenderer(g_State->renderer);
 		::exitGPUConfiguration();
+
+		// NOTE: RD_TEXTURES is mounted on the texture streaming file system, which reads from the pak file
+		::fsSetPathForResourceDir(::pSystemFileIO, ::RM_CONTENT, ::RD_TEXTURES, k_ContentDirectory);
+		if (g_State->contentPak.header)
+		{
+			UnmountPakFile(::RD_MESHES, k_ContentDirectory);
+			UnmountPakFile(::RD_COMPILED_MATERIALS, k_ContentDirectory);
+			ClosePakFile(&g_State->contentPak);
+		}
+
 		::exitLog();
 		::exitFileSystem();
 
@@ -780,81 +980,22 @@ namespace renderer
 			// TODO(gmodarelli): Find a way to associate a mesh/material to an entity in the scene
 			uint32_t meshIndex = (uint32_t)Meshes::Cube;
 			playerInstance->meshIndex = meshIndex;
-			playerInstance->materialBufferIndex = 0;
-
-			// NOTE(gmodarelli): We are currently creating indirect draw arguments on the CPU,
-			// but we will move this to the GPU when we start implementing GPU-driven rendering
-			ASSERT(g_State->indirectDrawCommandCount == 0);
-			const GPUMesh& mesh = g_State->meshes[meshIndex];
-			::IndirectDrawIndexArguments* drawIndexArgs = &g_State->indirectDrawIndexArgs[g_State->indirectDrawCommandCount++];
-			drawIndexArgs->mIndexCount = mesh.indexCount;
-			drawIndexArgs->mStartIndex = mesh.indexOffset;
-			drawIndexArgs->mVertexOffset = mesh.vertexOffset;
-			drawIndexArgs->mInstanceCount = 1;
-			drawIndexArgs->mStartInstance = 0;
+			playerInstance->materialBufferIndex = player->materialHandle;
 		}
 
 		// Load all other instances
-		if (scene->entityCount > 0)
+		// NOTE(gmodarelli): Indirect draw arguments are built every frame in Draw, since the LOD
+		// of every instance depends on the camera
+		for (uint32_t i = 0; i < scene->entityCount; ++i)
 		{
-			::IndirectDrawIndexArguments currentIndirectDrawArgs = {};
-
-			for (uint32_t i = 0; i < scene->entityCount; ++i)
-			{
-				const Entity* entity = &scene->entities[i];
-				const GPUMesh& mesh = g_State->meshes[entity->meshHandle];
-				
-				if (i == 0)
-				{
-					currentIndirectDrawArgs.mIndexCount = mesh.indexCount;
-					currentIndirectDrawArgs.mStartIndex = mesh.indexOffset;
-					currentIndirectDrawArgs.mVertexOffset = mesh.vertexOffset;
-					currentIndirectDrawArgs.mInstanceCount = 1;
-					currentIndirectDrawArgs.mStartInstance = g_State->instanceCount;
-
-					GPUInstance* instance = &g_State->instances[g_State->instanceCount++];
-					::mat4 translate = ::mat4::translation({ entity->position.x, entity->position.y, entity->position.z });
-					::mat4 scale = ::mat4::scale({ entity->scale.x, entity->scale.y, entity->scale.z });
-					loadMat4(translate * scale, &instance->worldMat.m[0]);
-					instance->meshIndex = entity->meshHandle;
-					instance->materialBufferIndex = entity->materialHandle;
-
-					continue;
-				}
-
-				if (entity->meshHandle != g_State->instances[g_State->instanceCount - 1].meshIndex)
-				{
-					::IndirectDrawIndexArguments* indirectDrawArgs = &g_State->indirectDrawIndexArgs[g_State->indirectDrawCommandCount++];
-					memcpy(indirectDrawArgs, &currentIndirectDrawArgs, sizeof(::IndirectDrawIndexArguments));
-
-					currentIndirectDrawArgs.mIndexCount = mesh.indexCount;
-					currentIndirectDrawArgs.mStartIndex = mesh.indexOffset;
-					currentIndirectDrawArgs.mVertexOffset = mesh.vertexOffset;
-					currentIndirectDrawArgs.mInstanceCount = 1;
-					currentIndirectDrawArgs.mStartInstance = g_State->instanceCount;
-
-					GPUInstance* instance = &g_State->instances[g_State->instanceCount++];
-					::mat4 translate = ::mat4::translation({ entity->position.x, entity->position.y, entity->position.z });
-					::mat4 scale = ::mat4::scale({ entity->scale.x, entity->scale.y, entity->scale.z });
-					loadMat4(translate * scale, &instance->worldMat.m[0]);
-					instance->meshIndex = entity->meshHandle;
-					instance->materialBufferIndex = entity->materialHandle;
-				}
-				else
-				{
-					GPUInstance* instance = &g_State->instances[g_State->instanceCount++];
-					::mat4 translate = ::mat4::translation({ entity->position.x, entity->position.y, entity->position.z });
-					::mat4 scale = ::mat4::scale({ entity->scale.x, entity->scale.y, entity->scale.z });
-					loadMat4(translate * scale, &instance->worldMat.m[0]);
-					instance->meshIndex = entity->meshHandle;
-					instance->materialBufferIndex = entity->materialHandle;
-
-					currentIndirectDrawArgs.mInstanceCount += 1;
-				}
-			}
-
-			::IndirectDrawIndexArguments* indirectDrawArgs = &g_State->indirectDrawIndexArgs[g_State->indirectDrawCommandCount++];
-			memcpy(indirectDrawArgs, &currentIndirectDrawArgs, sizeof(::IndirectDrawIndexArguments));
+			const Entity* entity = &scene->entities[i];
+
+			GPUInstance* instance = &g_State->instances[g_State->instanceCount++];
+			::mat4 translate = ::mat4::translation({ entity->position.x, entity->position.y, entity->position.z });
+			::mat4 scale = ::mat4::scale({ entity->scale.x, entity->scale.y, entity->scale.z });
+			loadMat4(translate * scale, &instance->worldMat.m[0]);
+			instance->meshIndex = entity->meshHandle;
+			instance->materialBufferIndex = entity->materialHandle;
 		}
 
 		ASSERT(g_State->lights);
@@ -881,51 +1022,169 @@ namespace renderer
 			gpuLight->intensity = light->intensity;
 		}
 
-		// TLAS Creation
+		AddTopLevelAccelerationStructure();
+	}
+
+	uint32_t AddMesh(const char* meshPath)
+	{
+		// NOTE(gmodarelli): Adding a mesh can move the geometry buffers, so no frame can be in flight
+		::waitQueueIdle(g_State->graphicsQueue);
+
+		uint32_t meshIndex = AddGeometryMesh(meshPath);
+		if (meshIndex != k_InvalidMeshIndex)
 		{
-			::AccelerationStructureInstanceDesc* instanceDescs = (::AccelerationStructureInstanceDesc*)tf_malloc(sizeof(AccelerationStructureInstanceDesc) * g_State->instanceCount);
-			memset(instanceDescs, 0, sizeof(AccelerationStructureInstanceDesc)* g_State->instanceCount);
-			for (uint32_t i = 0; i < g_State->instanceCount; i++)
-			{
-				const GPUInstance& instance = g_State->instances[i];
-
-				instanceDescs[i].mFlags = ::ACCELERATION_STRUCTURE_INSTANCE_FLAG_NONE;
-				instanceDescs[i].mInstanceContributionToHitGroupIndex = 0;
-				instanceDescs[i].mInstanceID = i;
-				instanceDescs[i].mInstanceMask = 1;
-				instanceDescs[i].pBottomAS = g_State->blas;
-				memcpy(instanceDescs[i].mTransform, &instance.worldMat, sizeof(float[12]));
-			}
+			AddBottomLevelAccelerationStructure();
+			AddTopLevelAccelerationStructure();
+		}
 
-			::AccelerationStructureDesc desc = {};
-			desc.mType = ::ACCELERATION_STRUCTURE_TYPE_TOP;
-			desc.mFlags = ::ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
-			desc.mTop.mDescCount = g_State->instanceCount;
-			desc.mTop.pInstanceDescs = instanceDescs;
-			::addAccelerationStructure(g_State->raytracing, &desc, &g_State->tlas);
-
-			::GpuCmdRingElement elem = ::getNextGpuCmdRingElement(&g_State->graphicsCmdRing, true, 1);
-			::resetCmdPool(g_State->renderer, elem.pCmdPool);
-
-			::RaytracingBuildASDesc buildASDesc = {};
-			buildASDesc.pAccelerationStructure = g_State->tlas;
-			buildASDesc.mIssueRWBarrier = true;
-			::beginCmd(elem.pCmds[0]);
-			::cmdBuildAccelerationStructure(elem.pCmds[0], g_State->raytracing, &buildASDesc);
-
-			::endCmd(elem.pCmds[0]);
-
-			::QueueSubmitDesc submitDesc = {};
-			submitDesc.mCmdCount = 1;
-			submitDesc.ppCmds = elem.pCmds;
-			submitDesc.pSignalFence = elem.pFence;
-			submitDesc.mSubmitDone = true;
-			::queueSubmit(g_State->graphicsQueue, &submitDesc);
-			::waitForFences(g_State->renderer, 1, &elem.pFence);
+		return meshIndex;
+	}
+
+	void RemoveMesh(uint32_t meshIndex)
+	{
+		::waitQueueIdle(g_State->graphicsQueue);
+
+		RemoveGeometryMesh(meshIndex);
+		CompactGeometry(k_GeometryPoolMaxFragmentation);
+		AddBottomLevelAccelerationStructure();
+		AddTopLevelAccelerationStructure();
+	}
 
-			::removeAccelerationStructureScratch(g_State->raytracing, g_State->tlas);
-			tf_free(instanceDescs);
+	void DefragmentGeometry()
+	{
+		::waitQueueIdle(g_State->graphicsQueue);
+
+		if (CompactGeometry(0.0f))
+		{
+			AddBottomLevelAccelerationStructure();
+			AddTopLevelAccelerationStructure();
+		}
+	}
+
+	void SetGeometryResidency(GeometryResidency residency)
+	{
+		g_State->geometryResidency = residency;
+	}
+
+	bool GetMeshBounds(uint32_t meshIndex, ::float3* aabbMin, ::float3* aabbMax)
+	{
+		if (meshIndex >= g_State->meshCount || !g_State->meshAllocations[meshIndex].used)
+		{
+			return false;
+		}
+
+		const GPUMesh& mesh = g_State->meshes[meshIndex];
+		*aabbMin = mesh.aabbMin;
+		*aabbMax = mesh.aabbMax;
+		return true;
+	}
+
+	bool GetMeshPositions(uint32_t meshIndex, MeshPositions* meshPositions)
+	{
+		if (meshIndex >= g_State->meshCount || !LoadGeometryMeshPositions(meshIndex))
+		{
+			return false;
+		}
+
+		const GPUMesh& mesh = g_State->meshes[meshIndex];
+		const MeshAllocation& ownerAllocation = g_State->meshAllocations[g_State->meshAllocations[meshIndex].owner];
+		meshPositions->positions = ownerAllocation.positions;
+		meshPositions->vertexCount = mesh.vertexCount;
+		meshPositions->indices = ownerAllocation.indices;
+		meshPositions->indexCount = mesh.lods[0].indexCount;
+		return true;
+	}
+
+	void ReleaseMeshPositions(uint32_t meshIndex)
+	{
+		if (meshIndex < g_State->meshCount)
+		{
+			ReleaseGeometryMeshPositions(meshIndex);
+		}
+	}
+
+	TextureHandle AcquireTexture(const char* path)
+	{
+		return AddTextureReference(path);
+	}
+
+	void ReleaseTexture(TextureHandle handle)
+	{
+		RemoveTextureReference(handle);
+	}
+
+	void SetTextureStreamingBudget(uint64_t budget)
+	{
+		g_State->textureStreamingBudget = budget;
+	}
+
+	bool LoadMaterialLibrary(const char* path)
+	{
+		return AddMaterialLibrary(path);
+	}
+
+	uint32_t FindMaterial(const char* name)
+	{
+		const uint32_t nameIndex = findMaterialName(HashBytes(name, strlen(name), 0));
+		return nameIndex != UINT32_MAX ? g_State->materialNames[nameIndex].materialIndex : k_InvalidMaterialIndex;
+	}
+
+	bool GetMaterialParameters(uint32_t materialIndex, MaterialParameters* parameters)
+	{
+		if (materialIndex >= g_State->materialCount)
+		{
+			return false;
+		}
+
+		const GPUMaterial& material = g_State->materials[materialIndex];
+		parameters->baseColor[0] = material.baseColor.x;
+		parameters->baseColor[1] = material.baseColor.y;
+		parameters->baseColor[2] = material.baseColor.z;
+		parameters->baseColor[3] = material.baseColor.w;
+		parameters->normalIntensity = material.normalIntensity;
+		parameters->occlusionFactor = material.occlusionFactor;
+		parameters->roughnessFactor = material.roughnessFactor;
+		parameters->metalnessFactor = material.metalnessFactor;
+		parameters->emissiveFactor = material.emissiveFactor;
+		parameters->reflectance = material.reflectance;
+		parameters->uv0Tiling[0] = material.uv0Tiling.x;
+		parameters->uv0Tiling[1] = material.uv0Tiling.y;
+		return true;
+	}
+
+	uint32_t SetMaterialParameters(const char* name, const MaterialParameters& parameters)
+	{
+		const uint32_t nameIndex = findMaterialName(HashBytes(name, strlen(name), 0));
+		if (nameIndex == UINT32_MAX)
+		{
+			return k_InvalidMaterialIndex;
+		}
+
+		// NOTE(gmodarelli): Materials shared by several names (identical in their libraries) are copied
+		// first, so that only the named one changes
+		uint32_t materialIndex = g_State->materialNames[nameIndex].materialIndex;
+		uint32_t sharingNameCount = 0;
+		for (uint32_t i = 0; i < g_State->materialNameCount; ++i)
+		{
+			sharingNameCount += g_State->materialNames[i].materialIndex == materialIndex ? 1 : 0;
+		}
+
+		if (sharingNameCount > 1)
+		{
+			materialIndex = copyMaterial(materialIndex);
+			if (materialIndex == UINT32_MAX)
+			{
+				LOGF(eERROR, "Couldn't change material '%s', k_MaterialsMaxCount (%u) is too small to copy it", name, k_MaterialsMaxCount);
+				return k_InvalidMaterialIndex;
+			}
+			g_State->materialNames[nameIndex].materialIndex = materialIndex;
 		}
+
+		setMaterialParameters(&g_State->materials[materialIndex], parameters);
+		// NOTE(gmodarelli): The material doesn't match its library anymore, so libraries loaded later don't share it
+		g_State->materialContentHashes[materialIndex] = 0;
+		markMaterialDirty(materialIndex);
+		return materialIndex;
 	}
 
 	void Draw(const Scene* scene)
@@ -973,7 +1232,7 @@ namespace renderer
 				::mat4 scale = ::mat4::scale({ scene->player.scale.x, scene->player.scale.y, scene->player.scale.z });
 				loadMat4(translate* scale, &instance.worldMat.m[0]);
 				instance.meshIndex = meshIndex;
-				instance.materialBufferIndex = 0;
+				instance.materialBufferIndex = scene->player.materialHandle;
 			}
 
 			// Update player light
@@ -986,6 +1245,16 @@ namespace renderer
 				playerLight->intensity = scene->playerLight.intensity;
 			}
 
+			// Select a LOD for every instance and build the indirect draw arguments
+			BuildDrawCommands(&scene->playerCamera, windowWidth);
+
+			// Patch the materials whose textures finished loading and remove the released textures
+			// the GPU is done with
+			UpdateTextures();
+
+			// Stream the texture mips in and out for the mips this frame needs
+			UpdateTextureStreaming(&scene->playerCamera, windowWidth);
+
 			// TODO(gmodarelli): Figure out a way to update only the data that actually
 			// changed
 			{
@@ -1013,6 +1282,37 @@ namespace renderer
 					::endUpdateResource(&updateDesc);
 				}
 
+				// Upload the instance and material indices of every draw to the GPU
+				if (g_State->drawInstanceCount > 0)
+				{
+					::BufferUpdateDesc updateDesc = {};
+					updateDesc.pBuffer = g_State->drawInstanceBuffers[g_State->frameIndex];
+					updateDesc.mDstOffset = 0;
+					updateDesc.mSize = sizeof(GPUDrawInstance) * g_State->drawInstanceCount;
+					::beginUpdateResource(&updateDesc);
+					memcpy(updateDesc.pMappedData, g_State->drawInstances, sizeof(GPUDrawInstance) * g_State->drawInstanceCount);
+					::endUpdateResource(&updateDesc);
+				}
+
+				// Upload the materials that changed since this buffer was last updated
+				{
+					MaterialDirtyRanges* dirtyRanges = &g_State->materialDirtyRanges[g_State->frameIndex];
+					for (uint32_t i = 0; i < dirtyRanges->count; ++i)
+					{
+						const uint32_t firstMaterial = dirtyRanges->begins[i];
+						const uint32_t materialCount = dirtyRanges->ends[i] - firstMaterial;
+
+						::BufferUpdateDesc updateDesc = {};
+						updateDesc.pBuffer = g_State->materialBuffers[g_State->frameIndex];
+						updateDesc.mDstOffset = sizeof(GPUMaterial) * firstMaterial;
+						updateDesc.mSize = sizeof(GPUMaterial) * materialCount;
+						::beginUpdateResource(&updateDesc);
+						memcpy(updateDesc.pMappedData, &g_State->materials[firstMaterial], sizeof(GPUMaterial) * materialCount);
+						::endUpdateResource(&updateDesc);
+					}
+					dirtyRanges->count = 0;
+				}
+
 				// Upload all lights to the GPU
 				{
 					::BufferUpdateDesc updateDesc = {};
@@ -1025,7 +1325,7 @@ namespace renderer
 				}
 			}
 
-			::mat4 projMat = ::mat4::perspectiveRH(1.0471f, windowHeight / (float)windowWidth, 100.0f, 0.01f);
+			::mat4 projMat = ::mat4::perspectiveRH(k_CameraFovX, windowHeight / (float)windowWidth, 100.0f, 0.01f);
 			::mat4 projViewMat = projMat * scene->playerCamera.viewMatrix; 
 			::mat4 invProjViewMat = ::inverse(projViewMat);
 			Frame frameData = {};
@@ -1036,10 +1336,12 @@ namespace renderer
 			frameData.cameraPosition = { scene->playerCamera.position.x, scene->playerCamera.position.y, scene->playerCamera.position.z, 1.0f };
 			frameData.meshBufferIndex = (uint32_t)g_State->meshesBuffer->mDx.mDescriptors;
 			frameData.vertexBufferIndex = (uint32_t)g_State->vertexBuffer->mDx.mDescriptors;
+			frameData.positionBufferIndex = (uint32_t)g_State->positionBuffer->mDx.mDescriptors;
 			frameData.materialBufferIndex = (uint32_t)g_State->materialBuffers[g_State->frameIndex]->mDx.mDescriptors;
 			frameData.instanceBufferIndex = (uint32_t)g_State->instanceBuffers[g_State->frameIndex]->mDx.mDescriptors;
 			frameData.lightBufferIndex = (uint32_t)g_State->lightBuffers[g_State->frameIndex]->mDx.mDescriptors;
 			frameData.numLights = g_State->lightsCount;
+			frameData.drawInstanceBufferIndex = (uint32_t)g_State->drawInstanceBuffers[g_State->frameIndex]->mDx.mDescriptors;
 
 			::BufferUpdateDesc desc = { g_State->frameUniformBuffers[g_State->frameIndex] };
 			::beginUpdateResource(&desc);
@@ -1091,9 +1393,20 @@ namespace renderer
 				::cmdBindPipeline(cmd, g_State->uberPipeline);
 				::cmdBindDescriptorSet(cmd, 0, g_State->uberPersistentDescriptorSet);
 				::cmdBindDescriptorSet(cmd, g_State->frameIndex, g_State->uberPerFrameDescriptorSet);
-				::cmdBindIndexBuffer(cmd, g_State->indexBuffer, ::INDEX_TYPE_UINT32, 0);
 
-				::cmdExecuteIndirect(cmd, ::INDIRECT_DRAW_INDEX, g_State->indirectDrawCommandCount, g_State->indirectDrawBuffers[g_State->frameIndex], 0, NULL, 0);
+				const uint32_t drawCount32 = g_State->indirectDrawIndex32CommandCount;
+				const uint32_t drawCount16 = g_State->indirectDrawCommandCount - drawCount32;
+				if (drawCount32 > 0)
+				{
+					::cmdBindIndexBuffer(cmd, g_State->indexBuffer, ::INDEX_TYPE_UINT32, 0);
+					::cmdExecuteIndirect(cmd, ::INDIRECT_DRAW_INDEX, drawCount32, g_State->indirectDrawBuffers[g_State->frameIndex], 0, NULL, 0);
+				}
+
+				if (drawCount16 > 0)
+				{
+					::cmdBindIndexBuffer(cmd, g_State->indexBuffer16, ::INDEX_TYPE_UINT16, 0);
+					::cmdExecuteIndirect(cmd, ::INDIRECT_DRAW_INDEX, drawCount16, g_State->indirectDrawBuffers[g_State->frameIndex], sizeof(::IndirectDrawIndexArguments) * drawCount32, NULL, 0);
+				}
 			}
 
 			::cmdBindRenderTargets(cmd, NULL);
@@ -1299,6 +1612,7 @@ namespace renderer
 		::queuePresent(g_State->graphicsQueue, &presentDesc);
 
 		g_State->frameIndex = (g_State->frameIndex + 1) % k_DataBufferCount;
+		g_State->frameCount++;
 	}
 }
 
@@ -1935,342 +2249,2023 @@ void RemovePipelines()
 	::removePipeline(g_State->renderer, g_State->toneMappingPipeline);
 }
 
-void AddGeometry()
+// How the buffer of every geometry stream is created
+struct GeometryStreamDesc
 {
-	const uint32_t maxVertices = 256 * 1024;
-	const uint32_t maxIndices = 1024 * 1024;
-
-	g_State->geometry.vertices = (MeshVertex*)tf_malloc(sizeof(MeshVertex) * maxVertices);
-	ASSERT(g_State->geometry.vertices);
-	memset(g_State->geometry.vertices, 0, sizeof(MeshVertex) * maxVertices);
-
-	g_State->geometry.indices = (uint32_t*)tf_malloc(sizeof(uint32_t) * maxIndices);
-	ASSERT(g_State->geometry.indices);
-	memset(g_State->geometry.indices, 0, sizeof(uint32_t) * maxIndices);
-
-	g_State->meshes = (GPUMesh*)tf_malloc(sizeof(GPUMesh) * k_MeshesMaxCount);
-	ASSERT(g_State->meshes);
-	memset(g_State->meshes, 0, sizeof(GPUMesh) * k_MeshesMaxCount);
-	g_State->meshCount = 0;
+	const char* name;
+	uint32_t elementSize;
+	uint32_t initialCapacity;
+	::DescriptorType descriptors;
+	::BufferCreationFlags flags;
+	bool bindless;
+};
 
-	GPUMesh* plane = &g_State->meshes[(size_t)Meshes::Plane];
-	const char* planePath = "Content/Models/Plane.obj";
-	LoadMesh(&g_State->geometry, planePath, plane);
+// NOTE(gmodarelli): Meshlets hold at least a few dozen triangles, so a fraction of the triangle
+// count is plenty. Meshlet vertices can't outnumber indices.
+static const GeometryStreamDesc k_GeometryStreamDescs[(uint32_t)GeometryStream::_Count] = {
+	{ "Position Buffer", sizeof(float3), k_GeometryPoolInitialVertexCount, ::DESCRIPTOR_TYPE_BUFFER_RAW, ::BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS, true },
+	{ "Vertex Buffer", sizeof(MeshVertexAttributes), k_GeometryPoolInitialVertexCount, ::DESCRIPTOR_TYPE_BUFFER_RAW, ::BUFFER_CREATION_FLAG_NONE, true },
+	{ "Index Buffer", sizeof(uint32_t), k_GeometryPoolInitialIndexCount, ::DESCRIPTOR_TYPE_INDEX_BUFFER, ::BUFFER_CREATION_FLAG_NONE, false },
+	{ "Index Buffer 16", sizeof(uint16_t), k_GeometryPoolInitialIndexCount, ::DESCRIPTOR_TYPE_INDEX_BUFFER, ::BUFFER_CREATION_FLAG_NONE, false },
+	{ "Meshlet Buffer", sizeof(GPUMeshlet), k_GeometryPoolInitialIndexCount / 3 / 16, ::DESCRIPTOR_TYPE_BUFFER_RAW, ::BUFFER_CREATION_FLAG_NONE, true },
+	{ "Meshlet Vertices Buffer", sizeof(uint32_t), k_GeometryPoolInitialIndexCount, ::DESCRIPTOR_TYPE_BUFFER_RAW, ::BUFFER_CREATION_FLAG_NONE, true },
+	{ "Meshlet Triangles Buffer", sizeof(uint32_t), k_GeometryPoolInitialIndexCount / 3, ::DESCRIPTOR_TYPE_BUFFER_RAW, ::BUFFER_CREATION_FLAG_NONE, true },
+	{ "Submesh Buffer", sizeof(GPUSubmesh), k_MeshesMaxCount, ::DESCRIPTOR_TYPE_BUFFER_RAW, ::BUFFER_CREATION_FLAG_NONE, true },
+};
 
-	GPUMesh* cube = &g_State->meshes[(size_t)Meshes::Cube];
-	const char* cubePath = "Content/Models/Cube.obj";
-	LoadMesh(&g_State->geometry, cubePath, cube);
+// CPU copy of a mesh that is being added to the geometry pool, either a memory-mapped cooked
+// mesh or an imported one
+struct MeshSource
+{
+	MeshFile meshFile;
+	ImportedMesh importedMesh;
+	char sourcePath[FS_MAX_PATH];
+	uint64_t importKey;
+	bool hasImportKey;
+	bool imported;
+	bool loaded;
+};
 
-	GPUMesh* helmet = &g_State->meshes[(size_t)Meshes::DamagedHelmet];
-	const char* helmetPath = "Content/Models/DamagedHelmet.obj";
-	LoadMesh(&g_State->geometry, helmetPath, helmet);
+// Copies data straight into the upload memory of a range of buffer
+static void uploadBufferRange(::Buffer* buffer, uint64_t offset, const void* data, uint64_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
 
-	g_State->meshCount = (uint32_t)Meshes::_Count;
+	::BufferUpdateDesc updateDesc = {};
+	updateDesc.pBuffer = buffer;
+	updateDesc.mDstOffset = offset;
+	updateDesc.mSize = size;
+	::beginUpdateResource(&updateDesc);
+	memcpy(updateDesc.pMappedData, data, size);
+	::endUpdateResource(&updateDesc);
+}
 
+static ::Buffer* addGeometryStreamBuffer(GeometryStream stream, uint32_t capacity)
+{
+	const GeometryStreamDesc& streamDesc = k_GeometryStreamDescs[(uint32_t)stream];
+
+	::Buffer* buffer = NULL;
+	::BufferLoadDesc desc = {};
+	desc.mDesc.mDescriptors = streamDesc.descriptors;
+	desc.mDesc.mMemoryUsage = ::RESOURCE_MEMORY_USAGE_GPU_ONLY;
+	desc.mDesc.mFlags = streamDesc.flags;
+	// NOTE(gmodarelli): Keep the size a multiple of 4 bytes, raw views and 16-bit index buffers need it
+	desc.mDesc.mSize = ((uint64_t)streamDesc.elementSize * capacity + 3) & ~(uint64_t)3;
+	if (streamDesc.bindless)
 	{
-		::BufferLoadDesc meshDesc = {};
-		meshDesc.mDesc.mDescriptors = ::DESCRIPTOR_TYPE_BUFFER_RAW;
-		meshDesc.mDesc.mMemoryUsage = ::RESOURCE_MEMORY_USAGE_GPU_ONLY;
-		meshDesc.mDesc.mFlags = ::BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS;
-		meshDesc.mDesc.mSize = sizeof(GPUMesh) * k_MeshesMaxCount;
-		meshDesc.mDesc.mElementCount = (uint32_t)(meshDesc.mDesc.mSize / sizeof(uint32_t));
-		meshDesc.mDesc.bBindless = true;
-		meshDesc.pData = g_State->meshes;
-		meshDesc.ppBuffer = &g_State->meshesBuffer;
-		meshDesc.mDesc.pName = "Mesh Buffer";
-		::addResource(&meshDesc, NULL);
+		desc.mDesc.mElementCount = (uint32_t)(desc.mDesc.mSize / sizeof(uint32_t));
+		desc.mDesc.bBindless = true;
+	}
+	desc.pData = NULL;
+	desc.ppBuffer = &buffer;
+	desc.mDesc.pName = streamDesc.name;
+	::addResource(&desc, NULL);
 
-		::BufferLoadDesc vbDesc = {};
-		vbDesc.mDesc.mDescriptors = ::DESCRIPTOR_TYPE_BUFFER_RAW;
-		vbDesc.mDesc.mMemoryUsage = ::RESOURCE_MEMORY_USAGE_GPU_ONLY;
-		vbDesc.mDesc.mFlags = ::BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS;
-		vbDesc.mDesc.mSize = sizeof(MeshVertex) * g_State->geometry.vertexCount;
-		vbDesc.mDesc.mElementCount = (uint32_t)(vbDesc.mDesc.mSize / sizeof(uint32_t));
-		vbDesc.mDesc.bBindless = true;
-		vbDesc.pData = g_State->geometry.vertices;
-		vbDesc.ppBuffer = &g_State->vertexBuffer;
-		vbDesc.mDesc.pName = "Vertex Buffer";
-		::addResource(&vbDesc, NULL);
+	return buffer;
+}
 
-		::BufferLoadDesc ibDesc = {};
-		ibDesc.mDesc.mDescriptors = ::DESCRIPTOR_TYPE_INDEX_BUFFER;
-		ibDesc.mDesc.mMemoryUsage = ::RESOURCE_MEMORY_USAGE_GPU_ONLY;
-		ibDesc.mDesc.mSize = sizeof(uint32_t) * g_State->geometry.indexCount;
-		ibDesc.pData = g_State->geometry.indices;
-		ibDesc.ppBuffer = &g_State->indexBuffer;
-		::addResource(&ibDesc, NULL);
+static uint32_t* meshStreamOffset(GPUMesh* mesh, GeometryStream stream)
+{
+	switch (stream)
+	{
+	case GeometryStream::Positions:
+		return &mesh->positionOffset;
+	case GeometryStream::Vertices:
+		return &mesh->vertexOffset;
+	case GeometryStream::Indices32:
+	case GeometryStream::Indices16:
+		return &mesh->indexOffset;
+	case GeometryStream::Meshlets:
+		return &mesh->meshletOffset;
+	case GeometryStream::MeshletVertices:
+		return &mesh->meshletVertexOffset;
+	case GeometryStream::MeshletTriangles:
+		return &mesh->meshletTriangleOffset;
+	case GeometryStream::Submeshes:
+		return &mesh->submeshOffset;
+	default:
+		ASSERT(false);
+		return NULL;
 	}
 }
 
-void RemoveGeometry()
+// Mesh slot that owns the geometry ranges used by a mesh
+static uint32_t geometryOwner(uint32_t meshIndex)
 {
-	::removeResource(g_State->meshesBuffer);
-	::removeResource(g_State->vertexBuffer);
-	::removeResource(g_State->indexBuffer);
-
-	tf_free(g_State->geometry.indices);
-	tf_free(g_State->geometry.vertices);
-	tf_free(g_State->meshes);
-
-	k_ScratchGeometryData.destroy();
+	const MeshAllocation& allocation = g_State->meshAllocations[meshIndex];
+	return allocation.used ? allocation.owner : meshIndex;
 }
 
-static inline void loadMat4(const ::mat4& matrix, float* output)
+// Copies the GPUMesh of every owner into the meshes sharing its geometry
+static void syncSharedMeshes()
 {
-	output[0] = matrix.getCol(0).getX();
-	output[1] = matrix.getCol(0).getY();
-	output[2] = matrix.getCol(0).getZ();
-	output[3] = matrix.getCol(0).getW();
-	output[4] = matrix.getCol(1).getX();
-	output[5] = matrix.getCol(1).getY();
-	output[6] = matrix.getCol(1).getZ();
-	output[7] = matrix.getCol(1).getW();
-	output[8] = matrix.getCol(2).getX();
-	output[9] = matrix.getCol(2).getY();
-	output[10] = matrix.getCol(2).getZ();
-	output[11] = matrix.getCol(2).getW();
-	output[12] = matrix.getCol(3).getX();
-	output[13] = matrix.getCol(3).getY();
-	output[14] = matrix.getCol(3).getZ();
-	output[15] = matrix.getCol(3).getW();
+	for (uint32_t i = 0; i < g_State->meshCount; ++i)
+	{
+		const uint32_t owner = geometryOwner(i);
+		if (owner != i)
+		{
+			g_State->meshes[i] = g_State->meshes[owner];
+		}
+	}
 }
 
-int32_t mikkt_GetNumFaces(const SMikkTSpaceContext* context);
-int32_t mikkt_GetNumVerticesOfFace(const SMikkTSpaceContext* context, int32_t faceIndex);
-uint32_t mikkt_GetVertexIndex(const SMikkTSpaceContext* context, int32_t faceIndex, int32_t vertIndex);
-void mikkt_GetPosition(const SMikkTSpaceContext* context, float position[3], int32_t faceIndex, int32_t vertIndex);
-void mikkt_GetNormal(const SMikkTSpaceContext* context, float normal[3], int32_t faceIndex, int32_t vertIndex);
-void mikkt_GetTexcoord(const SMikkTSpaceContext* context, float normal[2], int32_t faceIndex, int32_t vertIndex);
-void mikkt_SetTSpaceBasic(const SMikkTSpaceContext* context, const float tangent[3], float sign, int32_t faceIndex, int32_t vertIndex);
+// Checks that every used mesh slot has a used owner, and that the owners count their sharers
+static void validateGeometryOwners()
+{
+#if defined(_DEBUG)
+	for (uint32_t i = 0; i < g_State->meshCount; ++i)
+	{
+		const MeshAllocation& allocation = g_State->meshAllocations[i];
+		if (!allocation.used)
+		{
+			continue;
+		}
+
+		ASSERT(allocation.owner < g_State->meshCount);
+		const MeshAllocation& ownerAllocation = g_State->meshAllocations[allocation.owner];
+		ASSERT(ownerAllocation.used && ownerAllocation.owner == allocation.owner);
+		if (allocation.owner != i)
+		{
+			continue;
+		}
+
+		uint32_t sharingCount = 0;
+		for (uint32_t j = 0; j < g_State->meshCount; ++j)
+		{
+			sharingCount += geometryOwner(j) == i ? 1 : 0;
+		}
+		ASSERT(sharingCount == allocation.refCount);
+	}
+#endif
+}
 
-struct MikkTUserData
+static uint32_t findGeometryOwner(uint64_t pathHash, uint64_t contentHash)
 {
-	RendererGeometry* geometry;
-};
+	for (uint32_t i = 0; i < g_State->meshCount; ++i)
+	{
+		const MeshAllocation& allocation = g_State->meshAllocations[i];
+		if (allocation.used && allocation.owner == i &&
+			(allocation.pathHash == pathHash || (contentHash != 0 && allocation.contentHash == contentHash)))
+		{
+			return i;
+		}
+	}
+
+	return renderer::k_InvalidMeshIndex;
+}
 
-void LoadMesh(RendererGeometry* geometry, const char* path, GPUMesh* mesh)
+// Makes a free mesh slot share the geometry of owner
+static void shareMeshGeometry(uint32_t meshIndex, uint32_t owner, uint64_t pathHash)
 {
-	k_ScratchGeometryData.initialize();
-	k_ScratchGeometryData.reset();
+	ASSERT(!g_State->meshAllocations[meshIndex].used);
+	MeshAllocation* ownerAllocation = &g_State->meshAllocations[owner];
+	ASSERT(ownerAllocation->used && ownerAllocation->owner == owner);
+
+	MeshAllocation* allocation = &g_State->meshAllocations[meshIndex];
+	*allocation = {};
+	allocation->used = true;
+	allocation->owner = owner;
+	allocation->pathHash = pathHash;
+	allocation->contentHash = ownerAllocation->contentHash;
+	ownerAllocation->refCount++;
+
+	g_State->meshes[meshIndex] = g_State->meshes[owner];
+	g_State->meshCount = TF_MAX(g_State->meshCount, meshIndex + 1);
+}
+
+// Copies the live ranges of a stream to the front of a new buffer of newCapacity elements and
+// patches the offsets of the meshes using them, which both compacts and grows the stream.
+// NOTE(gmodarelli): The old buffer is released as soon as the copies are done, so no frame using it
+// can be in flight. The meshes buffer has to be uploaded again afterwards.
+static void relocateGeometryStream(GeometryStream stream, uint32_t newCapacity)
+{
+	GeometryStreamPool* pool = &g_State->geometryStreams[(uint32_t)stream];
+	const GeometryStreamDesc& streamDesc = k_GeometryStreamDescs[(uint32_t)stream];
+	const uint64_t elementSize = streamDesc.elementSize;
+	ASSERT(newCapacity >= pool->allocator.usedSize);
+
+	// Pending uploads to the old buffer have to land before it gets copied
+	::waitForAllResourceLoads();
 
-	fastObjMesh* obj = fast_obj_read(path);
-	if (!obj)
+	::Buffer* oldBuffer = *pool->ppBuffer;
+	::Buffer* newBuffer = addGeometryStreamBuffer(stream, newCapacity);
+
+	::GpuCmdRingElement elem = ::getNextGpuCmdRingElement(&g_State->graphicsCmdRing, true, 1);
+	::resetCmdPool(g_State->renderer, elem.pCmdPool);
+
+	::Cmd* cmd = elem.pCmds[0];
+	::beginCmd(cmd);
+
+	::BufferBarrier barriers[] = {
+		{ oldBuffer, ::RESOURCE_STATE_COMMON, ::RESOURCE_STATE_COPY_SOURCE },
+		{ newBuffer, ::RESOURCE_STATE_COMMON, ::RESOURCE_STATE_COPY_DEST },
+	};
+	::cmdResourceBarrier(cmd, TF_ARRAY_COUNT(barriers), barriers, 0, NULL, 0, NULL);
+
+	// Ranges are packed in mesh order
+	uint32_t packedSize = 0;
+	for (uint32_t i = 0; i < g_State->meshCount; ++i)
 	{
-		return;
+		MeshAllocation* allocation = &g_State->meshAllocations[i];
+		const uint32_t count = allocation->counts[(uint32_t)stream];
+		if (!allocation->used || count == 0)
+		{
+			continue;
+		}
+
+		::cmdUpdateBuffer(cmd, newBuffer, elementSize * packedSize, oldBuffer, elementSize * allocation->offsets[(uint32_t)stream], elementSize * count);
+		allocation->offsets[(uint32_t)stream] = packedSize;
+		*meshStreamOffset(&g_State->meshes[i], stream) = packedSize;
+		packedSize += count;
+	}
+	ASSERT(packedSize == pool->allocator.usedSize);
+	syncSharedMeshes();
+
+	barriers[0] = { oldBuffer, ::RESOURCE_STATE_COPY_SOURCE, ::RESOURCE_STATE_COMMON };
+	barriers[1] = { newBuffer, ::RESOURCE_STATE_COPY_DEST, ::RESOURCE_STATE_COMMON };
+	::cmdResourceBarrier(cmd, TF_ARRAY_COUNT(barriers), barriers, 0, NULL, 0, NULL);
+	::endCmd(cmd);
+
+	::QueueSubmitDesc submitDesc = {};
+	submitDesc.mCmdCount = 1;
+	submitDesc.ppCmds = elem.pCmds;
+	submitDesc.pSignalFence = elem.pFence;
+	submitDesc.mSubmitDone = true;
+	::queueSubmit(g_State->graphicsQueue, &submitDesc);
+	::waitForFences(g_State->renderer, 1, &elem.pFence);
+
+	::removeResource(oldBuffer);
+	*pool->ppBuffer = newBuffer;
+	pool->allocator.resetCompacted(newCapacity, packedSize);
+
+	LOGF(eINFO, "Geometry pool: relocated '%s', %u of %u elements used", streamDesc.name, packedSize, newCapacity);
+}
+
+// Allocates count elements of a stream, compacting the stream when the free space is fragmented
+// and growing it when there isn't enough free space
+static uint32_t allocGeometryRange(GeometryStream stream, uint32_t count)
+{
+	RangeAllocator* allocator = &g_State->geometryStreams[(uint32_t)stream].allocator;
+
+	uint32_t offset = 0;
+	if (allocator->alloc(count, &offset))
+	{
+		return offset;
 	}
 
-	size_t indexCount = 0;
-	for (uint32_t i = 0; i < obj->face_count; ++i)
+	uint32_t newCapacity = allocator->capacity;
+	if (allocator->capacity - allocator->usedSize < count)
 	{
-		indexCount += 3 * (obj->face_vertices[i] - 2);
+		newCapacity = TF_MAX(allocator->capacity * 2, allocator->usedSize + count);
 	}
+	relocateGeometryStream(stream, newCapacity);
 
-	size_t vertexOffset = 0;
-	size_t indexOffset = 0;
-	mesh->aabbMin = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
-	mesh->aabbMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	bool allocated = allocator->alloc(count, &offset);
+	ASSERT(allocated);
+	return offset;
+}
 
-	for (uint32_t i = 0; i < obj->face_count; ++i)
+// Meshes are loaded from their cooked version (Content/Models/*.mesh), falling back to the import cache
+// and then to importing the source OBJ when a mesh hasn't been cooked yet. Meshes that need importing
+// are imported in parallel and added to the import cache.
+static void loadMeshSources(const char* const* meshPaths, uint32_t count, MeshSource* sources)
+{
+	const char** importPaths = (const char**)tf_malloc(sizeof(const char*) * count);
+	uint32_t* importSourceIndices = (uint32_t*)tf_malloc(sizeof(uint32_t) * count);
+	ImportedMesh* importedMeshes = (ImportedMesh*)tf_malloc(sizeof(ImportedMesh) * count);
+	bool* importResults = (bool*)tf_malloc(sizeof(bool) * count);
+	ASSERT(importPaths && importSourceIndices && importedMeshes && importResults);
+	uint32_t importCount = 0;
+
+	for (uint32_t i = 0; i < count; ++i)
 	{
-		ASSERT(obj->face_vertices[i] == 3);
+		MeshSource* source = &sources[i];
+		*source = {};
 
-		for (uint32_t j = 0; j < obj->face_vertices[i]; ++j)
+		char cookedPath[FS_MAX_PATH] = {};
+		snprintf(cookedPath, sizeof(cookedPath), "%s.mesh", meshPaths[i]);
+		if (OpenMeshFile(::RD_MESHES, cookedPath, &source->meshFile))
 		{
-			fastObjIndex gi = obj->indices[indexOffset + j];
-
-			MeshVertex* v = &k_ScratchGeometryData.geometry.vertices[vertexOffset++];
-			v->position.x = obj->positions[gi.p * 3 + 0];
-			v->position.y = obj->positions[gi.p * 3 + 1];
-			v->position.z = obj->positions[gi.p * 3 + 2];
-			v->color.x = obj->colors[gi.p * 3 + 0];
-			v->color.y = obj->colors[gi.p * 3 + 1];
-			v->color.z = obj->colors[gi.p * 3 + 2];
-			v->normal.x = obj->normals[gi.n * 3 + 0];
-			v->normal.y = obj->normals[gi.n * 3 + 1];
-			v->normal.z = obj->normals[gi.n * 3 + 2];
-			v->uv.x = obj->texcoords[gi.t * 2 + 0];
-			v->uv.y = 1.0f - obj->texcoords[gi.t * 2 + 1];
-			v->tangent.x = 0;
-			v->tangent.z = 0;
-			v->tangent.y = 0;
-			v->tangent.w = 0;
+			source->loaded = true;
+			continue;
+		}
 
-			mesh->aabbMin.x = TF_MIN(mesh->aabbMin.x, v->position.x);
-			mesh->aabbMin.y = TF_MIN(mesh->aabbMin.y, v->position.y);
-			mesh->aabbMin.z = TF_MIN(mesh->aabbMin.z, v->position.z);
-			mesh->aabbMax.x = TF_MAX(mesh->aabbMax.x, v->position.x);
-			mesh->aabbMax.y = TF_MAX(mesh->aabbMax.y, v->position.y);
-			mesh->aabbMax.z = TF_MAX(mesh->aabbMax.z, v->position.z);
+		snprintf(source->sourcePath, sizeof(source->sourcePath), "Content/%s.obj", meshPaths[i]);
+		source->hasImportKey = ComputeMeshImportKey(source->sourcePath, &source->importKey);
+		if (source->hasImportKey && OpenCachedMesh(source->importKey, &source->meshFile))
+		{
+			LOGF(eINFO, "Mesh '%s' has not been cooked, loaded '%s' from the import cache", cookedPath, source->sourcePath);
+			source->loaded = true;
+			continue;
 		}
 
-		indexOffset += obj->face_vertices[i];
+		LOGF(eWARNING, "Mesh '%s' has not been cooked, importing '%s'", cookedPath, source->sourcePath);
+
+		importPaths[importCount] = source->sourcePath;
+		importSourceIndices[importCount] = i;
+		importedMeshes[importCount] = {};
+		importResults[importCount] = false;
+		importCount++;
 	}
 
-	ASSERT(vertexOffset == indexCount);
-	k_ScratchGeometryData.geometry.vertexCount = (uint32_t)indexCount;
-	k_ScratchGeometryData.geometry.indexCount = (uint32_t)indexCount;
+	if (importCount > 0)
+	{
+		ImportMeshes(importPaths, importCount, importedMeshes, importResults);
 
+		for (uint32_t i = 0; i < importCount; ++i)
+		{
+			MeshSource* source = &sources[importSourceIndices[i]];
+			source->importedMesh = importedMeshes[i];
+			source->imported = true;
+			source->loaded = importResults[i];
 
-	for (uint32_t i = 0; i < indexCount; ++i) {
-		k_ScratchGeometryData.geometry.indices[i] = (uint32_t)i;
+			if (source->loaded && source->hasImportKey)
+			{
+				StoreCachedMesh(source->importKey, &source->importedMesh);
+			}
+		}
 	}
 
-	// Calculate MikkTSpace tangents
-	::SMikkTSpaceInterface mikktInterface = {};
-	mikktInterface.m_getNumFaces = mikkt_GetNumFaces;
-	mikktInterface.m_getNumVerticesOfFace = mikkt_GetNumVerticesOfFace;
-	mikktInterface.m_getPosition = mikkt_GetPosition;
-	mikktInterface.m_getNormal = mikkt_GetNormal;
-	mikktInterface.m_getTexCoord = mikkt_GetTexcoord;
-	mikktInterface.m_setTSpaceBasic = mikkt_SetTSpaceBasic;
-
-	::SMikkTSpaceContext mikktContext = {};
-	mikktContext.m_pInterface = &mikktInterface;
-	mikktContext.m_pUserData = (void*)&k_ScratchGeometryData.geometry;
+	tf_free(importPaths);
+	tf_free(importSourceIndices);
+	tf_free(importedMeshes);
+	tf_free(importResults);
+}
 
-	::genTangSpaceDefault(&mikktContext);
+static uint64_t meshSourceContentHash(const MeshSource* source)
+{
+	return source->meshFile.header ? source->meshFile.header->contentHash : source->importedMesh.contentHash;
+}
 
-	fast_obj_destroy(obj);
+static uint64_t hashMeshPath(const char* meshPath)
+{
+	return HashBytes(meshPath, strlen(meshPath), 0);
+}
 
-	mesh->indexOffset = geometry->indexCount;
-	mesh->vertexOffset = geometry->vertexCount;
+static void closeMeshSource(MeshSource* source)
+{
+	if (source->meshFile.header)
+	{
+		CloseMeshFile(&source->meshFile);
+	}
 
-	// Generate the index buffer with meshoptimizer
+	if (source->imported)
 	{
-		uint32_t* remap = (uint32_t*)tf_malloc(sizeof(uint32_t) * k_ScratchGeometryData.geometry.vertexCount);
-		size_t vertexCount = meshopt_generateVertexRemap(remap,
-			k_ScratchGeometryData.geometry.indices, 
-			k_ScratchGeometryData.geometry.indexCount,
-			k_ScratchGeometryData.geometry.vertices,
-			k_ScratchGeometryData.geometry.vertexCount,
-			sizeof(MeshVertex));
+		DestroyImportedMesh(&source->importedMesh);
+	}
+
+	*source = {};
+}
 
-		meshopt_remapIndexBuffer(&geometry->indices[geometry->indexCount],
-			k_ScratchGeometryData.geometry.indices,
-			k_ScratchGeometryData.geometry.indexCount,
-			remap);
+// Copies the positions and the LOD 0 indices of a loaded mesh to its owner allocation
+static bool copyMeshPositions(MeshAllocation* allocation, const MeshSource* source)
+{
+	ASSERT(!allocation->positions && !allocation->indices);
 
-		geometry->indexCount += indexCount;
+	// NOTE(gmodarelli): Cooked meshes are encoded, so they're decoded in full first
+	ImportedMesh loadedMesh = {};
+	const ImportedMesh* importedMesh = &source->importedMesh;
+	if (source->meshFile.header)
+	{
+		if (!LoadMeshFile(&source->meshFile, &loadedMesh))
+		{
+			return false;
+		}
+		importedMesh = &loadedMesh;
+	}
 
-		meshopt_remapVertexBuffer(&geometry->vertices[geometry->vertexCount],
-			k_ScratchGeometryData.geometry.vertices,
-			k_ScratchGeometryData.geometry.vertexCount,
-			sizeof(MeshVertex),
-			remap);
+	const RendererGeometry& geometry = importedMesh->geometry;
+	const GPUMeshLod& lod = importedMesh->mesh.lods[0];
+	ASSERT(lod.indexOffset + lod.indexCount <= geometry.indexCount);
 
-		geometry->vertexCount += vertexCount;
-		mesh->indexCount = indexCount;
-		mesh->vertexCount = vertexCount;
+	allocation->positions = (float3*)tf_malloc(sizeof(float3) * geometry.vertexCount);
+	allocation->indices = (uint32_t*)tf_malloc(sizeof(uint32_t) * TF_MAX(lod.indexCount, 1u));
+	ASSERT(allocation->positions && allocation->indices);
+	for (uint32_t i = 0; i < geometry.vertexCount; ++i)
+	{
+		allocation->positions[i] = geometry.vertices[i].position;
+	}
+	memcpy(allocation->indices, &geometry.indices[lod.indexOffset], sizeof(uint32_t) * lod.indexCount);
 
-		tf_free(remap);
+	if (source->meshFile.header)
+	{
+		DestroyImportedMesh(&loadedMesh);
 	}
 
-	return;
+	return true;
+}
+
+static void freeMeshPositions(MeshAllocation* allocation)
+{
+	tf_free(allocation->positions);
+	tf_free(allocation->indices);
+	allocation->positions = NULL;
+	allocation->indices = NULL;
+}
+
+// Frees everything an owner allocation keeps on the CPU
+static void freeMeshCpuData(MeshAllocation* allocation)
+{
+	freeMeshPositions(allocation);
+	tf_free(allocation->submeshes);
+	tf_free(allocation->meshPath);
+	allocation->submeshes = NULL;
+	allocation->meshPath = NULL;
 }
 
-bool ScratchGeometryData::isInitialized()
+// Splits interleaved (imported) vertices into the position and attribute streams of a mesh, writing
+// both straight into the upload memory of their ranges. Cooked meshes store the two streams separately.
+static void uploadMeshVertices(const GPUMesh* mesh, const MeshVertex* vertices)
 {
-	return geometry.vertices != NULL && geometry.indices != NULL;
+	::BufferUpdateDesc positionUpdateDesc = {};
+	positionUpdateDesc.pBuffer = g_State->positionBuffer;
+	positionUpdateDesc.mDstOffset = sizeof(float3) * mesh->positionOffset;
+	positionUpdateDesc.mSize = sizeof(float3) * mesh->vertexCount;
+	::beginUpdateResource(&positionUpdateDesc);
+
+	::BufferUpdateDesc attributeUpdateDesc = {};
+	attributeUpdateDesc.pBuffer = g_State->vertexBuffer;
+	attributeUpdateDesc.mDstOffset = sizeof(MeshVertexAttributes) * mesh->vertexOffset;
+	attributeUpdateDesc.mSize = sizeof(MeshVertexAttributes) * mesh->vertexCount;
+	::beginUpdateResource(&attributeUpdateDesc);
+
+	float3* positions = (float3*)positionUpdateDesc.pMappedData;
+	MeshVertexAttributes* attributes = (MeshVertexAttributes*)attributeUpdateDesc.pMappedData;
+	for (uint32_t i = 0; i < mesh->vertexCount; ++i)
+	{
+		const MeshVertex& vertex = vertices[i];
+		positions[i] = vertex.position;
+		attributes[i].normal = vertex.normal;
+		attributes[i].tangent = vertex.tangent;
+		attributes[i].uv = vertex.uv;
+		attributes[i].color = vertex.color;
+	}
+
+	::endUpdateResource(&positionUpdateDesc);
+	::endUpdateResource(&attributeUpdateDesc);
 }
 
-void ScratchGeometryData::initialize()
+// Allocates the geometry ranges of a free mesh slot and uploads the mesh into them
+static bool addMeshToGeometryPool(uint32_t meshIndex, const char* meshPath, const MeshSource* source, uint64_t pathHash)
 {
-	if (isInitialized()) return;
-	ASSERT(verticesMaxCount > 0);
-	ASSERT(indicexMaxCount > 0);
+	ASSERT(meshIndex < k_MeshesMaxCount);
+	ASSERT(!g_State->meshAllocations[meshIndex].used);
+
+	GPUMesh* mesh = &g_State->meshes[meshIndex];
+	MeshAllocation* allocation = &g_State->meshAllocations[meshIndex];
+	*mesh = {};
+	*allocation = {};
+
+	if (!source->loaded)
+	{
+		return false;
+	}
+
+	const MeshFileHeader* header = source->meshFile.header;
+	const RendererGeometry* importedGeometry = &source->importedMesh.geometry;
+	uint32_t* counts = allocation->counts;
+	if (header)
+	{
+		mesh->vertexCount = header->vertexCount;
+		mesh->indexCount = header->indexCount;
+		mesh->indexSize = header->indexSize;
+		mesh->aabbMin = { header->aabbMin[0], header->aabbMin[1], header->aabbMin[2] };
+		mesh->aabbMax = { header->aabbMax[0], header->aabbMax[1], header->aabbMax[2] };
+		mesh->meshletCount = header->meshletCount;
+		mesh->submeshCount = header->submeshCount;
+		mesh->lodCount = header->lodCount;
+		memcpy(mesh->lods, header->lods, sizeof(mesh->lods));
+		counts[(uint32_t)GeometryStream::MeshletVertices] = header->meshletVertexCount;
+		counts[(uint32_t)GeometryStream::MeshletTriangles] = header->meshletTriangleCount;
+	}
+	else
+	{
+		*mesh = source->importedMesh.mesh;
+		counts[(uint32_t)GeometryStream::MeshletVertices] = importedGeometry->meshletVertexCount;
+		counts[(uint32_t)GeometryStream::MeshletTriangles] = importedGeometry->meshletTriangleCount;
+	}
+
+	if (mesh->vertexCount == 0 || mesh->indexCount == 0 || mesh->submeshCount == 0)
+	{
+		*mesh = {};
+		*allocation = {};
+		return false;
+	}
+
+	const bool index16 = mesh->indexSize == sizeof(uint16_t);
+	mesh->indexSize = index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	counts[(uint32_t)GeometryStream::Positions] = mesh->vertexCount;
+	counts[(uint32_t)GeometryStream::Vertices] = mesh->vertexCount;
+	counts[(uint32_t)(index16 ? GeometryStream::Indices16 : GeometryStream::Indices32)] = mesh->indexCount;
+	counts[(uint32_t)GeometryStream::Meshlets] = mesh->meshletCount;
+	counts[(uint32_t)GeometryStream::Submeshes] = mesh->submeshCount;
+
+	// NOTE(gmodarelli): Allocating may relocate a stream and patch the offsets of the other meshes,
+	// this mesh is only marked as used once all of its ranges are allocated
+	for (uint32_t stream = 0; stream < (uint32_t)GeometryStream::_Count; ++stream)
+	{
+		if (counts[stream] > 0)
+		{
+			allocation->offsets[stream] = allocGeometryRange((GeometryStream)stream, counts[stream]);
+			*meshStreamOffset(mesh, (GeometryStream)stream) = allocation->offsets[stream];
+		}
+	}
+	allocation->used = true;
+	allocation->owner = meshIndex;
+	allocation->refCount = 1;
+	allocation->pathHash = pathHash;
+	allocation->contentHash = meshSourceContentHash(source);
+	g_State->meshCount = TF_MAX(g_State->meshCount, meshIndex + 1);
+
+	::Buffer* indexBuffer = index16 ? g_State->indexBuffer16 : g_State->indexBuffer;
+	const GPUMeshlet* meshlets = NULL;
+	const uint32_t* meshletVertices = NULL;
+	const uint32_t* meshletTriangles = NULL;
+	const GPUSubmesh* submeshes = NULL;
+
+	// Decode (cooked meshes) or copy (imported meshes) the mesh straight from its source into the
+	// upload memory of its ranges
+	if (header)
+	{
+		// NOTE(gmodarelli): A queued update can't be cancelled, a failed decode leaves garbage in
+		// ranges that are released right below
+		::BufferUpdateDesc positionUpdateDesc = {};
+		positionUpdateDesc.pBuffer = g_State->positionBuffer;
+		positionUpdateDesc.mDstOffset = sizeof(float3) * mesh->positionOffset;
+		positionUpdateDesc.mSize = sizeof(float3) * mesh->vertexCount;
+		::beginUpdateResource(&positionUpdateDesc);
+		bool decoded = DecodeMeshFilePositions(&source->meshFile, (float3*)positionUpdateDesc.pMappedData);
+		::endUpdateResource(&positionUpdateDesc);
+
+		if (decoded)
+		{
+			::BufferUpdateDesc attributeUpdateDesc = {};
+			attributeUpdateDesc.pBuffer = g_State->vertexBuffer;
+			attributeUpdateDesc.mDstOffset = sizeof(MeshVertexAttributes) * mesh->vertexOffset;
+			attributeUpdateDesc.mSize = sizeof(MeshVertexAttributes) * mesh->vertexCount;
+			::beginUpdateResource(&attributeUpdateDesc);
+			decoded = DecodeMeshFileAttributes(&source->meshFile, (MeshVertexAttributes*)attributeUpdateDesc.pMappedData);
+			::endUpdateResource(&attributeUpdateDesc);
+		}
+
+		if (decoded)
+		{
+			::BufferUpdateDesc ibUpdateDesc = {};
+			ibUpdateDesc.pBuffer = indexBuffer;
+			ibUpdateDesc.mDstOffset = mesh->indexSize * mesh->indexOffset;
+			ibUpdateDesc.mSize = mesh->indexSize * mesh->indexCount;
+			::beginUpdateResource(&ibUpdateDesc);
+			decoded = DecodeMeshFileIndices(&source->meshFile, ibUpdateDesc.pMappedData);
+			::endUpdateResource(&ibUpdateDesc);
+		}
+
+		if (!decoded)
+		{
+			LOGF(eERROR, "Couldn't decode mesh '%s', it needs to be cooked again", meshPath);
+			for (uint32_t stream = 0; stream < (uint32_t)GeometryStream::_Count; ++stream)
+			{
+				g_State->geometryStreams[stream].allocator.release(allocation->offsets[stream], allocation->counts[stream]);
+			}
+			*allocation = {};
+			*mesh = {};
+			return false;
+		}
+
+		meshlets = source->meshFile.meshlets;
+		meshletVertices = source->meshFile.meshletVertices;
+		meshletTriangles = source->meshFile.meshletTriangles;
+		submeshes = source->meshFile.submeshes;
+	}
+	else
+	{
+		uploadMeshVertices(mesh, importedGeometry->vertices);
+		if (index16)
+		{
+			// NOTE(gmodarelli): Imported indices are 32-bit on the CPU, narrow them while writing the upload memory
+			::BufferUpdateDesc ibUpdateDesc = {};
+			ibUpdateDesc.pBuffer = indexBuffer;
+			ibUpdateDesc.mDstOffset = sizeof(uint16_t) * mesh->indexOffset;
+			ibUpdateDesc.mSize = sizeof(uint16_t) * mesh->indexCount;
+			::beginUpdateResource(&ibUpdateDesc);
+			uint16_t* indices16 = (uint16_t*)ibUpdateDesc.pMappedData;
+			for (uint32_t index = 0; index < mesh->indexCount; ++index)
+			{
+				ASSERT(importedGeometry->indices[index] < MESH_INDEX16_MAX_VERTICES);
+				indices16[index] = (uint16_t)importedGeometry->indices[index];
+			}
+			::endUpdateResource(&ibUpdateDesc);
+		}
+		else
+		{
+			uploadBufferRange(indexBuffer, sizeof(uint32_t) * mesh->indexOffset, importedGeometry->indices, sizeof(uint32_t) * mesh->indexCount);
+		}
+
+		meshlets = importedGeometry->meshlets;
+		meshletVertices = importedGeometry->meshletVertices;
+		meshletTriangles = importedGeometry->meshletTriangles;
+		submeshes = importedGeometry->submeshes;
+	}
+
+	uploadBufferRange(g_State->meshletsBuffer, sizeof(GPUMeshlet) * mesh->meshletOffset, meshlets, sizeof(GPUMeshlet) * mesh->meshletCount);
+	uploadBufferRange(g_State->meshletVerticesBuffer, sizeof(uint32_t) * mesh->meshletVertexOffset, meshletVertices, sizeof(uint32_t) * counts[(uint32_t)GeometryStream::MeshletVertices]);
+	uploadBufferRange(g_State->meshletTrianglesBuffer, sizeof(uint32_t) * mesh->meshletTriangleOffset, meshletTriangles, sizeof(uint32_t) * counts[(uint32_t)GeometryStream::MeshletTriangles]);
+	uploadBufferRange(g_State->submeshesBuffer, sizeof(GPUSubmesh) * mesh->submeshOffset, submeshes, sizeof(GPUSubmesh) * mesh->submeshCount);
+
+	// NOTE(gmodarelli): Everything else is released with the mesh source once the upload is queued
+	allocation->submeshes = (GPUSubmesh*)tf_malloc(sizeof(GPUSubmesh) * mesh->submeshCount);
+	ASSERT(allocation->submeshes);
+	memcpy(allocation->submeshes, submeshes, sizeof(GPUSubmesh) * mesh->submeshCount);
+
+	const size_t meshPathSize = strlen(meshPath) + 1;
+	allocation->meshPath = (char*)tf_malloc(meshPathSize);
+	ASSERT(allocation->meshPath);
+	memcpy(allocation->meshPath, meshPath, meshPathSize);
 
-	geometry.vertices = (MeshVertex*)tf_malloc(sizeof(MeshVertex) * verticesMaxCount);
-	geometry.indices = (uint32_t*)tf_malloc(sizeof(uint32_t) * indicexMaxCount);
-	reset();
+	if (g_State->geometryResidency == renderer::GeometryResidency::Positions && !copyMeshPositions(allocation, source))
+	{
+		LOGF(eWARNING, "Couldn't keep the positions of mesh '%s' on the CPU", meshPath);
+	}
+
+	return true;
 }
 
-void ScratchGeometryData::reset()
+// Adds a loaded mesh to a free slot. Meshes already in the pool with the same path or content
+// are shared instead of being uploaded again.
+static bool addMeshSource(uint32_t meshIndex, const char* meshPath, const MeshSource* source)
 {
-	ASSERT(verticesMaxCount > 0);
-	ASSERT(indicexMaxCount > 0);
+	if (!source->loaded)
+	{
+		return false;
+	}
 
-	ASSERT(geometry.vertices);
-	memset(geometry.vertices, 0, sizeof(MeshVertex) * verticesMaxCount);
-	geometry.vertexCount = 0;
+	const uint64_t pathHash = hashMeshPath(meshPath);
+	const uint32_t owner = findGeometryOwner(pathHash, meshSourceContentHash(source));
+	if (owner != renderer::k_InvalidMeshIndex)
+	{
+		shareMeshGeometry(meshIndex, owner, pathHash);
+		LOGF(eINFO, "Mesh '%s' shares the geometry of mesh %u", meshPath, owner);
+		return true;
+	}
 
-	ASSERT(geometry.indices);
-	memset(geometry.indices, 0, sizeof(uint32_t) * indicexMaxCount);
-	geometry.indexCount = 0;
+	return addMeshToGeometryPool(meshIndex, meshPath, source, pathHash);
 }
 
-void ScratchGeometryData::destroy()
+static void uploadMeshes()
 {
-	tf_free(geometry.vertices);
-	tf_free(geometry.indices);
+	uploadBufferRange(g_State->meshesBuffer, 0, g_State->meshes, sizeof(GPUMesh) * g_State->meshCount);
 }
 
-int32_t mikkt_GetNumFaces(const SMikkTSpaceContext* context)
+void AddGeometry()
 {
-	RendererGeometry* geometry = (RendererGeometry*)context->m_pUserData;
-	return (int32_t)geometry->indexCount / 3;
+	g_State->meshes = (GPUMesh*)tf_malloc(sizeof(GPUMesh) * k_MeshesMaxCount);
+	ASSERT(g_State->meshes);
+	memset(g_State->meshes, 0, sizeof(GPUMesh) * k_MeshesMaxCount);
+	g_State->meshAllocations = (MeshAllocation*)tf_malloc(sizeof(MeshAllocation) * k_MeshesMaxCount);
+	ASSERT(g_State->meshAllocations);
+	memset(g_State->meshAllocations, 0, sizeof(MeshAllocation) * k_MeshesMaxCount);
+	g_State->meshCount = 0;
+
+	::Buffer** streamBuffers[(uint32_t)GeometryStream::_Count] = {};
+	streamBuffers[(uint32_t)GeometryStream::Positions] = &g_State->positionBuffer;
+	streamBuffers[(uint32_t)GeometryStream::Vertices] = &g_State->vertexBuffer;
+	streamBuffers[(uint32_t)GeometryStream::Indices32] = &g_State->indexBuffer;
+	streamBuffers[(uint32_t)GeometryStream::Indices16] = &g_State->indexBuffer16;
+	streamBuffers[(uint32_t)GeometryStream::Meshlets] = &g_State->meshletsBuffer;
+	streamBuffers[(uint32_t)GeometryStream::MeshletVertices] = &g_State->meshletVerticesBuffer;
+	streamBuffers[(uint32_t)GeometryStream::MeshletTriangles] = &g_State->meshletTrianglesBuffer;
+	streamBuffers[(uint32_t)GeometryStream::Submeshes] = &g_State->submeshesBuffer;
+	for (uint32_t stream = 0; stream < (uint32_t)GeometryStream::_Count; ++stream)
+	{
+		GeometryStreamPool* pool = &g_State->geometryStreams[stream];
+		const uint32_t initialCapacity = k_GeometryStreamDescs[stream].initialCapacity;
+		pool->ppBuffer = streamBuffers[stream];
+		pool->allocator.init(initialCapacity);
+		*pool->ppBuffer = addGeometryStreamBuffer((GeometryStream)stream, initialCapacity);
+	}
+
+	{
+		::BufferLoadDesc meshDesc = {};
+		meshDesc.mDesc.mDescriptors = ::DESCRIPTOR_TYPE_BUFFER_RAW;
+		meshDesc.mDesc.mMemoryUsage = ::RESOURCE_MEMORY_USAGE_GPU_ONLY;
+		meshDesc.mDesc.mFlags = ::BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS;
+		meshDesc.mDesc.mSize = sizeof(GPUMesh) * k_MeshesMaxCount;
+		meshDesc.mDesc.mElementCount = (uint32_t)(meshDesc.mDesc.mSize / sizeof(uint32_t));
+		meshDesc.mDesc.bBindless = true;
+		meshDesc.pData = g_State->meshes;
+		meshDesc.ppBuffer = &g_State->meshesBuffer;
+		meshDesc.mDesc.pName = "Mesh Buffer";
+		::addResource(&meshDesc, NULL);
+	}
+
+	const uint32_t meshCount = (uint32_t)Meshes::_Count;
+	const char* meshPaths[meshCount] = {};
+	meshPaths[(uint32_t)Meshes::Plane] = "Models/Plane";
+	meshPaths[(uint32_t)Meshes::Cube] = "Models/Cube";
+	meshPaths[(uint32_t)Meshes::DamagedHelmet] = "Models/DamagedHelmet";
+
+	MeshSource meshSources[meshCount] = {};
+	loadMeshSources(meshPaths, meshCount, meshSources);
+
+	for (uint32_t i = 0; i < meshCount; ++i)
+	{
+		if (!addMeshSource(i, meshPaths[i], &meshSources[i]))
+		{
+			LOGF(eERROR, "Couldn't load mesh '%s'", meshPaths[i]);
+		}
+		closeMeshSource(&meshSources[i]);
+	}
+
+	// NOTE(gmodarelli): The built-in meshes always own the first slots, even if they failed to load
+	g_State->meshCount = meshCount;
+	uploadMeshes();
 }
 
-int32_t mikkt_GetNumVerticesOfFace(const SMikkTSpaceContext* context, int32_t faceIndex)
+void RemoveGeometry()
 {
-	(void)context;
-	(void)faceIndex;
+	::removeResource(g_State->meshesBuffer);
+	g_State->meshesBuffer = NULL;
+
+	for (uint32_t stream = 0; stream < (uint32_t)GeometryStream::_Count; ++stream)
+	{
+		GeometryStreamPool* pool = &g_State->geometryStreams[stream];
+		::removeResource(*pool->ppBuffer);
+		*pool->ppBuffer = NULL;
+		pool->allocator.destroy();
+	}
 
-	return 3;
+	for (uint32_t i = 0; i < g_State->meshCount; ++i)
+	{
+		freeMeshCpuData(&g_State->meshAllocations[i]);
+	}
+	tf_free(g_State->meshAllocations);
+	tf_free(g_State->meshes);
+	g_State->meshAllocations = NULL;
+	g_State->meshes = NULL;
+	g_State->meshCount = 0;
 }
 
-uint32_t mikkt_GetVertexIndex(const SMikkTSpaceContext* context, int32_t faceIndex, int32_t vertIndex)
+uint32_t AddGeometryMesh(const char* meshPath)
 {
-	RendererGeometry* geometry = (RendererGeometry*)context->m_pUserData;
+	uint32_t meshIndex = 0;
+	while (meshIndex < k_MeshesMaxCount && g_State->meshAllocations[meshIndex].used)
+	{
+		meshIndex++;
+	}
+
+	if (meshIndex == k_MeshesMaxCount)
+	{
+		LOGF(eERROR, "Couldn't add mesh '%s', all %u mesh slots are in use", meshPath, k_MeshesMaxCount);
+		return renderer::k_InvalidMeshIndex;
+	}
+
+	// Meshes that are already loaded are shared without going to disk
+	const uint64_t pathHash = hashMeshPath(meshPath);
+	const uint32_t owner = findGeometryOwner(pathHash, 0);
+	if (owner != renderer::k_InvalidMeshIndex)
+	{
+		shareMeshGeometry(meshIndex, owner, pathHash);
+		validateGeometryOwners();
+		uploadMeshes();
+		return meshIndex;
+	}
 
-	uint32_t index = faceIndex * 3 + vertIndex;
-	ASSERT(index < geometry->indexCount);
+	MeshSource source = {};
+	loadMeshSources(&meshPath, 1, &source);
+	bool added = addMeshSource(meshIndex, meshPath, &source);
+	closeMeshSource(&source);
 
-	uint32_t vertexIndex = geometry->indices[index];
-	ASSERT(vertexIndex < geometry->vertexCount);
+	if (!added)
+	{
+		LOGF(eERROR, "Couldn't load mesh '%s'", meshPath);
+		return renderer::k_InvalidMeshIndex;
+	}
 
-	return vertexIndex;
+	uploadMeshes();
+	::waitForAllResourceLoads();
+	return meshIndex;
 }
 
-void mikkt_GetPosition(const SMikkTSpaceContext* context, float position[3], int32_t faceIndex, int32_t vertIndex)
+void RemoveGeometryMesh(uint32_t meshIndex)
 {
-	RendererGeometry* geometry = (RendererGeometry*)context->m_pUserData;
+	ASSERT(meshIndex < g_State->meshCount);
+
+	MeshAllocation* allocation = &g_State->meshAllocations[meshIndex];
+	if (!allocation->used)
+	{
+		return;
+	}
+
+	if (allocation->owner != meshIndex)
+	{
+		g_State->meshAllocations[allocation->owner].refCount--;
+	}
+	else if (allocation->refCount > 1)
+	{
+		// Hand the geometry ranges over to the first mesh sharing them
+		// NOTE(gmodarelli): Sharers can sit in lower slots than their owner, AddGeometryMesh reuses the
+		// first free slot
+		uint32_t newOwner = 0;
+		while (newOwner < g_State->meshCount && (newOwner == meshIndex || geometryOwner(newOwner) != meshIndex))
+		{
+			newOwner++;
+		}
+		ASSERT(newOwner < g_State->meshCount);
 
-	uint32_t vertexIndex = mikkt_GetVertexIndex(context, faceIndex, vertIndex);
-	const MeshVertex& vertex = geometry->vertices[vertexIndex];
-	position[0] = vertex.position.x;
-	position[1] = vertex.position.y;
-	position[2] = vertex.position.z;
+		MeshAllocation* newOwnerAllocation = &g_State->meshAllocations[newOwner];
+		const uint64_t pathHash = newOwnerAllocation->pathHash;
+		*newOwnerAllocation = *allocation;
+		newOwnerAllocation->owner = newOwner;
+		newOwnerAllocation->refCount = allocation->refCount - 1;
+		newOwnerAllocation->pathHash = pathHash;
+
+		for (uint32_t i = newOwner + 1; i < g_State->meshCount; ++i)
+		{
+			if (i != meshIndex && geometryOwner(i) == meshIndex)
+			{
+				g_State->meshAllocations[i].owner = newOwner;
+			}
+		}
+	}
+	else
+	{
+		for (uint32_t stream = 0; stream < (uint32_t)GeometryStream::_Count; ++stream)
+		{
+			g_State->geometryStreams[stream].allocator.release(allocation->offsets[stream], allocation->counts[stream]);
+		}
+		freeMeshCpuData(allocation);
+	}
+
+	// NOTE(gmodarelli): An empty mesh (lodCount == 0) is skipped by instances still referencing it
+	*allocation = {};
+	g_State->meshes[meshIndex] = {};
+	validateGeometryOwners();
+
+	uploadMeshes();
 }
 
-void mikkt_GetNormal(const SMikkTSpaceContext* context, float normal[3], int32_t faceIndex, int32_t vertIndex)
+// Makes the CPU positions of a mesh resident, reloading its geometry when they aren't
+bool LoadGeometryMeshPositions(uint32_t meshIndex)
 {
-	RendererGeometry* geometry = (RendererGeometry*)context->m_pUserData;
+	if (!g_State->meshAllocations[meshIndex].used)
+	{
+		return false;
+	}
+
+	MeshAllocation* allocation = &g_State->meshAllocations[geometryOwner(meshIndex)];
+	if (allocation->positions)
+	{
+		return true;
+	}
+
+	MeshSource source = {};
+	loadMeshSources((const char* const*)&allocation->meshPath, 1, &source);
+	bool loaded = source.loaded && copyMeshPositions(allocation, &source);
+	closeMeshSource(&source);
+
+	if (!loaded)
+	{
+		LOGF(eERROR, "Couldn't reload the positions of mesh '%s'", allocation->meshPath);
+		return false;
+	}
+
+	LOGF(eINFO, "Reloaded the positions of mesh '%s'", allocation->meshPath);
+	return true;
+}
 
-	uint32_t vertexIndex = mikkt_GetVertexIndex(context, faceIndex, vertIndex);
-	const MeshVertex& vertex = geometry->vertices[vertexIndex];
-	normal[0] = vertex.normal.x;
-	normal[1] = vertex.normal.y;
-	normal[2] = vertex.normal.z;
+void ReleaseGeometryMeshPositions(uint32_t meshIndex)
+{
+	if (g_State->meshAllocations[meshIndex].used)
+	{
+		freeMeshPositions(&g_State->meshAllocations[geometryOwner(meshIndex)]);
+	}
 }
 
-void mikkt_GetTexcoord(const SMikkTSpaceContext* context, float texcoord[2], int32_t faceIndex, int32_t vertIndex)
+bool CompactGeometry(float maxFragmentation)
 {
-	RendererGeometry* geometry = (RendererGeometry*)context->m_pUserData;
+	bool relocated = false;
+	for (uint32_t stream = 0; stream < (uint32_t)GeometryStream::_Count; ++stream)
+	{
+		const RangeAllocator& allocator = g_State->geometryStreams[stream].allocator;
+		if (allocator.fragmentation() > maxFragmentation)
+		{
+			relocateGeometryStream((GeometryStream)stream, allocator.capacity);
+			relocated = true;
+		}
+	}
 
-	uint32_t vertexIndex = mikkt_GetVertexIndex(context, faceIndex, vertIndex);
-	const MeshVertex& vertex = geometry->vertices[vertexIndex];
-	texcoord[0] = vertex.uv.x;
-	texcoord[1] = vertex.uv.y;
+	if (relocated)
+	{
+		uploadMeshes();
+		::waitForAllResourceLoads();
+	}
+
+	return relocated;
+}
+
+static uint32_t* materialTextureIndex(GPUMaterial* material, MaterialTextureSlot slot)
+{
+	switch (slot)
+	{
+	case MaterialTextureSlot::Albedo:
+		return &material->albedoTextureIndex;
+	case MaterialTextureSlot::Normal:
+		return &material->normalTextureIndex;
+	case MaterialTextureSlot::Orm:
+		return &material->ormTextureIndex;
+	case MaterialTextureSlot::Emissive:
+		return &material->emissiveTextureIndex;
+	default:
+		ASSERT(false);
+		return NULL;
+	}
 }
 
-void mikkt_SetTSpaceBasic(const SMikkTSpaceContext* context, const float tangent[3], float sign, int32_t faceIndex, int32_t vertIndex)
+static void addMaterialDirtyRange(MaterialDirtyRanges* ranges, uint32_t begin, uint32_t end)
 {
-	RendererGeometry* geometry = (RendererGeometry*)context->m_pUserData;
+	// Ranges overlapping or touching the new one grow
+	for (uint32_t i = 0; i < ranges->count; ++i)
+	{
+		if (begin <= ranges->ends[i] && end >= ranges->begins[i])
+		{
+			ranges->begins[i] = TF_MIN(begin, ranges->begins[i]);
+			ranges->ends[i] = TF_MAX(end, ranges->ends[i]);
+			return;
+		}
+	}
 
-	uint32_t vertexIndex = mikkt_GetVertexIndex(context, faceIndex, vertIndex);
-	MeshVertex& vertex = geometry->vertices[vertexIndex];
-	vertex.tangent.x = tangent[0];
-	vertex.tangent.y = tangent[1];
-	vertex.tangent.z = tangent[2];
-	vertex.tangent.w = sign;
-}
\ No newline at end of file
+	if (ranges->count == k_MaterialDirtyRangesMaxCount)
+	{
+		for (uint32_t i = 0; i < ranges->count; ++i)
+		{
+			begin = TF_MIN(begin, ranges->begins[i]);
+			end = TF_MAX(end, ranges->ends[i]);
+		}
+		ranges->count = 0;
+	}
+
+	ranges->begins[ranges->count] = begin;
+	ranges->ends[ranges->count] = end;
+	ranges->count++;
+}
+
+// Uploads the material to every material buffer, the next time each one is used
+static void markMaterialDirty(uint32_t materialIndex)
+{
+	for (uint32_t i = 0; i < k_DataBufferCount; ++i)
+	{
+		addMaterialDirtyRange(&g_State->materialDirtyRanges[i], materialIndex, materialIndex + 1);
+	}
+}
+
+void AddPlaceholderTextures()
+{
+	const char* names[(uint32_t)PlaceholderTexture::_Count] = {
+		"White Placeholder Texture",
+		"Flat Normal Placeholder Texture",
+		"Black Placeholder Texture",
+	};
+
+	for (uint32_t i = 0; i < (uint32_t)PlaceholderTexture::_Count; ++i)
+	{
+		::TextureDesc textureDesc = {};
+		textureDesc.mWidth = 1;
+		textureDesc.mHeight = 1;
+		textureDesc.mDepth = 1;
+		textureDesc.mArraySize = 1;
+		textureDesc.mMipLevels = 1;
+		textureDesc.mSampleCount = ::SAMPLE_COUNT_1;
+		textureDesc.mFormat = ::TinyImageFormat_R8G8B8A8_UNORM;
+		textureDesc.mStartState = ::RESOURCE_STATE_SHADER_RESOURCE;
+		textureDesc.mDescriptors = ::DESCRIPTOR_TYPE_TEXTURE;
+		textureDesc.bBindless = true;
+		textureDesc.pName = names[i];
+
+		::TextureLoadDesc loadDesc = {};
+		loadDesc.pDesc = &textureDesc;
+		loadDesc.ppTexture = &g_State->placeholderTextures[i];
+		::addResource(&loadDesc, NULL);
+
+		::TextureUpdateDesc updateDesc = {};
+		updateDesc.pTexture = g_State->placeholderTextures[i];
+		updateDesc.mMipLevel = 0;
+		updateDesc.mArrayLayer = 0;
+		::beginUpdateResource(&updateDesc);
+		memcpy(updateDesc.pMappedData, k_PlaceholderTextureColors[i], sizeof(k_PlaceholderTextureColors[i]));
+		::endUpdateResource(&updateDesc);
+	}
+}
+
+void RemovePlaceholderTextures()
+{
+	for (uint32_t i = 0; i < (uint32_t)PlaceholderTexture::_Count; ++i)
+	{
+		::removeResource(g_State->placeholderTextures[i]);
+		g_State->placeholderTextures[i] = NULL;
+	}
+}
+
+static inline renderer::TextureHandle makeTextureHandle(uint32_t slot, uint16_t generation)
+{
+	return ((uint32_t)generation << 16) | slot;
+}
+
+// Returns NULL for invalid handles and handles of removed textures
+static TextureSlot* resolveTextureHandle(renderer::TextureHandle handle)
+{
+	const uint32_t slot = handle & 0xFFFF;
+	if (handle == renderer::k_InvalidTextureHandle || slot >= g_State->textureSlotCount)
+	{
+		return NULL;
+	}
+
+	TextureSlot* textureSlot = &g_State->textures[slot];
+	return textureSlot->used && textureSlot->generation == (uint16_t)(handle >> 16) ? textureSlot : NULL;
+}
+
+// Bindless index of a material texture: the texture once it's loaded, its placeholder until then
+// (or if it failed to load), and INVALID_BINDLESS_INDEX without a texture
+static uint32_t materialTextureBindlessIndex(renderer::TextureHandle handle, MaterialTextureSlot slot)
+{
+	const TextureSlot* textureSlot = resolveTextureHandle(handle);
+	if (!textureSlot)
+	{
+		return INVALID_BINDLESS_INDEX;
+	}
+
+	if (textureSlot->state == TextureState::Ready)
+	{
+		return (uint32_t)textureSlot->texture->mDx.mDescriptors;
+	}
+
+	const ::Texture* placeholder = g_State->placeholderTextures[(uint32_t)k_MaterialTextureSlotPlaceholders[(uint32_t)slot]];
+	return (uint32_t)placeholder->mDx.mDescriptors;
+}
+
+// Re-reads the bindless indices of every material slot referencing handle
+static void patchMaterialTextures(renderer::TextureHandle handle)
+{
+	for (uint32_t i = 0; i < g_State->materialCount; ++i)
+	{
+		for (uint32_t slot = 0; slot < (uint32_t)MaterialTextureSlot::_Count; ++slot)
+		{
+			if (g_State->materialTextures[i].handles[slot] == handle)
+			{
+				*materialTextureIndex(&g_State->materials[i], (MaterialTextureSlot)slot) = materialTextureBindlessIndex(handle, (MaterialTextureSlot)slot);
+				markMaterialDirty(i);
+			}
+		}
+	}
+}
+
+static void removeTextureSlot(uint32_t slot)
+{
+	TextureSlot* textureSlot = &g_State->textures[slot];
+	ASSERT(textureSlot->used && ::isTokenCompleted(&textureSlot->token) && ::isTokenCompleted(&textureSlot->streamingToken));
+
+	if (textureSlot->texture)
+	{
+		::removeResource(textureSlot->texture);
+	}
+	if (textureSlot->streaming)
+	{
+		if (textureSlot->streamingTexture)
+		{
+			::removeResource(textureSlot->streamingTexture);
+		}
+		g_State->streamingTextureCount--;
+	}
+	if (textureSlot->retiredTexture)
+	{
+		::removeResource(textureSlot->retiredTexture);
+		g_State->retiredTextureCount--;
+	}
+	tf_free(textureSlot->path);
+	tf_free(textureSlot->mipTailPath);
+
+	const uint16_t generation = (uint16_t)(textureSlot->generation + 1);
+	*textureSlot = {};
+	// NOTE(gmodarelli): Generations start at 1, so no handle is ever k_InvalidTextureHandle
+	textureSlot->generation = generation != 0 ? generation : 1;
+	g_State->texturePathHashes[slot] = 0;
+	g_State->freeTextureSlots[g_State->freeTextureSlotCount++] = slot;
+}
+
+void AddTextures()
+{
+	g_State->textures = (TextureSlot*)tf_calloc(k_TexturesMaxCount, sizeof(TextureSlot));
+	g_State->texturePathHashes = (uint64_t*)tf_calloc(k_TexturesMaxCount, sizeof(uint64_t));
+	g_State->freeTextureSlots = (uint32_t*)tf_malloc(sizeof(uint32_t) * k_TexturesMaxCount);
+	ASSERT(g_State->textures && g_State->texturePathHashes && g_State->freeTextureSlots);
+
+	g_State->textureScreenSizes = (float*)tf_malloc(sizeof(float) * k_TexturesMaxCount);
+	g_State->materialScreenSizes = (float*)tf_malloc(sizeof(float) * k_MaterialsMaxCount);
+	g_State->streamedTextures = (StreamedTexture*)tf_malloc(sizeof(StreamedTexture) * k_TexturesMaxCount);
+	g_State->streamedTextureSlots = (uint32_t*)tf_malloc(sizeof(uint32_t) * k_TexturesMaxCount);
+	g_State->targetTextureMips = (uint32_t*)tf_malloc(sizeof(uint32_t) * k_TexturesMaxCount);
+	g_State->textureStreamingOrder = (uint32_t*)tf_malloc(sizeof(uint32_t) * k_TexturesMaxCount);
+	ASSERT(g_State->textureScreenSizes && g_State->materialScreenSizes && g_State->streamedTextures);
+	ASSERT(g_State->streamedTextureSlots && g_State->targetTextureMips && g_State->textureStreamingOrder);
+
+	for (uint32_t i = 0; i < k_TexturesMaxCount; ++i)
+	{
+		g_State->textures[i].generation = 1;
+	}
+	g_State->textureSlotCount = 0;
+	g_State->freeTextureSlotCount = 0;
+	g_State->loadingTextureCount = 0;
+	g_State->releasedTextureCount = 0;
+	g_State->streamingTextureCount = 0;
+	g_State->retiredTextureCount = 0;
+	g_State->textureStreamingBudget = k_TextureStreamingDefaultBudget;
+}
+
+// Removes every texture, referenced or not. No texture can be loading.
+void RemoveTextures()
+{
+	for (uint32_t i = 0; i < g_State->textureSlotCount; ++i)
+	{
+		TextureSlot* textureSlot = &g_State->textures[i];
+		if (!textureSlot->used)
+		{
+			continue;
+		}
+
+		if (textureSlot->refCount > 0)
+		{
+			LOGF(eWARNING, "Texture '%s' is still referenced (%u references)", textureSlot->path, textureSlot->refCount);
+		}
+		removeTextureSlot(i);
+	}
+
+	tf_free(g_State->textures);
+	tf_free(g_State->texturePathHashes);
+	tf_free(g_State->freeTextureSlots);
+	g_State->textures = NULL;
+	g_State->texturePathHashes = NULL;
+	g_State->freeTextureSlots = NULL;
+
+	tf_free(g_State->textureScreenSizes);
+	tf_free(g_State->materialScreenSizes);
+	tf_free(g_State->streamedTextures);
+	tf_free(g_State->streamedTextureSlots);
+	tf_free(g_State->targetTextureMips);
+	tf_free(g_State->textureStreamingOrder);
+	g_State->textureScreenSizes = NULL;
+	g_State->materialScreenSizes = NULL;
+	g_State->streamedTextures = NULL;
+	g_State->streamedTextureSlots = NULL;
+	g_State->targetTextureMips = NULL;
+	g_State->textureStreamingOrder = NULL;
+	g_State->textureSlotCount = 0;
+	g_State->freeTextureSlotCount = 0;
+}
+
+renderer::TextureHandle AddTextureReference(const char* path)
+{
+	// Textures already in the registry get one more reference, including released ones that
+	// haven't been removed yet
+	const uint64_t pathHash = HashPakPath(path);
+	for (uint32_t i = 0; i < g_State->textureSlotCount; ++i)
+	{
+		if (g_State->texturePathHashes[i] != pathHash || !g_State->textures[i].used)
+		{
+			continue;
+		}
+
+		TextureSlot* textureSlot = &g_State->textures[i];
+		if (textureSlot->refCount++ == 0)
+		{
+			g_State->releasedTextureCount--;
+		}
+		return makeTextureHandle(i, textureSlot->generation);
+	}
+
+	uint32_t slot = 0;
+	if (g_State->freeTextureSlotCount > 0)
+	{
+		slot = g_State->freeTextureSlots[--g_State->freeTextureSlotCount];
+	}
+	else if (g_State->textureSlotCount < k_TexturesMaxCount)
+	{
+		slot = g_State->textureSlotCount++;
+	}
+	else
+	{
+		LOGF(eERROR, "Couldn't load texture '%s', the texture registry is full (%u textures)", path, k_TexturesMaxCount);
+		return renderer::k_InvalidTextureHandle;
+	}
+
+	TextureSlot* textureSlot = &g_State->textures[slot];
+	ASSERT(!textureSlot->used);
+	textureSlot->used = true;
+	textureSlot->state = TextureState::Loading;
+	textureSlot->refCount = 1;
+	textureSlot->texture = NULL;
+	textureSlot->token = 0;
+
+	const size_t pathSize = strlen(path) + 1;
+	textureSlot->path = (char*)tf_malloc(pathSize);
+	ASSERT(textureSlot->path);
+	memcpy(textureSlot->path, path, pathSize);
+
+	g_State->texturePathHashes[slot] = pathHash;
+	g_State->loadingTextureCount++;
+
+	// NOTE(gmodarelli): Only the header is read here. Textures larger than their base mip start with
+	// the mips from their base mip on, UpdateTextureStreaming streams the finer ones in.
+	const char* fileName = textureSlot->path;
+	if (ReadDdsFileInfo(::RD_TEXTURES, path, &textureSlot->info))
+	{
+		const uint32_t baseMip = ComputeTextureBaseMip(textureSlot->info.width, textureSlot->info.height, textureSlot->info.mipCount);
+		if (baseMip > 0)
+		{
+			const size_t mipTailPathSize = pathSize + 16;
+			textureSlot->mipTailPath = (char*)tf_malloc(mipTailPathSize);
+			ASSERT(textureSlot->mipTailPath);
+			if (FormatDdsMipTailPath(path, baseMip, textureSlot->mipTailPath, mipTailPathSize))
+			{
+				textureSlot->streamed = true;
+				textureSlot->residentMip = (uint8_t)baseMip;
+				fileName = textureSlot->mipTailPath;
+			}
+		}
+	}
+
+	::TextureDesc textureDesc = {};
+	memset(&textureDesc, 0, sizeof(::TextureDesc));
+	textureDesc.bBindless = true;
+
+	::TextureLoadDesc textureLoadDesc = {};
+	memset(&textureLoadDesc, 0, sizeof(::TextureLoadDesc));
+	textureLoadDesc.pDesc = &textureDesc;
+	textureLoadDesc.pFileName = fileName;
+	textureLoadDesc.ppTexture = &textureSlot->texture;
+	::addResource(&textureLoadDesc, &textureSlot->token);
+
+	return makeTextureHandle(slot, textureSlot->generation);
+}
+
+void RemoveTextureReference(renderer::TextureHandle handle)
+{
+	TextureSlot* textureSlot = resolveTextureHandle(handle);
+	if (!textureSlot || textureSlot->refCount == 0)
+	{
+		LOGF(eERROR, "Invalid texture handle 0x%08x", handle);
+		return;
+	}
+
+	if (--textureSlot->refCount == 0)
+	{
+		// NOTE(gmodarelli): The frames in flight might still sample it, UpdateTextures removes it
+		textureSlot->releaseFrame = g_State->frameCount;
+		g_State->releasedTextureCount++;
+	}
+}
+
+void UpdateTextures()
+{
+	if (g_State->loadingTextureCount == 0 && g_State->releasedTextureCount == 0 && g_State->streamingTextureCount == 0 && g_State->retiredTextureCount == 0)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < g_State->textureSlotCount; ++i)
+	{
+		TextureSlot* textureSlot = &g_State->textures[i];
+		if (!textureSlot->used)
+		{
+			continue;
+		}
+
+		if (textureSlot->state == TextureState::Loading)
+		{
+			if (!::isTokenCompleted(&textureSlot->token))
+			{
+				continue;
+			}
+
+			g_State->loadingTextureCount--;
+			if (textureSlot->texture)
+			{
+				textureSlot->state = TextureState::Ready;
+			}
+			else
+			{
+				LOGF(eERROR, "Couldn't load texture '%s', keeping its placeholder", textureSlot->path);
+				textureSlot->state = TextureState::Failed;
+			}
+			patchMaterialTextures(makeTextureHandle(i, textureSlot->generation));
+		}
+
+		if (textureSlot->streaming)
+		{
+			if (!::isTokenCompleted(&textureSlot->streamingToken))
+			{
+				continue;
+			}
+
+			g_State->streamingTextureCount--;
+			textureSlot->streaming = false;
+			if (textureSlot->streamingTexture)
+			{
+				textureSlot->retiredTexture = textureSlot->texture;
+				textureSlot->retiredFrame = g_State->frameCount;
+				textureSlot->texture = textureSlot->streamingTexture;
+				textureSlot->residentMip = textureSlot->streamingMip;
+				textureSlot->streamingTexture = NULL;
+				g_State->retiredTextureCount++;
+				patchMaterialTextures(makeTextureHandle(i, textureSlot->generation));
+			}
+			else
+			{
+				LOGF(eERROR, "Couldn't stream texture '%s' from mip %u, keeping mip %u", textureSlot->path, textureSlot->streamingMip, textureSlot->residentMip);
+			}
+		}
+
+		// The frame fence waited on at the start of Draw guarantees the GPU is done with the
+		// frames drawn before the last k_DataBufferCount ones
+		if (textureSlot->retiredTexture && g_State->frameCount >= textureSlot->retiredFrame + k_DataBufferCount)
+		{
+			::removeResource(textureSlot->retiredTexture);
+			textureSlot->retiredTexture = NULL;
+			g_State->retiredTextureCount--;
+		}
+
+		if (textureSlot->refCount == 0 && g_State->frameCount >= textureSlot->releaseFrame + k_DataBufferCount)
+		{
+			removeTextureSlot(i);
+			g_State->releasedTextureCount--;
+		}
+	}
+}
+
+void SetMaterialTexture(uint32_t materialIndex, MaterialTextureSlot slot, const char* path)
+{
+	ASSERT(materialIndex < g_State->materialCount);
+
+	renderer::TextureHandle* handle = &g_State->materialTextures[materialIndex].handles[(uint32_t)slot];
+	const renderer::TextureHandle previousHandle = *handle;
+	*handle = path ? AddTextureReference(path) : renderer::k_InvalidTextureHandle;
+	if (previousHandle != renderer::k_InvalidTextureHandle)
+	{
+		RemoveTextureReference(previousHandle);
+	}
+
+	*materialTextureIndex(&g_State->materials[materialIndex], slot) = materialTextureBindlessIndex(*handle, slot);
+	markMaterialDirty(materialIndex);
+}
+
+void ReleaseMaterialTextures(uint32_t materialIndex)
+{
+	for (uint32_t slot = 0; slot < (uint32_t)MaterialTextureSlot::_Count; ++slot)
+	{
+		SetMaterialTexture(materialIndex, (MaterialTextureSlot)slot, NULL);
+	}
+}
+
+static void setMaterialParameters(GPUMaterial* material, const MaterialParameters& parameters)
+{
+	material->baseColor = { parameters.baseColor[0], parameters.baseColor[1], parameters.baseColor[2], parameters.baseColor[3] };
+	material->normalIntensity = parameters.normalIntensity;
+	material->occlusionFactor = parameters.occlusionFactor;
+	material->roughnessFactor = parameters.roughnessFactor;
+	material->metalnessFactor = parameters.metalnessFactor;
+	material->emissiveFactor = parameters.emissiveFactor;
+	material->reflectance = parameters.reflectance;
+	material->uv0Tiling = { parameters.uv0Tiling[0], parameters.uv0Tiling[1] };
+}
+
+static uint32_t findMaterialName(uint64_t nameHash)
+{
+	for (uint32_t i = 0; i < g_State->materialNameCount; ++i)
+	{
+		if (g_State->materialNames[i].nameHash == nameHash)
+		{
+			return i;
+		}
+	}
+	return UINT32_MAX;
+}
+
+// Copies a material into a new slot, with references of its own to its textures.
+// Returns the index of the copy, UINT32_MAX if the materials are full.
+static uint32_t copyMaterial(uint32_t materialIndex)
+{
+	ASSERT(materialIndex < g_State->materialCount);
+	if (g_State->materialCount == k_MaterialsMaxCount)
+	{
+		return UINT32_MAX;
+	}
+
+	const uint32_t copyIndex = g_State->materialCount++;
+	g_State->materials[copyIndex] = g_State->materials[materialIndex];
+	g_State->materialTextures[copyIndex] = {};
+	g_State->materialContentHashes[copyIndex] = 0;
+
+	for (uint32_t slot = 0; slot < (uint32_t)MaterialTextureSlot::_Count; ++slot)
+	{
+		const TextureSlot* textureSlot = resolveTextureHandle(g_State->materialTextures[materialIndex].handles[slot]);
+		SetMaterialTexture(copyIndex, (MaterialTextureSlot)slot, textureSlot ? textureSlot->path : NULL);
+	}
+
+	markMaterialDirty(copyIndex);
+	return copyIndex;
+}
+
+bool AddMaterialLibrary(const char* path)
+{
+	MaterialFile materialFile = {};
+	if (!OpenMaterialFile(::RD_COMPILED_MATERIALS, path, &materialFile))
+	{
+		return false;
+	}
+
+	const MaterialFileHeader* header = materialFile.header;
+
+	// Loaded index of every material of the library, UINT32_MAX for the ones that need a new slot
+	uint32_t* materialIndices = (uint32_t*)tf_malloc(sizeof(uint32_t) * TF_MAX(header->materialCount, 1u));
+	ASSERT(materialIndices);
+
+	// NOTE(gmodarelli): Materials identical to loaded ones (e.g. in other libraries) are shared.
+	// Materials are few, linear scans are enough.
+	uint32_t sharedMaterialCount = 0;
+	uint32_t newMaterialCount = 0;
+	for (uint32_t i = 0; i < header->materialCount; ++i)
+	{
+		const uint64_t contentHash = materialFile.materials[i].contentHash;
+		uint32_t materialIndex = 0;
+		while (materialIndex < g_State->materialCount && g_State->materialContentHashes[materialIndex] != contentHash)
+		{
+			materialIndex++;
+		}
+
+		materialIndices[i] = materialIndex < g_State->materialCount ? materialIndex : UINT32_MAX;
+		if (materialIndices[i] != UINT32_MAX)
+		{
+			sharedMaterialCount++;
+			continue;
+		}
+
+		// Identical materials of this library share a single new slot
+		bool duplicate = false;
+		for (uint32_t j = 0; j < i && !duplicate; ++j)
+		{
+			duplicate = materialIndices[j] == UINT32_MAX && materialFile.materials[j].contentHash == contentHash;
+		}
+		newMaterialCount += duplicate ? 0 : 1;
+	}
+
+	uint32_t newNameCount = 0;
+	for (uint32_t i = 0; i < header->nameCount; ++i)
+	{
+		const char* name = materialFile.strings + materialFile.names[i].nameOffset;
+		const uint64_t nameHash = HashBytes(name, strlen(name), 0);
+		bool duplicate = findMaterialName(nameHash) != UINT32_MAX;
+		for (uint32_t j = 0; j < i && !duplicate; ++j)
+		{
+			const char* otherName = materialFile.strings + materialFile.names[j].nameOffset;
+			duplicate = strcmp(name, otherName) == 0;
+		}
+		newNameCount += duplicate ? 0 : 1;
+	}
+
+	// A library is loaded whole or not at all, so nothing is changed until it's known to fit
+	if (newMaterialCount > k_MaterialsMaxCount - g_State->materialCount)
+	{
+		LOGF(eERROR, "Material library '%s' doesn't fit, k_MaterialsMaxCount (%u) is too small", path, k_MaterialsMaxCount);
+		tf_free(materialIndices);
+		CloseMaterialFile(&materialFile);
+		return false;
+	}
+
+	if (newNameCount > k_MaterialNamesMaxCount - g_State->materialNameCount)
+	{
+		LOGF(eERROR, "Material library '%s' doesn't fit, k_MaterialNamesMaxCount (%u) is too small", path, k_MaterialNamesMaxCount);
+		tf_free(materialIndices);
+		CloseMaterialFile(&materialFile);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header->materialCount; ++i)
+	{
+		if (materialIndices[i] != UINT32_MAX)
+		{
+			continue;
+		}
+
+		const MaterialFileMaterial* fileMaterial = &materialFile.materials[i];
+		uint32_t materialIndex = g_State->materialCount;
+		for (uint32_t j = 0; j < i; ++j)
+		{
+			if (materialFile.materials[j].contentHash == fileMaterial->contentHash)
+			{
+				materialIndex = materialIndices[j];
+				break;
+			}
+		}
+
+		materialIndices[i] = materialIndex;
+		if (materialIndex < g_State->materialCount)
+		{
+			continue;
+		}
+
+		ASSERT(g_State->materialCount < k_MaterialsMaxCount);
+		g_State->materialCount++;
+		g_State->materialContentHashes[materialIndex] = fileMaterial->contentHash;
+		g_State->materialTextures[materialIndex] = {};
+
+		GPUMaterial* material = &g_State->materials[materialIndex];
+		setMaterialParameters(material, fileMaterial->parameters);
+		for (uint32_t slot = 0; slot < (uint32_t)MaterialTextureSlot::_Count; ++slot)
+		{
+			*materialTextureIndex(material, (MaterialTextureSlot)slot) = INVALID_BINDLESS_INDEX;
+			SetMaterialTexture(materialIndex, (MaterialTextureSlot)slot, GetMaterialFileTexturePath(&materialFile, fileMaterial, (MaterialFileTexture)slot));
+		}
+	}
+
+	for (uint32_t i = 0; i < header->nameCount; ++i)
+	{
+		const char* name = materialFile.strings + materialFile.names[i].nameOffset;
+		const uint64_t nameHash = HashBytes(name, strlen(name), 0);
+
+		// Names of later libraries take over the ones already loaded
+		uint32_t nameIndex = findMaterialName(nameHash);
+		if (nameIndex == UINT32_MAX)
+		{
+			ASSERT(g_State->materialNameCount < k_MaterialNamesMaxCount);
+			nameIndex = g_State->materialNameCount++;
+		}
+
+		g_State->materialNames[nameIndex].nameHash = nameHash;
+		g_State->materialNames[nameIndex].materialIndex = materialIndices[materialFile.names[i].materialIndex];
+	}
+
+	LOGF(eINFO, "Loaded material library '%s': %u materials (%u shared with loaded ones), %u names", path, header->materialCount, sharedMaterialCount, header->nameCount);
+
+	tf_free(materialIndices);
+	CloseMaterialFile(&materialFile);
+	return true;
+}
+
+// NOTE(gmodarelli): Every mesh geometry (shared by its duplicates) is a geometry of a single BLAS, so it has to be rebuilt whenever
+// meshes are added, removed or moved in the geometry pool
+void AddBottomLevelAccelerationStructure()
+{
+	if (g_State->blas)
+	{
+		::removeAccelerationStructure(g_State->raytracing, g_State->blas);
+		g_State->blas = NULL;
+	}
+
+	::AccelerationStructureDesc desc = {};
+	::AccelerationStructureGeometryDesc geometryDesc[k_MeshesMaxCount] = {};
+	uint32_t geometryCount = 0;
+
+	for (uint32_t i = 0; i < g_State->meshCount; ++i)
+	{
+		// NOTE(gmodarelli): Meshes sharing their geometry get a single BLAS geometry
+		const GPUMesh& gpuMesh = g_State->meshes[i];
+		if (gpuMesh.lodCount == 0 || geometryOwner(i) != i)
+		{
+			continue;
+		}
+
+		::AccelerationStructureGeometryDesc* geometry = &geometryDesc[geometryCount++];
+		geometry->mFlags = ::ACCELERATION_STRUCTURE_GEOMETRY_FLAG_OPAQUE;
+		geometry->pVertexBuffer = g_State->positionBuffer;
+		geometry->mVertexCount = gpuMesh.vertexCount;
+		geometry->mVertexStride = sizeof(float3);
+		geometry->mVertexOffset = gpuMesh.positionOffset * sizeof(float3);
+		geometry->mVertexFormat = ::TinyImageFormat_R32G32B32_SFLOAT;
+		// NOTE(gmodarelli): Ray tracing always uses the full mesh (LOD 0)
+		geometry->mIndexCount = gpuMesh.lods[0].indexCount;
+		if (gpuMesh.indexSize == sizeof(uint16_t))
+		{
+			geometry->pIndexBuffer = g_State->indexBuffer16;
+			geometry->mIndexOffset = gpuMesh.indexOffset * sizeof(uint16_t);
+			geometry->mIndexType = ::INDEX_TYPE_UINT16;
+		}
+		else
+		{
+			geometry->pIndexBuffer = g_State->indexBuffer;
+			geometry->mIndexOffset = gpuMesh.indexOffset * sizeof(uint32_t);
+			geometry->mIndexType = ::INDEX_TYPE_UINT32;
+		}
+	}
+
+	if (geometryCount == 0)
+	{
+		return;
+	}
+
+	desc.mBottom.mDescCount = geometryCount;
+	desc.mBottom.pGeometryDescs = geometryDesc;
+	desc.mType = ::ACCELERATION_STRUCTURE_TYPE_BOTTOM;
+	desc.mFlags = ::ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+	::addAccelerationStructure(g_State->raytracing, &desc, &g_State->blas);
+
+	::GpuCmdRingElement elem = ::getNextGpuCmdRingElement(&g_State->graphicsCmdRing, true, 1);
+	::resetCmdPool(g_State->renderer, elem.pCmdPool);
+
+	::RaytracingBuildASDesc buildASDesc = {};
+	buildASDesc.pAccelerationStructure = g_State->blas;
+	buildASDesc.mIssueRWBarrier = true;
+	::beginCmd(elem.pCmds[0]);
+	::cmdBuildAccelerationStructure(elem.pCmds[0], g_State->raytracing, &buildASDesc);
+
+	::endCmd(elem.pCmds[0]);
+
+	::QueueSubmitDesc submitDesc = {};
+	submitDesc.mCmdCount = 1;
+	submitDesc.ppCmds = elem.pCmds;
+	submitDesc.pSignalFence = elem.pFence;
+	submitDesc.mSubmitDone = true;
+	::queueSubmit(g_State->graphicsQueue, &submitDesc);
+	::waitForFences(g_State->renderer, 1, &elem.pFence);
+
+	::removeAccelerationStructureScratch(g_State->raytracing, g_State->blas);
+}
+
+void AddTopLevelAccelerationStructure()
+{
+	if (g_State->tlas)
+	{
+		::removeAccelerationStructure(g_State->raytracing, g_State->tlas);
+		g_State->tlas = NULL;
+	}
+
+	if (!g_State->blas || g_State->instanceCount == 0)
+	{
+		return;
+	}
+
+	::AccelerationStructureInstanceDesc* instanceDescs = (::AccelerationStructureInstanceDesc*)tf_malloc(sizeof(AccelerationStructureInstanceDesc) * g_State->instanceCount);
+	memset(instanceDescs, 0, sizeof(AccelerationStructureInstanceDesc)* g_State->instanceCount);
+	for (uint32_t i = 0; i < g_State->instanceCount; i++)
+	{
+		const GPUInstance& instance = g_State->instances[i];
+
+		instanceDescs[i].mFlags = ::ACCELERATION_STRUCTURE_INSTANCE_FLAG_NONE;
+		instanceDescs[i].mInstanceContributionToHitGroupIndex = 0;
+		instanceDescs[i].mInstanceID = i;
+		instanceDescs[i].mInstanceMask = 1;
+		instanceDescs[i].pBottomAS = g_State->blas;
+		memcpy(instanceDescs[i].mTransform, &instance.worldMat, sizeof(float[12]));
+	}
+
+	::AccelerationStructureDesc desc = {};
+	desc.mType = ::ACCELERATION_STRUCTURE_TYPE_TOP;
+	desc.mFlags = ::ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+	desc.mTop.mDescCount = g_State->instanceCount;
+	desc.mTop.pInstanceDescs = instanceDescs;
+	::addAccelerationStructure(g_State->raytracing, &desc, &g_State->tlas);
+
+	::GpuCmdRingElement elem = ::getNextGpuCmdRingElement(&g_State->graphicsCmdRing, true, 1);
+	::resetCmdPool(g_State->renderer, elem.pCmdPool);
+
+	::RaytracingBuildASDesc buildASDesc = {};
+	buildASDesc.pAccelerationStructure = g_State->tlas;
+	buildASDesc.mIssueRWBarrier = true;
+	::beginCmd(elem.pCmds[0]);
+	::cmdBuildAccelerationStructure(elem.pCmds[0], g_State->raytracing, &buildASDesc);
+
+	::endCmd(elem.pCmds[0]);
+
+	::QueueSubmitDesc submitDesc = {};
+	submitDesc.mCmdCount = 1;
+	submitDesc.ppCmds = elem.pCmds;
+	submitDesc.pSignalFence = elem.pFence;
+	submitDesc.mSubmitDone = true;
+	::queueSubmit(g_State->graphicsQueue, &submitDesc);
+	::waitForFences(g_State->renderer, 1, &elem.pFence);
+
+	::removeAccelerationStructureScratch(g_State->raytracing, g_State->tlas);
+	tf_free(instanceDescs);
+}
+
+// Bounding sphere of an instance, from the bounds of its mesh and the largest scale of its world matrix.
+// Returns the distance from the camera to the closest point of the sphere (<= 0 inside the sphere).
+static float instanceBoundingSphere(const GPUMesh& mesh, const GPUInstance& instance, const ::float3& cameraPosition, float* radius, float* scale)
+{
+	const float* m = instance.worldMat.m;
+	::float3 aabbCenter = {
+		(mesh.aabbMin.x + mesh.aabbMax.x) * 0.5f,
+		(mesh.aabbMin.y + mesh.aabbMax.y) * 0.5f,
+		(mesh.aabbMin.z + mesh.aabbMax.z) * 0.5f,
+	};
+	::float3 aabbExtents = {
+		(mesh.aabbMax.x - mesh.aabbMin.x) * 0.5f,
+		(mesh.aabbMax.y - mesh.aabbMin.y) * 0.5f,
+		(mesh.aabbMax.z - mesh.aabbMin.z) * 0.5f,
+	};
+
+	float scaleX = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+	float scaleY = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+	float scaleZ = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+	*scale = sqrtf(TF_MAX(scaleX, TF_MAX(scaleY, scaleZ)));
+
+	float centerX = m[0] * aabbCenter.x + m[4] * aabbCenter.y + m[8] * aabbCenter.z + m[12];
+	float centerY = m[1] * aabbCenter.x + m[5] * aabbCenter.y + m[9] * aabbCenter.z + m[13];
+	float centerZ = m[2] * aabbCenter.x + m[6] * aabbCenter.y + m[10] * aabbCenter.z + m[14];
+	*radius = sqrtf(aabbExtents.x * aabbExtents.x + aabbExtents.y * aabbExtents.y + aabbExtents.z * aabbExtents.z) * *scale;
+
+	float dx = centerX - cameraPosition.x;
+	float dy = centerY - cameraPosition.y;
+	float dz = centerZ - cameraPosition.z;
+	return sqrtf(dx * dx + dy * dy + dz * dz) - *radius;
+}
+
+// NOTE(gmodarelli): The error of a LOD is measured in object space, so it gets scaled by the largest
+// scale of the instance and projected at the closest point of the instance bounding sphere.
+static uint32_t selectMeshLod(const GPUMesh& mesh, const GPUInstance& instance, const ::float3& cameraPosition, float projectionScale)
+{
+	float radius = 0.0f;
+	float scale = 0.0f;
+	float distance = instanceBoundingSphere(mesh, instance, cameraPosition, &radius, &scale);
+	if (distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	for (uint32_t lodIndex = mesh.lodCount - 1; lodIndex > 0; --lodIndex)
+	{
+		float projectedError = mesh.lods[lodIndex].error * scale / distance * projectionScale;
+		if (projectedError <= k_LodMaxScreenError)
+		{
+			return lodIndex;
+		}
+	}
+
+	return 0;
+}
+
+// Builds one indirect draw per (submesh, LOD) pair used by the instances. Instances are first batched
+// by mesh and LOD, then every batch emits one draw per submesh of the mesh, each one with a draw
+// instance (instance and material index) per instance of the batch. Draws are grouped by index pool,
+// 32-bit first, so that each pool is drawn by a single indirect call.
+// NOTE(gmodarelli): The LOD is selected per instance from the bounds of the whole mesh, so all the
+// submeshes of an instance switch LOD together.
+void BuildDrawCommands(const PlayerCamera* camera, uint32_t viewportWidth)
+{
+	const float projectionScale = (float)viewportWidth / (2.0f * tanf(k_CameraFovX * 0.5f));
+	const uint32_t batchCount = g_State->meshCount * MESH_MAX_LODS;
+	uint32_t* batchInstanceCounts = g_State->drawBatchInstanceCounts;
+	uint32_t* batchOffsets = g_State->drawBatchOffsets;
+	memset(batchInstanceCounts, 0, sizeof(uint32_t) * batchCount);
+
+	uint32_t drawInstanceCount = 0;
+	for (uint32_t i = 0; i < g_State->instanceCount; ++i)
+	{
+		const GPUInstance& instance = g_State->instances[i];
+		ASSERT(instance.meshIndex < g_State->meshCount);
+		const GPUMesh& mesh = g_State->meshes[instance.meshIndex];
+		if (mesh.lodCount == 0 || drawInstanceCount + mesh.submeshCount > k_DrawInstancesMaxCount)
+		{
+			// The mesh has been removed or failed to load, or the draw instance buffer is full
+			g_State->instanceLods[i] = k_InstanceNotDrawn;
+			continue;
+		}
+
+		// NOTE(gmodarelli): Instances of meshes sharing their geometry are drawn by the same commands
+		uint32_t lodIndex = selectMeshLod(mesh, instance, camera->position, projectionScale);
+		g_State->instanceLods[i] = (uint8_t)lodIndex;
+		batchInstanceCounts[geometryOwner(instance.meshIndex) * MESH_MAX_LODS + lodIndex]++;
+		drawInstanceCount += mesh.submeshCount;
+	}
+
+	g_State->indirectDrawCommandCount = 0;
+	g_State->indirectDrawIndex32CommandCount = 0;
+	uint32_t droppedDrawCount = 0;
+	uint32_t startInstance = 0;
+	const uint32_t poolIndexSizes[] = { sizeof(uint32_t), sizeof(uint16_t) };
+	for (uint32_t poolIndex = 0; poolIndex < TF_ARRAY_COUNT(poolIndexSizes); ++poolIndex)
+	{
+		for (uint32_t batchIndex = 0; batchIndex < batchCount; ++batchIndex)
+		{
+			const uint32_t meshIndex = batchIndex / MESH_MAX_LODS;
+			const GPUMesh& mesh = g_State->meshes[meshIndex];
+			if (mesh.indexSize != poolIndexSizes[poolIndex])
+			{
+				continue;
+			}
+
+			const uint32_t instanceCount = batchInstanceCounts[batchIndex];
+			batchOffsets[batchIndex] = startInstance;
+			if (instanceCount == 0)
+			{
+				continue;
+			}
+
+			const GPUSubmesh* submeshes = g_State->meshAllocations[meshIndex].submeshes;
+			for (uint32_t submeshIndex = 0; submeshIndex < mesh.submeshCount; ++submeshIndex)
+			{
+				const GPUMeshLod& lod = submeshes[submeshIndex].lods[batchIndex % MESH_MAX_LODS];
+
+				// NOTE(gmodarelli): Draws that don't fit are skipped, their draw instances keep their place so
+				// that the following draws still find theirs
+				if (g_State->indirectDrawCommandCount == k_IndirectDrawCommandsMaxCount)
+				{
+					droppedDrawCount++;
+					startInstance += instanceCount;
+					continue;
+				}
+
+				::IndirectDrawIndexArguments* drawIndexArgs = &g_State->indirectDrawIndexArgs[g_State->indirectDrawCommandCount++];
+				drawIndexArgs->mIndexCount = lod.indexCount;
+				drawIndexArgs->mStartIndex = mesh.indexOffset + lod.indexOffset;
+				drawIndexArgs->mVertexOffset = mesh.vertexOffset;
+				drawIndexArgs->mInstanceCount = instanceCount;
+				drawIndexArgs->mStartInstance = startInstance;
+
+				startInstance += instanceCount;
+			}
+		}
+
+		if (poolIndex == 0)
+		{
+			g_State->indirectDrawIndex32CommandCount = g_State->indirectDrawCommandCount;
+		}
+	}
+	ASSERT(startInstance == drawInstanceCount);
+	g_State->drawInstanceCount = drawInstanceCount;
+
+	if (droppedDrawCount > 0)
+	{
+		LOGF(eERROR, "%u draws don't fit in the indirect draw buffer, k_IndirectDrawCommandsMaxCount (%u) is too small", droppedDrawCount, k_IndirectDrawCommandsMaxCount);
+	}
+
+	// The draw instances of a batch are laid out submesh after submesh, instanceCount each
+	const uint32_t lastMaterialIndex = g_State->materialCount > 0 ? g_State->materialCount - 1 : 0;
+	for (uint32_t i = 0; i < g_State->instanceCount; ++i)
+	{
+		if (g_State->instanceLods[i] == k_InstanceNotDrawn)
+		{
+			continue;
+		}
+
+		const GPUInstance& instance = g_State->instances[i];
+		const uint32_t meshIndex = geometryOwner(instance.meshIndex);
+		const uint32_t batchIndex = meshIndex * MESH_MAX_LODS + g_State->instanceLods[i];
+		const uint32_t instanceCount = batchInstanceCounts[batchIndex];
+		const uint32_t drawInstanceIndex = batchOffsets[batchIndex]++;
+		const GPUSubmesh* submeshes = g_State->meshAllocations[meshIndex].submeshes;
+		for (uint32_t submeshIndex = 0; submeshIndex < g_State->meshes[meshIndex].submeshCount; ++submeshIndex)
+		{
+			GPUDrawInstance* drawInstance = &g_State->drawInstances[drawInstanceIndex + submeshIndex * instanceCount];
+			drawInstance->instanceIndex = i;
+			drawInstance->materialIndex = TF_MIN(instance.materialBufferIndex + submeshes[submeshIndex].materialSlot, lastMaterialIndex);
+		}
+	}
+}
+
+// Starts loading the mips [firstMip, mipCount) of a streamed texture, UpdateTextures swaps it in
+static void streamTextureMips(TextureSlot* textureSlot, uint32_t firstMip)
+{
+	ASSERT(textureSlot->streamed && !textureSlot->streaming && !textureSlot->retiredTexture);
+
+	// NOTE: mipTailPath was allocated with room for any mip suffix, see AddTextureReference
+	const size_t mipTailPathSize = strlen(textureSlot->path) + 1 + 16;
+	if (!FormatDdsMipTailPath(textureSlot->path, firstMip, textureSlot->mipTailPath, mipTailPathSize))
+	{
+		return;
+	}
+
+	textureSlot->streaming = true;
+	textureSlot->streamingMip = (uint8_t)firstMip;
+	textureSlot->streamingTexture = NULL;
+	textureSlot->streamingToken = 0;
+	g_State->streamingTextureCount++;
+
+	::TextureDesc textureDesc = {};
+	memset(&textureDesc, 0, sizeof(::TextureDesc));
+	textureDesc.bBindless = true;
+
+	::TextureLoadDesc textureLoadDesc = {};
+	memset(&textureLoadDesc, 0, sizeof(::TextureLoadDesc));
+	textureLoadDesc.pDesc = &textureDesc;
+	textureLoadDesc.pFileName = textureSlot->mipTailPath;
+	textureLoadDesc.ppTexture = &textureSlot->streamingTexture;
+	::addResource(&textureLoadDesc, &textureSlot->streamingToken);
+}
+
+// Estimates how large every texture gets on screen from the instances drawn this frame, picks the mips
+// of the streamed textures that fit in the budget (see SelectTextureMips) and starts loading the
+// textures whose mips change, at most k_TextureStreamingMaxLoads at once.
+// NOTE(gmodarelli): Textures losing mips are loaded first, least important first, since swapping them
+// frees memory. Then the ones gaining mips, most important first.
+void UpdateTextureStreaming(const PlayerCamera* camera, uint32_t viewportWidth)
+{
+	const float projectionScale = (float)viewportWidth / (2.0f * tanf(k_CameraFovX * 0.5f));
+
+	// Largest screen size of the materials, over the instances using them
+	float* materialScreenSizes = g_State->materialScreenSizes;
+	memset(materialScreenSizes, 0, sizeof(float) * g_State->materialCount);
+	const uint32_t lastMaterialIndex = g_State->materialCount > 0 ? g_State->materialCount - 1 : 0;
+	for (uint32_t i = 0; i < g_State->instanceCount; ++i)
+	{
+		if (g_State->instanceLods[i] == k_InstanceNotDrawn || g_State->materialCount == 0)
+		{
+			continue;
+		}
+
+		const GPUInstance& instance = g_State->instances[i];
+		float radius = 0.0f;
+		float scale = 0.0f;
+		const float distance = instanceBoundingSphere(g_State->meshes[instance.meshIndex], instance, camera->position, &radius, &scale);
+
+		const uint32_t meshIndex = geometryOwner(instance.meshIndex);
+		const GPUSubmesh* submeshes = g_State->meshAllocations[meshIndex].submeshes;
+		for (uint32_t submeshIndex = 0; submeshIndex < g_State->meshes[meshIndex].submeshCount; ++submeshIndex)
+		{
+			const uint32_t materialIndex = TF_MIN(instance.materialBufferIndex + submeshes[submeshIndex].materialSlot, lastMaterialIndex);
+			const ::float2& uvTiling = g_State->materials[materialIndex].uv0Tiling;
+			const float screenSize = ComputeTextureScreenSize(radius, distance, TF_MAX(uvTiling.x, uvTiling.y), projectionScale);
+			materialScreenSizes[materialIndex] = TF_MAX(materialScreenSizes[materialIndex], screenSize);
+		}
+	}
+
+	// Largest screen size of the textures, over the materials using them
+	float* textureScreenSizes = g_State->textureScreenSizes;
+	memset(textureScreenSizes, 0, sizeof(float) * g_State->textureSlotCount);
+	for (uint32_t i = 0; i < g_State->materialCount; ++i)
+	{
+		for (uint32_t slot = 0; slot < (uint32_t)MaterialTextureSlot::_Count; ++slot)
+		{
+			const renderer::TextureHandle handle = g_State->materialTextures[i].handles[slot];
+			if (resolveTextureHandle(handle))
+			{
+				const uint32_t textureIndex = handle & 0xFFFF;
+				textureScreenSizes[textureIndex] = TF_MAX(textureScreenSizes[textureIndex], materialScreenSizes[i]);
+			}
+		}
+	}
+
+	// NOTE(gmodarelli): Released textures are about to be removed and loading ones don't have their
+	// base mips yet, neither of them is streamed
+	uint32_t streamedTextureCount = 0;
+	for (uint32_t i = 0; i < g_State->textureSlotCount; ++i)
+	{
+		const TextureSlot* textureSlot = &g_State->textures[i];
+		if (!textureSlot->used || !textureSlot->streamed || textureSlot->state != TextureState::Ready || textureSlot->refCount == 0)
+		{
+			continue;
+		}
+
+		StreamedTexture* streamedTexture = &g_State->streamedTextures[streamedTextureCount];
+		streamedTexture->width = textureSlot->info.width;
+		streamedTexture->height = textureSlot->info.height;
+		streamedTexture->mipCount = textureSlot->info.mipCount;
+		streamedTexture->blockSize = textureSlot->info.blockSize;
+		streamedTexture->residentMip = textureSlot->residentMip;
+		streamedTexture->screenSize = textureScreenSizes[i];
+		g_State->streamedTextureSlots[streamedTextureCount++] = i;
+	}
+
+	if (streamedTextureCount == 0)
+	{
+		return;
+	}
+
+	SelectTextureMips(g_State->streamedTextures, streamedTextureCount, g_State->textureStreamingBudget, g_State->targetTextureMips, g_State->textureStreamingOrder);
+
+	for (uint32_t pass = 0; pass < 2; ++pass)
+	{
+		const bool dropMips = pass == 0;
+		for (uint32_t i = 0; i < streamedTextureCount && g_State->streamingTextureCount < k_TextureStreamingMaxLoads; ++i)
+		{
+			const uint32_t streamedTextureIndex = g_State->textureStreamingOrder[dropMips ? streamedTextureCount - 1 - i : i];
+			TextureSlot* textureSlot = &g_State->textures[g_State->streamedTextureSlots[streamedTextureIndex]];
+			const uint32_t targetMip = g_State->targetTextureMips[streamedTextureIndex];
+			if (textureSlot->streaming || textureSlot->retiredTexture || targetMip == textureSlot->residentMip || (targetMip > textureSlot->residentMip) != dropMips)
+			{
+				continue;
+			}
+
+			streamTextureMips(textureSlot, targetMip);
+		}
+	}
+}
+
+static inline void loadMat4(const ::mat4& matrix, float* output)
+{
+	output[0] = matrix.getCol(0).getX();
+	output[1] = matrix.getCol(0).getY();
+	output[2] = matrix.getCol(0).getZ();
+	output[3] = matrix.getCol(0).getW();
+	output[4] = matrix.getCol(1).getX();
+	output[5] = matrix.getCol(1).getY();
+	output[6] = matrix.getCol(1).getZ();
+	output[7] = matrix.getCol(1).getW();
+	output[8] = matrix.getCol(2).getX();
+	output[9] = matrix.getCol(2).getY();
+	output[10] = matrix.getCol(2).getZ();
+	output[11] = matrix.getCol(2).getW();
+	output[12] = matrix.getCol(3).getX();
+	output[13] = matrix.getCol(3).getY();
+	output[14] = matrix.getCol(3).getZ();
+	output[15] = matrix.getCol(3).getW();
+}
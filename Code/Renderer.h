@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MaterialFile.h"
 #include "Scene.h"
 #include <OS/Interfaces/IOperatingSystem.h>
 
@@ -12,4 +13,71 @@ namespace renderer
 
 	void LoadScene(const Scene* scene);
 	void Draw(const Scene* scene);
+
+	const uint32_t k_InvalidMeshIndex = UINT32_MAX;
+
+	// Streams meshes in and out of the geometry pool. Both stall until the GPU is idle.
+	// AddMesh returns the index of the mesh, to be used by instances, or k_InvalidMeshIndex.
+	// Instances of a removed mesh are not drawn, and its index can be reused by a later AddMesh.
+	uint32_t AddMesh(const char* meshPath);
+	void RemoveMesh(uint32_t meshIndex);
+	// Compacts every fragmented geometry stream, e.g. after unloading a level
+	void DefragmentGeometry();
+
+	// What stays on the CPU once a mesh is in the geometry pool. Bounds and submeshes are always kept,
+	// Positions also keeps the positions and the LOD 0 indices (e.g. for collision).
+	// Only meshes added after the policy changes are affected.
+	enum class GeometryResidency
+	{
+		Bounds = 0,
+		Positions,
+	};
+	void SetGeometryResidency(GeometryResidency residency);
+
+	// Position-only CPU copy of a mesh, the indices are the mesh-local ones of its full (LOD 0) version
+	struct MeshPositions
+	{
+		const ::float3* positions = NULL;
+		uint32_t vertexCount = 0;
+		const uint32_t* indices = NULL;
+		uint32_t indexCount = 0;
+	};
+
+	bool GetMeshBounds(uint32_t meshIndex, ::float3* aabbMin, ::float3* aabbMax);
+	// Returns the CPU positions of a mesh, reloading them from its cooked asset when they aren't resident.
+	// Reloaded positions stay resident until ReleaseMeshPositions is called or the mesh is removed.
+	bool GetMeshPositions(uint32_t meshIndex, MeshPositions* meshPositions);
+	void ReleaseMeshPositions(uint32_t meshIndex);
+
+	// Stable handle of a texture of the texture registry. The low 16 bits are its slot, the high
+	// 16 bits the generation of the slot, so handles of removed textures never resolve again.
+	typedef uint32_t TextureHandle;
+	const TextureHandle k_InvalidTextureHandle = 0;
+
+	// Textures are loaded in the background, once per path (ignoring case and slashes), and
+	// reference counted. AcquireTexture adds a reference to the texture at path, loading it if needed.
+	// A texture whose last reference is released is removed once the frames in flight are done with it.
+	TextureHandle AcquireTexture(const char* path);
+	void ReleaseTexture(TextureHandle handle);
+
+	// Textures start with their mips up to 64x64 and stream their finer mips in and out depending on
+	// how large they get on screen. The streamed mips of all the textures fit in budget bytes, the
+	// textures covering the most pixels get their mips first.
+	void SetTextureStreamingBudget(uint64_t budget);
+
+	const uint32_t k_InvalidMaterialIndex = UINT32_MAX;
+
+	// Loads a cooked material library (*.matlib, see MaterialFile.h). Materials identical to loaded ones
+	// are shared, the new ones get the next indices in the order of the library. Names already loaded
+	// now refer to the materials of this library.
+	bool LoadMaterialLibrary(const char* path);
+	// Index of a material by name, or k_InvalidMaterialIndex
+	uint32_t FindMaterial(const char* name);
+
+	bool GetMaterialParameters(uint32_t materialIndex, MaterialParameters* parameters);
+	// Changes the parameters of a material by name. Only the changed material is uploaded, to each frame's
+	// material buffer before it's next used. A material shared with other names (see LoadMaterialLibrary)
+	// is copied first, so that they keep theirs. Returns the index of the material now behind the name,
+	// which entities using it have to switch to, or k_InvalidMaterialIndex.
+	uint32_t SetMaterialParameters(const char* name, const MaterialParameters& parameters);
 }
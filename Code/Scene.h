@@ -19,6 +19,7 @@ struct Player
 	::float3 scale;
 	float movementSpeed;
 	::float2 movementVector;
+	uint32_t materialHandle;	// TMP
 };
 
 enum class LightType
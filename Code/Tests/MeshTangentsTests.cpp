@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../Arena.h"
+#include "../MeshImporter.h"
+#include "../MeshTangents.h"
+#include "../ObjParser.h"
+#include "Tests.h"
+
+// MikkTSpace
+
+#include <mikktspace.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// MeshTangentsTests: checks that GenerateTangents, which splits large meshes in welded components and
+// runs MikkTSpace on them in parallel, writes the same tangents, bit for bit, as a single
+// genTangSpaceDefault run over the whole mesh.
+//
+// Every mesh is checked as it is, then tiled (translated copies of it) until it is large enough for
+// the parallel path of GenerateTangents. The shipped meshes are checked unless OBJ files are given.
+// Run it from the root of the repository. The importer only uses the parallel path once this passes,
+// see k_TangentsParallelImport.
+//
+// Usage: MeshTangentsTests [mesh.obj...]
+
+static const char* k_ShippedMeshes[] = {
+	"Content/Models/Plane.obj",
+	"Content/Models/Cube.obj",
+	"Content/Models/DamagedHelmet.obj",
+};
+
+// Plain MikkTSpace callbacks over de-indexed vertices (3 per triangle), the reference
+struct ReferenceMesh
+{
+	ImportVertex* vertices;
+	uint32_t triangleCount;
+};
+
+static int32_t reference_GetNumFaces(const SMikkTSpaceContext* context)
+{
+	return (int32_t)((const ReferenceMesh*)context->m_pUserData)->triangleCount;
+}
+
+static int32_t reference_GetNumVerticesOfFace(const SMikkTSpaceContext* context, int32_t faceIndex)
+{
+	(void)context;
+	(void)faceIndex;
+
+	return 3;
+}
+
+static const ImportVertex& referenceVertex(const SMikkTSpaceContext* context, int32_t faceIndex, int32_t vertIndex)
+{
+	return ((const ReferenceMesh*)context->m_pUserData)->vertices[faceIndex * 3 + vertIndex];
+}
+
+static void reference_GetPosition(const SMikkTSpaceContext* context, float position[3], int32_t faceIndex, int32_t vertIndex)
+{
+	const ImportVertex& vertex = referenceVertex(context, faceIndex, vertIndex);
+	position[0] = vertex.position.x;
+	position[1] = vertex.position.y;
+	position[2] = vertex.position.z;
+}
+
+static void reference_GetNormal(const SMikkTSpaceContext* context, float normal[3], int32_t faceIndex, int32_t vertIndex)
+{
+	const ImportVertex& vertex = referenceVertex(context, faceIndex, vertIndex);
+	normal[0] = vertex.normal.x;
+	normal[1] = vertex.normal.y;
+	normal[2] = vertex.normal.z;
+}
+
+static void reference_GetTexcoord(const SMikkTSpaceContext* context, float texcoord[2], int32_t faceIndex, int32_t vertIndex)
+{
+	const ImportVertex& vertex = referenceVertex(context, faceIndex, vertIndex);
+	texcoord[0] = vertex.uv.x;
+	texcoord[1] = vertex.uv.y;
+}
+
+static void reference_SetTSpaceBasic(const SMikkTSpaceContext* context, const float tangent[3], float sign, int32_t faceIndex, int32_t vertIndex)
+{
+	ImportVertex& vertex = ((const ReferenceMesh*)context->m_pUserData)->vertices[faceIndex * 3 + vertIndex];
+	vertex.tangent = { tangent[0], tangent[1], tangent[2], sign };
+}
+
+static bool generateReferenceTangents(ImportVertex* vertices, uint32_t vertexCount)
+{
+	ReferenceMesh mesh = { vertices, vertexCount / 3 };
+
+	::SMikkTSpaceInterface mikktInterface = {};
+	mikktInterface.m_getNumFaces = reference_GetNumFaces;
+	mikktInterface.m_getNumVerticesOfFace = reference_GetNumVerticesOfFace;
+	mikktInterface.m_getPosition = reference_GetPosition;
+	mikktInterface.m_getNormal = reference_GetNormal;
+	mikktInterface.m_getTexCoord = reference_GetTexcoord;
+	mikktInterface.m_setTSpaceBasic = reference_SetTSpaceBasic;
+
+	::SMikkTSpaceContext mikktContext = {};
+	mikktContext.m_pInterface = &mikktInterface;
+	mikktContext.m_pUserData = &mesh;
+
+	return ::genTangSpaceDefault(&mikktContext) != 0;
+}
+
+// De-indexes the triangles of an OBJ file the way ImportMesh does, polygons are split in fans.
+// Returns the vertex count, 0 if the file can't be read.
+static uint32_t readMeshVertices(const char* path, ImportVertex** vertices)
+{
+	ObjFile objFile = {};
+	if (!ReadObjFile(path, k_ObjParserMaxWorkers, &objFile))
+	{
+		return 0;
+	}
+	const fastObjMesh* obj = objFile.mesh;
+
+	uint32_t vertexCount = 0;
+	for (uint32_t i = 0; i < obj->face_count; ++i)
+	{
+		vertexCount += 3 * (obj->face_vertices[i] - 2);
+	}
+
+	*vertices = (ImportVertex*)tf_malloc(sizeof(ImportVertex) * TF_MAX(vertexCount, 1u));
+	ASSERT(*vertices);
+
+	uint32_t vertexIndex = 0;
+	uint32_t indexOffset = 0;
+	for (uint32_t i = 0; i < obj->face_count; ++i)
+	{
+		for (uint32_t j = 2; j < obj->face_vertices[i]; ++j)
+		{
+			const uint32_t corners[3] = { indexOffset, indexOffset + j - 1, indexOffset + j };
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				fastObjIndex gi = obj->indices[corners[k]];
+				ImportVertex* v = &(*vertices)[vertexIndex++];
+				*v = {};
+				v->position = { obj->positions[gi.p * 3 + 0], obj->positions[gi.p * 3 + 1], obj->positions[gi.p * 3 + 2] };
+				v->normal = { obj->normals[gi.n * 3 + 0], obj->normals[gi.n * 3 + 1], obj->normals[gi.n * 3 + 2] };
+				v->uv = { obj->texcoords[gi.t * 2 + 0], 1.0f - obj->texcoords[gi.t * 2 + 1] };
+			}
+		}
+		indexOffset += obj->face_vertices[i];
+	}
+	ASSERT(vertexIndex == vertexCount);
+
+	DestroyObjFile(&objFile);
+	return vertexCount;
+}
+
+// Runs GenerateTangents and the reference on copies of vertices, returns false if their tangents differ
+static bool compareTangents(const char* name, const ImportVertex* vertices, uint32_t vertexCount, Arena* arena)
+{
+	ImportVertex* generated = (ImportVertex*)tf_malloc(sizeof(ImportVertex) * vertexCount);
+	ImportVertex* reference = (ImportVertex*)tf_malloc(sizeof(ImportVertex) * vertexCount);
+	ASSERT(generated && reference);
+	memcpy(generated, vertices, sizeof(ImportVertex) * vertexCount);
+	memcpy(reference, vertices, sizeof(ImportVertex) * vertexCount);
+
+	arena->reset();
+	GenerateTangents(generated, vertexCount, k_TangentsMaxWorkers, arena);
+	CHECK(generateReferenceTangents(reference, vertexCount));
+
+	uint32_t mismatchCount = 0;
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		if (memcmp(&generated[i].tangent, &reference[i].tangent, sizeof(float4)) != 0)
+		{
+			if (mismatchCount == 0)
+			{
+				const float4& a = generated[i].tangent;
+				const float4& b = reference[i].tangent;
+				fprintf(stderr, "%s: vertex %u has tangent (%.9g %.9g %.9g %.9g), MikkTSpace on the whole mesh gives (%.9g %.9g %.9g %.9g)\n",
+					name, i, a.x, a.y, a.z, a.w, b.x, b.y, b.z, b.w);
+			}
+			mismatchCount++;
+		}
+	}
+
+	printf("%s: %u triangles, %u of %u tangents differ\n", name, vertexCount / 3, mismatchCount, vertexCount);
+
+	tf_free(generated);
+	tf_free(reference);
+	return mismatchCount == 0;
+}
+
+// Translated copies of a mesh, side by side along X, with at least twice the triangles that make
+// GenerateTangents go parallel
+static uint32_t tileMesh(const ImportVertex* vertices, uint32_t vertexCount, ImportVertex** tiledVertices)
+{
+	const uint32_t triangleCount = vertexCount / 3;
+	const uint32_t copyCount = (2 * k_TangentsParallelMinTriangles + triangleCount - 1) / triangleCount;
+
+	float minX = vertices[0].position.x;
+	float maxX = vertices[0].position.x;
+	for (uint32_t i = 1; i < vertexCount; ++i)
+	{
+		minX = TF_MIN(minX, vertices[i].position.x);
+		maxX = TF_MAX(maxX, vertices[i].position.x);
+	}
+	const float spacing = (maxX - minX) + 1.0f;
+
+	const uint32_t tiledVertexCount = vertexCount * copyCount;
+	*tiledVertices = (ImportVertex*)tf_malloc(sizeof(ImportVertex) * tiledVertexCount);
+	ASSERT(*tiledVertices);
+	for (uint32_t copy = 0; copy < copyCount; ++copy)
+	{
+		ImportVertex* tile = &(*tiledVertices)[copy * vertexCount];
+		memcpy(tile, vertices, sizeof(ImportVertex) * vertexCount);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			tile[i].position.x += spacing * (float)copy;
+		}
+	}
+
+	return tiledVertexCount;
+}
+
+int main(int argc, char** argv)
+{
+	const char* const* paths = k_ShippedMeshes;
+	uint32_t pathCount = TF_ARRAY_COUNT(k_ShippedMeshes);
+	if (argc > 1)
+	{
+		paths = argv + 1;
+		pathCount = (uint32_t)(argc - 1);
+	}
+
+	if (!::initMemAlloc("MeshTangentsTests"))
+	{
+		fprintf(stderr, "Couldn't initialize the memory allocator\n");
+		return 1;
+	}
+
+	FileSystemInitDesc fsDesc = FileSystemInitDesc{};
+	fsDesc.pAppName = "MeshTangentsTests";
+	if (!::initFileSystem(&fsDesc))
+	{
+		fprintf(stderr, "Couldn't initialize the file system\n");
+		::exitMemAlloc();
+		return 1;
+	}
+
+	::initLog("MeshTangentsTests", LogLevel::eALL);
+
+	Arena arena = {};
+	for (uint32_t i = 0; i < pathCount; ++i)
+	{
+		ImportVertex* vertices = NULL;
+		uint32_t vertexCount = readMeshVertices(paths[i], &vertices);
+		if (!CHECK(vertexCount > 0))
+		{
+			fprintf(stderr, "Couldn't read mesh '%s'\n", paths[i]);
+			tf_free(vertices);
+			continue;
+		}
+
+		CHECK(compareTangents(paths[i], vertices, vertexCount, &arena));
+
+		ImportVertex* tiledVertices = NULL;
+		uint32_t tiledVertexCount = tileMesh(vertices, vertexCount, &tiledVertices);
+		char name[FS_MAX_PATH] = {};
+		snprintf(name, sizeof(name), "%s (tiled x%u)", paths[i], tiledVertexCount / vertexCount);
+		CHECK(compareTangents(name, tiledVertices, tiledVertexCount, &arena));
+
+		tf_free(tiledVertices);
+		tf_free(vertices);
+	}
+	arena.destroy();
+
+	int result = testReport("MeshTangentsTests");
+
+	::exitLog();
+	::exitFileSystem();
+	::exitMemAlloc();
+
+	return result;
+}
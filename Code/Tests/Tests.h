@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Checks shared by the test programs of this folder. Every test program is a console application that
+// runs its checks, prints the failed ones and returns 1 if any failed. The projects run them right
+// after they're built (see the PostBuildEvent of Build/*Tests.vcxproj), so a failing test fails the build.
+
+static uint32_t s_CheckCount = 0;
+static uint32_t s_FailedCheckCount = 0;
+
+static bool testCheck(bool condition, const char* expression, const char* file, int line)
+{
+	s_CheckCount++;
+	if (!condition)
+	{
+		s_FailedCheckCount++;
+		fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+	}
+
+	return condition;
+}
+
+#define CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+
+// Prints the summary of a test program, returns its exit code
+static int testReport(const char* testName)
+{
+	if (s_FailedCheckCount > 0)
+	{
+		fprintf(stderr, "%s: %u of %u checks failed\n", testName, s_FailedCheckCount, s_CheckCount);
+		return 1;
+	}
+
+	printf("%s: %u checks passed\n", testName, s_CheckCount);
+	return 0;
+}
@@ -0,0 +1,236 @@
+#include "../TextureStreaming.h"
+#include "Tests.h"
+
+// The-Forge
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// TextureStreamingTests: checks the mip selection of TextureStreaming.h, from the mip a texture needs
+// for its size on screen to the mips SelectTextureMips grants within a budget.
+
+const uint32_t k_TextureCount = 4;
+// BC1
+const uint32_t k_BlockSize = 8;
+
+// 1024x1024 BC1 texture with its full mip chain, its base mip is mip 4 (64x64)
+static StreamedTexture makeTexture(float screenSize, uint32_t residentMip)
+{
+	StreamedTexture texture = {};
+	texture.width = 1024;
+	texture.height = 1024;
+	texture.mipCount = 11;
+	texture.blockSize = k_BlockSize;
+	texture.residentMip = residentMip;
+	texture.screenSize = screenSize;
+	return texture;
+}
+
+// Bytes of the mips selected for every texture
+static uint64_t selectedSize(const StreamedTexture* textures, uint32_t textureCount, const uint32_t* targetMips)
+{
+	uint64_t size = 0;
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		size += ComputeStreamedTextureSize(textures[i], targetMips[i]);
+	}
+	return size;
+}
+
+static void testRequiredMip()
+{
+	// One texel per pixel
+	CHECK(ComputeRequiredTextureMip(1024, 1024, 11, 1024.0f) == 0);
+	CHECK(ComputeRequiredTextureMip(1024, 1024, 11, 4096.0f) == 0);
+	CHECK(ComputeRequiredTextureMip(1024, 1024, 11, 512.0f) == 1);
+	CHECK(ComputeRequiredTextureMip(1024, 1024, 11, 300.0f) == 1);
+	CHECK(ComputeRequiredTextureMip(1024, 1024, 11, 256.0f) == 2);
+	// The larger side decides
+	CHECK(ComputeRequiredTextureMip(1024, 256, 11, 256.0f) == 2);
+	CHECK(ComputeRequiredTextureMip(256, 1024, 11, 256.0f) == 2);
+	// Textures too small on screen (or not seen) need their last mip only
+	CHECK(ComputeRequiredTextureMip(1024, 1024, 11, 1.0f) == 10);
+	CHECK(ComputeRequiredTextureMip(1024, 1024, 11, 0.0f) == 10);
+	CHECK(ComputeRequiredTextureMip(1024, 1024, 3, 16.0f) == 2);
+
+	CHECK(ComputeTextureBaseMip(1024, 1024, 11) == 4);
+	CHECK(ComputeTextureBaseMip(64, 64, 7) == 0);
+	CHECK(ComputeTextureBaseMip(2048, 64, 12) == 5);
+	CHECK(ComputeTextureBaseMip(1024, 1024, 3) == 2);
+
+	// Twice the radius or half the distance doubles the size on screen, tiling divides it
+	const float screenSize = ComputeTextureScreenSize(1.0f, 10.0f, 1.0f, 1000.0f);
+	CHECK(screenSize == 200.0f);
+	CHECK(ComputeTextureScreenSize(2.0f, 10.0f, 1.0f, 1000.0f) == 2.0f * screenSize);
+	CHECK(ComputeTextureScreenSize(1.0f, 5.0f, 1.0f, 1000.0f) == 2.0f * screenSize);
+	CHECK(ComputeTextureScreenSize(1.0f, 10.0f, 4.0f, 1000.0f) == screenSize / 4.0f);
+	// Cameras inside the bounding sphere get a finite size
+	CHECK(ComputeTextureScreenSize(1.0f, 0.0f, 1.0f, 1000.0f) == ComputeTextureScreenSize(1.0f, 0.01f, 1.0f, 1000.0f));
+}
+
+static void testBaseMips()
+{
+	// Textures that aren't seen keep their base mip only, and base mips stay even past the budget
+	StreamedTexture textures[k_TextureCount];
+	for (uint32_t i = 0; i < k_TextureCount; ++i)
+	{
+		textures[i] = makeTexture(0.0f, 4);
+	}
+	textures[1].screenSize = 1024.0f;
+
+	uint32_t targetMips[k_TextureCount] = {};
+	uint32_t order[k_TextureCount] = {};
+	const uint64_t baseSize = ComputeStreamedTextureSize(textures[0], 4);
+	const uint64_t usedSize = SelectTextureMips(textures, k_TextureCount, 0, targetMips, order);
+	CHECK(usedSize == k_TextureCount * baseSize);
+	CHECK(usedSize == selectedSize(textures, k_TextureCount, targetMips));
+	for (uint32_t i = 0; i < k_TextureCount; ++i)
+	{
+		CHECK(targetMips[i] == 4);
+	}
+
+	// Textures smaller than the base mip size are always fully resident
+	StreamedTexture small = makeTexture(1024.0f, 0);
+	small.width = 32;
+	small.height = 32;
+	small.mipCount = 6;
+	CHECK(SelectTextureMips(&small, 1, 0, targetMips, order) == ComputeStreamedTextureSize(small, 0));
+	CHECK(targetMips[0] == 0);
+}
+
+static void testBudget()
+{
+	// Every seen texture gets the mip it needs when the budget is large enough
+	StreamedTexture textures[k_TextureCount] = {
+		makeTexture(1024.0f, 4),
+		makeTexture(512.0f, 4),
+		makeTexture(256.0f, 4),
+		makeTexture(0.0f, 4),
+	};
+
+	uint32_t targetMips[k_TextureCount] = {};
+	uint32_t order[k_TextureCount] = {};
+	uint64_t usedSize = SelectTextureMips(textures, k_TextureCount, UINT64_MAX, targetMips, order);
+	CHECK(targetMips[0] == 0 && targetMips[1] == 1 && targetMips[2] == 2 && targetMips[3] == 4);
+	CHECK(usedSize == selectedSize(textures, k_TextureCount, targetMips));
+
+	// A budget that fits exactly what they need
+	const uint64_t budget = usedSize;
+	usedSize = SelectTextureMips(textures, k_TextureCount, budget, targetMips, order);
+	CHECK(targetMips[0] == 0 && targetMips[1] == 1 && targetMips[2] == 2 && targetMips[3] == 4);
+	CHECK(usedSize == budget);
+
+	// A byte less and the smallest texture on screen gives up its mip first, for the finest one that still fits
+	usedSize = SelectTextureMips(textures, k_TextureCount, budget - 1, targetMips, order);
+	CHECK(targetMips[0] == 0 && targetMips[1] == 1 && targetMips[2] == 3 && targetMips[3] == 4);
+	CHECK(usedSize <= budget - 1);
+	CHECK(usedSize == selectedSize(textures, k_TextureCount, targetMips));
+
+	// Every selection stays within the budget once the base mips fit
+	const uint64_t baseSize = k_TextureCount * ComputeStreamedTextureSize(textures[0], 4);
+	for (uint64_t extraSize = 0; extraSize <= budget - baseSize; extraSize += 4096)
+	{
+		usedSize = SelectTextureMips(textures, k_TextureCount, baseSize + extraSize, targetMips, order);
+		CHECK(usedSize <= baseSize + extraSize);
+		CHECK(usedSize == selectedSize(textures, k_TextureCount, targetMips));
+	}
+}
+
+static void testPriority()
+{
+	// Identical textures, only their size on screen differs. On top of the base mips, the budget fits
+	// mip 0 of one texture and mip 1 of another.
+	StreamedTexture textures[k_TextureCount] = {
+		makeTexture(2048.0f, 4),
+		makeTexture(0.0f, 4),
+		makeTexture(4096.0f, 4),
+		makeTexture(2048.0f, 4),
+	};
+
+	const uint64_t baseSize = ComputeStreamedTextureSize(textures[0], 4);
+	const uint64_t budget = ComputeStreamedTextureSize(textures[0], 0) + ComputeStreamedTextureSize(textures[0], 1) + (k_TextureCount - 2) * baseSize;
+	uint32_t targetMips[k_TextureCount] = {};
+	uint32_t order[k_TextureCount] = {};
+	SelectTextureMips(textures, k_TextureCount, budget, targetMips, order);
+
+	// Largest on screen first, ties in index order, unseen textures last
+	CHECK(order[0] == 2 && order[1] == 0 && order[2] == 3 && order[3] == 1);
+	CHECK(targetMips[2] == 0);
+	CHECK(targetMips[1] == 4);
+
+	// Of the two that tie, the first one in order gets what's left
+	CHECK(targetMips[0] == 1 && targetMips[3] == 4);
+	CHECK(selectedSize(textures, k_TextureCount, targetMips) == budget);
+}
+
+static void testHysteresis()
+{
+	uint32_t targetMip = 0;
+	uint32_t order = 0;
+
+	// Requiring one mip coarser than the resident one keeps the resident one
+	StreamedTexture texture = makeTexture(256.0f, 1);
+	SelectTextureMips(&texture, 1, UINT64_MAX, &targetMip, &order);
+	CHECK(targetMip == 1);
+
+	// Two mips coarser drops it
+	texture = makeTexture(128.0f, 1);
+	SelectTextureMips(&texture, 1, UINT64_MAX, &targetMip, &order);
+	CHECK(targetMip == 3);
+
+	// Finer mips are always requested
+	texture = makeTexture(1024.0f, 1);
+	SelectTextureMips(&texture, 1, UINT64_MAX, &targetMip, &order);
+	CHECK(targetMip == 0);
+
+	// Textures going back and forth over the boundary of mips 1 and 2 stay put
+	texture = makeTexture(257.0f, 1);
+	for (uint32_t frame = 0; frame < 4; ++frame)
+	{
+		SelectTextureMips(&texture, 1, UINT64_MAX, &targetMip, &order);
+		CHECK(targetMip == 1);
+		texture.residentMip = targetMip;
+		texture.screenSize = (frame & 1) ? 257.0f : 256.0f;
+	}
+
+	// The kept mip still has to fit in the budget
+	texture = makeTexture(256.0f, 1);
+	const uint64_t budget = ComputeStreamedTextureSize(texture, 2);
+	SelectTextureMips(&texture, 1, budget, &targetMip, &order);
+	CHECK(targetMip == 2);
+}
+
+int main()
+{
+	if (!::initMemAlloc("TextureStreamingTests"))
+	{
+		fprintf(stderr, "Couldn't initialize the memory allocator\n");
+		return 1;
+	}
+
+	FileSystemInitDesc fsDesc = FileSystemInitDesc{};
+	fsDesc.pAppName = "TextureStreamingTests";
+	if (!::initFileSystem(&fsDesc))
+	{
+		fprintf(stderr, "Couldn't initialize the file system\n");
+		::exitMemAlloc();
+		return 1;
+	}
+
+	::initLog("TextureStreamingTests", LogLevel::eALL);
+
+	testRequiredMip();
+	testBaseMips();
+	testBudget();
+	testPriority();
+	testHysteresis();
+
+	int result = testReport("TextureStreamingTests");
+
+	::exitLog();
+	::exitFileSystem();
+	::exitMemAlloc();
+
+	return result;
+}
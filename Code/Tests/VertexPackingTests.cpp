@@ -0,0 +1,208 @@
+#include "../VertexPacking.h"
+#include "Tests.h"
+
+#include <float.h>
+
+// VertexPackingTests: round-trips the attributes of MeshVertex through the encoders of VertexPacking.h
+// and checks that they come back within the error bounds of their formats.
+
+static const float k_Pi = 3.14159265358979f;
+
+static float dot(float3 a, float3 b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static float3 normalize(float3 v)
+{
+	float invLength = 1.0f / sqrtf(dot(v, v));
+	return { v.x * invLength, v.y * invLength, v.z * invLength };
+}
+
+// Angle between two unit vectors, in radians
+static float angleBetween(float3 a, float3 b)
+{
+	return acosf(packingClamp(dot(a, b), -1.0f, 1.0f));
+}
+
+// Evenly spread unit vectors covering the whole sphere (Fibonacci lattice)
+static float3 sphereDirection(uint32_t index, uint32_t count)
+{
+	float z = 1.0f - 2.0f * ((float)index + 0.5f) / (float)count;
+	float radius = sqrtf(TF_MAX(1.0f - z * z, 0.0f));
+	float phi = (float)index * k_Pi * (3.0f - sqrtf(5.0f));
+	return { cosf(phi) * radius, sinf(phi) * radius, z };
+}
+
+// Axis-aligned vectors and vectors on the folds of the octahedron, where the encoding has its edge cases
+static const float3 k_EdgeDirections[] = {
+	{ 1.0f, 0.0f, 0.0f },
+	{ -1.0f, 0.0f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f },
+	{ 0.0f, -1.0f, 0.0f },
+	{ 0.0f, 0.0f, 1.0f },
+	{ 0.0f, 0.0f, -1.0f },
+	{ 0.70710678f, 0.70710678f, 0.0f },
+	{ -0.70710678f, 0.70710678f, 0.0f },
+	{ 0.70710678f, -0.70710678f, 0.0f },
+	{ -0.70710678f, -0.70710678f, 0.0f },
+	{ 0.57735027f, 0.57735027f, -0.57735027f },
+	{ -0.57735027f, -0.57735027f, -0.57735027f },
+	{ 0.0f, 0.70710678f, -0.70710678f },
+	{ -0.70710678f, 0.0f, -0.70710678f },
+	{ 0.001f, 0.0f, -0.9999995f },
+	{ -0.001f, 0.001f, -0.999999f },
+};
+
+static void testNormals()
+{
+	const uint32_t directionCount = 20000;
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < directionCount; ++i)
+	{
+		float3 normal = sphereDirection(i, directionCount);
+		maxError = TF_MAX(maxError, angleBetween(normal, UnpackOctahedral(PackOctahedral(normal))));
+	}
+	CHECK(maxError <= k_PackedNormalMaxError);
+
+	for (uint32_t i = 0; i < TF_ARRAY_COUNT(k_EdgeDirections); ++i)
+	{
+		float3 normal = normalize(k_EdgeDirections[i]);
+		float3 unpacked = UnpackOctahedral(PackOctahedral(normal));
+		CHECK(angleBetween(normal, unpacked) <= k_PackedNormalMaxError);
+		// The negative hemisphere must not fold onto the positive one
+		CHECK(packingSign(unpacked.z) == packingSign(normal.z) || fabsf(normal.z) < 1e-3f);
+	}
+
+	// Packing doesn't need unit vectors
+	float3 scaled = { 0.0f, -3.0f, 4.0f };
+	CHECK(angleBetween(normalize(scaled), UnpackOctahedral(PackOctahedral(scaled))) <= k_PackedNormalMaxError);
+	float3 denormal = { FLT_MIN * 0.25f, 0.0f, -FLT_MIN * 0.25f };
+	CHECK(angleBetween(normalize({ 1.0f, 0.0f, -1.0f }), UnpackOctahedral(PackOctahedral(denormal))) <= k_PackedNormalMaxError);
+
+	// Vectors without a direction are packed as +Z
+	const float3 up = { 0.0f, 0.0f, 1.0f };
+	float nan = NAN;
+	CHECK(angleBetween(up, UnpackOctahedral(PackOctahedral({ 0.0f, 0.0f, 0.0f }))) == 0.0f);
+	CHECK(angleBetween(up, UnpackOctahedral(PackOctahedral({ -0.0f, -0.0f, -0.0f }))) == 0.0f);
+	CHECK(angleBetween(up, UnpackOctahedral(PackOctahedral({ nan, 0.0f, 1.0f }))) == 0.0f);
+}
+
+static void testTangents()
+{
+	const uint32_t directionCount = 20000;
+	float maxError = 0.0f;
+	bool signsMatch = true;
+	for (uint32_t i = 0; i < directionCount; ++i)
+	{
+		float3 direction = sphereDirection(i, directionCount);
+		float sign = (i & 1) ? -1.0f : 1.0f;
+		float4 unpacked = UnpackTangent(PackTangent({ direction.x, direction.y, direction.z, sign }));
+		maxError = TF_MAX(maxError, angleBetween(direction, { unpacked.x, unpacked.y, unpacked.z }));
+		signsMatch = signsMatch && unpacked.w == sign;
+	}
+	CHECK(maxError <= k_PackedTangentMaxError);
+	CHECK(signsMatch);
+
+	for (uint32_t i = 0; i < TF_ARRAY_COUNT(k_EdgeDirections); ++i)
+	{
+		float3 direction = normalize(k_EdgeDirections[i]);
+		for (float sign = -1.0f; sign <= 1.0f; sign += 2.0f)
+		{
+			float4 unpacked = UnpackTangent(PackTangent({ direction.x, direction.y, direction.z, sign }));
+			CHECK(angleBetween(direction, { unpacked.x, unpacked.y, unpacked.z }) <= k_PackedTangentMaxError);
+			CHECK(unpacked.w == sign);
+		}
+	}
+
+	// Degenerate tangents (MikkTSpace leaves them at zero) stay at zero and keep their sign
+	float4 zero = UnpackTangent(PackTangent({ 0.0f, 0.0f, 0.0f, -1.0f }));
+	CHECK(zero.x == 0.0f && zero.y == 0.0f && zero.z == 0.0f && zero.w == -1.0f);
+	// A zero sign is a positive one
+	CHECK(UnpackTangent(PackTangent({ 1.0f, 0.0f, 0.0f, 0.0f })).w == 1.0f);
+	float nan = NAN;
+	float4 invalid = UnpackTangent(PackTangent({ nan, nan, nan, 1.0f }));
+	CHECK(invalid.x == 0.0f && invalid.y == 0.0f && invalid.z == 0.0f);
+}
+
+static void testTexcoords()
+{
+	// Half floats have 11 significant bits
+	const float relativeError = 1.0f / 2048.0f;
+	float maxError = 0.0f;
+	for (int32_t i = -4096; i <= 4096; ++i)
+	{
+		float value = (float)i * (8.0f / 4096.0f) + 0.000123f;
+		float2 unpacked = UnpackTexcoord(PackTexcoord({ value, -value }));
+		maxError = TF_MAX(maxError, fabsf(unpacked.x - value) / TF_MAX(fabsf(value), 1.0f));
+		CHECK(unpacked.y == -unpacked.x);
+	}
+	CHECK(maxError <= relativeError);
+
+	// Texel corners are exact
+	const float exactValues[] = { 0.0f, 0.25f, 0.5f, 1.0f, -1.0f, 2.0f, 1.0f / 1024.0f, 1023.0f / 1024.0f };
+	for (uint32_t i = 0; i < TF_ARRAY_COUNT(exactValues); ++i)
+	{
+		float2 unpacked = UnpackTexcoord(PackTexcoord({ exactValues[i], 1.0f - exactValues[i] }));
+		CHECK(unpacked.x == exactValues[i] && unpacked.y == 1.0f - exactValues[i]);
+	}
+
+	// Out of range values clamp to the largest half, tiny ones become denormals or zero
+	CHECK(UnpackTexcoord(PackTexcoord({ 1e6f, -1e6f })).x == 65504.0f);
+	CHECK(UnpackTexcoord(PackTexcoord({ 1e6f, -1e6f })).y == -65504.0f);
+	CHECK(fabsf(UnpackTexcoord(PackTexcoord({ 1e-6f, 0.0f })).x - 1e-6f) < 1.0f / (float)(1 << 24));
+	CHECK(UnpackTexcoord(PackTexcoord({ 1e-10f, 0.0f })).x == 0.0f);
+}
+
+static void testColors()
+{
+	// Every 8-bit level round-trips exactly
+	bool exact = true;
+	for (uint32_t level = 0; level < 256; ++level)
+	{
+		float value = (float)level / 255.0f;
+		uint32_t packed = PackColor({ value, 1.0f - value, value });
+		float3 unpacked = UnpackColor(packed);
+		exact = exact && unpacked.x == value && unpacked.y == (float)(255 - level) / 255.0f && unpacked.z == value;
+		exact = exact && (packed >> 24) == 0xFF;
+	}
+	CHECK(exact);
+
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i <= 1000; ++i)
+	{
+		float value = (float)i / 1000.0f;
+		maxError = TF_MAX(maxError, fabsf(UnpackColor(PackColor({ value, value, value })).x - value));
+	}
+	CHECK(maxError <= 0.5f / 255.0f + 1e-6f);
+
+	// Out of range and invalid values clamp
+	float nan = NAN;
+	float3 clamped = UnpackColor(PackColor({ -1.0f, 2.0f, nan }));
+	CHECK(clamped.x == 0.0f && clamped.y == 1.0f && clamped.z == 0.0f);
+}
+
+static void testSnorm()
+{
+	float nan = NAN;
+	float infinity = INFINITY;
+	CHECK(PackSnorm(nan, 16) == 0);
+	CHECK(PackSnorm(infinity, 16) == 0x7FFF);
+	CHECK(UnpackSnorm(PackSnorm(-infinity, 16), 16) == -1.0f);
+	CHECK(UnpackSnorm(PackSnorm(-1.0f, 10), 10) == -1.0f);
+	CHECK(UnpackSnorm(PackSnorm(1.0f, 10), 10) == 1.0f);
+	CHECK(UnpackSnorm(PackSnorm(0.0f, 10), 10) == 0.0f);
+	// The extra negative value of two's complement still unpacks to -1
+	CHECK(UnpackSnorm(0x200, 10) == -1.0f);
+}
+
+int main()
+{
+	testSnorm();
+	testNormals();
+	testTangents();
+	testTexcoords();
+	testColors();
+
+	return testReport("VertexPackingTests");
+}
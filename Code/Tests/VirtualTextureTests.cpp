@@ -0,0 +1,383 @@
+#include "../VirtualTexture.h"
+#include "Tests.h"
+
+// The-Forge
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// VirtualTextureTests: drives the page management of VirtualTexture.h with hand-written feedback and
+// checks the requests it makes, the pages it evicts and the page tables it builds.
+
+static const uint32_t k_MaxRequestCount = 64;
+
+// Page table entry of a page
+static uint32_t pageTableEntry(VirtualTextureSystem* system, uint32_t textureIndex, uint32_t mip, uint32_t x, uint32_t y)
+{
+	const VirtualTexture& texture = system->textures[textureIndex];
+	const uint32_t mipWidth = TF_MAX(texture.widthInPages >> mip, 1u);
+	return GetVirtualTexturePageTable(system, textureIndex)[texture.mipOffsets[mip] + y * mipWidth + x];
+}
+
+static bool pageTableEntryIs(VirtualTextureSystem* system, uint32_t textureIndex, uint32_t mip, uint32_t x, uint32_t y, uint32_t entryMip, uint32_t entrySlot)
+{
+	const uint32_t entry = pageTableEntry(system, textureIndex, mip, x, y);
+	return entry != k_VirtualTextureNoPage && GetVirtualPageTableMip(entry) == entryMip && GetVirtualPageTableSlot(entry) == entrySlot;
+}
+
+static bool pageTableIsEmpty(VirtualTextureSystem* system, uint32_t textureIndex)
+{
+	const uint32_t* pageTable = GetVirtualTexturePageTable(system, textureIndex);
+	for (uint32_t i = 0; i < system->textures[textureIndex].pageCount; ++i)
+	{
+		if (pageTable[i] != k_VirtualTextureNoPage)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void completeRequests(VirtualTextureSystem* system, const VirtualTextureLoadRequest* requests, uint32_t requestCount, bool loaded)
+{
+	for (uint32_t i = 0; i < requestCount; ++i)
+	{
+		CompleteVirtualTexturePageLoad(system, requests[i], loaded);
+	}
+}
+
+// One frame sampling a single page, whose requests all load. Returns the number of requests.
+static uint32_t samplePage(VirtualTextureSystem* system, uint32_t pageId, VirtualTextureLoadRequest* requests)
+{
+	const uint32_t requestCount = ProcessVirtualTextureFeedback(system, &pageId, 1, requests, k_MaxRequestCount);
+	completeRequests(system, requests, requestCount, true);
+	return requestCount;
+}
+
+// Checks that the LRU list links both ways and holds exactly the resident pages that aren't locked
+static bool lruIsConsistent(const VirtualTextureSystem* system)
+{
+	uint32_t evictableCount = 0;
+	for (uint32_t i = 0; i < system->slotCount; ++i)
+	{
+		evictableCount += system->slots[i].state == VirtualPageState::Resident && !system->slots[i].locked ? 1 : 0;
+	}
+
+	uint32_t lruCount = 0;
+	uint32_t previous = UINT32_MAX;
+	for (uint32_t slot = system->lruHead; slot != UINT32_MAX && lruCount <= system->slotCount; slot = system->slots[slot].next)
+	{
+		if (system->slots[slot].previous != previous || system->slots[slot].state != VirtualPageState::Resident || system->slots[slot].locked)
+		{
+			return false;
+		}
+		previous = slot;
+		lruCount++;
+	}
+
+	return lruCount == evictableCount && system->lruTail == previous;
+}
+
+static void testAddVirtualTexture()
+{
+	VirtualTextureSystem system;
+	CHECK(InitVirtualTextureSystem(&system, 4, 4));
+
+	CHECK(AddVirtualTexture(&system, 100, 128) == k_InvalidVirtualTexture);
+	CHECK(AddVirtualTexture(&system, 64, 64) == k_InvalidVirtualTexture);
+	CHECK(AddVirtualTexture(&system, 128, k_VirtualTexturePageSize << k_VirtualTextureMaxMipCount) == k_InvalidVirtualTexture);
+
+	// 8x8 pages: mips of 8x8, 4x4, 2x2 and 1x1 pages
+	const uint32_t textureIndex = AddVirtualTexture(&system, 1024, 1024);
+	CHECK(textureIndex == 0);
+	CHECK(system.textures[textureIndex].mipCount == 4);
+	CHECK(system.textures[textureIndex].pageCount == 64 + 16 + 4 + 1);
+	CHECK(pageTableIsEmpty(&system, textureIndex));
+
+	// Non-square textures go down to a single page too
+	const uint32_t wideIndex = AddVirtualTexture(&system, 512, 128);
+	CHECK(wideIndex == 1);
+	CHECK(system.textures[wideIndex].mipCount == 3);
+	CHECK(system.textures[wideIndex].pageCount == 4 + 2 + 1);
+
+	ExitVirtualTextureSystem(&system);
+}
+
+static void testParentRequests()
+{
+	VirtualTextureSystem system;
+	CHECK(InitVirtualTextureSystem(&system, 4, 4));
+	const uint32_t t = AddVirtualTexture(&system, 1024, 1024);
+
+	// Invalid page ids are skipped
+	const uint32_t pageIds[] = {
+		MakeVirtualPageId(t, 0, 7, 7),
+		MakeVirtualPageId(t, 0, 0, 0),
+		UINT32_MAX,
+		MakeVirtualPageId(t, 4, 0, 0),
+		MakeVirtualPageId(t, 1, 4, 0),
+		MakeVirtualPageId(t + 1, 0, 0, 0),
+		MakeVirtualPageId(t, 0, 7, 7),
+		MakeVirtualPageId(t, 0, 7, 7),
+	};
+
+	// Parents first, then the most sampled pages first
+	const uint32_t expectedPageIds[] = {
+		MakeVirtualPageId(t, 3, 0, 0),
+		MakeVirtualPageId(t, 2, 1, 1),
+		MakeVirtualPageId(t, 2, 0, 0),
+		MakeVirtualPageId(t, 1, 3, 3),
+		MakeVirtualPageId(t, 1, 0, 0),
+		MakeVirtualPageId(t, 0, 7, 7),
+		MakeVirtualPageId(t, 0, 0, 0),
+	};
+
+	VirtualTextureLoadRequest requests[k_MaxRequestCount];
+	uint32_t requestCount = ProcessVirtualTextureFeedback(&system, pageIds, TF_ARRAY_COUNT(pageIds), requests, k_MaxRequestCount);
+	if (CHECK(requestCount == TF_ARRAY_COUNT(expectedPageIds)))
+	{
+		for (uint32_t i = 0; i < requestCount; ++i)
+		{
+			CHECK(requests[i].pageId == expectedPageIds[i]);
+			// Free slots are taken from the first one of the atlas
+			CHECK(requests[i].slot == i);
+			CHECK(requests[i].atlasX == i % 4 && requests[i].atlasY == i / 4);
+		}
+	}
+
+	// Pages being loaded aren't requested again
+	CHECK(ProcessVirtualTextureFeedback(&system, pageIds, TF_ARRAY_COUNT(pageIds), requests, k_MaxRequestCount) == 0);
+	ExitVirtualTextureSystem(&system);
+
+	// Requests past maxRequestCount are left to the next frames
+	CHECK(InitVirtualTextureSystem(&system, 4, 4));
+	AddVirtualTexture(&system, 1024, 1024);
+	requestCount = ProcessVirtualTextureFeedback(&system, pageIds, TF_ARRAY_COUNT(pageIds), requests, 2);
+	CHECK(requestCount == 2 && requests[0].pageId == expectedPageIds[0] && requests[1].pageId == expectedPageIds[1]);
+	requestCount = ProcessVirtualTextureFeedback(&system, pageIds, TF_ARRAY_COUNT(pageIds), requests, k_MaxRequestCount);
+	CHECK(requestCount == TF_ARRAY_COUNT(expectedPageIds) - 2 && requests[0].pageId == expectedPageIds[2]);
+
+	ExitVirtualTextureSystem(&system);
+}
+
+static void testPageTableFallback()
+{
+	VirtualTextureSystem system;
+	CHECK(InitVirtualTextureSystem(&system, 4, 4));
+	const uint32_t t = AddVirtualTexture(&system, 1024, 1024);
+
+	const uint32_t pageId = MakeVirtualPageId(t, 0, 5, 6);
+	VirtualTextureLoadRequest requests[k_MaxRequestCount];
+	const uint32_t requestCount = ProcessVirtualTextureFeedback(&system, &pageId, 1, requests, k_MaxRequestCount);
+	if (!CHECK(requestCount == 4))
+	{
+		ExitVirtualTextureSystem(&system);
+		return;
+	}
+
+	// Pages being loaded aren't mapped yet
+	CHECK(pageTableIsEmpty(&system, t));
+
+	// The coarsest page covers every page
+	CompleteVirtualTexturePageLoad(&system, requests[0], true);
+	CHECK(pageTableEntryIs(&system, t, 3, 0, 0, 3, requests[0].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 0, 0, 3, requests[0].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 5, 6, 3, requests[0].slot));
+
+	// Mip 2 page (1, 1) covers mip 1 pages (2..3, 2..3) and mip 0 pages (4..7, 4..7)
+	CompleteVirtualTexturePageLoad(&system, requests[1], true);
+	CHECK(pageTableEntryIs(&system, t, 2, 1, 1, 2, requests[1].slot));
+	CHECK(pageTableEntryIs(&system, t, 1, 2, 2, 2, requests[1].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 7, 4, 2, requests[1].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 5, 6, 2, requests[1].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 3, 6, 3, requests[0].slot));
+
+	CompleteVirtualTexturePageLoad(&system, requests[2], true);
+	CHECK(pageTableEntryIs(&system, t, 0, 4, 6, 1, requests[2].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 5, 6, 1, requests[2].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 5, 5, 2, requests[1].slot));
+
+	CompleteVirtualTexturePageLoad(&system, requests[3], true);
+	CHECK(pageTableEntryIs(&system, t, 0, 5, 6, 0, requests[3].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 4, 6, 1, requests[2].slot));
+	CHECK(pageTableEntryIs(&system, t, 0, 4, 7, 1, requests[2].slot));
+
+	ExitVirtualTextureSystem(&system);
+}
+
+static void testLruEviction()
+{
+	// 3 slots for a texture of 2x2 pages and its single page mip
+	VirtualTextureSystem system;
+	CHECK(InitVirtualTextureSystem(&system, 3, 1));
+	const uint32_t t = AddVirtualTexture(&system, 256, 256);
+	const uint32_t page00 = MakeVirtualPageId(t, 0, 0, 0);
+	const uint32_t page10 = MakeVirtualPageId(t, 0, 1, 0);
+	const uint32_t page01 = MakeVirtualPageId(t, 0, 0, 1);
+	const uint32_t page11 = MakeVirtualPageId(t, 0, 1, 1);
+
+	VirtualTextureLoadRequest requests[k_MaxRequestCount];
+	CHECK(samplePage(&system, page00, requests) == 2);
+	const uint32_t coarsestSlot = requests[0].slot;
+	const uint32_t slot00 = requests[1].slot;
+	CHECK(system.slots[coarsestSlot].locked && !system.slots[slot00].locked);
+
+	CHECK(samplePage(&system, page10, requests) == 1);
+	const uint32_t slot10 = requests[0].slot;
+	CHECK(system.freeSlotCount == 0);
+	CHECK(lruIsConsistent(&system));
+
+	// The least recently used page is evicted, the coarsest page isn't a candidate
+	CHECK(samplePage(&system, page01, requests) == 1 && requests[0].slot == slot00);
+	CHECK(pageTableEntryIs(&system, t, 0, 0, 0, 1, coarsestSlot));
+	CHECK(pageTableEntryIs(&system, t, 0, 0, 1, 0, slot00));
+	CHECK(samplePage(&system, page11, requests) == 1 && requests[0].slot == slot10);
+	CHECK(pageTableEntryIs(&system, t, 0, 1, 0, 1, coarsestSlot));
+
+	// Sampling a resident page makes it the most recently used one
+	CHECK(samplePage(&system, page01, requests) == 0);
+	CHECK(samplePage(&system, page00, requests) == 1 && requests[0].slot == slot10);
+	CHECK(pageTableEntryIs(&system, t, 0, 1, 1, 1, coarsestSlot));
+	CHECK(pageTableEntryIs(&system, t, 0, 0, 1, 0, slot00));
+	CHECK(lruIsConsistent(&system));
+
+	// Pages sampled this frame aren't evicted
+	const uint32_t pageIds[] = { page01, page00, page10 };
+	CHECK(ProcessVirtualTextureFeedback(&system, pageIds, TF_ARRAY_COUNT(pageIds), requests, k_MaxRequestCount) == 0);
+
+	// The coarsest page stays however long it isn't sampled, while the other pages take turns in the
+	// two slots left
+	const uint32_t cycledPageIds[] = { page11, page10, page00, page01 };
+	for (uint32_t frame = 0; frame < 16; ++frame)
+	{
+		CHECK(samplePage(&system, cycledPageIds[frame % TF_ARRAY_COUNT(cycledPageIds)], requests) == 1);
+	}
+	CHECK(system.slots[coarsestSlot].state == VirtualPageState::Resident && system.slots[coarsestSlot].locked);
+	CHECK(system.slots[coarsestSlot].pageId == MakeVirtualPageId(t, 1, 0, 0));
+	CHECK(pageTableEntryIs(&system, t, 1, 0, 0, 1, coarsestSlot));
+	CHECK(lruIsConsistent(&system));
+
+	ExitVirtualTextureSystem(&system);
+}
+
+static void testFailedLoads()
+{
+	VirtualTextureSystem system;
+	CHECK(InitVirtualTextureSystem(&system, 4, 4));
+	const uint32_t t = AddVirtualTexture(&system, 256, 256);
+	const uint32_t pageId = MakeVirtualPageId(t, 0, 1, 0);
+
+	VirtualTextureLoadRequest requests[k_MaxRequestCount];
+	CHECK(ProcessVirtualTextureFeedback(&system, &pageId, 1, requests, k_MaxRequestCount) == 2);
+	CompleteVirtualTexturePageLoad(&system, requests[0], true);
+	CompleteVirtualTexturePageLoad(&system, requests[1], false);
+
+	// The slot of a failed load is free again and its page falls back to its parent
+	const uint32_t failedSlot = requests[1].slot;
+	CHECK(system.slots[failedSlot].state == VirtualPageState::Free);
+	CHECK(system.freeSlotCount == system.slotCount - 1);
+	CHECK(pageTableEntryIs(&system, t, 0, 1, 0, 1, requests[0].slot));
+	CHECK(lruIsConsistent(&system));
+
+	// The page is requested again the next time it's sampled
+	CHECK(samplePage(&system, pageId, requests) == 1 && requests[0].pageId == pageId);
+	CHECK(pageTableEntryIs(&system, t, 0, 1, 0, 0, requests[0].slot));
+
+	// Failed coarsest pages leave nothing to fall back to
+	const uint32_t otherIndex = AddVirtualTexture(&system, 128, 128);
+	const uint32_t coarsestPageId = MakeVirtualPageId(otherIndex, 0, 0, 0);
+	CHECK(ProcessVirtualTextureFeedback(&system, &coarsestPageId, 1, requests, k_MaxRequestCount) == 1);
+	CompleteVirtualTexturePageLoad(&system, requests[0], false);
+	CHECK(!system.slots[requests[0].slot].locked);
+	CHECK(pageTableIsEmpty(&system, otherIndex));
+	CHECK(samplePage(&system, coarsestPageId, requests) == 1);
+	CHECK(pageTableEntryIs(&system, otherIndex, 0, 0, 0, 0, requests[0].slot));
+
+	ExitVirtualTextureSystem(&system);
+}
+
+static void testRemoveWhileLoading()
+{
+	VirtualTextureSystem system;
+	CHECK(InitVirtualTextureSystem(&system, 4, 4));
+	uint32_t t = AddVirtualTexture(&system, 1024, 1024);
+	const uint32_t pageId = MakeVirtualPageId(t, 0, 5, 6);
+
+	VirtualTextureLoadRequest staleRequests[k_MaxRequestCount];
+	if (!CHECK(ProcessVirtualTextureFeedback(&system, &pageId, 1, staleRequests, k_MaxRequestCount) == 4))
+	{
+		ExitVirtualTextureSystem(&system);
+		return;
+	}
+	CompleteVirtualTexturePageLoad(&system, staleRequests[0], true);
+	CompleteVirtualTexturePageLoad(&system, staleRequests[1], true);
+
+	// Resident pages are freed right away, the ones being loaded once their loads complete
+	RemoveVirtualTexture(&system, t);
+	CHECK(system.freeSlotCount == system.slotCount - 2);
+	CHECK(system.lruHead == UINT32_MAX && system.lruTail == UINT32_MAX);
+	CHECK(GetVirtualTexturePageTable(&system, t) == NULL);
+
+	// A new texture takes the index back, and the same page ids, before the stale loads complete
+	CHECK(AddVirtualTexture(&system, 1024, 1024) == t);
+	CHECK(pageTableIsEmpty(&system, t));
+	VirtualTextureLoadRequest requests[k_MaxRequestCount];
+	const uint32_t requestCount = ProcessVirtualTextureFeedback(&system, &pageId, 1, requests, k_MaxRequestCount);
+	CHECK(requestCount == 4);
+	for (uint32_t i = 0; i < requestCount; ++i)
+	{
+		CHECK(requests[i].slot != staleRequests[2].slot && requests[i].slot != staleRequests[3].slot);
+	}
+
+	// Stale loads only free their slots, whether they loaded or not
+	CompleteVirtualTexturePageLoad(&system, staleRequests[2], true);
+	CompleteVirtualTexturePageLoad(&system, staleRequests[3], false);
+	CHECK(system.freeSlotCount == system.slotCount - requestCount);
+	CHECK(pageTableIsEmpty(&system, t));
+	CHECK(lruIsConsistent(&system));
+
+	completeRequests(&system, requests, requestCount, true);
+	CHECK(pageTableEntryIs(&system, t, 0, 5, 6, 0, requests[3].slot));
+
+	RemoveVirtualTexture(&system, t);
+	CHECK(system.freeSlotCount == system.slotCount);
+	CHECK(lruIsConsistent(&system));
+
+	ExitVirtualTextureSystem(&system);
+}
+
+int main()
+{
+	if (!::initMemAlloc("VirtualTextureTests"))
+	{
+		fprintf(stderr, "Couldn't initialize the memory allocator\n");
+		return 1;
+	}
+
+	FileSystemInitDesc fsDesc = FileSystemInitDesc{};
+	fsDesc.pAppName = "VirtualTextureTests";
+	if (!::initFileSystem(&fsDesc))
+	{
+		fprintf(stderr, "Couldn't initialize the file system\n");
+		::exitMemAlloc();
+		return 1;
+	}
+
+	::initLog("VirtualTextureTests", LogLevel::eALL);
+
+	testAddVirtualTexture();
+	testParentRequests();
+	testPageTableFallback();
+	testLruEviction();
+	testFailedLoads();
+	testRemoveWhileLoading();
+
+	int result = testReport("VirtualTextureTests");
+
+	::exitLog();
+	::exitFileSystem();
+	::exitMemAlloc();
+
+	return result;
+}
@@ -0,0 +1,791 @@
+#include "TextureCooker.h"
+
+#include "DdsFile.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define TEXTURE_COOKER_SSE2
+#include <emmintrin.h>
+#endif
+
+// stb_image
+// NOTE(gmodarelli): Compiled static here so it can't clash with other copies linked into the tools.
+// It allocates through the CRT, its images are released with stbi_image_free.
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_TGA
+#define STBI_ONLY_JPEG
+#include <Utilities/ThirdParty/OpenSource/Nothings/stb_image.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IThread.h>
+#include <Utilities/Interfaces/ITime.h>
+#include <Utilities/Math/MathTypes.h>
+#include <Utilities/Threading/Atomics.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+const uint32_t k_TextureBlockDimension = 4;
+const uint32_t k_TextureMaxMips = 16;
+
+struct TextureCookRule
+{
+	const char* suffix;
+	TextureCookFormat format;
+	bool srgb;
+};
+
+// NOTE: Keep in sync with the texture rules in Tools/AssetCooker/rules.lua
+static const TextureCookRule k_TextureCookRules[] = {
+	{ "_albedo", TextureCookFormat::BC1_SRGB, true },
+	{ "_emissive", TextureCookFormat::BC1_SRGB, true },
+	{ "_orm", TextureCookFormat::BC1, true },
+	{ "_normal", TextureCookFormat::BC5, false },
+};
+
+static const char* k_TextureSourceExtensions[] = { ".png", ".tga", ".jpg" };
+
+struct TextureFormatDesc
+{
+	const char* name;
+	uint32_t dxgiFormat;
+	uint32_t blockSize;
+};
+
+static const TextureFormatDesc k_TextureFormatDescs[(uint32_t)TextureCookFormat::_Count] = {
+	{ "BC1_UNORM_SRGB", 72, 8 },
+	{ "BC1_UNORM", 71, 8 },
+	{ "BC5_UNORM", 83, 16 },
+};
+
+enum class MipFilter
+{
+	Linear = 0,
+	Srgb,
+	Normal,
+};
+
+// RGBA8 pixels of a mip and where its blocks go in the compressed data
+struct TextureMip
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t blocksX;
+	uint32_t blocksY;
+	const uint8_t* pixels;
+	uint64_t dataOffset;
+};
+
+// NOTE: Rows of blocks are pulled by every worker until there are none left, every row is
+// written to its own place in blocks, so the output doesn't depend on scheduling.
+struct TextureEncodeJob
+{
+	const TextureMip* mips = NULL;
+	uint32_t mipCount = 0;
+	TextureCookFormat format = TextureCookFormat::BC1_SRGB;
+	uint8_t* blocks = NULL;
+	uint32_t rowCount = 0;
+	tfrg_atomic32_t nextRow = 0;
+};
+
+static float srgbToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static uint8_t toUnorm8(float value)
+{
+	value = TF_MIN(TF_MAX(value, 0.0f), 1.0f);
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+// Decodes RGBA8 pixels into the float space mips are filtered in
+static void decodeMipPixels(const uint8_t* pixels, uint32_t pixelCount, MipFilter filter, float* values)
+{
+	float srgbTable[256];
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		srgbTable[i] = srgbToLinear(i / 255.0f);
+	}
+
+	for (uint32_t i = 0; i < pixelCount * 4; ++i)
+	{
+		const uint32_t channel = i & 3;
+		if (filter == MipFilter::Srgb && channel < 3)
+		{
+			values[i] = srgbTable[pixels[i]];
+		}
+		else if (filter == MipFilter::Normal && channel < 3)
+		{
+			values[i] = pixels[i] / 255.0f * 2.0f - 1.0f;
+		}
+		else
+		{
+			values[i] = pixels[i] / 255.0f;
+		}
+	}
+}
+
+// Box filters values into the next mip, odd edges are clamped
+static void downsampleMip(const float* values, uint32_t width, uint32_t height, MipFilter filter, float* mipValues, uint32_t mipWidth, uint32_t mipHeight)
+{
+	for (uint32_t y = 0; y < mipHeight; ++y)
+	{
+		const uint32_t y0 = TF_MIN(y * 2, height - 1);
+		const uint32_t y1 = TF_MIN(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < mipWidth; ++x)
+		{
+			const uint32_t x0 = TF_MIN(x * 2, width - 1);
+			const uint32_t x1 = TF_MIN(x * 2 + 1, width - 1);
+			float* result = &mipValues[(y * mipWidth + x) * 4];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				result[c] = 0.25f * (values[(y0 * width + x0) * 4 + c] + values[(y0 * width + x1) * 4 + c] +
+									 values[(y1 * width + x0) * 4 + c] + values[(y1 * width + x1) * 4 + c]);
+			}
+
+			if (filter == MipFilter::Normal)
+			{
+				const float length = sqrtf(result[0] * result[0] + result[1] * result[1] + result[2] * result[2]);
+				if (length > 1e-6f)
+				{
+					result[0] /= length;
+					result[1] /= length;
+					result[2] /= length;
+				}
+				else
+				{
+					result[0] = 0.0f;
+					result[1] = 0.0f;
+					result[2] = 1.0f;
+				}
+			}
+		}
+	}
+}
+
+static void encodeMipPixels(const float* values, uint32_t pixelCount, MipFilter filter, uint8_t* pixels)
+{
+	for (uint32_t i = 0; i < pixelCount * 4; ++i)
+	{
+		const uint32_t channel = i & 3;
+		if (filter == MipFilter::Srgb && channel < 3)
+		{
+			pixels[i] = toUnorm8(linearToSrgb(values[i]));
+		}
+		else if (filter == MipFilter::Normal && channel < 3)
+		{
+			pixels[i] = toUnorm8(values[i] * 0.5f + 0.5f);
+		}
+		else
+		{
+			pixels[i] = toUnorm8(values[i]);
+		}
+	}
+}
+
+static uint16_t packColor565(const float* color)
+{
+	const uint32_t r = (uint32_t)(TF_MIN(TF_MAX(color[0], 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+	const uint32_t g = (uint32_t)(TF_MIN(TF_MAX(color[1], 0.0f), 255.0f) * (63.0f / 255.0f) + 0.5f);
+	const uint32_t b = (uint32_t)(TF_MIN(TF_MAX(color[2], 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackColor565(uint16_t packed, float* color)
+{
+	const uint32_t r = (packed >> 11) & 31;
+	const uint32_t g = (packed >> 5) & 63;
+	const uint32_t b = packed & 31;
+	color[0] = (float)((r << 3) | (r >> 2));
+	color[1] = (float)((g << 2) | (g >> 4));
+	color[2] = (float)((b << 3) | (b >> 2));
+}
+
+// Picks the closest palette entry of every pixel, returns the squared error of the block
+static float selectBC1Indices(const float* r, const float* g, const float* b, const float (*palette)[3], uint32_t* indices)
+{
+	uint32_t packed = 0;
+	float error = 0.0f;
+
+#if defined(TEXTURE_COOKER_SSE2)
+	__m128 errors = _mm_setzero_ps();
+	for (uint32_t i = 0; i < 16; i += 4)
+	{
+		const __m128 pr = _mm_loadu_ps(&r[i]);
+		const __m128 pg = _mm_loadu_ps(&g[i]);
+		const __m128 pb = _mm_loadu_ps(&b[i]);
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (uint32_t p = 0; p < 4; ++p)
+		{
+			const __m128 dr = _mm_sub_ps(pr, _mm_set1_ps(palette[p][0]));
+			const __m128 dg = _mm_sub_ps(pg, _mm_set1_ps(palette[p][1]));
+			const __m128 db = _mm_sub_ps(pb, _mm_set1_ps(palette[p][2]));
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+			best = _mm_min_ps(distance, best);
+			bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32((int)p)));
+		}
+		errors = _mm_add_ps(errors, best);
+
+		uint32_t lanes[4];
+		_mm_storeu_si128((__m128i*)lanes, bestIndex);
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			packed |= lanes[lane] << (2 * (i + lane));
+		}
+	}
+
+	float laneErrors[4];
+	_mm_storeu_ps(laneErrors, errors);
+	error = laneErrors[0] + laneErrors[1] + laneErrors[2] + laneErrors[3];
+#else
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		float best = FLT_MAX;
+		uint32_t bestIndex = 0;
+		for (uint32_t p = 0; p < 4; ++p)
+		{
+			const float dr = r[i] - palette[p][0];
+			const float dg = g[i] - palette[p][1];
+			const float db = b[i] - palette[p][2];
+			const float distance = dr * dr + dg * dg + db * db;
+			if (distance < best)
+			{
+				best = distance;
+				bestIndex = p;
+			}
+		}
+		error += best;
+		packed |= bestIndex << (2 * i);
+	}
+#endif
+
+	*indices = packed;
+	return error;
+}
+
+// Builds the 4-color palette of two endpoints and selects the indices for it. The endpoints are
+// ordered so that color0 > color1, equal endpoints end up in the 3-color mode with every index 0.
+static float encodeBC1Endpoints(const float* r, const float* g, const float* b, uint16_t* color0, uint16_t* color1, uint32_t* indices)
+{
+	if (*color0 < *color1)
+	{
+		const uint16_t swap = *color0;
+		*color0 = *color1;
+		*color1 = swap;
+	}
+
+	float palette[4][3];
+	unpackColor565(*color0, palette[0]);
+	unpackColor565(*color1, palette[1]);
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (*color0 == *color1)
+		{
+			palette[1][c] = palette[0][c];
+			palette[2][c] = palette[0][c];
+			palette[3][c] = palette[0][c];
+		}
+		else
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+	}
+
+	return selectBC1Indices(r, g, b, palette, indices);
+}
+
+void EncodeBC1Block(const uint8_t* rgba, uint8_t* block)
+{
+	float r[16];
+	float g[16];
+	float b[16];
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	float minColor[3] = { 255.0f, 255.0f, 255.0f };
+	float maxColor[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		r[i] = rgba[i * 4 + 0];
+		g[i] = rgba[i * 4 + 1];
+		b[i] = rgba[i * 4 + 2];
+		const float color[3] = { r[i], g[i], b[i] };
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			mean[c] += color[c] / 16.0f;
+			minColor[c] = TF_MIN(minColor[c], color[c]);
+			maxColor[c] = TF_MAX(maxColor[c], color[c]);
+		}
+	}
+
+	// NOTE(gmodarelli): The endpoints are the two pixels furthest apart along the principal axis of
+	// the block, found with a few power iterations on its covariance matrix
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		const float dr = r[i] - mean[0];
+		const float dg = g[i] - mean[1];
+		const float db = b[i] - mean[2];
+		covariance[0] += dr * dr;
+		covariance[1] += dr * dg;
+		covariance[2] += dr * db;
+		covariance[3] += dg * dg;
+		covariance[4] += dg * db;
+		covariance[5] += db * db;
+	}
+
+	float axis[3] = { maxColor[0] - minColor[0], maxColor[1] - minColor[1], maxColor[2] - minColor[2] };
+	for (uint32_t iteration = 0; iteration < 4; ++iteration)
+	{
+		const float x = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+		const float y = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+		const float z = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+		const float scale = TF_MAX(fabsf(x), TF_MAX(fabsf(y), fabsf(z)));
+		if (scale < 1e-6f)
+		{
+			break;
+		}
+		axis[0] = x / scale;
+		axis[1] = y / scale;
+		axis[2] = z / scale;
+	}
+
+	uint32_t minPixel = 0;
+	uint32_t maxPixel = 0;
+	float minProjection = FLT_MAX;
+	float maxProjection = -FLT_MAX;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		const float projection = r[i] * axis[0] + g[i] * axis[1] + b[i] * axis[2];
+		if (projection < minProjection)
+		{
+			minProjection = projection;
+			minPixel = i;
+		}
+		if (projection > maxProjection)
+		{
+			maxProjection = projection;
+			maxPixel = i;
+		}
+	}
+
+	const float endpoint0[3] = { r[maxPixel], g[maxPixel], b[maxPixel] };
+	const float endpoint1[3] = { r[minPixel], g[minPixel], b[minPixel] };
+	uint16_t color0 = packColor565(endpoint0);
+	uint16_t color1 = packColor565(endpoint1);
+	uint32_t indices = 0;
+	float error = encodeBC1Endpoints(r, g, b, &color0, &color1, &indices);
+
+	// Refine the endpoints with a least squares fit to the selected indices
+	if (color0 != color1 && error > 0.0f)
+	{
+		const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float alpha2 = 0.0f;
+		float beta2 = 0.0f;
+		float alphaBeta = 0.0f;
+		float alphaColor[3] = { 0.0f, 0.0f, 0.0f };
+		float betaColor[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float alpha = weights[(indices >> (2 * i)) & 3];
+			const float beta = 1.0f - alpha;
+			alpha2 += alpha * alpha;
+			beta2 += beta * beta;
+			alphaBeta += alpha * beta;
+			alphaColor[0] += alpha * r[i];
+			alphaColor[1] += alpha * g[i];
+			alphaColor[2] += alpha * b[i];
+			betaColor[0] += beta * r[i];
+			betaColor[1] += beta * g[i];
+			betaColor[2] += beta * b[i];
+		}
+
+		const float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+		if (fabsf(determinant) > 1e-6f)
+		{
+			float refined0[3];
+			float refined1[3];
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				refined0[c] = (alphaColor[c] * beta2 - betaColor[c] * alphaBeta) / determinant;
+				refined1[c] = (betaColor[c] * alpha2 - alphaColor[c] * alphaBeta) / determinant;
+			}
+
+			uint16_t refinedColor0 = packColor565(refined0);
+			uint16_t refinedColor1 = packColor565(refined1);
+			uint32_t refinedIndices = 0;
+			const float refinedError = encodeBC1Endpoints(r, g, b, &refinedColor0, &refinedColor1, &refinedIndices);
+			if (refinedError < error)
+			{
+				color0 = refinedColor0;
+				color1 = refinedColor1;
+				indices = refinedIndices;
+			}
+		}
+	}
+
+	block[0] = (uint8_t)(color0 & 0xFF);
+	block[1] = (uint8_t)(color0 >> 8);
+	block[2] = (uint8_t)(color1 & 0xFF);
+	block[3] = (uint8_t)(color1 >> 8);
+	block[4] = (uint8_t)(indices & 0xFF);
+	block[5] = (uint8_t)((indices >> 8) & 0xFF);
+	block[6] = (uint8_t)((indices >> 16) & 0xFF);
+	block[7] = (uint8_t)(indices >> 24);
+}
+
+void EncodeBC4Block(const uint8_t* rgba, uint32_t channel, uint8_t* block)
+{
+	ASSERT(channel < 4);
+
+	uint8_t minValue = 255;
+	uint8_t maxValue = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		minValue = TF_MIN(minValue, rgba[i * 4 + channel]);
+		maxValue = TF_MAX(maxValue, rgba[i * 4 + channel]);
+	}
+
+	// NOTE(gmodarelli): endpoint0 > endpoint1 selects the 8-value mode, equal endpoints decode every
+	// index 0 to the endpoint itself
+	block[0] = maxValue;
+	block[1] = minValue;
+
+	uint64_t indices = 0;
+	if (maxValue > minValue)
+	{
+		float palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (uint32_t k = 1; k < 7; ++k)
+		{
+			palette[k + 1] = ((7 - k) * (float)maxValue + k * (float)minValue) / 7.0f;
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float value = rgba[i * 4 + channel];
+			uint64_t bestIndex = 0;
+			float best = FLT_MAX;
+			for (uint32_t p = 0; p < 8; ++p)
+			{
+				const float distance = fabsf(value - palette[p]);
+				if (distance < best)
+				{
+					best = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= bestIndex << (3 * i);
+		}
+	}
+
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		block[2 + i] = (uint8_t)((indices >> (8 * i)) & 0xFF);
+	}
+}
+
+static void encodeBlockRow(const TextureMip* mip, uint32_t blockY, TextureCookFormat format, uint8_t* blocks)
+{
+	const uint32_t blockSize = k_TextureFormatDescs[(uint32_t)format].blockSize;
+	uint8_t* rowBlocks = blocks + mip->dataOffset + (uint64_t)blockY * mip->blocksX * blockSize;
+
+	uint8_t rgba[k_TextureBlockDimension * k_TextureBlockDimension * 4];
+	for (uint32_t blockX = 0; blockX < mip->blocksX; ++blockX)
+	{
+		// Blocks hanging off the edges of the mip repeat its last row and column
+		for (uint32_t y = 0; y < k_TextureBlockDimension; ++y)
+		{
+			const uint32_t sourceY = TF_MIN(blockY * k_TextureBlockDimension + y, mip->height - 1);
+			for (uint32_t x = 0; x < k_TextureBlockDimension; ++x)
+			{
+				const uint32_t sourceX = TF_MIN(blockX * k_TextureBlockDimension + x, mip->width - 1);
+				memcpy(&rgba[(y * k_TextureBlockDimension + x) * 4], &mip->pixels[((uint64_t)sourceY * mip->width + sourceX) * 4], 4);
+			}
+		}
+
+		uint8_t* block = rowBlocks + (uint64_t)blockX * blockSize;
+		switch (format)
+		{
+		case TextureCookFormat::BC1_SRGB:
+		case TextureCookFormat::BC1:
+			EncodeBC1Block(rgba, block);
+			break;
+		case TextureCookFormat::BC5:
+			EncodeBC4Block(rgba, 0, block);
+			EncodeBC4Block(rgba, 1, block + 8);
+			break;
+		default:
+			ASSERT(false);
+			break;
+		}
+	}
+}
+
+static void encodeTextureRows(void* userData)
+{
+	TextureEncodeJob* job = (TextureEncodeJob*)userData;
+	while (true)
+	{
+		uint32_t row = (uint32_t)tfrg_atomic32_add_relaxed(&job->nextRow, 1);
+		if (row >= job->rowCount)
+		{
+			break;
+		}
+
+		uint32_t mipIndex = 0;
+		while (row >= job->mips[mipIndex].blocksY)
+		{
+			row -= job->mips[mipIndex].blocksY;
+			mipIndex++;
+			ASSERT(mipIndex < job->mipCount);
+		}
+
+		encodeBlockRow(&job->mips[mipIndex], row, job->format, job->blocks);
+	}
+}
+
+static bool writeDDS(const char* path, const TextureMip* mips, uint32_t mipCount, TextureCookFormat format, const uint8_t* blocks, uint64_t size)
+{
+	const TextureFormatDesc& formatDesc = k_TextureFormatDescs[(uint32_t)format];
+
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = k_DDSFlagCaps | k_DDSFlagHeight | k_DDSFlagWidth | k_DDSFlagPixelFormat | k_DDSFlagMipMapCount | k_DDSFlagLinearSize;
+	header.height = mips[0].height;
+	header.width = mips[0].width;
+	header.pitchOrLinearSize = mips[0].blocksX * mips[0].blocksY * formatDesc.blockSize;
+	header.mipMapCount = mipCount;
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = k_DDSPixelFormatFourCC;
+	header.pixelFormat.fourCC = k_DDSFourCCDX10;
+	header.caps = k_DDSCapsTexture | (mipCount > 1 ? k_DDSCapsComplex | k_DDSCapsMipMap : 0);
+
+	DDSHeaderDX10 headerDX10 = {};
+	headerDX10.dxgiFormat = formatDesc.dxgiFormat;
+	headerDX10.resourceDimension = k_DDSResourceDimensionTexture2D;
+	headerDX10.arraySize = 1;
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		LOGF(eERROR, "Couldn't open '%s' for writing", path);
+		return false;
+	}
+
+	bool success = fwrite(&k_DDSMagic, sizeof(k_DDSMagic), 1, file) == 1;
+	success = success && fwrite(&header, sizeof(header), 1, file) == 1;
+	success = success && fwrite(&headerDX10, sizeof(headerDX10), 1, file) == 1;
+	success = success && fwrite(blocks, 1, (size_t)size, file) == size;
+	success = fclose(file) == 0 && success;
+
+	if (!success)
+	{
+		LOGF(eERROR, "Couldn't write '%s'", path);
+		remove(path);
+	}
+
+	return success;
+}
+
+bool GetTextureCookSettings(const char* path, TextureCookSettings* settings)
+{
+	const char* extension = strrchr(path, '.');
+	if (!extension)
+	{
+		return false;
+	}
+
+	bool supported = false;
+	for (uint32_t i = 0; i < TF_ARRAY_COUNT(k_TextureSourceExtensions); ++i)
+	{
+		supported = supported || strcmp(extension, k_TextureSourceExtensions[i]) == 0;
+	}
+
+	if (!supported)
+	{
+		return false;
+	}
+
+	const size_t stemLength = (size_t)(extension - path);
+	for (uint32_t i = 0; i < TF_ARRAY_COUNT(k_TextureCookRules); ++i)
+	{
+		const TextureCookRule& rule = k_TextureCookRules[i];
+		const size_t suffixLength = strlen(rule.suffix);
+		if (stemLength >= suffixLength && strncmp(extension - suffixLength, rule.suffix, suffixLength) == 0)
+		{
+			settings->format = rule.format;
+			settings->srgb = rule.srgb;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ParseTextureCookFormat(const char* name, TextureCookFormat* format)
+{
+	for (uint32_t i = 0; i < (uint32_t)TextureCookFormat::_Count; ++i)
+	{
+		if (strcmp(name, k_TextureFormatDescs[i].name) == 0)
+		{
+			*format = (TextureCookFormat)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* GetTextureCookFormatName(TextureCookFormat format)
+{
+	ASSERT(format < TextureCookFormat::_Count);
+	return k_TextureFormatDescs[(uint32_t)format].name;
+}
+
+bool CookTexture(const char* inputPath, const char* outputPath, const TextureCookSettings* settings, TextureCookStats* stats)
+{
+	TextureCookStats localStats = {};
+	stats = stats ? stats : &localStats;
+	*stats = {};
+
+	const int64_t cookStart = ::getUSec(true);
+	int64_t stageStart = cookStart;
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	uint8_t* sourcePixels = stbi_load(inputPath, &width, &height, &channels, 4);
+	if (!sourcePixels)
+	{
+		LOGF(eERROR, "Couldn't load '%s': %s", inputPath, stbi_failure_reason());
+		return false;
+	}
+	stats->loadTime = ::getUSec(true) - stageStart;
+	stageStart = ::getUSec(true);
+
+	const TextureCookFormat format = settings->format;
+	const MipFilter filter = format == TextureCookFormat::BC5 ? MipFilter::Normal : (settings->srgb ? MipFilter::Srgb : MipFilter::Linear);
+	const uint32_t blockSize = k_TextureFormatDescs[(uint32_t)format].blockSize;
+
+	uint32_t fullMipCount = 1;
+	while ((TF_MAX((uint32_t)width, (uint32_t)height) >> fullMipCount) > 0)
+	{
+		fullMipCount++;
+	}
+	const uint32_t mipCount = TF_MAX(TF_MIN(TF_MIN(settings->mipCount, fullMipCount), k_TextureMaxMips), 1u);
+
+	TextureMip mips[k_TextureMaxMips] = {};
+	uint64_t dataSize = 0;
+	uint32_t rowCount = 0;
+	for (uint32_t i = 0; i < mipCount; ++i)
+	{
+		TextureMip* mip = &mips[i];
+		mip->width = TF_MAX((uint32_t)width >> i, 1u);
+		mip->height = TF_MAX((uint32_t)height >> i, 1u);
+		mip->blocksX = (mip->width + k_TextureBlockDimension - 1) / k_TextureBlockDimension;
+		mip->blocksY = (mip->height + k_TextureBlockDimension - 1) / k_TextureBlockDimension;
+		mip->dataOffset = dataSize;
+		dataSize += (uint64_t)mip->blocksX * mip->blocksY * blockSize;
+		rowCount += mip->blocksY;
+		stats->blockCount += mip->blocksX * mip->blocksY;
+	}
+
+	// NOTE(gmodarelli): Every mip is filtered from the full precision version of the previous one,
+	// so only two float mips are alive at a time
+	mips[0].pixels = sourcePixels;
+	uint8_t* mipPixels = NULL;
+	if (mipCount > 1)
+	{
+		uint64_t mipPixelsSize = 0;
+		for (uint32_t i = 1; i < mipCount; ++i)
+		{
+			mipPixelsSize += (uint64_t)mips[i].width * mips[i].height * 4;
+		}
+		mipPixels = (uint8_t*)tf_malloc((size_t)mipPixelsSize);
+		float* values = (float*)tf_malloc(sizeof(float) * 4 * (size_t)width * height);
+		float* mipValues = (float*)tf_malloc(sizeof(float) * 4 * (size_t)mips[1].width * mips[1].height);
+		ASSERT(mipPixels && values && mipValues);
+
+		decodeMipPixels(sourcePixels, (uint32_t)width * (uint32_t)height, filter, values);
+		uint8_t* pixels = mipPixels;
+		for (uint32_t i = 1; i < mipCount; ++i)
+		{
+			const TextureMip& previous = mips[i - 1];
+			TextureMip* mip = &mips[i];
+			downsampleMip(values, previous.width, previous.height, filter, mipValues, mip->width, mip->height);
+			encodeMipPixels(mipValues, mip->width * mip->height, filter, pixels);
+			mip->pixels = pixels;
+			pixels += (uint64_t)mip->width * mip->height * 4;
+
+			float* swap = values;
+			values = mipValues;
+			mipValues = swap;
+		}
+
+		tf_free(values);
+		tf_free(mipValues);
+	}
+	stats->mipsTime = ::getUSec(true) - stageStart;
+	stageStart = ::getUSec(true);
+
+	uint8_t* blocks = (uint8_t*)tf_malloc((size_t)dataSize);
+	ASSERT(blocks);
+
+	TextureEncodeJob job = {};
+	job.mips = mips;
+	job.mipCount = mipCount;
+	job.format = format;
+	job.blocks = blocks;
+	job.rowCount = rowCount;
+
+	// The calling thread works too, so we only spawn (workerCount - 1) threads
+	uint32_t workerCount = TF_MIN(TF_MAX(::getNumCPUCores(), 1u), rowCount);
+	workerCount = TF_MIN(TF_MIN(workerCount, settings->maxWorkerCount), k_TextureCookerMaxWorkers);
+	workerCount = TF_MAX(workerCount, 1u);
+	::ThreadHandle threads[k_TextureCookerMaxWorkers] = {};
+	for (uint32_t i = 1; i < workerCount; ++i)
+	{
+		::ThreadDesc threadDesc = {};
+		threadDesc.pFunc = encodeTextureRows;
+		threadDesc.pData = &job;
+		snprintf(threadDesc.mThreadName, sizeof(threadDesc.mThreadName), "TextureCook %u", i);
+		::initThread(&threadDesc, &threads[i]);
+	}
+
+	encodeTextureRows(&job);
+
+	for (uint32_t i = 1; i < workerCount; ++i)
+	{
+		::joinThread(threads[i]);
+	}
+	stats->encodeTime = ::getUSec(true) - stageStart;
+
+	const bool success = writeDDS(outputPath, mips, mipCount, format, blocks, dataSize);
+
+	tf_free(blocks);
+	tf_free(mipPixels);
+	stbi_image_free(sourcePixels);
+
+	stats->width = (uint32_t)width;
+	stats->height = (uint32_t)height;
+	stats->mipCount = mipCount;
+	stats->workerCount = workerCount;
+	stats->totalTime = ::getUSec(true) - cookStart;
+
+	return success;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Native texture cooker: reads a PNG/TGA/JPG, builds its mip chain and writes a BC compressed DDS
+// (DX10 header), like the texconv invocations of the texture rules in Tools/AssetCooker/rules.lua did.
+// Blocks of every mip are compressed on all cores.
+
+const uint32_t k_TextureCookDefaultMipCount = 8;
+const uint32_t k_TextureCookerMaxWorkers = 64;
+
+enum class TextureCookFormat
+{
+	BC1_SRGB = 0,
+	BC1,
+	BC5,
+
+	_Count,
+};
+
+struct TextureCookSettings
+{
+	TextureCookFormat format = TextureCookFormat::BC1_SRGB;
+	// NOTE(gmodarelli): Like texconv -srgb, the source is treated as sRGB: mips are filtered in linear
+	// space and written back with the sRGB curve, even when the format isn't an sRGB one.
+	// BC5 textures are normal maps, their mips are renormalized instead.
+	bool srgb = true;
+	// Clamped to the full mip chain of the texture
+	uint32_t mipCount = k_TextureCookDefaultMipCount;
+	uint32_t maxWorkerCount = UINT32_MAX;
+};
+
+struct TextureCookStats
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipCount = 0;
+	uint32_t blockCount = 0;
+	uint32_t workerCount = 0;
+
+	int64_t loadTime = 0;			// stb_image
+	int64_t mipsTime = 0;
+	int64_t encodeTime = 0;
+	int64_t totalTime = 0;
+};
+
+// Picks the settings of a source texture from its name suffix (_albedo, _emissive, _orm, _normal),
+// matching the texture rules. Returns false if no rule matches.
+bool GetTextureCookSettings(const char* path, TextureCookSettings* settings);
+bool ParseTextureCookFormat(const char* name, TextureCookFormat* format);
+const char* GetTextureCookFormatName(TextureCookFormat format);
+
+bool CookTexture(const char* inputPath, const char* outputPath, const TextureCookSettings* settings, TextureCookStats* stats = NULL);
+
+// Block encoders, 16 RGBA8 pixels in row order in, one 8-byte block out.
+// BC1 ignores alpha and always uses the 4-color mode.
+void EncodeBC1Block(const uint8_t* rgba, uint8_t* block);
+// Encodes one channel of 16 RGBA8 pixels (0 = R, 1 = G, ...)
+void EncodeBC4Block(const uint8_t* rgba, uint32_t channel, uint8_t* block);
@@ -0,0 +1,123 @@
+#include "TextureStreaming.h"
+
+#include "DdsFile.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+float ComputeTextureScreenSize(float objectRadius, float distance, float uvTiling, float projectionScale)
+{
+	// NOTE(gmodarelli): Measured at the closest point of the bounding sphere, the camera being inside
+	// the sphere counts as the closest allowed distance
+	const float minDistance = 0.01f;
+	const float projectedDiameter = 2.0f * objectRadius * projectionScale / fmaxf(distance, minDistance);
+	return projectedDiameter / fmaxf(uvTiling, 1.0f);
+}
+
+uint32_t ComputeRequiredTextureMip(uint32_t width, uint32_t height, uint32_t mipCount, float screenSize)
+{
+	ASSERT(mipCount > 0);
+	if (screenSize <= 1.0f)
+	{
+		return mipCount - 1;
+	}
+
+	const float texelsPerPixel = (float)(width > height ? width : height) / screenSize;
+	if (texelsPerPixel <= 1.0f)
+	{
+		return 0;
+	}
+
+	const uint32_t mip = (uint32_t)floorf(log2f(texelsPerPixel));
+	return mip < mipCount ? mip : mipCount - 1;
+}
+
+uint32_t ComputeTextureBaseMip(uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	ASSERT(mipCount > 0);
+	uint32_t mip = 0;
+	while (mip + 1 < mipCount && ((width >> mip) > k_TextureStreamingBaseMipSize || (height >> mip) > k_TextureStreamingBaseMipSize))
+	{
+		mip++;
+	}
+	return mip;
+}
+
+uint64_t ComputeStreamedTextureSize(const StreamedTexture& texture, uint32_t firstMip)
+{
+	return GetDdsMipTailSize(texture.width, texture.height, texture.mipCount, texture.blockSize, firstMip);
+}
+
+static int compareSortKeys(const void* a, const void* b)
+{
+	const uint64_t keyA = *(const uint64_t*)a;
+	const uint64_t keyB = *(const uint64_t*)b;
+	return keyA < keyB ? -1 : (keyA > keyB ? 1 : 0);
+}
+
+uint64_t SelectTextureMips(const StreamedTexture* textures, uint32_t textureCount, uint64_t budget, uint32_t* targetMips, uint32_t* order)
+{
+	uint64_t usedSize = 0;
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		const StreamedTexture& texture = textures[i];
+		targetMips[i] = ComputeTextureBaseMip(texture.width, texture.height, texture.mipCount);
+		usedSize += ComputeStreamedTextureSize(texture, targetMips[i]);
+	}
+
+	// NOTE(gmodarelli): Screen sizes are positive, so their bits sort like them. The inverted bits sort
+	// the largest first, and the index in the low bits keeps ties in the same order from frame to frame.
+	uint64_t* sortKeys = (uint64_t*)tf_malloc(sizeof(uint64_t) * TF_MAX(textureCount, 1u));
+	ASSERT(sortKeys);
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		uint32_t screenSizeBits = 0;
+		const float screenSize = fmaxf(textures[i].screenSize, 0.0f);
+		memcpy(&screenSizeBits, &screenSize, sizeof(screenSizeBits));
+		sortKeys[i] = ((uint64_t)~screenSizeBits << 32) | i;
+	}
+	qsort(sortKeys, textureCount, sizeof(uint64_t), compareSortKeys);
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		order[i] = (uint32_t)sortKeys[i];
+	}
+	tf_free(sortKeys);
+
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		const uint32_t textureIndex = order[i];
+		const StreamedTexture& texture = textures[textureIndex];
+		const uint32_t baseMip = targetMips[textureIndex];
+		if (texture.screenSize <= 0.0f)
+		{
+			// The rest of the textures isn't seen either
+			break;
+		}
+
+		uint32_t requiredMip = ComputeRequiredTextureMip(texture.width, texture.height, texture.mipCount, texture.screenSize);
+		if (requiredMip == texture.residentMip + 1)
+		{
+			requiredMip = texture.residentMip;
+		}
+
+		const uint64_t baseSize = ComputeStreamedTextureSize(texture, baseMip);
+		for (uint32_t mip = requiredMip; mip < baseMip; ++mip)
+		{
+			const uint64_t size = ComputeStreamedTextureSize(texture, mip);
+			if (usedSize + (size - baseSize) <= budget)
+			{
+				targetMips[textureIndex] = mip;
+				usedSize += size - baseSize;
+				break;
+			}
+		}
+	}
+
+	return usedSize;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Mip selection of the texture streaming (see UpdateTextureStreaming in Renderer.cpp). CPU only, it
+// doesn't depend on the renderer, so it can be exercised without a GPU
+// (see Tests/TextureStreamingTests.cpp).
+//
+// Every streamed texture keeps the mips [residentMip, mipCount) in memory. It never drops below its
+// base mip, the first mip no larger than k_TextureStreamingBaseMipSize, which is what gets loaded first.
+// Every frame the mip each texture needs is estimated from how large it gets on screen, and
+// SelectTextureMips grants the finer mips to the largest textures on screen first, within a budget.
+
+// NOTE(gmodarelli): 64x64 BC1 mips weigh 2 KB (2.7 KB with their own mips), so thousands of textures
+// fit in a few MB before any of them is seen
+const uint32_t k_TextureStreamingBaseMipSize = 64;
+
+struct StreamedTexture
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+	// Bytes per 4x4 block
+	uint32_t blockSize;
+	// First mip in memory
+	uint32_t residentMip;
+	// Largest number of pixels a unit of UV space covers on screen over the frame, 0 when the
+	// texture isn't seen. Textures covering more pixels get their mips first.
+	float screenSize;
+};
+
+// Pixels a unit of UV space covers on screen, for a material tiling its UVs uvTiling times over an
+// object of radius objectRadius at distance from the camera. projectionScale is the number of pixels
+// of a unit-sized object at distance 1 (viewport width / (2 * tan(fovX / 2))).
+// NOTE(gmodarelli): The UVs are assumed to span the object once, which holds for unwrapped meshes.
+float ComputeTextureScreenSize(float objectRadius, float distance, float uvTiling, float projectionScale);
+
+// First mip of a width x height texture to sample to get about one texel per pixel over screenSize pixels
+uint32_t ComputeRequiredTextureMip(uint32_t width, uint32_t height, uint32_t mipCount, float screenSize);
+
+// First mip no larger than k_TextureStreamingBaseMipSize
+uint32_t ComputeTextureBaseMip(uint32_t width, uint32_t height, uint32_t mipCount);
+
+// Bytes of the mips [firstMip, mipCount) of a texture
+uint64_t ComputeStreamedTextureSize(const StreamedTexture& texture, uint32_t firstMip);
+
+// Picks the first mip of every texture (targetMips) so that the textures fit in budget bytes.
+// Base mips always stay in memory, even past the budget. Then, from the largest texture on screen to
+// the smallest one, every texture gets the finest mip it requires that still fits, so far textures
+// are the first to lose their mips when the budget runs out.
+// A texture keeps a resident mip one level finer than it requires (hysteresis), so it doesn't stream
+// in and out when it sits on a mip boundary.
+// order receives the textures sorted by priority (most important first), it can be used to schedule
+// the loads. Returns the bytes used by the selected mips.
+uint64_t SelectTextureMips(const StreamedTexture* textures, uint32_t textureCount, uint64_t budget, uint32_t* targetMips, uint32_t* order);
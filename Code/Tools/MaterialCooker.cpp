@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../MappedFile.h"
+#include "../MaterialFile.h"
+
+// The-Forge
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// MaterialCooker: cooks a source material library (*.materials) into the *.matlib file loaded by the
+// renderer. Invoked by the AssetCooker (see Tools/AssetCooker/rules.lua).
+//
+// A source library lists materials, one "material <name>" line each, followed by the values that
+// differ from the defaults (see GetDefaultMaterialParameters), one "<key> <values>" line each:
+//
+//   material Grid
+//       roughnessFactor 1.0
+//       albedoTexture Textures/Debug/Grid_albedo.dds
+//
+// Keys are the names of the MaterialParameters fields, plus albedoTexture, normalTexture, ormTexture
+// and emissiveTexture. Texture paths are relative to the content directory. Empty lines and lines
+// starting with '#' are skipped.
+//
+// Usage: MaterialCooker.exe <input.materials> <output.matlib>
+
+struct MaterialKey
+{
+	const char* name;
+	size_t offset;
+	uint32_t valueCount;
+};
+
+static const MaterialKey k_MaterialKeys[] = {
+	{ "baseColor", offsetof(MaterialParameters, baseColor), 4 },
+	{ "normalIntensity", offsetof(MaterialParameters, normalIntensity), 1 },
+	{ "occlusionFactor", offsetof(MaterialParameters, occlusionFactor), 1 },
+	{ "roughnessFactor", offsetof(MaterialParameters, roughnessFactor), 1 },
+	{ "metalnessFactor", offsetof(MaterialParameters, metalnessFactor), 1 },
+	{ "emissiveFactor", offsetof(MaterialParameters, emissiveFactor), 1 },
+	{ "reflectance", offsetof(MaterialParameters, reflectance), 1 },
+	{ "uv0Tiling", offsetof(MaterialParameters, uv0Tiling), 2 },
+};
+
+static const char* k_MaterialTextureKeys[(uint32_t)MaterialFileTexture::_Count] = {
+	"albedoTexture",
+	"normalTexture",
+	"ormTexture",
+	"emissiveTexture",
+};
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+// Splits a line into whitespace-separated tokens, in place. Returns the number of tokens.
+static uint32_t tokenizeLine(char* line, char** tokens, uint32_t maxTokenCount)
+{
+	uint32_t tokenCount = 0;
+	while (*line != '\0')
+	{
+		while (isSpace(*line))
+		{
+			*line++ = '\0';
+		}
+
+		if (*line == '\0')
+		{
+			break;
+		}
+
+		if (tokenCount == maxTokenCount)
+		{
+			return maxTokenCount + 1;
+		}
+
+		tokens[tokenCount++] = line;
+		while (*line != '\0' && !isSpace(*line))
+		{
+			line++;
+		}
+	}
+
+	return tokenCount;
+}
+
+static bool parseMaterialValue(MaterialDesc* material, char** tokens, uint32_t tokenCount)
+{
+	for (uint32_t i = 0; i < TF_ARRAY_COUNT(k_MaterialTextureKeys); ++i)
+	{
+		if (strcmp(tokens[0], k_MaterialTextureKeys[i]) == 0)
+		{
+			if (tokenCount != 2)
+			{
+				return false;
+			}
+			material->texturePaths[i] = tokens[1];
+			return true;
+		}
+	}
+
+	for (uint32_t i = 0; i < TF_ARRAY_COUNT(k_MaterialKeys); ++i)
+	{
+		const MaterialKey& key = k_MaterialKeys[i];
+		if (strcmp(tokens[0], key.name) != 0)
+		{
+			continue;
+		}
+
+		if (tokenCount != key.valueCount + 1)
+		{
+			return false;
+		}
+
+		float* values = (float*)((uint8_t*)&material->parameters + key.offset);
+		for (uint32_t j = 0; j < key.valueCount; ++j)
+		{
+			char* end = NULL;
+			values[j] = strtof(tokens[j + 1], &end);
+			if (end == tokens[j + 1] || *end != '\0')
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+// Parses a source library. The source buffer is modified in place, names and paths point into it.
+static bool parseMaterialLibrary(const char* path, char* source, MaterialDesc* materials, uint32_t maxMaterialCount, uint32_t* materialCount)
+{
+	*materialCount = 0;
+	uint32_t lineNumber = 0;
+	char* line = source;
+	while (*line != '\0')
+	{
+		lineNumber++;
+		char* lineEnd = line;
+		while (*lineEnd != '\0' && *lineEnd != '\n' && *lineEnd != '\r')
+		{
+			lineEnd++;
+		}
+		char* next = *lineEnd != '\0' ? lineEnd + 1 : lineEnd;
+		if (*lineEnd == '\r' && *next == '\n')
+		{
+			next++;
+		}
+		*lineEnd = '\0';
+
+		char* tokens[8] = {};
+		const uint32_t tokenCount = tokenizeLine(line, tokens, TF_ARRAY_COUNT(tokens));
+		line = next;
+
+		if (tokenCount == 0 || tokens[0][0] == '#')
+		{
+			continue;
+		}
+
+		if (strcmp(tokens[0], "material") == 0)
+		{
+			if (tokenCount != 2)
+			{
+				LOGF(eERROR, "%s(%u): Expected 'material <name>'", path, lineNumber);
+				return false;
+			}
+
+			ASSERT(*materialCount < maxMaterialCount);
+			MaterialDesc* material = &materials[(*materialCount)++];
+			*material = {};
+			material->name = tokens[1];
+			material->parameters = GetDefaultMaterialParameters();
+			continue;
+		}
+
+		if (*materialCount == 0)
+		{
+			LOGF(eERROR, "%s(%u): '%s' is outside of a material", path, lineNumber, tokens[0]);
+			return false;
+		}
+
+		if (!parseMaterialValue(&materials[*materialCount - 1], tokens, tokenCount))
+		{
+			LOGF(eERROR, "%s(%u): Invalid value '%s'", path, lineNumber, tokens[0]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: MaterialCooker <input.materials> <output.matlib>\n");
+		return 1;
+	}
+
+	const char* inputPath = argv[1];
+	const char* outputPath = argv[2];
+
+	if (!::initMemAlloc("MaterialCooker"))
+	{
+		fprintf(stderr, "Couldn't initialize the memory allocator\n");
+		return 1;
+	}
+
+	FileSystemInitDesc fsDesc = FileSystemInitDesc{};
+	fsDesc.pAppName = "MaterialCooker";
+	if (!::initFileSystem(&fsDesc))
+	{
+		fprintf(stderr, "Couldn't initialize the file system\n");
+		::exitMemAlloc();
+		return 1;
+	}
+
+	::initLog("MaterialCooker", LogLevel::eALL);
+
+	bool success = false;
+	MappedFile sourceFile = {};
+	if (MapFile(inputPath, &sourceFile))
+	{
+		// The mapping is read-only, the source is parsed in a copy
+		const size_t sourceSize = (size_t)sourceFile.size;
+		char* source = (char*)tf_malloc(sourceSize + 1);
+		ASSERT(source);
+		memcpy(source, sourceFile.data, sourceSize);
+		source[sourceSize] = '\0';
+		UnmapFile(&sourceFile);
+
+		// Every material takes at least the 11 bytes of "material x\n"
+		const uint32_t maxMaterialCount = (uint32_t)(sourceSize / 11 + 1);
+		MaterialDesc* materials = (MaterialDesc*)tf_malloc(sizeof(MaterialDesc) * maxMaterialCount);
+		ASSERT(materials);
+
+		uint32_t materialCount = 0;
+		uint32_t uniqueMaterialCount = 0;
+		success = parseMaterialLibrary(inputPath, source, materials, maxMaterialCount, &materialCount);
+		success = success && WriteMaterialFile(outputPath, materials, materialCount, &uniqueMaterialCount);
+
+		if (success)
+		{
+			LOGF(eINFO, "Cooked '%s': %u materials (%u unique)", outputPath, materialCount, uniqueMaterialCount);
+		}
+
+		tf_free(materials);
+		tf_free(source);
+	}
+	else
+	{
+		LOGF(eERROR, "Couldn't read material library '%s'", inputPath);
+	}
+
+	::exitLog();
+	::exitFileSystem();
+	::exitMemAlloc();
+
+	return success ? 0 : 1;
+}
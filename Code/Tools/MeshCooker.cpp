@@ -0,0 +1,137 @@
+#include <stdio.h>
+
+#include "../MeshCache.h"
+#include "../MeshFile.h"
+#include "../MeshImporter.h"
+
+// The-Forge
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// MeshCooker: imports a source OBJ and writes the cooked *.mesh file loaded by the renderer.
+// Invoked by the AssetCooker (see Tools/AssetCooker/rules.lua). Meshes found in the import cache
+// (see MeshCache.h) are copied from it instead of being imported again.
+//
+// Usage: MeshCooker.exe <input.obj> <output.mesh>
+
+static bool copyFile(const char* sourcePath, const char* destinationPath)
+{
+	FILE* source = fopen(sourcePath, "rb");
+	if (!source)
+	{
+		return false;
+	}
+
+	FILE* destination = fopen(destinationPath, "wb");
+	if (!destination)
+	{
+		LOGF(eERROR, "Couldn't open '%s' for writing", destinationPath);
+		fclose(source);
+		return false;
+	}
+
+	char buffer[64 * 1024];
+	bool success = true;
+	size_t readSize = 0;
+	while (success && (readSize = fread(buffer, 1, sizeof(buffer), source)) > 0)
+	{
+		success = fwrite(buffer, 1, readSize, destination) == readSize;
+	}
+	success = success && ferror(source) == 0;
+
+	fclose(source);
+	fclose(destination);
+
+	if (!success)
+	{
+		remove(destinationPath);
+	}
+
+	return success;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: MeshCooker <input.obj> <output.mesh>\n");
+		return 1;
+	}
+
+	const char* inputPath = argv[1];
+	const char* outputPath = argv[2];
+
+	if (!::initMemAlloc("MeshCooker"))
+	{
+		fprintf(stderr, "Couldn't initialize the memory allocator\n");
+		return 1;
+	}
+
+	FileSystemInitDesc fsDesc = FileSystemInitDesc{};
+	fsDesc.pAppName = "MeshCooker";
+	if (!::initFileSystem(&fsDesc))
+	{
+		fprintf(stderr, "Couldn't initialize the file system\n");
+		::exitMemAlloc();
+		return 1;
+	}
+
+	::initLog("MeshCooker", LogLevel::eALL);
+
+	// Cached meshes are mesh files already, so they're copied as they are
+	uint64_t key = 0;
+	const bool hasKey = ComputeMeshImportKey(inputPath, &key);
+	char cachePath[FS_MAX_PATH] = {};
+	MeshFile cachedMesh = {};
+	if (hasKey)
+	{
+		GetMeshCachePath(key, cachePath, sizeof(cachePath));
+	}
+
+	if (hasKey && OpenMeshFileFromPath(cachePath, &cachedMesh))
+	{
+		CloseMeshFile(&cachedMesh);
+		if (copyFile(cachePath, outputPath))
+		{
+			LOGF(eINFO, "Cooked '%s' from the import cache ('%s')", inputPath, cachePath);
+			::exitLog();
+			::exitFileSystem();
+			::exitMemAlloc();
+			return 0;
+		}
+	}
+
+	// NOTE(gmodarelli): The mesh is written straight from the imported geometry, so there's no
+	// upper bound on its size other than the memory available.
+	ScratchGeometryData scratch = {};
+	ImportedMesh importedMesh = {};
+	bool success = ImportMesh(inputPath, &scratch, &importedMesh);
+	if (success)
+	{
+		success = WriteMeshFile(outputPath, &importedMesh.geometry, &importedMesh.mesh);
+	}
+
+	if (success)
+	{
+		const GPUMesh& mesh = importedMesh.mesh;
+		LOGF(eINFO, "Cooked '%s': %u vertices, %u indices, %u meshlets, %u LODs (scratch high-water mark: %.2f MB)",
+			inputPath, mesh.vertexCount, mesh.indexCount, mesh.meshletCount, mesh.lodCount,
+			scratch.arena.highWaterMark / (1024.0 * 1024.0));
+
+		if (hasKey)
+		{
+			StoreCachedMesh(key, &importedMesh);
+		}
+	}
+
+	DestroyImportedMesh(&importedMesh);
+	scratch.destroy();
+
+	::exitLog();
+	::exitFileSystem();
+	::exitMemAlloc();
+
+	return success ? 0 : 1;
+}
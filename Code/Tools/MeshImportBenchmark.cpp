@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <dirent.h>
+#include <sys/resource.h>
+#endif
+
+#include "../MeshImporter.h"
+
+// The-Forge
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// MeshImportBenchmark: runs the mesh import pipeline (ImportMesh) over every OBJ file of a directory
+// and reports the wall time of each stage as CSV. It doesn't create a renderer, so it runs headless.
+//
+// Usage: MeshImportBenchmark <directory> [iterations] [output.csv]
+//
+// Times are the average over the iterations, in milliseconds. verts_per_sec counts the vertices
+// before indexing (3 per triangle). peak_rss_mb is the peak resident memory of the process so far.
+
+const uint32_t k_BenchmarkMaxFiles = 4096;
+
+struct BenchmarkFiles
+{
+	char* paths[k_BenchmarkMaxFiles];
+	uint32_t count;
+};
+
+static bool hasObjExtension(const char* fileName)
+{
+	size_t length = strlen(fileName);
+	if (length < 4)
+	{
+		return false;
+	}
+
+	const char* extension = fileName + length - 4;
+	return extension[0] == '.' &&
+		(extension[1] == 'o' || extension[1] == 'O') &&
+		(extension[2] == 'b' || extension[2] == 'B') &&
+		(extension[3] == 'j' || extension[3] == 'J');
+}
+
+static void addBenchmarkFile(BenchmarkFiles* files, const char* directory, const char* fileName)
+{
+	if (files->count == k_BenchmarkMaxFiles)
+	{
+		LOGF(eWARNING, "More than %u OBJ files in '%s', skipping '%s'", k_BenchmarkMaxFiles, directory, fileName);
+		return;
+	}
+
+	char path[FS_MAX_PATH] = {};
+	snprintf(path, sizeof(path), "%s/%s", directory, fileName);
+	size_t size = strlen(path) + 1;
+	files->paths[files->count] = (char*)tf_malloc(size);
+	memcpy(files->paths[files->count], path, size);
+	files->count++;
+}
+
+static int compareBenchmarkFiles(const void* a, const void* b)
+{
+	return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static bool listObjFiles(const char* directory, BenchmarkFiles* files)
+{
+	files->count = 0;
+
+#if defined(_WIN32)
+	char pattern[FS_MAX_PATH] = {};
+	snprintf(pattern, sizeof(pattern), "%s\\*.obj", directory);
+
+	WIN32_FIND_DATAA findData = {};
+	HANDLE findHandle = FindFirstFileA(pattern, &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+	{
+		return GetLastError() == ERROR_FILE_NOT_FOUND;
+	}
+
+	do
+	{
+		if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && hasObjExtension(findData.cFileName))
+		{
+			addBenchmarkFile(files, directory, findData.cFileName);
+		}
+	} while (FindNextFileA(findHandle, &findData));
+	FindClose(findHandle);
+#else
+	DIR* dir = opendir(directory);
+	if (!dir)
+	{
+		return false;
+	}
+
+	while (struct dirent* entry = readdir(dir))
+	{
+		if (entry->d_type != DT_DIR && hasObjExtension(entry->d_name))
+		{
+			addBenchmarkFile(files, directory, entry->d_name);
+		}
+	}
+	closedir(dir);
+#endif
+
+	// Stable order, so runs can be diffed
+	qsort(files->paths, files->count, sizeof(char*), compareBenchmarkFiles);
+	return true;
+}
+
+static double getPeakResidentMemoryMB()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+	}
+	return 0.0;
+#else
+	struct rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		// NOTE: ru_maxrss is in kilobytes on Linux
+		return usage.ru_maxrss / 1024.0;
+	}
+	return 0.0;
+#endif
+}
+
+static void accumulateStats(MeshImportStats* sum, const MeshImportStats& stats)
+{
+	sum->sourceVertexCount = stats.sourceVertexCount;
+	sum->parsedInParallel = stats.parsedInParallel;
+	sum->parseTime += stats.parseTime;
+	sum->expandTime += stats.expandTime;
+	sum->tangentsTime += stats.tangentsTime;
+	sum->packTime += stats.packTime;
+	sum->remapTime += stats.remapTime;
+	sum->optimizeTime += stats.optimizeTime;
+	sum->analyzeTime += stats.analyzeTime;
+	sum->meshletsTime += stats.meshletsTime;
+	sum->lodsTime += stats.lodsTime;
+	sum->totalTime += stats.totalTime;
+}
+
+static void writeCsvRow(FILE* output, const char* name, const MeshImportStats& sum, uint64_t sourceVertexCount, uint32_t vertexCount, uint32_t triangleCount, uint32_t iterations, double scratchPeakMB)
+{
+	// Microseconds summed over the iterations to average milliseconds
+	const double scale = 1.0 / (1000.0 * iterations);
+	const double totalSeconds = sum.totalTime / 1000000.0;
+	const double verticesPerSecond = totalSeconds > 0.0 ? (double)sourceVertexCount * iterations / totalSeconds : 0.0;
+
+	fprintf(output, "%s,%llu,%u,%u,%u,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f,%.2f,%.2f\n",
+		name, (unsigned long long)sourceVertexCount, vertexCount, triangleCount, iterations, sum.parsedInParallel ? "parallel" : "fast_obj",
+		sum.parseTime * scale, sum.expandTime * scale, sum.tangentsTime * scale, sum.packTime * scale,
+		sum.remapTime * scale, sum.optimizeTime * scale, sum.analyzeTime * scale, sum.meshletsTime * scale,
+		sum.lodsTime * scale, sum.totalTime * scale, verticesPerSecond, scratchPeakMB, getPeakResidentMemoryMB());
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || argc > 4)
+	{
+		fprintf(stderr, "Usage: MeshImportBenchmark <directory> [iterations] [output.csv]\n");
+		return 1;
+	}
+
+	const char* directory = argv[1];
+	const int iterationsArg = argc > 2 ? atoi(argv[2]) : 1;
+	const char* outputPath = argc > 3 ? argv[3] : NULL;
+	if (iterationsArg <= 0)
+	{
+		fprintf(stderr, "Invalid iteration count '%s'\n", argv[2]);
+		return 1;
+	}
+	const uint32_t iterations = (uint32_t)iterationsArg;
+
+	if (!::initMemAlloc("MeshImportBenchmark"))
+	{
+		fprintf(stderr, "Couldn't initialize the memory allocator\n");
+		return 1;
+	}
+
+	FileSystemInitDesc fsDesc = FileSystemInitDesc{};
+	fsDesc.pAppName = "MeshImportBenchmark";
+	if (!::initFileSystem(&fsDesc))
+	{
+		fprintf(stderr, "Couldn't initialize the file system\n");
+		::exitMemAlloc();
+		return 1;
+	}
+
+	// NOTE(gmodarelli): The importer logs optimization stats for every mesh, which would
+	// interleave with the CSV and skew the timings
+	::initLog("MeshImportBenchmark", LogLevel::eWARNING);
+
+	BenchmarkFiles* files = (BenchmarkFiles*)tf_malloc(sizeof(BenchmarkFiles));
+	ASSERT(files);
+	bool success = listObjFiles(directory, files);
+	if (!success)
+	{
+		LOGF(eERROR, "Couldn't open directory '%s'", directory);
+	}
+
+	FILE* output = stdout;
+	if (success && outputPath)
+	{
+		output = fopen(outputPath, "w");
+		if (!output)
+		{
+			LOGF(eERROR, "Couldn't open '%s' for writing", outputPath);
+			success = false;
+		}
+	}
+
+	if (success)
+	{
+		fprintf(output, "file,source_vertices,vertices,triangles,iterations,parser,parse_ms,expand_ms,tangents_ms,pack_ms,remap_ms,optimize_ms,analyze_ms,meshlets_ms,lods_ms,total_ms,verts_per_sec,scratch_peak_mb,peak_rss_mb\n");
+
+		// NOTE(gmodarelli): Imports run on this thread only, so every stage is timed without
+		// contention. The scratch is shared by all imports, like on an import worker.
+		ScratchGeometryData scratch = {};
+		MeshImportStats allSum = {};
+		uint64_t allSourceVertexCount = 0;
+		uint32_t allVertexCount = 0;
+		uint32_t allTriangleCount = 0;
+		uint32_t failedCount = 0;
+
+		for (uint32_t fileIndex = 0; fileIndex < files->count; ++fileIndex)
+		{
+			const char* path = files->paths[fileIndex];
+			MeshImportStats sum = {};
+			uint32_t vertexCount = 0;
+			uint32_t triangleCount = 0;
+			bool imported = true;
+
+			for (uint32_t iteration = 0; iteration < iterations && imported; ++iteration)
+			{
+				ImportedMesh importedMesh = {};
+				imported = ImportMesh(path, &scratch, &importedMesh);
+				if (imported)
+				{
+					accumulateStats(&sum, importedMesh.stats);
+					vertexCount = importedMesh.mesh.vertexCount;
+					triangleCount = importedMesh.mesh.lods[0].indexCount / 3;
+				}
+				DestroyImportedMesh(&importedMesh);
+			}
+
+			if (!imported)
+			{
+				LOGF(eERROR, "Couldn't import '%s'", path);
+				failedCount++;
+				continue;
+			}
+
+			writeCsvRow(output, path, sum, sum.sourceVertexCount, vertexCount, triangleCount, iterations, scratch.arena.highWaterMark / (1024.0 * 1024.0));
+			fflush(output);
+
+			accumulateStats(&allSum, sum);
+			allSourceVertexCount += sum.sourceVertexCount;
+			allVertexCount += vertexCount;
+			allTriangleCount += triangleCount;
+		}
+
+		writeCsvRow(output, "total", allSum, allSourceVertexCount, allVertexCount, allTriangleCount, iterations, scratch.arena.highWaterMark / (1024.0 * 1024.0));
+
+		scratch.destroy();
+		success = failedCount == 0;
+	}
+
+	if (output && output != stdout)
+	{
+		fclose(output);
+	}
+
+	for (uint32_t i = 0; i < files->count; ++i)
+	{
+		tf_free(files->paths[i]);
+	}
+	tf_free(files);
+
+	::exitLog();
+	::exitFileSystem();
+	::exitMemAlloc();
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../MappedFile.h"
+#include "../PakFile.h"
+
+// The-Forge
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// PakCooker: packs the cooked files listed in a pak manifest (*.pakmanifest) into the *.pak file
+// loaded by the renderer. Invoked by the AssetCooker (see Tools/AssetCooker/rules.lua).
+//
+// A manifest lists one path per line, relative to the content directory. Empty lines and lines
+// starting with '#' are skipped. The files are stored in the order they're listed.
+// With -d, a Make dependency file listing the packed files is written, so the AssetCooker cooks
+// the pak again when one of them changes.
+//
+// Usage: PakCooker.exe [-c] [-d <dep file>] <manifest> <content directory> <output.pak>
+
+static void printUsage()
+{
+	fprintf(stderr, "Usage: PakCooker [-c] [-d <dep file>] <manifest> <content directory> <output.pak>\n");
+}
+
+// Splits a manifest into its paths. The manifest buffer is modified in place, paths point into it.
+static uint32_t parseManifest(char* manifest, const char** paths, uint32_t maxPathCount)
+{
+	uint32_t pathCount = 0;
+	char* line = manifest;
+	while (*line != '\0')
+	{
+		char* lineEnd = line;
+		while (*lineEnd != '\0' && *lineEnd != '\n' && *lineEnd != '\r')
+		{
+			lineEnd++;
+		}
+		char* next = *lineEnd != '\0' ? lineEnd + 1 : lineEnd;
+
+		// Trim the line
+		while (line < lineEnd && (*line == ' ' || *line == '\t'))
+		{
+			line++;
+		}
+		while (lineEnd > line && (lineEnd[-1] == ' ' || lineEnd[-1] == '\t'))
+		{
+			lineEnd--;
+		}
+		*lineEnd = '\0';
+
+		if (line < lineEnd && *line != '#')
+		{
+			ASSERT(pathCount < maxPathCount);
+			paths[pathCount++] = line;
+		}
+
+		line = next;
+	}
+
+	return pathCount;
+}
+
+static bool writeDepFile(const char* depFilePath, const char* outputPath, const char* contentDirectory, const char* const* paths, uint32_t pathCount)
+{
+	FILE* file = fopen(depFilePath, "wb");
+	if (!file)
+	{
+		LOGF(eERROR, "Couldn't create dependency file '%s'", depFilePath);
+		return false;
+	}
+
+	bool success = fprintf(file, "%s:", outputPath) > 0;
+	for (uint32_t i = 0; success && i < pathCount; ++i)
+	{
+		success = fprintf(file, " \\\n  %s/%s", contentDirectory, paths[i]) > 0;
+	}
+	success = success && fprintf(file, "\n") > 0;
+	fclose(file);
+
+	if (!success)
+	{
+		LOGF(eERROR, "Couldn't write dependency file '%s'", depFilePath);
+		remove(depFilePath);
+	}
+
+	return success;
+}
+
+int main(int argc, char** argv)
+{
+	bool compress = false;
+	const char* depFilePath = NULL;
+	const char* paths[3] = {};
+	uint32_t pathCount = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-c") == 0)
+		{
+			compress = true;
+		}
+		else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+		{
+			depFilePath = argv[++i];
+		}
+		else if (argv[i][0] != '-' && pathCount < 3)
+		{
+			paths[pathCount++] = argv[i];
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	if (pathCount != 3)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const char* manifestPath = paths[0];
+	const char* contentDirectory = paths[1];
+	const char* outputPath = paths[2];
+
+	if (!::initMemAlloc("PakCooker"))
+	{
+		fprintf(stderr, "Couldn't initialize the memory allocator\n");
+		return 1;
+	}
+
+	FileSystemInitDesc fsDesc = FileSystemInitDesc{};
+	fsDesc.pAppName = "PakCooker";
+	if (!::initFileSystem(&fsDesc))
+	{
+		fprintf(stderr, "Couldn't initialize the file system\n");
+		::exitMemAlloc();
+		return 1;
+	}
+
+	::initLog("PakCooker", LogLevel::eALL);
+
+	bool success = false;
+	MappedFile manifestFile = {};
+	if (MapFile(manifestPath, &manifestFile))
+	{
+		// The mapping is read-only, the paths are split in a copy
+		const size_t manifestSize = (size_t)manifestFile.size;
+		char* manifest = (char*)tf_malloc(manifestSize + 1);
+		ASSERT(manifest);
+		memcpy(manifest, manifestFile.data, manifestSize);
+		manifest[manifestSize] = '\0';
+		UnmapFile(&manifestFile);
+
+		// Every path takes at least two bytes of the manifest
+		const uint32_t maxEntryCount = (uint32_t)(manifestSize / 2 + 1);
+		const char** entryPaths = (const char**)tf_malloc(sizeof(const char*) * maxEntryCount);
+		ASSERT(entryPaths);
+
+		const uint32_t entryCount = parseManifest(manifest, entryPaths, maxEntryCount);
+
+		PakWriteStats stats = {};
+		success = WritePakFile(outputPath, contentDirectory, entryPaths, entryCount, compress, &stats);
+		if (success && depFilePath)
+		{
+			success = writeDepFile(depFilePath, outputPath, contentDirectory, entryPaths, entryCount);
+		}
+
+		if (success)
+		{
+			LOGF(eINFO, "Cooked '%s': %u files (%u compressed), %.2f MB -> %.2f MB",
+				outputPath, stats.entryCount, stats.compressedEntryCount,
+				stats.inputSize / (1024.0 * 1024.0), stats.outputSize / (1024.0 * 1024.0));
+		}
+
+		tf_free(entryPaths);
+		tf_free(manifest);
+	}
+	else
+	{
+		LOGF(eERROR, "Couldn't read pak manifest '%s'", manifestPath);
+	}
+
+	::exitLog();
+	::exitFileSystem();
+	::exitMemAlloc();
+
+	return success ? 0 : 1;
+}
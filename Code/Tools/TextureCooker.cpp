@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../TextureCooker.h"
+
+// The-Forge
+
+#include <Utilities/Interfaces/IFileSystem.h>
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+// TextureCooker: compresses a source PNG/TGA/JPG into the *.dds file loaded by the renderer.
+// Invoked by the AssetCooker (see Tools/AssetCooker/rules.lua). The format and the sRGB filtering
+// come from the name suffix of the texture unless they are given on the command line.
+//
+// Usage: TextureCooker.exe [-f BC1_UNORM_SRGB|BC1_UNORM|BC5_UNORM] [-srgb] [-m <mip count>] [-j <threads>] <input> <output.dds>
+
+static void printUsage()
+{
+	fprintf(stderr, "Usage: TextureCooker [-f BC1_UNORM_SRGB|BC1_UNORM|BC5_UNORM] [-srgb] [-m <mip count>] [-j <threads>] <input> <output.dds>\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* formatName = NULL;
+	bool srgb = false;
+	uint32_t mipCount = k_TextureCookDefaultMipCount;
+	uint32_t maxWorkerCount = UINT32_MAX;
+	const char* paths[2] = {};
+	uint32_t pathCount = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+		{
+			formatName = argv[++i];
+		}
+		else if (strcmp(argv[i], "-srgb") == 0)
+		{
+			srgb = true;
+		}
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+		{
+			mipCount = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			maxWorkerCount = (uint32_t)atoi(argv[++i]);
+		}
+		else if (argv[i][0] != '-' && pathCount < 2)
+		{
+			paths[pathCount++] = argv[i];
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	if (pathCount != 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const char* inputPath = paths[0];
+	const char* outputPath = paths[1];
+
+	TextureCookSettings settings = {};
+	if (formatName)
+	{
+		if (!ParseTextureCookFormat(formatName, &settings.format))
+		{
+			fprintf(stderr, "Unsupported format '%s'\n", formatName);
+			return 1;
+		}
+		settings.srgb = srgb;
+	}
+	else if (!GetTextureCookSettings(inputPath, &settings))
+	{
+		fprintf(stderr, "No texture rule matches '%s', pass the format with -f\n", inputPath);
+		return 1;
+	}
+	settings.mipCount = mipCount;
+	settings.maxWorkerCount = maxWorkerCount;
+
+	if (!::initMemAlloc("TextureCooker"))
+	{
+		fprintf(stderr, "Couldn't initialize the memory allocator\n");
+		return 1;
+	}
+
+	FileSystemInitDesc fsDesc = FileSystemInitDesc{};
+	fsDesc.pAppName = "TextureCooker";
+	if (!::initFileSystem(&fsDesc))
+	{
+		fprintf(stderr, "Couldn't initialize the file system\n");
+		::exitMemAlloc();
+		return 1;
+	}
+
+	::initLog("TextureCooker", LogLevel::eALL);
+
+	TextureCookStats stats = {};
+	const bool success = CookTexture(inputPath, outputPath, &settings, &stats);
+	if (success)
+	{
+		LOGF(eINFO, "Cooked '%s': %ux%u %s, %u mips, %u blocks on %u workers (load %.2f ms, mips %.2f ms, encode %.2f ms, total %.2f ms)",
+			inputPath, stats.width, stats.height, GetTextureCookFormatName(settings.format), stats.mipCount, stats.blockCount, stats.workerCount,
+			stats.loadTime / 1000.0, stats.mipsTime / 1000.0, stats.encodeTime / 1000.0, stats.totalTime / 1000.0);
+	}
+
+	::exitLog();
+	::exitFileSystem();
+	::exitMemAlloc();
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <math.h>
+#include <string.h>
+
+// Math
+#include <Utilities/Math/MathTypes.h>
+
+// Encoders for the packed attributes of MeshVertex. The matching decoders used by the
+// shaders live in ShaderGlobals.h, the C++ ones below are only used to validate the encoding.
+//
+//   normal:  octahedral, 2x 16-bit snorm
+//   tangent: 10:10:10:2 snorm, w holds the bitangent sign
+//   uv:      2x half float
+//   color:   RGBA8 unorm
+
+// NOTE: Bump this every time the layout of MeshVertex or the encoding of its attributes changes.
+// It is part of the key of the mesh import cache (see MeshCache.h).
+const uint32_t k_MeshVertexLayoutVersion = 1;
+
+// Max error of a unit vector after the round-trip, in radians
+const float k_PackedNormalMaxError = 0.001f;
+const float k_PackedTangentMaxError = 0.005f;
+
+inline float packingClamp(float value, float minValue, float maxValue)
+{
+	return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+}
+
+inline float packingSign(float value)
+{
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// NOTE(gmodarelli): NaN fails every comparison of packingClamp, the encoders map it to 0 before
+// clamping so that the casts to integers below are always defined
+inline uint32_t PackSnorm(float value, uint32_t bits)
+{
+	const float scale = (float)((1u << (bits - 1)) - 1);
+	float clamped = value == value ? packingClamp(value, -1.0f, 1.0f) : 0.0f;
+	int32_t quantized = (int32_t)roundf(clamped * scale);
+	return (uint32_t)quantized & ((1u << bits) - 1);
+}
+
+inline float UnpackSnorm(uint32_t value, uint32_t bits)
+{
+	const float scale = (float)((1u << (bits - 1)) - 1);
+	// Sign-extend
+	int32_t quantized = (int32_t)(value << (32 - bits)) >> (32 - bits);
+	return packingClamp((float)quantized / scale, -1.0f, 1.0f);
+}
+
+inline uint32_t PackUnorm8(float value)
+{
+	float clamped = value == value ? packingClamp(value, 0.0f, 1.0f) : 0.0f;
+	return (uint32_t)roundf(clamped * 255.0f);
+}
+
+inline float UnpackUnorm8(uint32_t value)
+{
+	return (float)(value & 0xFF) / 255.0f;
+}
+
+// Round-to-nearest float to half conversion. Values out of the half range are clamped to
+// the largest finite half, which is fine for texture coordinates.
+inline uint32_t PackHalf(float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x007FFFFF;
+
+	if (exponent <= 0)
+	{
+		// Denormals
+		if (exponent < -10)
+		{
+			return sign;
+		}
+
+		mantissa |= 0x00800000;
+		uint32_t shift = (uint32_t)(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+		{
+			half++;
+		}
+		return sign | half;
+	}
+
+	if (exponent >= 31)
+	{
+		return sign | 0x7BFF;
+	}
+
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		// May carry into the exponent, which is still the correctly rounded value
+		half++;
+	}
+
+	return sign | TF_MIN(half, 0x7BFFu);
+}
+
+inline float UnpackHalf(uint32_t value)
+{
+	uint32_t sign = (value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	uint32_t bits = 0;
+	if (exponent == 0)
+	{
+		float result = (float)mantissa / (float)(1 << 24);
+		return sign ? -result : result;
+	}
+	else if (exponent == 31)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+
+	float result = 0.0f;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+// Vectors without a direction (zero, or with NaN components) are packed as +Z
+inline uint32_t PackOctahedral(float3 n)
+{
+	float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (!(l1 > 0.0f))
+	{
+		return PackSnorm(0.0f, 16) | (PackSnorm(0.0f, 16) << 16);
+	}
+
+	// Divided rather than multiplied by the inverse, which overflows for denormal vectors
+	float x = n.x / l1;
+	float y = n.y / l1;
+	if (n.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * packingSign(x);
+		float foldedY = (1.0f - fabsf(x)) * packingSign(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	return PackSnorm(x, 16) | (PackSnorm(y, 16) << 16);
+}
+
+inline float3 UnpackOctahedral(uint32_t packed)
+{
+	float x = UnpackSnorm(packed & 0xFFFF, 16);
+	float y = UnpackSnorm(packed >> 16, 16);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - fabsf(y)) * packingSign(x);
+		float unfoldedY = (1.0f - fabsf(x)) * packingSign(y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+	return { x * invLength, y * invLength, z * invLength };
+}
+
+inline uint32_t PackTangent(float4 t)
+{
+	uint32_t w = t.w < 0.0f ? 0x3u : 0x1u; // -1 or +1 as a 2-bit snorm
+	return PackSnorm(t.x, 10) | (PackSnorm(t.y, 10) << 10) | (PackSnorm(t.z, 10) << 20) | (w << 30);
+}
+
+inline float4 UnpackTangent(uint32_t packed)
+{
+	float x = UnpackSnorm(packed & 0x3FF, 10);
+	float y = UnpackSnorm((packed >> 10) & 0x3FF, 10);
+	float z = UnpackSnorm((packed >> 20) & 0x3FF, 10);
+	float w = UnpackSnorm(packed >> 30, 2);
+
+	float length = sqrtf(x * x + y * y + z * z);
+	float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+	return { x * invLength, y * invLength, z * invLength, w };
+}
+
+inline uint32_t PackTexcoord(float2 uv)
+{
+	return PackHalf(uv.x) | (PackHalf(uv.y) << 16);
+}
+
+inline float2 UnpackTexcoord(uint32_t packed)
+{
+	return { UnpackHalf(packed & 0xFFFF), UnpackHalf(packed >> 16) };
+}
+
+inline uint32_t PackColor(float3 color)
+{
+	return PackUnorm8(color.x) | (PackUnorm8(color.y) << 8) | (PackUnorm8(color.z) << 16) | (0xFFu << 24);
+}
+
+inline float3 UnpackColor(uint32_t packed)
+{
+	return { UnpackUnorm8(packed), UnpackUnorm8(packed >> 8), UnpackUnorm8(packed >> 16) };
+}
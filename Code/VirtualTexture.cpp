@@ -0,0 +1,513 @@
+#include "VirtualTexture.h"
+
+#include "TextureStreaming.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The-Forge
+
+#include <Utilities/Interfaces/ILog.h>
+#include <Utilities/Interfaces/IMemory.h>
+
+const uint32_t k_NoSlot = UINT32_MAX;
+const uint32_t k_MaxFeedbackCount = 0x0FFFFFFF;
+
+static bool isPowerOfTwo(uint32_t value)
+{
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
+static uint32_t mipWidthInPages(const VirtualTexture& texture, uint32_t mip)
+{
+	return TF_MAX(texture.widthInPages >> mip, 1u);
+}
+
+static uint32_t mipHeightInPages(const VirtualTexture& texture, uint32_t mip)
+{
+	return TF_MAX(texture.heightInPages >> mip, 1u);
+}
+
+// Index of a page in the page tables of its virtual texture, or UINT32_MAX when the page id is invalid
+static uint32_t findPage(const VirtualTextureSystem* system, uint32_t pageId)
+{
+	const uint32_t textureIndex = GetVirtualPageTexture(pageId);
+	if (textureIndex >= system->textureCount || !system->textures[textureIndex].used)
+	{
+		return UINT32_MAX;
+	}
+
+	const VirtualTexture& texture = system->textures[textureIndex];
+	const uint32_t mip = GetVirtualPageMip(pageId);
+	const uint32_t x = GetVirtualPageX(pageId);
+	const uint32_t y = GetVirtualPageY(pageId);
+	if (mip >= texture.mipCount || x >= mipWidthInPages(texture, mip) || y >= mipHeightInPages(texture, mip))
+	{
+		return UINT32_MAX;
+	}
+
+	return texture.mipOffsets[mip] + y * mipWidthInPages(texture, mip) + x;
+}
+
+static void removeFromLru(VirtualTextureSystem* system, uint32_t slotIndex)
+{
+	VirtualPageSlot* slot = &system->slots[slotIndex];
+	if (slot->previous != k_NoSlot)
+	{
+		system->slots[slot->previous].next = slot->next;
+	}
+	else
+	{
+		system->lruHead = slot->next;
+	}
+
+	if (slot->next != k_NoSlot)
+	{
+		system->slots[slot->next].previous = slot->previous;
+	}
+	else
+	{
+		system->lruTail = slot->previous;
+	}
+
+	slot->previous = k_NoSlot;
+	slot->next = k_NoSlot;
+}
+
+static void addToLru(VirtualTextureSystem* system, uint32_t slotIndex)
+{
+	VirtualPageSlot* slot = &system->slots[slotIndex];
+	slot->previous = k_NoSlot;
+	slot->next = system->lruHead;
+	if (system->lruHead != k_NoSlot)
+	{
+		system->slots[system->lruHead].previous = slotIndex;
+	}
+	else
+	{
+		system->lruTail = slotIndex;
+	}
+	system->lruHead = slotIndex;
+}
+
+static void freeSlot(VirtualTextureSystem* system, uint32_t slotIndex)
+{
+	VirtualPageSlot* slot = &system->slots[slotIndex];
+	slot->pageId = k_VirtualTextureNoPage;
+	slot->state = VirtualPageState::Free;
+	slot->locked = false;
+	system->freeSlots[system->freeSlotCount++] = slotIndex;
+}
+
+// Takes a free slot, or evicts the least recently used page not sampled this frame. Returns k_NoSlot
+// when every slot is in use this frame.
+static uint32_t acquireSlot(VirtualTextureSystem* system)
+{
+	if (system->freeSlotCount > 0)
+	{
+		return system->freeSlots[--system->freeSlotCount];
+	}
+
+	const uint32_t slotIndex = system->lruTail;
+	if (slotIndex == k_NoSlot || system->slots[slotIndex].lastUsedFrame == system->frame)
+	{
+		return k_NoSlot;
+	}
+
+	const VirtualPageSlot& slot = system->slots[slotIndex];
+	ASSERT(slot.state == VirtualPageState::Resident && !slot.locked);
+	VirtualTexture* texture = &system->textures[GetVirtualPageTexture(slot.pageId)];
+	texture->slots[findPage(system, slot.pageId)] = k_VirtualTextureNoPage;
+	texture->pageTableDirty = true;
+	removeFromLru(system, slotIndex);
+	return slotIndex;
+}
+
+static int compareKeys(const void* a, const void* b)
+{
+	const uint64_t keyA = *(const uint64_t*)a;
+	const uint64_t keyB = *(const uint64_t*)b;
+	return keyA < keyB ? -1 : (keyA > keyB ? 1 : 0);
+}
+
+// Sorts (page id << 32 | count) keys and merges the ones of the same page. Returns the number of pages.
+static uint64_t mergeFeedbackKeys(uint64_t* keys, uint64_t keyCount)
+{
+	qsort(keys, (size_t)keyCount, sizeof(uint64_t), compareKeys);
+
+	uint64_t pageCount = 0;
+	for (uint64_t i = 0; i < keyCount; ++i)
+	{
+		if (pageCount > 0 && (keys[pageCount - 1] >> 32) == (keys[i] >> 32))
+		{
+			const uint64_t count = TF_MIN((keys[pageCount - 1] & 0xFFFFFFFF) + (keys[i] & 0xFFFFFFFF), (uint64_t)k_MaxFeedbackCount);
+			keys[pageCount - 1] = (keys[i] & 0xFFFFFFFF00000000ull) | count;
+		}
+		else
+		{
+			keys[pageCount++] = keys[i];
+		}
+	}
+	return pageCount;
+}
+
+bool InitVirtualTextureSystem(VirtualTextureSystem* system, uint32_t atlasWidth, uint32_t atlasHeight)
+{
+	memset(system, 0, sizeof(VirtualTextureSystem));
+
+	const uint64_t slotCount = (uint64_t)atlasWidth * atlasHeight;
+	if (slotCount == 0 || slotCount > 0xFFFFFF)
+	{
+		LOGF(eERROR, "Virtual texture atlas of %ux%u pages is not supported", atlasWidth, atlasHeight);
+		return false;
+	}
+
+	system->atlasWidth = atlasWidth;
+	system->atlasHeight = atlasHeight;
+	system->slotCount = (uint32_t)slotCount;
+	system->slots = (VirtualPageSlot*)tf_malloc(sizeof(VirtualPageSlot) * system->slotCount);
+	system->freeSlots = (uint32_t*)tf_malloc(sizeof(uint32_t) * system->slotCount);
+	ASSERT(system->slots && system->freeSlots);
+
+	system->lruHead = k_NoSlot;
+	system->lruTail = k_NoSlot;
+	// NOTE(gmodarelli): Free slots are taken from the end, so the first pages fill the atlas from its first slot
+	for (uint32_t i = system->slotCount; i > 0; --i)
+	{
+		VirtualPageSlot* slot = &system->slots[i - 1];
+		slot->previous = k_NoSlot;
+		slot->next = k_NoSlot;
+		slot->lastUsedFrame = 0;
+		freeSlot(system, i - 1);
+	}
+
+	return true;
+}
+
+void ExitVirtualTextureSystem(VirtualTextureSystem* system)
+{
+	for (uint32_t i = 0; i < system->textureCount; ++i)
+	{
+		if (system->textures[i].used)
+		{
+			tf_free(system->textures[i].slots);
+			tf_free(system->textures[i].pageTable);
+		}
+	}
+
+	tf_free(system->slots);
+	tf_free(system->freeSlots);
+	tf_free(system->feedbackKeys);
+	memset(system, 0, sizeof(VirtualTextureSystem));
+}
+
+uint32_t AddVirtualTexture(VirtualTextureSystem* system, uint32_t width, uint32_t height)
+{
+	const uint32_t maxSize = k_VirtualTexturePageSize << (k_VirtualTextureMaxMipCount - 1);
+	if (width < k_VirtualTexturePageSize || height < k_VirtualTexturePageSize || width > maxSize || height > maxSize || !isPowerOfTwo(width) || !isPowerOfTwo(height))
+	{
+		LOGF(eERROR, "Virtual textures of %ux%u texels are not supported, sizes must be powers of two between %u and %u", width, height, k_VirtualTexturePageSize, maxSize);
+		return k_InvalidVirtualTexture;
+	}
+
+	uint32_t textureIndex = 0;
+	while (textureIndex < system->textureCount && system->textures[textureIndex].used)
+	{
+		textureIndex++;
+	}
+
+	if (textureIndex == k_VirtualTexturesMaxCount)
+	{
+		LOGF(eERROR, "Too many virtual textures, k_VirtualTexturesMaxCount (%u) is too small", k_VirtualTexturesMaxCount);
+		return k_InvalidVirtualTexture;
+	}
+
+	VirtualTexture* texture = &system->textures[textureIndex];
+	*texture = {};
+	texture->used = true;
+	texture->widthInPages = width / k_VirtualTexturePageSize;
+	texture->heightInPages = height / k_VirtualTexturePageSize;
+
+	// Mips down to the one fitting in a single page
+	texture->mipCount = 1;
+	while ((texture->widthInPages >> (texture->mipCount - 1)) > 1 || (texture->heightInPages >> (texture->mipCount - 1)) > 1)
+	{
+		texture->mipCount++;
+	}
+
+	for (uint32_t mip = 0; mip < texture->mipCount; ++mip)
+	{
+		texture->mipOffsets[mip] = texture->pageCount;
+		texture->pageCount += mipWidthInPages(*texture, mip) * mipHeightInPages(*texture, mip);
+	}
+
+	texture->slots = (uint32_t*)tf_malloc(sizeof(uint32_t) * texture->pageCount);
+	texture->pageTable = (uint32_t*)tf_malloc(sizeof(uint32_t) * texture->pageCount);
+	ASSERT(texture->slots && texture->pageTable);
+	for (uint32_t i = 0; i < texture->pageCount; ++i)
+	{
+		texture->slots[i] = k_VirtualTextureNoPage;
+	}
+	texture->pageTableDirty = true;
+
+	system->textureCount = TF_MAX(system->textureCount, textureIndex + 1);
+	return textureIndex;
+}
+
+void RemoveVirtualTexture(VirtualTextureSystem* system, uint32_t textureIndex)
+{
+	if (textureIndex >= system->textureCount || !system->textures[textureIndex].used)
+	{
+		return;
+	}
+
+	VirtualTexture* texture = &system->textures[textureIndex];
+	for (uint32_t i = 0; i < texture->pageCount; ++i)
+	{
+		const uint32_t slotIndex = texture->slots[i];
+		if (slotIndex == k_VirtualTextureNoPage)
+		{
+			continue;
+		}
+
+		VirtualPageSlot* slot = &system->slots[slotIndex];
+		if (slot->state == VirtualPageState::Loading)
+		{
+			// NOTE(gmodarelli): The slot is freed when its load completes, it doesn't match its request anymore
+			slot->pageId = k_VirtualTextureNoPage;
+			continue;
+		}
+
+		if (!slot->locked)
+		{
+			removeFromLru(system, slotIndex);
+		}
+		freeSlot(system, slotIndex);
+	}
+
+	tf_free(texture->slots);
+	tf_free(texture->pageTable);
+	*texture = {};
+}
+
+uint32_t ProcessVirtualTextureFeedback(VirtualTextureSystem* system, const uint32_t* pageIds, uint32_t pageIdCount, VirtualTextureLoadRequest* requests, uint32_t maxRequestCount)
+{
+	system->frame++;
+
+	// Every sampled page can add its parents
+	const uint64_t capacity = (uint64_t)TF_MAX(pageIdCount, 1u) * k_VirtualTextureMaxMipCount;
+	if (system->feedbackCapacity < capacity)
+	{
+		tf_free(system->feedbackKeys);
+		system->feedbackKeys = (uint64_t*)tf_malloc(sizeof(uint64_t) * capacity);
+		ASSERT(system->feedbackKeys);
+		system->feedbackCapacity = capacity;
+	}
+
+	// Sampled pages with the number of times they're sampled
+	uint64_t* keys = system->feedbackKeys;
+	uint64_t keyCount = 0;
+	for (uint32_t i = 0; i < pageIdCount; ++i)
+	{
+		if (findPage(system, pageIds[i]) != UINT32_MAX)
+		{
+			keys[keyCount++] = ((uint64_t)pageIds[i] << 32) | 1;
+		}
+	}
+	const uint64_t sampledPageCount = mergeFeedbackKeys(keys, keyCount);
+
+	// NOTE(gmodarelli): Parents get the samples of their children, so they're kept at least as long
+	// as them and the least recently used pages are always the finest ones
+	keyCount = sampledPageCount;
+	for (uint64_t i = 0; i < sampledPageCount; ++i)
+	{
+		const uint32_t pageId = (uint32_t)(keys[i] >> 32);
+		const uint32_t textureIndex = GetVirtualPageTexture(pageId);
+		const uint32_t mipCount = system->textures[textureIndex].mipCount;
+		uint32_t x = GetVirtualPageX(pageId);
+		uint32_t y = GetVirtualPageY(pageId);
+		for (uint32_t mip = GetVirtualPageMip(pageId) + 1; mip < mipCount; ++mip)
+		{
+			x >>= 1;
+			y >>= 1;
+			keys[keyCount++] = ((uint64_t)MakeVirtualPageId(textureIndex, mip, x, y) << 32) | (keys[i] & 0xFFFFFFFF);
+		}
+	}
+	const uint64_t pageCount = mergeFeedbackKeys(keys, keyCount);
+
+	// Resident pages move to the front of the LRU list, missing ones are kept with their priority
+	uint64_t missingPageCount = 0;
+	for (uint64_t i = 0; i < pageCount; ++i)
+	{
+		const uint32_t pageId = (uint32_t)(keys[i] >> 32);
+		const uint32_t count = (uint32_t)(keys[i] & 0xFFFFFFFF);
+		const VirtualTexture& texture = system->textures[GetVirtualPageTexture(pageId)];
+		const uint32_t slotIndex = texture.slots[findPage(system, pageId)];
+		if (slotIndex == k_VirtualTextureNoPage)
+		{
+			// Coarsest mips first, then most sampled pages first
+			const uint64_t mipPriority = k_VirtualTextureMaxMipCount - 1 - GetVirtualPageMip(pageId);
+			keys[missingPageCount++] = (mipPriority << 60) | ((uint64_t)(k_MaxFeedbackCount - count) << 32) | pageId;
+			continue;
+		}
+
+		VirtualPageSlot* slot = &system->slots[slotIndex];
+		if (slot->state == VirtualPageState::Resident)
+		{
+			slot->lastUsedFrame = system->frame;
+			if (!slot->locked)
+			{
+				removeFromLru(system, slotIndex);
+				addToLru(system, slotIndex);
+			}
+		}
+	}
+	qsort(keys, (size_t)missingPageCount, sizeof(uint64_t), compareKeys);
+
+	uint32_t requestCount = 0;
+	for (uint64_t i = 0; i < missingPageCount && requestCount < maxRequestCount; ++i)
+	{
+		const uint32_t slotIndex = acquireSlot(system);
+		if (slotIndex == k_NoSlot)
+		{
+			break;
+		}
+
+		const uint32_t pageId = (uint32_t)keys[i];
+		VirtualPageSlot* slot = &system->slots[slotIndex];
+		slot->pageId = pageId;
+		slot->state = VirtualPageState::Loading;
+		slot->locked = false;
+		slot->lastUsedFrame = system->frame;
+		system->textures[GetVirtualPageTexture(pageId)].slots[findPage(system, pageId)] = slotIndex;
+
+		VirtualTextureLoadRequest* request = &requests[requestCount++];
+		request->pageId = pageId;
+		request->slot = slotIndex;
+		request->atlasX = slotIndex % system->atlasWidth;
+		request->atlasY = slotIndex / system->atlasWidth;
+	}
+
+	return requestCount;
+}
+
+void CompleteVirtualTexturePageLoad(VirtualTextureSystem* system, const VirtualTextureLoadRequest& request, bool loaded)
+{
+	ASSERT(request.slot < system->slotCount);
+	VirtualPageSlot* slot = &system->slots[request.slot];
+	ASSERT(slot->state == VirtualPageState::Loading);
+
+	// The virtual texture of the page was removed while it was loading
+	if (slot->pageId != request.pageId)
+	{
+		freeSlot(system, request.slot);
+		return;
+	}
+
+	VirtualTexture* texture = &system->textures[GetVirtualPageTexture(request.pageId)];
+	const uint32_t pageIndex = findPage(system, request.pageId);
+	if (!loaded)
+	{
+		// NOTE(gmodarelli): The page is requested again the next time it's sampled
+		texture->slots[pageIndex] = k_VirtualTextureNoPage;
+		freeSlot(system, request.slot);
+		return;
+	}
+
+	slot->state = VirtualPageState::Resident;
+	slot->locked = GetVirtualPageMip(request.pageId) == texture->mipCount - 1;
+	if (!slot->locked)
+	{
+		addToLru(system, request.slot);
+	}
+	texture->pageTableDirty = true;
+}
+
+const uint32_t* GetVirtualTexturePageTable(VirtualTextureSystem* system, uint32_t textureIndex)
+{
+	if (textureIndex >= system->textureCount || !system->textures[textureIndex].used)
+	{
+		return NULL;
+	}
+
+	VirtualTexture* texture = &system->textures[textureIndex];
+	if (!texture->pageTableDirty)
+	{
+		return texture->pageTable;
+	}
+
+	// From the coarsest mip down, pages without a resident page of their own take the entry of their parent
+	for (uint32_t mip = texture->mipCount; mip > 0; --mip)
+	{
+		const uint32_t mipWidth = mipWidthInPages(*texture, mip - 1);
+		const uint32_t mipHeight = mipHeightInPages(*texture, mip - 1);
+		for (uint32_t y = 0; y < mipHeight; ++y)
+		{
+			for (uint32_t x = 0; x < mipWidth; ++x)
+			{
+				const uint32_t pageIndex = texture->mipOffsets[mip - 1] + y * mipWidth + x;
+				const uint32_t slotIndex = texture->slots[pageIndex];
+				if (slotIndex != k_VirtualTextureNoPage && system->slots[slotIndex].state == VirtualPageState::Resident)
+				{
+					texture->pageTable[pageIndex] = ((mip - 1) << 24) | slotIndex;
+				}
+				else if (mip == texture->mipCount)
+				{
+					texture->pageTable[pageIndex] = k_VirtualTextureNoPage;
+				}
+				else
+				{
+					const uint32_t parentWidth = mipWidthInPages(*texture, mip);
+					texture->pageTable[pageIndex] = texture->pageTable[texture->mipOffsets[mip] + (y >> 1) * parentWidth + (x >> 1)];
+				}
+			}
+		}
+	}
+
+	texture->pageTableDirty = false;
+	return texture->pageTable;
+}
+
+uint32_t GenerateVirtualTexturePlaneFeedback(const VirtualTextureSystem* system, uint32_t textureIndex, const VirtualTexturePlaneView& view, uint32_t* pageIds, uint32_t maxPageIdCount)
+{
+	if (textureIndex >= system->textureCount || !system->textures[textureIndex].used || view.samplesPerSide == 0)
+	{
+		return 0;
+	}
+
+	const VirtualTexture& texture = system->textures[textureIndex];
+	const uint32_t width = texture.widthInPages * k_VirtualTexturePageSize;
+	const uint32_t height = texture.heightInPages * k_VirtualTexturePageSize;
+
+	uint32_t pageIdCount = 0;
+	for (uint32_t sampleY = 0; sampleY < view.samplesPerSide; ++sampleY)
+	{
+		for (uint32_t sampleX = 0; sampleX < view.samplesPerSide && pageIdCount < maxPageIdCount; ++sampleX)
+		{
+			const float u = ((float)sampleX + 0.5f) / (float)view.samplesPerSide;
+			const float v = ((float)sampleY + 0.5f) / (float)view.samplesPerSide;
+
+			const float toSample[3] = {
+				view.planeCenter[0] + (u - 0.5f) * view.planeSize - view.cameraPosition[0],
+				view.planeCenter[1] - view.cameraPosition[1],
+				view.planeCenter[2] + (v - 0.5f) * view.planeSize - view.cameraPosition[2],
+			};
+			const float distance = sqrtf(toSample[0] * toSample[0] + toSample[1] * toSample[1] + toSample[2] * toSample[2]);
+			const float cosAngle = (toSample[0] * view.cameraForward[0] + toSample[1] * view.cameraForward[1] + toSample[2] * view.cameraForward[2]) / fmaxf(distance, 1e-6f);
+			if (cosAngle < view.cosHalfFov)
+			{
+				continue;
+			}
+
+			// The texture spans the plane once
+			const float screenSize = ComputeTextureScreenSize(view.planeSize * 0.5f, distance, 1.0f, view.projectionScale);
+			const uint32_t mip = ComputeRequiredTextureMip(width, height, texture.mipCount, screenSize);
+			const uint32_t pageX = TF_MIN((uint32_t)(u * (float)mipWidthInPages(texture, mip)), mipWidthInPages(texture, mip) - 1);
+			const uint32_t pageY = TF_MIN((uint32_t)(v * (float)mipHeightInPages(texture, mip)), mipHeightInPages(texture, mip) - 1);
+			pageIds[pageIdCount++] = MakeVirtualPageId(textureIndex, mip, pageX, pageY);
+		}
+	}
+
+	return pageIdCount;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Page management of the sparse virtual textures. CPU only, it doesn't depend on the renderer, so it
+// can be exercised without a GPU (see Tests/VirtualTextureTests.cpp).
+//
+// A virtual texture is split in pages of k_VirtualTexturePageSize texels, mip by mip, down to the mip
+// that fits in a single page. Only the pages something looks at live in memory, in the slots of a
+// physical page cache (an atlas of atlasWidth x atlasHeight pages shared by all the virtual textures),
+// so memory follows the texel density on screen instead of the size of the authored textures.
+//
+// Every frame the pages sampled on screen (the feedback, read back from the GPU or generated on the
+// CPU, see GenerateVirtualTexturePlaneFeedback) go through ProcessVirtualTextureFeedback, which keeps
+// the resident ones alive and turns the missing ones into load requests, evicting the least recently
+// used pages to make room. Once the texels of a request are in its slot of the atlas,
+// CompleteVirtualTexturePageLoad maps the page.
+//
+// The page table of every virtual texture has one entry per page, the cache slot of the finest
+// resident page covering it (see GetVirtualTexturePageTable). Missing pages fall back to their coarser
+// mips, and the single page of the coarsest mip never leaves the cache once loaded.
+
+// NOTE(gmodarelli): 128x128 BC1 pages weigh 8 KB, a 32x32 pages atlas (4096x4096 texels) weighs 8 MB
+const uint32_t k_VirtualTexturePageSize = 128;
+const uint32_t k_VirtualTexturesMaxCount = 256;
+// Up to 1024x1024 pages (128K x 128K texels) per virtual texture
+const uint32_t k_VirtualTextureMaxMipCount = 11;
+const uint32_t k_InvalidVirtualTexture = UINT32_MAX;
+// Page table entries of pages without any resident page covering them
+const uint32_t k_VirtualTextureNoPage = UINT32_MAX;
+
+// Page ids, as written by the feedback: virtual texture (8 bits), mip (4 bits), y (10 bits), x (10 bits)
+inline uint32_t MakeVirtualPageId(uint32_t textureIndex, uint32_t mip, uint32_t x, uint32_t y)
+{
+	return (textureIndex << 24) | (mip << 20) | (y << 10) | x;
+}
+
+inline uint32_t GetVirtualPageTexture(uint32_t pageId)
+{
+	return pageId >> 24;
+}
+
+inline uint32_t GetVirtualPageMip(uint32_t pageId)
+{
+	return (pageId >> 20) & 0xF;
+}
+
+inline uint32_t GetVirtualPageY(uint32_t pageId)
+{
+	return (pageId >> 10) & 0x3FF;
+}
+
+inline uint32_t GetVirtualPageX(uint32_t pageId)
+{
+	return pageId & 0x3FF;
+}
+
+// Page table entries: mip of the page (8 bits) and its cache slot (24 bits)
+inline uint32_t GetVirtualPageTableMip(uint32_t entry)
+{
+	return entry >> 24;
+}
+
+inline uint32_t GetVirtualPageTableSlot(uint32_t entry)
+{
+	return entry & 0xFFFFFF;
+}
+
+enum class VirtualPageState : uint8_t
+{
+	Free = 0,
+	Loading,
+	Resident,
+};
+
+// Slot of the physical page cache
+struct VirtualPageSlot
+{
+	uint32_t pageId;
+	VirtualPageState state;
+	// Pages of the coarsest mips are never evicted, they are what every other page falls back to
+	bool locked;
+	// Least recently used list of the evictable resident slots, UINT32_MAX at its ends
+	uint32_t previous;
+	uint32_t next;
+	uint64_t lastUsedFrame;
+};
+
+struct VirtualTexture
+{
+	bool used;
+	uint32_t widthInPages;
+	uint32_t heightInPages;
+	uint32_t mipCount;
+	// First page of every mip in the page tables, mips are stored row by row
+	uint32_t mipOffsets[k_VirtualTextureMaxMipCount];
+	uint32_t pageCount;
+	// Cache slot of every page, k_VirtualTextureNoPage for the pages that aren't resident
+	uint32_t* slots;
+	// What GetVirtualTexturePageTable returns, rebuilt when pages are mapped or evicted
+	uint32_t* pageTable;
+	bool pageTableDirty;
+};
+
+struct VirtualTextureSystem
+{
+	uint32_t atlasWidth;
+	uint32_t atlasHeight;
+	uint32_t slotCount;
+	VirtualPageSlot* slots;
+	uint32_t* freeSlots;
+	uint32_t freeSlotCount;
+	// Most recently used first
+	uint32_t lruHead;
+	uint32_t lruTail;
+
+	VirtualTexture textures[k_VirtualTexturesMaxCount];
+	uint32_t textureCount;
+
+	uint64_t frame;
+	// Scratch memory of ProcessVirtualTextureFeedback
+	uint64_t* feedbackKeys;
+	uint64_t feedbackCapacity;
+};
+
+// Page to load into a slot of the atlas
+struct VirtualTextureLoadRequest
+{
+	uint32_t pageId;
+	uint32_t slot;
+	// Position of the slot in the atlas, in pages
+	uint32_t atlasX;
+	uint32_t atlasY;
+};
+
+bool InitVirtualTextureSystem(VirtualTextureSystem* system, uint32_t atlasWidth, uint32_t atlasHeight);
+void ExitVirtualTextureSystem(VirtualTextureSystem* system);
+
+// Adds a virtual texture of width x height texels, both power-of-two multiples of
+// k_VirtualTexturePageSize. Returns its index, to be used in page ids, or k_InvalidVirtualTexture.
+uint32_t AddVirtualTexture(VirtualTextureSystem* system, uint32_t width, uint32_t height);
+// Frees the slots of the pages of a virtual texture. Loads in flight are dropped when they complete.
+void RemoveVirtualTexture(VirtualTextureSystem* system, uint32_t textureIndex);
+
+// Turns the pages sampled this frame into load requests, the coarsest mips and the most sampled pages
+// first. Pages can appear any number of times in pageIds, invalid ones are skipped. Requested pages
+// get their parent pages requested too, so that they're always loaded coarse to fine.
+// Slots are taken from the free ones first, then from the least recently used pages not sampled this
+// frame. Requests stop when no slot is left, the next frames request the rest.
+// Returns the number of requests.
+uint32_t ProcessVirtualTextureFeedback(VirtualTextureSystem* system, const uint32_t* pageIds, uint32_t pageIdCount, VirtualTextureLoadRequest* requests, uint32_t maxRequestCount);
+
+// Maps the page of a request once its texels are in the atlas, or frees its slot when they couldn't be loaded
+void CompleteVirtualTexturePageLoad(VirtualTextureSystem* system, const VirtualTextureLoadRequest& request, bool loaded);
+
+// Page table of a virtual texture, pageCount entries laid out like VirtualTexture::slots. Every entry
+// holds the mip and the cache slot of the finest resident page covering its page.
+const uint32_t* GetVirtualTexturePageTable(VirtualTextureSystem* system, uint32_t textureIndex);
+
+// Stand-in for the GPU feedback of a square virtual texture mapped once over a horizontal plane
+// (e.g. the ground grid). The plane is sampled samplesPerSide x samplesPerSide times, samples outside
+// of the camera cone (cosHalfFov) are skipped and the others get the page of the mip they need
+// (see ComputeTextureScreenSize and ComputeRequiredTextureMip in TextureStreaming.h).
+struct VirtualTexturePlaneView
+{
+	float cameraPosition[3];
+	// Normalized
+	float cameraForward[3];
+	float cosHalfFov;
+	float projectionScale;
+	float planeCenter[3];
+	float planeSize;
+	uint32_t samplesPerSide;
+};
+// Returns the number of page ids written, at most maxPageIdCount
+uint32_t GenerateVirtualTexturePlaneFeedback(const VirtualTextureSystem* system, uint32_t textureIndex, const VirtualTexturePlaneView& view, uint32_t* pageIds, uint32_t maxPageIdCount);
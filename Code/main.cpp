@@ -36,6 +36,19 @@ struct AppState
 
 void game_UpdatePlayerMovement(AppState* appState);
 
+// Index of a material of the loaded libraries, or the first material when it's missing
+static uint32_t findMaterial(const char* name)
+{
+	const uint32_t materialIndex = renderer::FindMaterial(name);
+	if (materialIndex == renderer::k_InvalidMaterialIndex)
+	{
+		SDL_Log("Couldn't find material '%s'", name);
+		return 0;
+	}
+
+	return materialIndex;
+}
+
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 {
 	AppState* as = (AppState*)SDL_calloc(1, sizeof(AppState));
@@ -67,6 +80,27 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 		as->scene.playerLight.color = { 1.0f, 1.0f, 1.0f };
 		as->scene.playerLight.intensity = 10.0f;
 		as->scene.playerLight.range = 10.0f;
+	}
+
+	as->window = SDL_CreateWindow("Prototype 0", 1920, 1080, SDL_WINDOW_RESIZABLE);
+	if (!as->window)
+	{
+		SDL_Log("Couldn't create window: %s", SDL_GetError());
+		return SDL_APP_FAILURE;
+	}
+
+	SDL_PropertiesID properties = SDL_GetWindowProperties(as->window);
+	void* hwnd = SDL_GetPointerProperty(properties, SDL_PROP_WINDOW_WIN32_HWND_POINTER, NULL);
+	if (!renderer::Initialize(hwnd))
+	{
+		return SDL_APP_FAILURE;
+	}
+
+	// Materials are looked up by name, once the renderer has loaded the material library
+	{
+		const uint32_t grid = findMaterial("Grid");
+		const uint32_t damagedHelmet = findMaterial("DamagedHelmet");
+		as->scene.player.materialHandle = findMaterial("Player");
 
 		// Ground
 		as->scene.entities = (Entity*)SDL_calloc(1024, sizeof(Entity));
@@ -79,7 +113,7 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 				entity.position = { x + 0.5f, y + 0.5f, 0.0f };
 				entity.scale = { 1.0f, 1.0f, 1.0f };
 				entity.meshHandle = 0; // plane
-				entity.materialHandle = 1; // grid debug material
+				entity.materialHandle = grid;
 			}
 		}
 
@@ -89,24 +123,10 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 			entity.position = { -10.0f, -10.0f, 1.0f };
 			entity.scale = { 1.0f, 1.0f, 1.0f };
 			entity.meshHandle = 2; // damaged helmet
-			entity.materialHandle = 2; // grid debug material
+			entity.materialHandle = damagedHelmet;
 		}
 	}
 
-	as->window = SDL_CreateWindow("Prototype 0", 1920, 1080, SDL_WINDOW_RESIZABLE);
-	if (!as->window)
-	{
-		SDL_Log("Couldn't create window: %s", SDL_GetError());
-		return SDL_APP_FAILURE;
-	}
-
-	SDL_PropertiesID properties = SDL_GetWindowProperties(as->window);
-	void* hwnd = SDL_GetPointerProperty(properties, SDL_PROP_WINDOW_WIN32_HWND_POINTER, NULL);
-	if (!renderer::Initialize(hwnd))
-	{
-		return SDL_APP_FAILURE;
-	}
-
 	renderer::LoadScene(&as->scene);
 	
 	SDL_Log("Initialized");
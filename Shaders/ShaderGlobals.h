@@ -119,13 +119,61 @@ typedef struct { float m[16]; } float4x4;
 
 #define INVALID_BINDLESS_INDEX (uint)-1
 
+// NOTE(gmodarelli): Attributes are packed at import time (see Code/VertexPacking.h), use
+// UnpackMeshVertex to decode them in shaders.
+//   normal:  octahedral, 2x 16-bit snorm
+//   tangent: 10:10:10:2 snorm, w holds the bitangent sign
+//   uv:      2x half float
+//   color:   RGBA8 unorm
 struct MeshVertex
 {
     float3 position;
-    float3 normal;
-    float4 tangent;
-    float3 color;
-    float2 uv;
+    uint normal;
+    uint tangent;
+    uint uv;
+    uint color;
+};
+
+// NOTE(gmodarelli): MeshVertex is the import and file layout. The geometry pool splits it in a tightly
+// packed position stream (float3, at GPUMesh::positionOffset) and this attribute stream (at
+// GPUMesh::vertexOffset), so depth-only passes and acceleration structure builds only fetch positions.
+struct MeshVertexAttributes
+{
+    uint normal;
+    uint tangent;
+    uint uv;
+    uint color;
+};
+
+// NOTE(gmodarelli): Like indices, meshlet vertices are mesh-local (add GPUMesh::vertexOffset)
+// and meshlet offsets are relative to the mesh's meshletVertexOffset/meshletTriangleOffset.
+// Every meshlet triangle is packed in a uint, 8 bits per (meshlet-local) vertex.
+struct GPUMeshlet
+{
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+    float3 boundsCenter;
+    float boundsRadius;
+    float3 coneApex;
+    float coneCutoff;
+    float3 coneAxis;
+    float _pad0;
+};
+
+#define MESH_MAX_LODS 4
+// Meshes with up to this many vertices use the 16-bit index pool
+#define MESH_INDEX16_MAX_VERTICES 65536
+
+// NOTE(gmodarelli): LOD index ranges are relative to GPUMesh::indexOffset. LOD 0 is the full
+// mesh and error is the object space deviation of the simplified mesh from it.
+struct GPUMeshLod
+{
+    uint indexOffset;
+    uint indexCount;
+    float error;
+    uint _pad0;
 };
 
 struct GPUMesh
@@ -135,9 +183,35 @@ struct GPUMesh
     uint vertexOffset;
     uint vertexCount;
     float3 aabbMin;
-    float _pad1;
+    uint positionOffset;
     float3 aabbMax;
     float _pad2;
+    uint meshletOffset;
+    uint meshletCount;
+    uint meshletVertexOffset;
+    uint meshletTriangleOffset;
+    uint lodCount;
+    uint indexSize; // 2 or 4 bytes, selects the index pool
+    uint submeshOffset;
+    uint submeshCount;
+    GPUMeshLod lods[MESH_MAX_LODS];
+};
+
+// NOTE(gmodarelli): A submesh is the part of a mesh drawn with one material (an OBJ object/material
+// pair). Its indices are contiguous in every LOD of the mesh, LOD index ranges are relative to
+// GPUMesh::indexOffset and meshletOffset is relative to GPUMesh::meshletOffset.
+// materialSlot is added to GPUInstance::materialBufferIndex to get the material of the submesh.
+struct GPUSubmesh
+{
+    float3 aabbMin;
+    uint materialSlot;
+    float3 aabbMax;
+    uint meshletOffset;
+    uint meshletCount;
+    uint _pad0;
+    uint _pad1;
+    uint _pad2;
+    GPUMeshLod lods[MESH_MAX_LODS];
 };
 
 struct GPUMaterial
@@ -165,6 +239,13 @@ struct GPUInstance
     uint _pad1;
 };
 
+// Entry of the draw instance buffer, one per instance and submesh drawn
+struct GPUDrawInstance
+{
+    uint instanceIndex;
+    uint materialIndex;
+};
+
 struct GPULight
 {
     float3 position;
@@ -182,10 +263,12 @@ struct Frame
     float4 sunColor;
     uint meshBufferIndex;
     uint vertexBufferIndex;
+    uint positionBufferIndex;
     uint instanceBufferIndex;
     uint materialBufferIndex;
     uint lightBufferIndex;
     uint numLights;
+    uint drawInstanceBufferIndex;
 };
 
 struct DownsampleUniform
@@ -205,6 +288,51 @@ bool HasValidTexture(uint textureBindlessIndex)
     return textureBindlessIndex != INVALID_BINDLESS_INDEX;
 }
 
+struct UnpackedMeshVertex
+{
+    float3 position;
+    float3 normal;
+    float4 tangent;
+    float3 color;
+    float2 uv;
+};
+
+float2 UnpackSnorm16x2(uint packed)
+{
+    int2 quantized = int2(int(packed << 16) >> 16, int(packed) >> 16);
+    return clamp(float2(quantized) / 32767.0, -1.0, 1.0);
+}
+
+float3 UnpackOctahedral(uint packed)
+{
+    float2 f = UnpackSnorm16x2(packed);
+    float3 n = float3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    if (n.z < 0.0)
+    {
+        n.xy = (1.0 - abs(n.yx)) * select(n.xy >= 0.0, 1.0, -1.0);
+    }
+    return normalize(n);
+}
+
+float4 UnpackTangent(uint packed)
+{
+    int3 quantized = int3(int(packed << 22) >> 22, int(packed << 12) >> 22, int(packed << 2) >> 22);
+    float3 t = clamp(float3(quantized) / 511.0, -1.0, 1.0);
+    float w = (int(packed) >> 30) < 0 ? -1.0 : 1.0;
+    return float4(normalize(t), w);
+}
+
+UnpackedMeshVertex UnpackMeshVertex(float3 position, MeshVertexAttributes attributes)
+{
+    UnpackedMeshVertex result;
+    result.position = position;
+    result.normal = UnpackOctahedral(attributes.normal);
+    result.tangent = UnpackTangent(attributes.tangent);
+    result.uv = float2(f16tof32(attributes.uv & 0xFFFF), f16tof32(attributes.uv >> 16));
+    result.color = float3(attributes.color & 0xFF, (attributes.color >> 8) & 0xFF, (attributes.color >> 16) & 0xFF) / 255.0;
+    return result;
+}
+
 struct GBufferOutput
 {
     float4 GBuffer0 : SV_Target0;
@@ -4,11 +4,8 @@
 [RootSignature(DefaultRootSignature)]
 GBufferOutput main(Varyings varyings)
 {
-    ByteAddressBuffer instanceBuffer = ResourceDescriptorHeap[g_Frame.instanceBufferIndex];
-    GPUInstance instance = instanceBuffer.Load<GPUInstance>(varyings.instanceID * sizeof(GPUInstance));
-    
     ByteAddressBuffer materialBuffer = ResourceDescriptorHeap[g_Frame.materialBufferIndex];
-    GPUMaterial material = materialBuffer.Load<GPUMaterial>(instance.materialBufferIndex * sizeof(GPUMaterial));
+    GPUMaterial material = materialBuffer.Load<GPUMaterial>(varyings.materialIndex * sizeof(GPUMaterial));
     
     float2 uv0 = varyings.Texcoord0 * material.uv0Tiling;
     
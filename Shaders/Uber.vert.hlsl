@@ -3,13 +3,22 @@
 [RootSignature(DefaultRootSignature)]
 Varyings main(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID, uint startVertexLocation : SV_StartVertexLocation, uint startInstanceLocation : SV_StartInstanceLocation)
 {
-    uint instanceIndex = instanceID + startInstanceLocation;
+    // NOTE(gmodarelli): Draws are batched by submesh and LOD, so instances are fetched through the draw instance buffer
+    ByteAddressBuffer drawInstanceBuffer = ResourceDescriptorHeap[g_Frame.drawInstanceBufferIndex];
+    GPUDrawInstance drawInstance = drawInstanceBuffer.Load<GPUDrawInstance>((instanceID + startInstanceLocation) * sizeof(GPUDrawInstance));
+    uint instanceIndex = drawInstance.instanceIndex;
     ByteAddressBuffer instanceBuffer = ResourceDescriptorHeap[g_Frame.instanceBufferIndex];
     GPUInstance instance = instanceBuffer.Load<GPUInstance>(instanceIndex * sizeof(GPUInstance));
     
+    // NOTE(gmodarelli): Draws set the base vertex to GPUMesh::vertexOffset, positions live in their own stream
+    ByteAddressBuffer meshBuffer = ResourceDescriptorHeap[g_Frame.meshBufferIndex];
+    GPUMesh mesh = meshBuffer.Load<GPUMesh>(instance.meshIndex * sizeof(GPUMesh));
     uint vertexIndex = vertexID + startVertexLocation;
+    uint positionIndex = mesh.positionOffset + (vertexIndex - mesh.vertexOffset);
+    ByteAddressBuffer positionBuffer = ResourceDescriptorHeap[g_Frame.positionBufferIndex];
     ByteAddressBuffer vertexBuffer = ResourceDescriptorHeap[g_Frame.vertexBufferIndex];
-    MeshVertex vertex = vertexBuffer.Load<MeshVertex>(vertexIndex * sizeof(MeshVertex));
+    float3 position = positionBuffer.Load<float3>(positionIndex * sizeof(float3));
+    UnpackedMeshVertex vertex = UnpackMeshVertex(position, vertexBuffer.Load<MeshVertexAttributes>(vertexIndex * sizeof(MeshVertexAttributes)));
     
     Varyings varyings = (Varyings) 0;
     varyings.Color = vertex.color;
@@ -20,6 +29,7 @@ Varyings main(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID, uint
     varyings.TangentWS.xyz = normalize(mul((float3x3) instance.worldMat, vertex.tangent.xyz));
     varyings.TangentWS.w = -vertex.tangent.w;
     varyings.instanceID = instanceIndex;
+    varyings.materialIndex = drawInstance.materialIndex;
 
     return varyings;
 }
\ No newline at end of file
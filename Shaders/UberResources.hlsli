@@ -12,6 +12,7 @@ struct Varyings
     float3 Color : COLOR;
     float2 Texcoord0 : TEXCOORD0;
     uint instanceID : SV_InstanceID;
+    nointerpolation uint materialIndex : MATERIAL_INDEX;
 };
 
 SamplerState gLinearRepeatSampler : register(s0, SPACE_Persistent);
@@ -46,9 +46,10 @@ function CreateTextureRule(inRuleName, inFormat, inFlags, inInputNameSuffixes, i
     local rule =
     {
         Name = inRuleName,
-        Version = 0,
+        Version = 1,
         OutputPaths = { '{ Repo:Bin }{ Dir }{ File }.dds' },
-        CommandLine = '{ Repo:Tools }texconv/texconv.exe -y -nologo -sepalpha -dx10 ' .. inFlags .. ' -m ' .. inMipCount .. ' -f ' .. inFormat .. ' -o "{ Repo:Bin }{ Dir_NoTrailingSlash }" "{ Repo:Source }{ Path }"',
+        -- NOTE: Keep the suffixes in sync with k_TextureCookRules in Code/TextureCooker.cpp
+        CommandLine = '{ Repo:Tools }TextureCooker/TextureCooker.exe ' .. inFlags .. ' -m ' .. inMipCount .. ' -f ' .. inFormat .. ' "{ Repo:Source }{ Path }" "{ Repo:Bin }{ Dir }{ File }.dds"',
         InputFilters = {},
     }
 
@@ -63,4 +64,76 @@ end
 
 CreateTextureRule("Texture BC1 sRGB", "BC1_UNORM_SRGB", "-srgb",  { "_albedo", "_emissive" })
 CreateTextureRule("Texture BC1",      "BC1_UNORM",      "-srgb",  { "_orm" })
-CreateTextureRule("Texture BC5",      "BC5_UNORM",      "",       { "_normal" })
\ No newline at end of file
+CreateTextureRule("Texture BC5",      "BC5_UNORM",      "",       { "_normal" })
+
+-- ███╗   ███╗███████╗███████╗██╗  ██╗███████╗███████╗
+-- ████╗ ████║██╔════╝██╔════╝██║  ██║██╔════╝██╔════╝
+-- ██╔████╔██║█████╗  ███████╗███████║█████╗  ███████╗
+-- ██║╚██╔╝██║██╔══╝  ╚════██║██╔══██║██╔══╝  ╚════██║
+-- ██║ ╚═╝ ██║███████╗███████║██║  ██║███████╗███████║
+-- ╚═╝     ╚═╝╚══════╝╚══════╝╚═╝  ╚═╝╚══════╝╚══════╝
+--
+
+function CreateMeshRule(inRuleName, inInputPath)
+    local rule =
+    {
+        Name = inRuleName,
+        -- NOTE: Keep in sync with k_MeshFileVersion in Code/MeshFile.h
+        Version = 10,
+        OutputPaths = { '{ Repo:Bin }{ Dir }{ File }.mesh' },
+        CommandLine = '{ Repo:Tools }MeshCooker/MeshCooker.exe "{ Repo:Source }{ Path }" "{ Repo:Bin }{ Dir }{ File }.mesh"',
+        InputFilters = { { Repo = "Source", PathPattern = inInputPath } },
+    }
+    table.insert(Rule, rule)
+end
+
+CreateMeshRule("Mesh OBJ", "*.obj")
+
+-- ███╗   ███╗ █████╗ ████████╗███████╗██████╗ ██╗ █████╗ ██╗     ███████╗
+-- ████╗ ████║██╔══██╗╚══██╔══╝██╔════╝██╔══██╗██║██╔══██╗██║     ██╔════╝
+-- ██╔████╔██║███████║   ██║   █████╗  ██████╔╝██║███████║██║     ███████╗
+-- ██║╚██╔╝██║██╔══██║   ██║   ██╔══╝  ██╔══██╗██║██╔══██║██║     ╚════██║
+-- ██║ ╚═╝ ██║██║  ██║   ██║   ███████╗██║  ██║██║██║  ██║███████╗███████║
+-- ╚═╝     ╚═╝╚═╝  ╚═╝   ╚═╝   ╚══════╝╚═╝  ╚═╝╚═╝╚═╝  ╚═╝╚══════╝╚══════╝
+--
+
+function CreateMaterialRule(inRuleName, inInputPath)
+    local rule =
+    {
+        Name = inRuleName,
+        -- NOTE: Keep in sync with k_MaterialFileVersion in Code/MaterialFile.h
+        Version = 1,
+        OutputPaths = { '{ Repo:Bin }{ Dir }{ File }.matlib' },
+        CommandLine = '{ Repo:Tools }MaterialCooker/MaterialCooker.exe "{ Repo:Source }{ Path }" "{ Repo:Bin }{ Dir }{ File }.matlib"',
+        InputFilters = { { Repo = "Source", PathPattern = inInputPath } },
+    }
+    table.insert(Rule, rule)
+end
+
+CreateMaterialRule("Material Library", "*.materials")
+
+-- ██████╗  █████╗ ██╗  ██╗███████╗
+-- ██╔══██╗██╔══██╗██║ ██╔╝██╔════╝
+-- ██████╔╝███████║█████╔╝ ███████╗
+-- ██╔═══╝ ██╔══██║██╔═██╗ ╚════██║
+-- ██║     ██║  ██║██║  ██╗███████║
+-- ╚═╝     ╚═╝  ╚═╝╚═╝  ╚═╝╚══════╝
+--
+
+-- Packs the cooked files listed in a manifest into a single archive. The dep file lists the packed
+-- files, so the archive is packed again when one of them is cooked again.
+function CreatePakRule(inRuleName, inInputPath)
+    local rule =
+    {
+        Name = inRuleName,
+        -- NOTE: Keep in sync with k_PakFileVersion in Code/PakFile.h
+        Version = 1,
+        OutputPaths = { '{ Repo:Bin }{ Dir }{ File }.pak' },
+        CommandLine = '{ Repo:Tools }PakCooker/PakCooker.exe -c -d "{ Repo:Intermediate }{ Dir }{ File }.d" "{ Repo:Source }{ Path }" "{ Repo:Bin }." "{ Repo:Bin }{ Dir }{ File }.pak"',
+        InputFilters = { { Repo = "Source", PathPattern = inInputPath } },
+        DepFile = { Path = '{ Repo:Intermediate }{ Dir }{ File }.d', Format = 'Make' },
+    }
+    table.insert(Rule, rule)
+end
+
+CreatePakRule("Pak", "*.pakmanifest")